@@ -362,16 +362,15 @@ OutputPreviewDialog::RenderedImage OutputPreviewDialog::renderPage(const pdf::PD
     settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::ActiveColorMask, activeColorMask != pdf::PDFPixelFormat::getAllColorsMask());
     settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::SeparationSimulation, m_inkMapperForRendering.getActiveSpotColorCount() > 0);
     settings.activeColorMask = activeColorMask;
+    settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::BandParallelRendering, true);
 
     QTransform pagePointToDevicePoint = pdf::PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize));
     pdf::PDFDrawWidgetProxy* proxy = m_widget->getDrawWidgetProxy();
     pdf::PDFCMSPointer cms = proxy->getCMSManager()->getCurrentCMS();
-    pdf::PDFTransparencyRenderer renderer(page, m_document, proxy->getFontCache(), cms.data(), proxy->getOptionalContentActivity(),
-                                          &m_inkMapperForRendering, settings, pagePointToDevicePoint);
+    pdf::PDFTransparencyBandRenderer renderer(page, m_document, proxy->getFontCache(), cms.data(), proxy->getOptionalContentActivity(),
+                                              &m_inkMapperForRendering, settings, pagePointToDevicePoint);
 
-    renderer.beginPaint(imageSize);
-    result.errors = renderer.processContents();
-    renderer.endPaint();
+    result.errors = renderer.render(imageSize);
 
     QImage image = renderer.toImage(false, true, paperColor);
 
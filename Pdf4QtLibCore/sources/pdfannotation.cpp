@@ -28,6 +28,7 @@
 
 #include <QtMath>
 #include <QIcon>
+#include <QElapsedTimer>
 
 #include "pdfdbgheap.h"
 
@@ -1297,7 +1298,11 @@ PDFAnnotationManager::PDFAnnotationManager(PDFFontCache* fontCache,
     m_features(features),
     m_target(target)
 {
-
+    if (m_cmsManager)
+    {
+        // Colors are converted, when appearance streams are compiled
+        connect(m_cmsManager, &PDFCMSManager::colorManagementSystemChanged, this, &PDFAnnotationManager::invalidateCompiledAppearances);
+    }
 }
 
 PDFAnnotationManager::~PDFAnnotationManager()
@@ -1611,10 +1616,6 @@ void PDFAnnotationManager::drawAnnotationUsingAppearanceStream(const PageAnnotat
     QRectF annotationRectangle = annotation.annotation->getRectangle();
     QRectF formBoundingBox = loader.readRectangle(formDictionary->get("BBox"), QRectF());
     QTransform formMatrix = loader.readMatrixFromDictionary(formDictionary, "Matrix", QTransform());
-    QByteArray content = m_document->getDecodedStream(formStream);
-    PDFObject resources = m_document->getObject(formDictionary->get("Resources"));
-    PDFObject transparencyGroup = m_document->getObject(formDictionary->get("Group"));
-    const PDFInteger formStructuralParentKey = loader.readIntegerFromDictionary(formDictionary, "StructParent", page->getStructureParentKey());
 
     if (formBoundingBox.isEmpty() || annotationRectangle.isEmpty())
     {
@@ -1645,25 +1646,41 @@ void PDFAnnotationManager::drawAnnotationUsingAppearanceStream(const PageAnnotat
     const PDFReal translateY = annotationRectangle.bottom() - transformedAppearanceBox.bottom() * scaleY;
     QTransform A(scaleX, 0.0, 0.0, scaleY, translateX, translateY);
 
-    // Step 3) - compute final matrix AA
-    QTransform AA = formMatrix * A;
+    // Step 3) - final matrix AA = formMatrix * A is composed from compiled
+    //           appearance stream (form matrix is already applied) and
+    //           matrix A, which is applied, when appearance is drawn.
 
-    bool isContentVisible = false;
+    // Jakub Melka: we must check, that we do not display annotation disabled by optional content
+    bool isContentVisible = true;
+    PDFObjectReference oc = annotation.annotation->getOptionalContent();
+    if (oc.isValid())
+    {
+        PDFPainter pdfPainter(painter, features, userSpaceToDeviceSpace, page, m_document, m_fontCache, cms, m_optionalActivity, m_meshQualitySettings);
+        isContentVisible = !pdfPainter.isContentSuppressedByOC(oc);
+    }
 
     // Draw annotation
+    if (isContentVisible)
     {
-        PDFPainterStateGuard guard(painter);
-        PDFPainter pdfPainter(painter, features, userSpaceToDeviceSpace, page, m_document, m_fontCache, cms, m_optionalActivity, m_meshQualitySettings);
-        pdfPainter.initializeProcessor();
+        std::shared_ptr<const PDFPrecompiledPage> compiledAppearance = getCompiledAppearance(annotation, formStream, page, cms);
 
-        // Jakub Melka: we must check, that we do not display annotation disabled by optional content
-        PDFObjectReference oc = annotation.annotation->getOptionalContent();
-        isContentVisible = !oc.isValid() || !pdfPainter.isContentSuppressedByOC(oc);
+        PDFPainterStateGuard guard(painter);
 
-        if (isContentVisible)
+        // Crop box is in the user space, not in the appearance space,
+        // so we must clip to crop box here.
+        if (features.testFlag(PDFRenderer::ClipToCropBox))
         {
-            pdfPainter.processForm(AA, formBoundingBox, resources, transparencyGroup, content, formStructuralParentKey);
+            QRectF cropBox = page->getCropBox();
+            if (cropBox.isValid())
+            {
+                QPainterPath path;
+                path.addPolygon(userSpaceToDeviceSpace.map(cropBox));
+                painter->setClipPath(path, Qt::IntersectClip);
+            }
+            features.setFlag(PDFRenderer::ClipToCropBox, false);
         }
+
+        compiledAppearance->draw(painter, QRectF(), A * userSpaceToDeviceSpace, features, painter->opacity(), PDFColorConvertor());
     }
 
     // Draw highlighting of fields, but only, if target is View,
@@ -1677,6 +1694,48 @@ void PDFAnnotationManager::drawAnnotationUsingAppearanceStream(const PageAnnotat
     }
 }
 
+std::shared_ptr<const PDFPrecompiledPage> PDFAnnotationManager::getCompiledAppearance(const PageAnnotation& annotation,
+                                                                                      const PDFStream* formStream,
+                                                                                      const PDFPage* page,
+                                                                                      const PDFCMS* cms) const
+{
+    const PDFAppeareanceStreams::Appearance appearance = annotation.appearance;
+
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = annotation.compiledAppearances.find(appearance);
+        if (it != annotation.compiledAppearances.cend())
+        {
+            return it->second;
+        }
+    }
+
+    // Compile the appearance stream without the lock, so threads
+    // drawing another annotations do not wait for each other.
+    QElapsedTimer timer;
+    timer.start();
+
+    PDFDocumentDataLoaderDecorator loader(m_document);
+    const PDFDictionary* formDictionary = formStream->getDictionary();
+    QRectF formBoundingBox = loader.readRectangle(formDictionary->get("BBox"), QRectF());
+    QTransform formMatrix = loader.readMatrixFromDictionary(formDictionary, "Matrix", QTransform());
+    QByteArray content = m_document->getDecodedStream(formStream);
+    PDFObject resources = m_document->getObject(formDictionary->get("Resources"));
+    PDFObject transparencyGroup = m_document->getObject(formDictionary->get("Group"));
+    const PDFInteger formStructuralParentKey = loader.readIntegerFromDictionary(formDictionary, "StructParent", page->getStructureParentKey());
+
+    std::shared_ptr<PDFPrecompiledPage> compiledAppearance = std::make_shared<PDFPrecompiledPage>();
+    PDFPrecompiledPageGenerator generator(compiledAppearance.get(), m_features, page, m_document, m_fontCache, cms, m_optionalActivity, m_meshQualitySettings);
+    generator.initializeProcessor();
+    generator.processForm(formMatrix, formBoundingBox, resources, transparencyGroup, content, formStructuralParentKey);
+    compiledAppearance->optimize();
+    compiledAppearance->finalize(timer.nsecsElapsed(), QList<PDFRenderError>());
+
+    QMutexLocker lock(&m_mutex);
+    annotation.compiledAppearances[appearance] = compiledAppearance;
+    return compiledAppearance;
+}
+
 void PDFAnnotationManager::setDocument(const PDFModifiedDocument& document)
 {
     if (m_document != document)
@@ -1688,6 +1747,12 @@ void PDFAnnotationManager::setDocument(const PDFModifiedDocument& document)
         {
             m_pageAnnotations.clear();
         }
+        else
+        {
+            // Appearance streams can be changed (for example, when form field value
+            // has been changed), so we must compile them again.
+            invalidateCompiledAppearances();
+        }
     }
 }
 
@@ -1715,7 +1780,10 @@ PDFAnnotationManager::PageAnnotations& PDFAnnotationManager::getPageAnnotations(
     auto it = m_pageAnnotations.find(pageIndex);
     if (it == m_pageAnnotations.cend())
     {
-        // Create page annotations
+        // Create page annotations. Parsing is done without the lock,
+        // so threads drawing different pages do not wait for each other.
+        lock.unlock();
+
         const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
         Q_ASSERT(page);
 
@@ -1734,6 +1802,9 @@ PDFAnnotationManager::PageAnnotations& PDFAnnotationManager::getPageAnnotations(
             }
         }
 
+        // If another thread parsed the same page in the meantime,
+        // then its annotations are used and ours are discarded.
+        lock.relock();
         it = m_pageAnnotations.insert(std::make_pair(pageIndex, qMove(annotations))).first;
     }
 
@@ -1769,6 +1840,18 @@ bool PDFAnnotationManager::hasAnyPageAnnotation() const
     return false;
 }
 
+void PDFAnnotationManager::invalidateCompiledAppearances()
+{
+    QMutexLocker lock(&m_mutex);
+    for (auto& pageAnnotations : m_pageAnnotations)
+    {
+        for (const PageAnnotation& annotation : pageAnnotations.second.annotations)
+        {
+            annotation.compiledAppearances.clear();
+        }
+    }
+}
+
 PDFFormManager* PDFAnnotationManager::getFormManager() const
 {
     return m_formManager;
@@ -1786,7 +1869,11 @@ PDFRenderer::Features PDFAnnotationManager::getFeatures() const
 
 void PDFAnnotationManager::setFeatures(PDFRenderer::Features features)
 {
-    m_features = features;
+    if (m_features != features)
+    {
+        m_features = features;
+        invalidateCompiledAppearances();
+    }
 }
 
 PDFMeshQualitySettings PDFAnnotationManager::getMeshQualitySettings() const
@@ -1797,6 +1884,7 @@ PDFMeshQualitySettings PDFAnnotationManager::getMeshQualitySettings() const
 void PDFAnnotationManager::setMeshQualitySettings(const PDFMeshQualitySettings& meshQualitySettings)
 {
     m_meshQualitySettings = meshQualitySettings;
+    invalidateCompiledAppearances();
 }
 
 PDFFontCache* PDFAnnotationManager::getFontCache() const
@@ -1816,7 +1904,11 @@ const PDFOptionalContentActivity* PDFAnnotationManager::getOptionalActivity() co
 
 void PDFAnnotationManager::setOptionalActivity(const PDFOptionalContentActivity* optionalActivity)
 {
-    m_optionalActivity = optionalActivity;
+    if (m_optionalActivity != optionalActivity)
+    {
+        m_optionalActivity = optionalActivity;
+        invalidateCompiledAppearances();
+    }
 }
 
 PDFAnnotationManager::Target PDFAnnotationManager::getTarget() const
@@ -1507,6 +1507,10 @@ public:
 
         /// This mutable appearance stream is protected by main mutex
         mutable PDFCachedItem<PDFObject> appearanceStream;
+
+        /// Compiled appearance streams for each appearance, protected by main mutex.
+        /// Appearance stream is compiled, when it is drawn for the first time.
+        mutable std::map<PDFAppeareanceStreams::Appearance, std::shared_ptr<const PDFPrecompiledPage>> compiledAppearances;
     };
 
     struct PDF4QTLIBCORESHARED_EXPORT PageAnnotations
@@ -1564,6 +1568,10 @@ public:
     /// Returns true, if any page in the document has annotation
     bool hasAnyPageAnnotation() const;
 
+    /// Invalidates compiled appearance streams of all annotations, so they
+    /// are compiled again, when they are drawn next time.
+    void invalidateCompiledAppearances();
+
 protected:
     void drawWidgetAnnotationHighlight(QRectF annotationRectangle,
                                        const PDFAnnotation* annotation,
@@ -1623,6 +1631,19 @@ protected:
                                              const PDFCMS* cms,
                                              QPainter* painter) const;
 
+    /// Returns compiled appearance stream of the annotation. Appearance stream
+    /// is compiled in the space of transformed appearance box (i.e. the form
+    /// matrix is applied), so compiled stream doesn't depend on annotation
+    /// placement. If it is not cached yet, then it is compiled and cached.
+    /// \param annotation Page annotation
+    /// \param formStream Appearance stream
+    /// \param page Page
+    /// \param cms Color management system
+    std::shared_ptr<const PDFPrecompiledPage> getCompiledAppearance(const PageAnnotation& annotation,
+                                                                    const PDFStream* formStream,
+                                                                    const PDFPage* page,
+                                                                    const PDFCMS* cms) const;
+
     const PDFDocument* m_document;
 
     PDFFontCache* m_fontCache;
@@ -17,6 +17,9 @@
 
 #include "pdfblpainter.h"
 #include "pdffont.h"
+#include "pdfpainter.h"
+#include "pdfcolorconvertor.h"
+#include "pdfpainterutils.h"
 
 #include <QThread>
 #include <QRawFont>
@@ -24,6 +27,8 @@
 #include <QPaintEngine>
 #include <QPainterPathStroker>
 
+#include <stack>
+
 #ifdef Q_OS_WIN
 #include <Blend2d.h>
 #else
@@ -33,10 +38,54 @@
 namespace pdf
 {
 
+/// Fill or stroke style of the Blend2D context (solid color, gradient
+/// or pattern), converted from the brush.
+class PDFBLStyle
+{
+public:
+    explicit PDFBLStyle() = default;
+
+    /// Creates style from the brush. If brush can't be converted,
+    /// then style is invalid and it is not applied to the context.
+    /// \param brush Brush
+    static PDFBLStyle create(const QBrush& brush);
+
+    /// Creates solid color style
+    /// \param color Color
+    static PDFBLStyle create(QColor color);
+
+    /// Sets style as fill style of the context
+    void applyFill(BLContext& context) const;
+
+    /// Sets style as stroke style of the context
+    void applyStroke(BLContext& context) const;
+
+    /// Returns memory consumption estimate (including gradient
+    /// stops and pattern image)
+    qint64 getMemoryConsumptionEstimate() const { return sizeof(PDFBLStyle) + m_dataMemoryConsumptionEstimate; }
+
+private:
+    enum class Type
+    {
+        Invalid,
+        Solid,
+        Gradient,
+        Pattern
+    };
+
+    Type m_type = Type::Invalid;
+    BLRgba32 m_color;
+    BLGradient m_gradient;
+    BLPattern m_pattern;
+    qint64 m_dataMemoryConsumptionEstimate = 0;
+};
+
 class PDFBLPaintEngine : public QPaintEngine
 {
+    friend class PDFBLPageRenderer;
+
 public:
-    explicit PDFBLPaintEngine(QImage& qtOffscreenBuffer, bool isMultithreaded);
+    explicit PDFBLPaintEngine(QImage& qtOffscreenBuffer, bool isMultithreaded, bool isClearedOnBegin);
 
     virtual bool begin(QPaintDevice*) override;
     virtual bool end() override;
@@ -77,6 +126,9 @@ private:
     /// Get BL path from path
     static BLPath getBLPath(const QPainterPath& path);
 
+    /// Get stroke options (width, caps, joins and dashes) from pen
+    static BLStrokeOptions getBLStrokeOptions(const QPen& pen);
+
     /// Set pen to the context
     static void setBLPen(BLContext& context, const QPen& pen);
 
@@ -117,6 +169,7 @@ private:
     std::optional<BLContext> m_blContext;
     std::optional<BLImage> m_blOffscreenBuffer;
     bool m_isMultithreaded;
+    bool m_isClearedOnBegin;
 
     QPen m_currentPen;
     QBrush m_currentBrush;
@@ -130,9 +183,146 @@ private:
     QRectF m_finalClipPathBoundingBox;
 };
 
-PDFBLPaintDevice::PDFBLPaintDevice(QImage& offscreenBuffer, bool isMultithreaded) :
+PDFBLStyle PDFBLStyle::create(const QBrush& brush)
+{
+    auto setGradientStops = [](BLGradient& blGradient, const auto& qGradient)
+    {
+        QVector<BLGradientStop> stops;
+        for (const auto& stop : qGradient.stops())
+        {
+            stops.append(BLGradientStop(stop.first, BLRgba32(stop.second.red(), stop.second.green(), stop.second.blue(), stop.second.alpha())));
+        }
+        blGradient.assignStops(stops.constData(), stops.size());
+        return qint64(stops.size() * sizeof(BLGradientStop));
+    };
+
+    PDFBLStyle style;
+
+    switch (brush.style())
+    {
+        default:
+        case Qt::SolidPattern:
+        {
+            style = create(brush.color());
+            break;
+        }
+        case Qt::LinearGradientPattern:
+        {
+            const QGradient* gradient = brush.gradient();
+            if (gradient && gradient->type() == QGradient::LinearGradient)
+            {
+                const QLinearGradient* linearGradient = static_cast<const QLinearGradient*>(gradient);
+                BLLinearGradientValues blLinearGradient;
+                blLinearGradient.x0 = linearGradient->start().x();
+                blLinearGradient.y0 = linearGradient->start().y();
+                blLinearGradient.x1 = linearGradient->finalStop().x();
+                blLinearGradient.y1 = linearGradient->finalStop().y();
+                style.m_type = Type::Gradient;
+                style.m_gradient = BLGradient(blLinearGradient);
+                style.m_dataMemoryConsumptionEstimate = setGradientStops(style.m_gradient, *gradient);
+            }
+            break;
+        }
+        case Qt::RadialGradientPattern:
+        {
+            const QGradient* gradient = brush.gradient();
+            if (gradient && gradient->type() == QGradient::RadialGradient)
+            {
+                const QRadialGradient* radialGradient = static_cast<const QRadialGradient*>(gradient);
+                BLRadialGradientValues blRadialGradientValues;
+                blRadialGradientValues.x0 = radialGradient->center().x();
+                blRadialGradientValues.y0 = radialGradient->center().y();
+                blRadialGradientValues.x1 = radialGradient->focalPoint().x();
+                blRadialGradientValues.y1 = radialGradient->focalPoint().y();
+                blRadialGradientValues.r0 = radialGradient->radius();
+                style.m_type = Type::Gradient;
+                style.m_gradient = BLGradient(blRadialGradientValues);
+                style.m_dataMemoryConsumptionEstimate = setGradientStops(style.m_gradient, *gradient);
+            }
+            break;
+        }
+        case Qt::TexturePattern:
+        {
+            QImage image = brush.textureImage();
+
+            if (image.format() != QImage::Format_ARGB32_Premultiplied)
+            {
+                image.convertTo(QImage::Format_ARGB32_Premultiplied);
+            }
+
+            BLImage blImage;
+            blImage.createFromData(image.width(), image.height(), BL_FORMAT_PRGB32, image.bits(), image.bytesPerLine());
+
+            BLImage blPatternImage;
+            blPatternImage.assignDeep(blImage);
+
+            style.m_type = Type::Pattern;
+            style.m_pattern = BLPattern(blPatternImage, BL_EXTEND_MODE_REPEAT);
+            style.m_dataMemoryConsumptionEstimate = image.sizeInBytes();
+            const QTransform transform = brush.transform();
+            BLMatrix2D matrix;
+            matrix.reset(transform.m11(), transform.m12(), transform.m21(), transform.m22(), transform.dx(), transform.dy());
+            style.m_pattern.setTransform(matrix);
+            break;
+        }
+    }
+
+    return style;
+}
+
+PDFBLStyle PDFBLStyle::create(QColor color)
+{
+    PDFBLStyle style;
+    style.m_type = Type::Solid;
+    style.m_color = BLRgba32(color.red(), color.green(), color.blue(), color.alpha());
+    return style;
+}
+
+void PDFBLStyle::applyFill(BLContext& context) const
+{
+    switch (m_type)
+    {
+        case Type::Invalid:
+            break;
+
+        case Type::Solid:
+            context.setFillStyle(m_color);
+            break;
+
+        case Type::Gradient:
+            context.setFillStyle(m_gradient);
+            break;
+
+        case Type::Pattern:
+            context.setFillStyle(m_pattern);
+            break;
+    }
+}
+
+void PDFBLStyle::applyStroke(BLContext& context) const
+{
+    switch (m_type)
+    {
+        case Type::Invalid:
+            break;
+
+        case Type::Solid:
+            context.setStrokeStyle(m_color);
+            break;
+
+        case Type::Gradient:
+            context.setStrokeStyle(m_gradient);
+            break;
+
+        case Type::Pattern:
+            context.setStrokeStyle(m_pattern);
+            break;
+    }
+}
+
+PDFBLPaintDevice::PDFBLPaintDevice(QImage& offscreenBuffer, bool isMultithreaded, bool isClearedOnBegin) :
     m_offscreenBuffer(offscreenBuffer),
-    m_paintEngine(new PDFBLPaintEngine(offscreenBuffer, isMultithreaded))
+    m_paintEngine(new PDFBLPaintEngine(offscreenBuffer, isMultithreaded, isClearedOnBegin))
 {
 
 }
@@ -194,10 +384,11 @@ int PDFBLPaintDevice::metric(PaintDeviceMetric metric) const
     return 0;
 }
 
-PDFBLPaintEngine::PDFBLPaintEngine(QImage& qtOffscreenBuffer, bool isMultithreaded) :
+PDFBLPaintEngine::PDFBLPaintEngine(QImage& qtOffscreenBuffer, bool isMultithreaded, bool isClearedOnBegin) :
     QPaintEngine(getStaticFeatures()),
     m_qtOffscreenBuffer(qtOffscreenBuffer),
-    m_isMultithreaded(isMultithreaded)
+    m_isMultithreaded(isMultithreaded),
+    m_isClearedOnBegin(isClearedOnBegin)
 {
 
 }
@@ -225,7 +416,10 @@ bool PDFBLPaintEngine::begin(QPaintDevice*)
     m_blOffscreenBuffer->createFromData(m_qtOffscreenBuffer.width(), m_qtOffscreenBuffer.height(), BL_FORMAT_PRGB32, m_qtOffscreenBuffer.bits(), m_qtOffscreenBuffer.bytesPerLine());
     if (m_blContext->begin(m_blOffscreenBuffer.value(), info) == BL_SUCCESS)
     {
-        m_blContext->clearAll();
+        if (m_isClearedOnBegin)
+        {
+            m_blContext->clearAll();
+        }
 
         qreal devicePixelRatio = m_qtOffscreenBuffer.devicePixelRatioF();
         m_blContext->scale(devicePixelRatio);
@@ -788,7 +982,7 @@ QPaintEngine::Type PDFBLPaintEngine::type() const
 
 QPaintEngine::PaintEngineFeatures PDFBLPaintEngine::getStaticFeatures()
 {
-    return PrimitiveTransform | PixmapTransform | LinearGradientFill |
+    return PrimitiveTransform | PatternTransform | PixmapTransform | LinearGradientFill |
            RadialGradientFill | ConicalGradientFill | AlphaBlend |
            PorterDuff | PainterPaths | Antialiasing | ConstantOpacity |
            BlendModes | PaintOutsidePaintEvent;
@@ -859,64 +1053,57 @@ BLPath PDFBLPaintEngine::getBLPath(const QPainterPath& path)
     return blPath;
 }
 
-void PDFBLPaintEngine::setBLPen(BLContext& context, const QPen& pen)
+BLStrokeOptions PDFBLPaintEngine::getBLStrokeOptions(const QPen& pen)
 {
     const Qt::PenCapStyle capStyle = pen.capStyle();
     const Qt::PenJoinStyle joinStyle = pen.joinStyle();
-    const QColor color = pen.color();
-    const qreal width = pen.widthF();
-    const qreal miterLimit = pen.miterLimit();
-    const qreal dashOffset = pen.dashOffset();
     const QList<qreal> customDashPattern = pen.dashPattern();
     const Qt::PenStyle penStyle = pen.style();
 
-    context.setStrokeAlpha(pen.color().alphaF());
-    context.setStrokeWidth(width);
-    context.setStrokeMiterLimit(miterLimit);
+    BLStrokeOptions strokeOptions;
+    strokeOptions.width = pen.widthF();
+    strokeOptions.miterLimit = pen.miterLimit();
 
     switch (capStyle)
     {
     case Qt::FlatCap:
-        context.setStrokeCaps(BL_STROKE_CAP_BUTT);
+        strokeOptions.setCaps(BL_STROKE_CAP_BUTT);
         break;
     case Qt::SquareCap:
-        context.setStrokeCaps(BL_STROKE_CAP_SQUARE);
+        strokeOptions.setCaps(BL_STROKE_CAP_SQUARE);
         break;
     case Qt::RoundCap:
-        context.setStrokeCaps(BL_STROKE_CAP_ROUND);
+        strokeOptions.setCaps(BL_STROKE_CAP_ROUND);
+        break;
+    default:
         break;
     }
 
-    BLArray<double> dashArray;
-
     for (double value : customDashPattern)
     {
-        dashArray.append(value);
+        strokeOptions.dashArray.append(value);
     }
 
-    context.setStrokeDashOffset(dashOffset);
-    context.setStrokeDashArray(dashArray);
+    strokeOptions.dashOffset = pen.dashOffset();
 
     switch (joinStyle)
     {
     case Qt::MiterJoin:
-        context.setStrokeJoin(BL_STROKE_JOIN_MITER_CLIP);
+        strokeOptions.join = BL_STROKE_JOIN_MITER_CLIP;
         break;
     case Qt::BevelJoin:
-        context.setStrokeJoin(BL_STROKE_JOIN_BEVEL);
+        strokeOptions.join = BL_STROKE_JOIN_BEVEL;
         break;
     case Qt::RoundJoin:
-        context.setStrokeJoin(BL_STROKE_JOIN_ROUND);
+        strokeOptions.join = BL_STROKE_JOIN_ROUND;
         break;
     case Qt::SvgMiterJoin:
-        context.setStrokeJoin(BL_STROKE_JOIN_MITER_CLIP);
+        strokeOptions.join = BL_STROKE_JOIN_MITER_CLIP;
+        break;
+    default:
         break;
     }
 
-    context.setStrokeStyle(BLRgba32(color.rgba()));
-
-    BLStrokeOptions strokeOptions = context.strokeOptions();
-
     switch (penStyle)
     {
     case Qt::SolidLine:
@@ -964,67 +1151,19 @@ void PDFBLPaintEngine::setBLPen(BLContext& context, const QPen& pen)
         break;
     }
 
-    context.setStrokeOptions(strokeOptions);
+    return strokeOptions;
 }
 
-void PDFBLPaintEngine::setBLBrush(BLContext& context, const QBrush& brush)
+void PDFBLPaintEngine::setBLPen(BLContext& context, const QPen& pen)
 {
-    auto setGradientStops = [](BLGradient& blGradient, const auto& qGradient)
-    {
-        QVector<BLGradientStop> stops;
-        for (const auto& stop : qGradient.stops())
-        {
-            stops.append(BLGradientStop(stop.first, BLRgba32(stop.second.red(), stop.second.green(), stop.second.blue(), stop.second.alpha())));
-        }
-        blGradient.assignStops(stops.constData(), stops.size());
-    };
+    context.setStrokeAlpha(pen.color().alphaF());
+    context.setStrokeOptions(getBLStrokeOptions(pen));
+    context.setStrokeStyle(BLRgba32(pen.color().rgba()));
+}
 
-    switch (brush.style())
-    {
-        default:
-        case Qt::SolidPattern:
-        {
-            QColor color = brush.color();
-            BLRgba32 blColor = BLRgba32(color.red(), color.green(), color.blue(), color.alpha());
-            context.setFillStyle(blColor);
-            break;
-        }
-        case Qt::LinearGradientPattern:
-        {
-            const QGradient* gradient = brush.gradient();
-            if (gradient && gradient->type() == QGradient::LinearGradient)
-            {
-                const QLinearGradient* linearGradient = static_cast<const QLinearGradient*>(gradient);
-                BLLinearGradientValues blLinearGradient;
-                blLinearGradient.x0 = linearGradient->start().x();
-                blLinearGradient.y0 = linearGradient->start().y();
-                blLinearGradient.x1 = linearGradient->finalStop().x();
-                blLinearGradient.y1 = linearGradient->finalStop().y();
-                BLGradient blGradient(blLinearGradient);
-                setGradientStops(blGradient, *gradient);
-                context.setFillStyle(blGradient);
-            }
-            break;
-        }
-        case Qt::RadialGradientPattern:
-        {
-            const QGradient* gradient = brush.gradient();
-            if (gradient && gradient->type() == QGradient::RadialGradient)
-            {
-                const QRadialGradient* radialGradient = static_cast<const QRadialGradient*>(gradient);
-                BLRadialGradientValues blRadialGradientValues;
-                blRadialGradientValues.x0 = radialGradient->center().x();
-                blRadialGradientValues.y0 = radialGradient->center().y();
-                blRadialGradientValues.x1 = radialGradient->focalPoint().x();
-                blRadialGradientValues.y1 = radialGradient->focalPoint().y();
-                blRadialGradientValues.r0 = radialGradient->radius();
-                BLGradient blGradient(blRadialGradientValues);
-                setGradientStops(blGradient, *gradient);
-                context.setFillStyle(blGradient);
-            }
-            break;
-        }
-    }
+void PDFBLPaintEngine::setBLBrush(BLContext& context, const QBrush& brush)
+{
+    PDFBLStyle::create(brush).applyFill(context);
 }
 
 bool PDFBLPaintEngine::loadBLFont(BLFont& font, QString fontName, PDFReal fontSize)
@@ -1310,4 +1449,593 @@ void PDFBLPaintEngine::setFillRule(Qt::FillRule fillRule)
     m_blContext->setFillRule(blFillRule);
 }
 
+/// Blend2D objects of the precompiled page. Geometry doesn't depend on the color
+/// convertor, so it is created only once. Colors (styles, images and meshes) are
+/// created for the last used color convertor. Objects are never modified, when
+/// they are created, so they can be used by more threads at once.
+class PDFBLPageCache
+{
+public:
+    struct Path
+    {
+        BLPath path;
+        BLFillRule fillRule = BL_FILL_RULE_NON_ZERO;
+        BLStrokeOptions strokeOptions;
+        bool isFilled = false;
+        bool isStroked = false;
+    };
+
+    struct Colors
+    {
+        PDFColorConvertor colorConvertor;
+        std::vector<PDFBLStyle> fillStyles;
+        std::vector<PDFBLStyle> strokeStyles;
+        std::vector<QImage> sourceImages;   ///< Images, data of 32-bit images are referenced by Blend2D images
+        std::vector<BLImage> images;        ///< Blend2D images (empty, if image is converted, when it is drawn)
+        std::vector<PDFMesh> meshes;        ///< Converted meshes (empty, if colors are not converted)
+        qint64 memoryConsumptionEstimate = 0;
+    };
+
+    std::vector<Path> paths;
+    std::shared_ptr<const Colors> colors;
+    qint64 pathsMemoryConsumptionEstimate = 0;
+};
+
+/// Images with less pixels are not cached in 32-bit format, they are converted, when drawn
+static constexpr qsizetype BL_SMALL_IMAGE_PIXEL_COUNT = 64 * 64;
+
+/// Creates Blend2D image in premultiplied format, which owns its data,
+/// so it can be used by asynchronous Blend2D context.
+/// \param image Image in arbitrary format
+static BLImage createBLImageCopy(const QImage& image)
+{
+    BLImage blImage;
+    BLImageData blImageData;
+    if (blImage.create(image.width(), image.height(), BL_FORMAT_PRGB32) != BL_SUCCESS ||
+        blImage.makeMutable(&blImageData) != BL_SUCCESS)
+    {
+        return BLImage();
+    }
+
+    QImage targetImage(static_cast<uchar*>(blImageData.pixelData), image.width(), image.height(), blImageData.stride, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&targetImage);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(0, 0, image);
+    painter.end();
+
+    return blImage;
+}
+
+struct PDFBLPageRenderer::CacheSnapshot
+{
+    std::shared_ptr<const PDFBLPageCache> cache;
+    std::shared_ptr<const PDFBLPageCache::Colors> colors;
+};
+
+struct PDFBLPageRenderer::Context
+{
+    struct State
+    {
+        QTransform worldMatrix;
+        std::optional<QPainterPath> clipPath;   ///< Clipping path in device space
+        QRectF clipBoundingBox;
+        bool isClipComplex = false;             ///< Clipping path isn't a single rectangle
+        QPainter::CompositionMode compositionMode = QPainter::CompositionMode_SourceOver;
+    };
+
+    QImage* image = nullptr;
+    BLContext blContext;
+    PDFReal opacity = 1.0;
+    PDFColorConvertor colorConvertor;
+    State state;
+    std::stack<State> stateStack;
+};
+
+bool PDFBLPageRenderer::draw(QImage& image,
+                             const PDFPrecompiledPage* page,
+                             const QRectF& cropBox,
+                             const QTransform& pagePointToDevicePointMatrix,
+                             PDFRenderer::Features features,
+                             PDFReal opacity,
+                             const PDFColorConvertor& colorConvertor,
+                             bool isMultithreaded,
+                             bool isClearedOnBegin)
+{
+    Q_ASSERT(page);
+    Q_ASSERT(pagePointToDevicePointMatrix.isInvertible());
+    Q_ASSERT(image.format() == QImage::Format_ARGB32_Premultiplied);
+
+    Context context;
+    context.image = &image;
+    context.opacity = opacity;
+    context.colorConvertor = colorConvertor;
+
+    BLImage blImage;
+    blImage.createFromData(image.width(), image.height(), BL_FORMAT_PRGB32, image.bits(), image.bytesPerLine());
+
+    BLContextCreateInfo info{};
+
+    if (isMultithreaded)
+    {
+        info.flags = BL_CONTEXT_CREATE_FLAG_FALLBACK_TO_SYNC;
+        info.threadCount = QThread::idealThreadCount();
+    }
+
+    if (context.blContext.begin(blImage, info) != BL_SUCCESS)
+    {
+        return false;
+    }
+
+    const bool isSmoothImages = features.testFlag(PDFRenderer::SmoothImages);
+    context.blContext.setHint(BL_CONTEXT_HINT_RENDERING_QUALITY, BL_RENDERING_QUALITY_MAX_VALUE);
+    context.blContext.setHint(BL_CONTEXT_HINT_PATTERN_QUALITY, isSmoothImages ? BL_PATTERN_QUALITY_BILINEAR : BL_PATTERN_QUALITY_NEAREST);
+    if (isClearedOnBegin)
+    {
+        context.blContext.clearAll();
+    }
+
+    context.blContext.scale(image.devicePixelRatioF());
+    context.blContext.userToMeta();
+    context.blContext.setGlobalAlpha(opacity);
+
+    if (features.testFlag(PDFRenderer::ClipToCropBox) && cropBox.isValid())
+    {
+        QPainterPath path;
+        path.addPolygon(pagePointToDevicePointMatrix.map(cropBox));
+        applyClipPath(context, qMove(path));
+    }
+
+    drawInstructions(context, page, pagePointToDevicePointMatrix);
+
+    context.blContext.end();
+    return true;
+}
+
+PDFBLPageRenderer::CacheSnapshot PDFBLPageRenderer::getCache(const PDFPrecompiledPage* page, const PDFColorConvertor& colorConvertor)
+{
+    QMutexLocker lock(&page->m_nativeCache.mutex);
+
+    std::shared_ptr<PDFBLPageCache>& cache = page->m_nativeCache.data;
+    if (!cache)
+    {
+        cache = std::make_shared<PDFBLPageCache>();
+        cache->paths.reserve(page->m_paths.size());
+
+        for (const PDFPrecompiledPage::PathPaintData& pathData : page->m_paths)
+        {
+            PDFBLPageCache::Path path;
+            path.path = PDFBLPaintEngine::getBLPath(pathData.path);
+            path.fillRule = (pathData.path.fillRule() == Qt::OddEvenFill) ? BL_FILL_RULE_EVEN_ODD : BL_FILL_RULE_NON_ZERO;
+            path.isFilled = pathData.brush.style() != Qt::NoBrush;
+            path.isStroked = pathData.pen.style() != Qt::NoPen;
+
+            if (path.isStroked)
+            {
+                path.strokeOptions = PDFBLPaintEngine::getBLStrokeOptions(pathData.pen);
+            }
+
+            cache->pathsMemoryConsumptionEstimate += sizeof(PDFBLPageCache::Path) + path.path.capacity() * (sizeof(BLPoint) + sizeof(uint8_t));
+            cache->paths.emplace_back(qMove(path));
+        }
+    }
+
+    if (!cache->colors || cache->colors->colorConvertor != colorConvertor)
+    {
+        const bool isColorConverted = colorConvertor.isActive();
+
+        auto colors = std::make_shared<PDFBLPageCache::Colors>();
+        colors->colorConvertor = colorConvertor;
+        colors->fillStyles.reserve(page->m_paths.size());
+        colors->strokeStyles.reserve(page->m_paths.size());
+        colors->sourceImages.reserve(page->m_images.size());
+        colors->images.reserve(page->m_images.size());
+
+        for (const PDFPrecompiledPage::PathPaintData& pathData : page->m_paths)
+        {
+            if (isColorConverted)
+            {
+                const QPen pen = pathData.pen.style() != Qt::NoPen ? colorConvertor.convert(pathData.pen, false, pathData.isText) : pathData.pen;
+                colors->fillStyles.emplace_back(PDFBLStyle::create(PDFPrecompiledPage::convertBrush(pathData.brush, colorConvertor, pathData.isText)));
+                colors->strokeStyles.emplace_back(PDFBLStyle::create(pen.color()));
+            }
+            else
+            {
+                colors->fillStyles.emplace_back(PDFBLStyle::create(pathData.brush));
+                colors->strokeStyles.emplace_back(PDFBLStyle::create(pathData.pen.color()));
+            }
+
+            colors->memoryConsumptionEstimate += colors->fillStyles.back().getMemoryConsumptionEstimate();
+            colors->memoryConsumptionEstimate += colors->strokeStyles.back().getMemoryConsumptionEstimate();
+        }
+
+        for (const PDFPrecompiledPage::ImageData& imageData : page->m_images)
+        {
+            QImage image = isColorConverted ? colorConvertor.convert(imageData.image) : imageData.image;
+
+            // Bilevel, indexed and grayscale images and small images are kept in their format
+            // and they are converted, when they are drawn. Other images are cached in the
+            // format, which Blend2D can use directly.
+            const bool isConvertedOnDraw = image.depth() < 32 || qsizetype(image.width()) * image.height() <= BL_SMALL_IMAGE_PIXEL_COUNT;
+            BLImage blImage;
+
+            if (image.format() == QImage::Format_RGB32)
+            {
+                // Image data are shared with the page, they are never modified
+                blImage.createFromData(image.width(), image.height(), BL_FORMAT_XRGB32, const_cast<uchar*>(image.constBits()), image.bytesPerLine());
+            }
+            else if (image.format() == QImage::Format_ARGB32_Premultiplied || !isConvertedOnDraw)
+            {
+                if (image.format() != QImage::Format_ARGB32_Premultiplied)
+                {
+                    image.convertTo(QImage::Format_ARGB32_Premultiplied);
+                }
+
+                // Image data are shared with the page, they are never modified
+                blImage.createFromData(image.width(), image.height(), BL_FORMAT_PRGB32, const_cast<uchar*>(image.constBits()), image.bytesPerLine());
+            }
+
+            // Only images, which were converted, occupy memory not shared with the page
+            if (image.constBits() != imageData.image.constBits())
+            {
+                colors->memoryConsumptionEstimate += image.sizeInBytes();
+            }
+            colors->memoryConsumptionEstimate += sizeof(QImage) + sizeof(BLImage);
+
+            colors->sourceImages.emplace_back(qMove(image));
+            colors->images.emplace_back(qMove(blImage));
+        }
+
+        if (isColorConverted)
+        {
+            colors->meshes.reserve(page->m_meshes.size());
+            for (const PDFPrecompiledPage::MeshPaintData& meshData : page->m_meshes)
+            {
+                PDFMesh mesh = meshData.mesh;
+                mesh.convertColors(colorConvertor);
+                colors->memoryConsumptionEstimate += mesh.getMemoryConsumptionEstimate();
+                colors->meshes.emplace_back(qMove(mesh));
+            }
+        }
+
+        cache->colors = qMove(colors);
+        page->m_nativeCache.memoryConsumptionEstimate = cache->pathsMemoryConsumptionEstimate + cache->colors->memoryConsumptionEstimate;
+    }
+
+    CacheSnapshot snapshot;
+    snapshot.cache = cache;
+    snapshot.colors = cache->colors;
+    return snapshot;
+}
+
+void PDFBLPageRenderer::applyClipPath(Context& context, QPainterPath clipPath)
+{
+    if (std::optional<QRectF> clipRect = PDFPainterHelper::getRectangle(clipPath))
+    {
+        applyClipRect(context, *clipRect);
+        return;
+    }
+
+    Context::State& state = context.state;
+
+    if (state.clipPath.has_value())
+    {
+        clipPath = state.clipPath->intersected(clipPath);
+    }
+
+    state.clipPath = qMove(clipPath);
+    std::optional<QRectF> clipRect = PDFPainterHelper::getRectangle(*state.clipPath);
+    state.clipBoundingBox = clipRect.has_value() ? *clipRect : state.clipPath->controlPointRect();
+
+    // Blend2D can clip only to rectangles. Other clipping paths are resolved
+    // by intersection with painted graphics, bounding box of the clipping
+    // path is still used to clip in Blend2D.
+    state.isClipComplex = !clipRect.has_value();
+
+    BLMatrix2D matrix = context.blContext.userTransform();
+    context.blContext.resetTransform();
+    context.blContext.clipToRect(PDFBLPaintEngine::getBLRect(state.clipBoundingBox));
+    context.blContext.setTransform(matrix);
+}
+
+void PDFBLPageRenderer::applyClipRect(Context& context, const QRectF& clipRect)
+{
+    Context::State& state = context.state;
+
+    if (state.isClipComplex)
+    {
+        // Complex clipping path must be intersected with the rectangle. Result
+        // can become a rectangle, if the rectangle lies inside the straight part
+        // of the clipping path.
+        QPainterPath rectPath;
+        rectPath.addRect(clipRect);
+        state.clipPath = state.clipPath->intersected(rectPath);
+
+        std::optional<QRectF> resultRect = PDFPainterHelper::getRectangle(*state.clipPath);
+        state.clipBoundingBox = resultRect.has_value() ? *resultRect : state.clipPath->controlPointRect();
+        state.isClipComplex = !resultRect.has_value();
+    }
+    else
+    {
+        // Rectangles are intersected arithmetically, without path intersection
+        state.clipBoundingBox = state.clipPath.has_value() ? state.clipBoundingBox.intersected(clipRect) : clipRect;
+        state.clipPath = QPainterPath();
+        state.clipPath->addRect(state.clipBoundingBox);
+    }
+
+    BLMatrix2D matrix = context.blContext.userTransform();
+    context.blContext.resetTransform();
+    context.blContext.clipToRect(PDFBLPaintEngine::getBLRect(state.clipBoundingBox));
+    context.blContext.setTransform(matrix);
+}
+
+void PDFBLPageRenderer::drawInstructions(Context& context,
+                                         const PDFPrecompiledPage* page,
+                                         const QTransform& pagePointToDevicePointMatrix)
+{
+    using InstructionType = PDFPrecompiledPage::InstructionType;
+
+    const CacheSnapshot snapshot = getCache(page, context.colorConvertor);
+    const PDFBLPageCache& cache = *snapshot.cache;
+    const PDFBLPageCache::Colors& colors = *snapshot.colors;
+    BLContext& blContext = context.blContext;
+
+    // Optional content is evaluated in the same way, as in the QPainter based drawing
+    std::stack<bool> optionalContentStack;
+    int suppressedOptionalContentCount = 0;
+
+    for (const PDFPrecompiledPage::Instruction& instruction : page->m_instructions)
+    {
+        if (suppressedOptionalContentCount > 0 && PDFPrecompiledPage::isPaintingInstruction(instruction.type))
+        {
+            continue;
+        }
+
+        switch (instruction.type)
+        {
+            case InstructionType::DrawPath:
+            {
+                const PDFBLPageCache::Path& path = cache.paths[instruction.dataIndex];
+                const PDFBLStyle& fillStyle = colors.fillStyles[instruction.dataIndex];
+                const PDFBLStyle& strokeStyle = colors.strokeStyles[instruction.dataIndex];
+
+                if (!context.state.isClipComplex)
+                {
+                    if (path.isFilled)
+                    {
+                        blContext.setFillRule(path.fillRule);
+                        fillStyle.applyFill(blContext);
+                        blContext.fillPath(path.path);
+                    }
+
+                    if (path.isStroked)
+                    {
+                        blContext.setStrokeOptions(path.strokeOptions);
+                        strokeStyle.applyStroke(blContext);
+                        blContext.strokePath(path.path);
+                    }
+                    break;
+                }
+
+                // Painted area is intersected with the clipping path in the device space,
+                // and then it is transformed back, so styles remain in the user space.
+                bool isInvertible = false;
+                const QTransform& worldMatrix = context.state.worldMatrix;
+                const QTransform inversedWorldMatrix = worldMatrix.inverted(&isInvertible);
+                const QPainterPath& clipPath = context.state.clipPath.value();
+                const PDFPrecompiledPage::PathPaintData& data = page->m_paths[instruction.dataIndex];
+
+                if (!isInvertible)
+                {
+                    break;
+                }
+
+                auto fillClippedPath = [&](QPainterPath devicePath, const PDFBLStyle& style)
+                {
+                    if (!devicePath.controlPointRect().intersects(context.state.clipBoundingBox))
+                    {
+                        return;
+                    }
+
+                    devicePath = devicePath.intersected(clipPath);
+                    if (!devicePath.isEmpty())
+                    {
+                        blContext.setFillRule((devicePath.fillRule() == Qt::OddEvenFill) ? BL_FILL_RULE_EVEN_ODD : BL_FILL_RULE_NON_ZERO);
+                        style.applyFill(blContext);
+                        blContext.fillPath(PDFBLPaintEngine::getBLPath(inversedWorldMatrix.map(devicePath)));
+                    }
+                };
+
+                if (path.isFilled)
+                {
+                    fillClippedPath(worldMatrix.map(data.path), fillStyle);
+                }
+
+                if (path.isStroked)
+                {
+                    QPainterPathStroker stroker(data.pen);
+                    fillClippedPath(worldMatrix.map(stroker.createStroke(data.path)), strokeStyle);
+                }
+                break;
+            }
+
+            case InstructionType::DrawImage:
+            {
+                const QImage& image = colors.sourceImages[instruction.dataIndex];
+                const BLImage& cachedBLImage = colors.images[instruction.dataIndex];
+
+                if (image.isNull())
+                {
+                    break;
+                }
+
+                QTransform imageTransform(1.0 / image.width(), 0, 0, 1.0 / image.height(), 0, 0);
+                QTransform worldTransform = imageTransform * context.state.worldMatrix;
+
+                // Jakub Melka: Because Qt uses opposite axis direction than PDF, then we must transform the y-axis
+                // to the opposite (so the image is then unchanged)
+                worldTransform.translate(0, image.height());
+                worldTransform.scale(1, -1);
+
+                blContext.save();
+                blContext.setTransform(PDFBLPaintEngine::getBLMatrix(worldTransform));
+
+                if (!context.state.isClipComplex)
+                {
+                    if (!cachedBLImage.empty())
+                    {
+                        blContext.blitImage(BLPoint(0, 0), cachedBLImage);
+                    }
+                    else
+                    {
+                        blContext.blitImage(BLPoint(0, 0), createBLImageCopy(image));
+                    }
+                }
+                else if (worldTransform.mapRect(QRectF(image.rect())).intersects(context.state.clipBoundingBox))
+                {
+                    // Pixels outside of the clipping path are made transparent
+                    QImage mask(image.size(), QImage::Format_ARGB32);
+                    mask.fill(Qt::transparent);
+
+                    QPainter maskPainter(&mask);
+                    maskPainter.setCompositionMode(QPainter::CompositionMode_Source);
+                    maskPainter.fillPath(worldTransform.inverted().map(context.state.clipPath.value()), Qt::white);
+                    maskPainter.end();
+
+                    QImage maskedImage = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+                    QPainter imagePainter(&maskedImage);
+                    imagePainter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+                    imagePainter.drawImage(0, 0, mask);
+                    imagePainter.end();
+
+                    BLImage blMaskedImage;
+                    blMaskedImage.createFromData(maskedImage.width(), maskedImage.height(), BL_FORMAT_PRGB32, maskedImage.bits(), maskedImage.bytesPerLine());
+
+                    BLImage blDrawImage;
+                    blDrawImage.assignDeep(blMaskedImage);
+                    blContext.blitImage(BLPoint(0, 0), blDrawImage);
+                }
+
+                blContext.restore();
+                break;
+            }
+
+            case InstructionType::DrawMesh:
+            {
+                const PDFPrecompiledPage::MeshPaintData& data = page->m_meshes[instruction.dataIndex];
+                const PDFMesh& mesh = !colors.meshes.empty() ? colors.meshes[instruction.dataIndex] : data.mesh;
+
+                // Meshes are painted by QPainter directly into the image,
+                // so all pending Blend2D commands must be finished at first.
+                blContext.flush(BL_CONTEXT_FLUSH_SYNC);
+
+                QPainter painter(context.image);
+                painter.setCompositionMode(context.state.compositionMode);
+                painter.setOpacity(context.opacity);
+
+                if (context.state.clipPath.has_value())
+                {
+                    painter.setClipPath(context.state.clipPath.value());
+                }
+
+                painter.setWorldTransform(pagePointToDevicePointMatrix);
+                mesh.paint(&painter, data.alpha);
+                painter.end();
+                break;
+            }
+
+            case InstructionType::Clip:
+            {
+                const PDFPrecompiledPage::ClipData& data = page->m_clips[instruction.dataIndex];
+                const QTransform& worldMatrix = context.state.worldMatrix;
+
+                if (data.clipRect.has_value() && worldMatrix.type() <= QTransform::TxScale)
+                {
+                    applyClipRect(context, worldMatrix.mapRect(*data.clipRect));
+                }
+                else
+                {
+                    applyClipPath(context, worldMatrix.map(data.clipPath));
+                }
+                break;
+            }
+
+            case InstructionType::SaveGraphicState:
+            {
+                context.stateStack.push(context.state);
+                blContext.save();
+                break;
+            }
+
+            case InstructionType::RestoreGraphicState:
+            {
+                if (!context.stateStack.empty())
+                {
+                    context.state = qMove(context.stateStack.top());
+                    context.stateStack.pop();
+                    blContext.restore();
+                }
+                break;
+            }
+
+            case InstructionType::SetWorldMatrix:
+            {
+                context.state.worldMatrix = page->m_matrices[instruction.dataIndex] * pagePointToDevicePointMatrix;
+                blContext.setTransform(PDFBLPaintEngine::getBLMatrix(context.state.worldMatrix));
+                break;
+            }
+
+            case InstructionType::SetCompositionMode:
+            {
+                context.state.compositionMode = page->m_compositionModes[instruction.dataIndex];
+                blContext.setCompOp(PDFBLPaintEngine::getBLCompOp(context.state.compositionMode));
+                break;
+            }
+
+            case InstructionType::DrawInstance:
+            {
+                const PDFPrecompiledPage::InstanceData& data = page->m_instances[instruction.dataIndex];
+                const size_t stateStackSize = context.stateStack.size();
+
+                context.stateStack.push(context.state);
+                blContext.save();
+
+                drawInstructions(context, data.page.get(), data.matrix * pagePointToDevicePointMatrix);
+
+                // Restore also states, which were not restored by the instanced page
+                while (context.stateStack.size() > stateStackSize)
+                {
+                    context.state = qMove(context.stateStack.top());
+                    context.stateStack.pop();
+                    blContext.restore();
+                }
+                break;
+            }
+
+            case InstructionType::BeginOptionalContent:
+            {
+                const bool isSuppressed = page->isOptionalContentSuppressed(page->m_optionalContents[instruction.dataIndex]);
+                optionalContentStack.push(isSuppressed);
+                suppressedOptionalContentCount += isSuppressed ? 1 : 0;
+                break;
+            }
+
+            case InstructionType::EndOptionalContent:
+            {
+                if (!optionalContentStack.empty())
+                {
+                    suppressedOptionalContentCount -= optionalContentStack.top() ? 1 : 0;
+                    optionalContentStack.pop();
+                }
+                break;
+            }
+
+            default:
+            {
+                Q_ASSERT(false);
+                break;
+            }
+        }
+    }
+}
+
 }   // namespace pdf
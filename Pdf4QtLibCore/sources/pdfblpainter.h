@@ -19,18 +19,26 @@
 #define PDFBLPAINTER_H
 
 #include "pdfglobal.h"
+#include "pdfrenderer.h"
 
 #include <QImage>
+#include <QPainterPath>
 #include <QPaintDevice>
 
 namespace pdf
 {
 class PDFBLPaintEngine;
+class PDFColorConvertor;
+class PDFPrecompiledPage;
 
 class PDF4QTLIBCORESHARED_EXPORT PDFBLPaintDevice : public QPaintDevice
 {
 public:
-    PDFBLPaintDevice(QImage& offscreenBuffer, bool isMultithreaded);
+    /// Constructs paint device drawing into the offscreen buffer
+    /// \param offscreenBuffer Offscreen buffer
+    /// \param isMultithreaded Use multithreaded Blend2D context
+    /// \param isClearedOnBegin Clear the offscreen buffer, when painting begins
+    PDFBLPaintDevice(QImage& offscreenBuffer, bool isMultithreaded, bool isClearedOnBegin = true);
     virtual ~PDFBLPaintDevice() override;
 
     virtual int devType() const override;
@@ -46,6 +54,66 @@ private:
     PDFBLPaintEngine* m_paintEngine;
 };
 
+/// Draws precompiled page directly using Blend2D, without translation of each
+/// path, pen and brush through the QPaintEngine interface. Paths, gradients,
+/// patterns and images are converted to Blend2D objects only once and they are
+/// cached in the precompiled page, so repeated drawing of the page (and of its
+/// instanced pages) just submits cached objects to the Blend2D context. Shading
+/// meshes are painted by QPainter into the same buffer.
+class PDF4QTLIBCORESHARED_EXPORT PDFBLPageRenderer
+{
+public:
+    /// Draws page into the image. Image is cleared at first (unless \p isClearedOnBegin
+    /// is false). Returns false, if Blend2D context can't be created, in that case,
+    /// nothing is drawn.
+    /// \param image Target image (must be in premultiplied ARGB32 format)
+    /// \param page Precompiled page
+    /// \param cropBox Page's crop box
+    /// \param pagePointToDevicePointMatrix Page point to device point transformation matrix
+    /// \param features Renderer features
+    /// \param opacity Opacity of page graphics
+    /// \param colorConvertor Color convertor, which is applied to the colors, when page is drawn
+    /// \param isMultithreaded Use multithreaded Blend2D context
+    /// \param isClearedOnBegin Clear the image, before page is drawn
+    static bool draw(QImage& image,
+                     const PDFPrecompiledPage* page,
+                     const QRectF& cropBox,
+                     const QTransform& pagePointToDevicePointMatrix,
+                     PDFRenderer::Features features,
+                     PDFReal opacity,
+                     const PDFColorConvertor& colorConvertor,
+                     bool isMultithreaded,
+                     bool isClearedOnBegin = true);
+
+private:
+    struct Context;
+    struct CacheSnapshot;
+
+    /// Returns cached Blend2D objects of the page for given color convertor,
+    /// objects are created, if they do not exist.
+    /// \param page Precompiled page
+    /// \param colorConvertor Color convertor
+    static CacheSnapshot getCache(const PDFPrecompiledPage* page, const PDFColorConvertor& colorConvertor);
+
+    /// Intersects current clipping of the context with the clipping path
+    /// \param context Drawing context
+    /// \param clipPath Clipping path in device space
+    static void applyClipPath(Context& context, QPainterPath clipPath);
+
+    /// Intersects current clipping of the context with the clipping rectangle
+    /// \param context Drawing context
+    /// \param clipRect Clipping rectangle in device space
+    static void applyClipRect(Context& context, const QRectF& clipRect);
+
+    /// Plays instructions of the page on the Blend2D context
+    /// \param context Drawing context
+    /// \param page Precompiled page
+    /// \param pagePointToDevicePointMatrix Page point to device point transformation matrix
+    static void drawInstructions(Context& context,
+                                 const PDFPrecompiledPage* page,
+                                 const QTransform& pagePointToDevicePointMatrix);
+};
+
 }   // namespace pdf
 
 #endif // PDFBLPAINTER_H
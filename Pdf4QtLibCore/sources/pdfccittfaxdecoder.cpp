@@ -58,7 +58,8 @@ struct PDFCCITTCode
     uint8_t bits;
 };
 
-static constexpr uint8_t MAX_CODE_BIT_LENGTH = 12;
+static constexpr uint8_t MAX_WHITE_CODE_BIT_LENGTH = 12;
+static constexpr uint8_t MAX_BLACK_CODE_BIT_LENGTH = 13;
 
 static constexpr PDFCCITTCode CCITT_WHITE_CODES[] = {
 
@@ -284,6 +285,116 @@ static constexpr PDFCCITTCode CCITT_BLACK_CODES[] = {
     { 2560,    0b000000011111,     000000011111_bitlength }
 };
 
+/// Lookup table of CCITT codes. Code is found using bits peeked from the stream
+/// (maximal code length bits, most significant bit is the first bit of the code).
+/// Table has two levels. Codes not longer than the first level bits are found directly
+/// in the first level table, longer codes are found in the second level table, which
+/// is pointed by the entry of first level table.
+class PDFCCITTLookupTable
+{
+public:
+    struct Entry
+    {
+        uint16_t value = 0;     ///< Value of the code, or offset of the second level table
+        uint8_t bits = 0;       ///< Bit length of the code, zero, if code is invalid
+        bool isLink = false;    ///< Entry points to the second level table
+    };
+
+    explicit PDFCCITTLookupTable(uint8_t firstLevelBits, uint8_t maxBits) :
+        m_firstLevelBits(firstLevelBits),
+        m_maxBits(maxBits),
+        m_entries(size_t(1) << firstLevelBits)
+    {
+        Q_ASSERT(firstLevelBits <= maxBits);
+    }
+
+    /// Adds code to the lookup table
+    /// \param value Value of the code
+    /// \param code Code bits
+    /// \param bits Bit length of the code
+    void addCode(uint16_t value, uint16_t code, uint8_t bits)
+    {
+        Q_ASSERT(bits <= m_maxBits);
+
+        if (bits <= m_firstLevelBits)
+        {
+            fill(size_t(code) << (m_firstLevelBits - bits), size_t(1) << (m_firstLevelBits - bits), value, bits);
+        }
+        else
+        {
+            const uint8_t secondLevelBits = m_maxBits - m_firstLevelBits;
+            const uint8_t remainingBits = bits - m_firstLevelBits;
+            const size_t prefix = code >> remainingBits;
+
+            if (!m_entries[prefix].isLink)
+            {
+                Q_ASSERT(m_entries[prefix].bits == 0);
+                m_entries[prefix].value = static_cast<uint16_t>(m_entries.size());
+                m_entries[prefix].isLink = true;
+                m_entries.resize(m_entries.size() + (size_t(1) << secondLevelBits));
+            }
+
+            const size_t suffix = code & ((size_t(1) << remainingBits) - 1);
+            fill(m_entries[prefix].value + (suffix << (secondLevelBits - remainingBits)), size_t(1) << (secondLevelBits - remainingBits), value, bits);
+        }
+    }
+
+    /// Returns entry for the code starting at the most significant bit
+    /// of \p bits (bits contains maximal code length bits).
+    /// \param bits Peeked bits
+    inline const Entry& getEntry(uint32_t bits) const
+    {
+        const uint8_t secondLevelBits = m_maxBits - m_firstLevelBits;
+        const Entry& entry = m_entries[bits >> secondLevelBits];
+
+        if (entry.isLink)
+        {
+            return m_entries[entry.value + (bits & ((uint32_t(1) << secondLevelBits) - 1))];
+        }
+
+        return entry;
+    }
+
+    /// Returns maximal code length
+    uint8_t getMaxBits() const { return m_maxBits; }
+
+private:
+    void fill(size_t index, size_t count, uint16_t value, uint8_t bits)
+    {
+        for (size_t i = index; i < index + count; ++i)
+        {
+            // Codes are prefix free, so entries can't be overwritten
+            Q_ASSERT(m_entries[i].bits == 0 && !m_entries[i].isLink);
+            m_entries[i].value = value;
+            m_entries[i].bits = bits;
+        }
+    }
+
+    uint8_t m_firstLevelBits;
+    uint8_t m_maxBits;
+    std::vector<Entry> m_entries;
+};
+
+static PDFCCITTLookupTable createCCITTLookupTable(const PDFCCITTCode* codes, size_t codeCount, uint8_t firstLevelBits, uint8_t maxBits)
+{
+    PDFCCITTLookupTable table(firstLevelBits, maxBits);
+    for (size_t i = 0; i < codeCount; ++i)
+    {
+        table.addCode(codes[i].length, codes[i].code, codes[i].bits);
+    }
+    return table;
+}
+
+static PDFCCITTLookupTable create2DModeLookupTable()
+{
+    PDFCCITTLookupTable table(MAX_2D_MODE_BIT_LENGTH, MAX_2D_MODE_BIT_LENGTH);
+    for (const PDFCCITT2DModeInfo& info : CCITT_2D_CODE_MODES)
+    {
+        table.addCode(info.mode, info.code, info.bits);
+    }
+    return table;
+}
+
 PDFCCITTFaxDecoder::PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTFaxDecoderParameters& parameters) :
     m_reader(stream, 1),
     m_parameters(parameters)
@@ -293,7 +404,13 @@ PDFCCITTFaxDecoder::PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTF
 
 PDFImageData PDFCCITTFaxDecoder::decode()
 {
-    PDFBitWriter writer(1);
+    const int bytesPerRow = (m_parameters.columns + 7) / 8;
+    QByteArray imageData;
+    if (!m_parameters.hasEndOfBlock && m_parameters.rows > 0)
+    {
+        imageData.reserve(bytesPerRow * m_parameters.rows);
+    }
+
     std::vector<int> codingLine;
     std::vector<int> referenceLine;
 
@@ -454,19 +571,8 @@ PDFImageData PDFCCITTFaxDecoder::decode()
         }
 
         // Write the line to the output buffer
-        isCurrentPixelBlack = false;
-        int index = 0;
-        for (int i = 0; i < m_parameters.columns; ++i)
-        {
-            if (i == codingLine[index])
-            {
-                isCurrentPixelBlack = !isCurrentPixelBlack;
-                ++index;
-            }
-
-            writer.write(isCurrentPixelBlack ? 0 : 1);
-        }
-        writer.finishLine();
+        imageData.append(bytesPerRow, 0);
+        writeLine(codingLine, reinterpret_cast<uint8_t*>(imageData.data()) + imageData.size() - bytesPerRow);
 
         ++row;
 
@@ -556,7 +662,56 @@ PDFImageData PDFCCITTFaxDecoder::decode()
         decode = { m_parameters.decode[0], m_parameters.decode[1] };
     }
 
-    return PDFImageData(1, 1, m_parameters.columns, row, (m_parameters.columns + 7) / 8, m_parameters.maskingType, writer.takeByteArray(), { }, qMove(decode), { });
+    return PDFImageData(1, 1, m_parameters.columns, row, bytesPerRow, m_parameters.maskingType, qMove(imageData), { }, qMove(decode), { });
+}
+
+void PDFCCITTFaxDecoder::writeLine(const std::vector<int>& line, uint8_t* outputRow) const
+{
+    // Line contains changing elements, runs between them alternate. Pixels
+    // left of the first changing element are white (written as ones), then
+    // black run follows (written as zeros), etc. Row is already filled with
+    // zeros, so we fill only white runs with ones.
+    auto fillOnes = [outputRow](int begin, int end)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+
+        const int firstByte = begin / 8;
+        const int lastByte = (end - 1) / 8;
+        const uint8_t firstMask = 0xFF >> (begin % 8);
+        const uint8_t lastMask = 0xFF << (7 - (end - 1) % 8);
+
+        if (firstByte == lastByte)
+        {
+            outputRow[firstByte] |= firstMask & lastMask;
+        }
+        else
+        {
+            outputRow[firstByte] |= firstMask;
+            std::fill(outputRow + firstByte + 1, outputRow + lastByte, uint8_t(0xFF));
+            outputRow[lastByte] |= lastMask;
+        }
+    };
+
+    const int columns = static_cast<int>(m_parameters.columns);
+    int begin = 0;
+    for (size_t index = 0; index < line.size(); index += 2)
+    {
+        fillOnes(begin, qMin(line[index], columns));
+
+        if (index + 1 >= line.size() || line[index] >= columns)
+        {
+            break;
+        }
+
+        begin = line[index + 1];
+        if (begin >= columns)
+        {
+            break;
+        }
+    }
 }
 
 void PDFCCITTFaxDecoder::skipFill()
@@ -640,57 +795,172 @@ uint32_t PDFCCITTFaxDecoder::getRunLength(bool white)
 
 uint32_t PDFCCITTFaxDecoder::getWhiteCode()
 {
-    return getCode(CCITT_WHITE_CODES, std::size(CCITT_WHITE_CODES));
+    // Most frequent codes are short, so they are found in the first level table
+    static const PDFCCITTLookupTable table = createCCITTLookupTable(CCITT_WHITE_CODES, std::size(CCITT_WHITE_CODES), 9, MAX_WHITE_CODE_BIT_LENGTH);
+    return getCode(table);
 }
 
 uint32_t PDFCCITTFaxDecoder::getBlackCode()
 {
-    return getCode(CCITT_BLACK_CODES, std::size(CCITT_BLACK_CODES));
+    static const PDFCCITTLookupTable table = createCCITTLookupTable(CCITT_BLACK_CODES, std::size(CCITT_BLACK_CODES), 8, MAX_BLACK_CODE_BIT_LENGTH);
+    return getCode(table);
 }
 
-uint32_t PDFCCITTFaxDecoder::getCode(const PDFCCITTCode* codes, size_t codeCount)
+uint32_t PDFCCITTFaxDecoder::getCode(const PDFCCITTLookupTable& table)
 {
-    uint32_t code = 0;
-    uint8_t bits = 0;
+    // Bits beyond the end of the stream are peeked as zeros. If code is found,
+    // but there are not enough bits in the stream, then exception is thrown when reading.
+    const PDFCCITTLookupTable::Entry& entry = table.getEntry(static_cast<uint32_t>(m_reader.look(table.getMaxBits())));
 
-    while (bits <= MAX_CODE_BIT_LENGTH)
+    if (entry.bits == 0)
     {
-        code = (code << 1) + m_reader.read(1);
-        ++bits;
+        throw PDFException(PDFTranslationContext::tr("Invalid CCITT run length code word."));
+    }
+
+    m_reader.read(entry.bits);
+    return entry.value;
+}
 
-        for (size_t i = 0; i < codeCount; ++i)
+CCITT_2D_Code_Mode PDFCCITTFaxDecoder::get2DMode()
+{
+    static const PDFCCITTLookupTable table = create2DModeLookupTable();
+    const PDFCCITTLookupTable::Entry& entry = table.getEntry(static_cast<uint32_t>(m_reader.look(table.getMaxBits())));
+
+    if (entry.bits == 0)
+    {
+        throw PDFException(PDFTranslationContext::tr("Invalid CCITT 2D mode."));
+    }
+
+    m_reader.read(entry.bits);
+    return static_cast<CCITT_2D_Code_Mode>(entry.value);
+}
+
+static inline bool getCCITTPixel(const uint8_t* row, int x)
+{
+    return (row[x >> 3] >> (7 - (x & 7))) & 1;
+}
+
+/// Returns first position not less than \p start, where pixel
+/// color differs from \p color, or \p width, if no such pixel exists.
+static int findCCITTChangingElement(const uint8_t* row, int start, int width, bool color)
+{
+    const uint8_t skipByte = color ? 0xFF : 0x00;
+
+    int x = start;
+    while (x < width)
+    {
+        if ((x & 7) == 0 && x + 8 <= width && row[x >> 3] == skipByte)
         {
-            const PDFCCITTCode& currentCode = codes[i];
-            if (currentCode.bits == bits && currentCode.code == code)
-            {
-                return currentCode.length;
-            }
+            x += 8;
+            continue;
+        }
+
+        if (getCCITTPixel(row, x) != color)
+        {
+            return x;
         }
+
+        ++x;
     }
 
-    throw PDFException(PDFTranslationContext::tr("Invalid CCITT run length code word."));
+    return width;
 }
 
-CCITT_2D_Code_Mode PDFCCITTFaxDecoder::get2DMode()
+QByteArray PDFCCITTFaxEncoder::encodeGroup4(const uint8_t* data, int width, int height, int bytesPerLine)
 {
-    uint32_t code = 0;
-    uint8_t bits = 0;
+    PDFBitWriter writer(1);
+    writer.reserve(bytesPerLine * height / 8);
 
-    while (bits <= MAX_2D_MODE_BIT_LENGTH)
+    // Reference line of the first row is imaginary white line
+    std::vector<uint8_t> whiteLine(bytesPerLine, 0);
+    const uint8_t* referenceRow = whiteLine.data();
+
+    for (int y = 0; y < height; ++y)
     {
-        code = (code << 1) + m_reader.read(1);
-        ++bits;
+        const uint8_t* codingRow = data + qsizetype(y) * bytesPerLine;
+
+        int a0 = 0;
+        int a1 = getCCITTPixel(codingRow, 0) ? 0 : findCCITTChangingElement(codingRow, 0, width, false);
+        int b1 = getCCITTPixel(referenceRow, 0) ? 0 : findCCITTChangingElement(referenceRow, 0, width, false);
 
-        for (const PDFCCITT2DModeInfo& info : CCITT_2D_CODE_MODES)
+        for (;;)
         {
-            if (info.bits == bits && info.code == code)
+            const int b2 = b1 < width ? findCCITTChangingElement(referenceRow, b1, width, getCCITTPixel(referenceRow, b1)) : width;
+
+            if (b2 < a1)
             {
-                return info.mode;
+                writeMode(writer, Pass);
+                a0 = b2;
             }
+            else if (std::abs(a1 - b1) <= 3)
+            {
+                writeMode(writer, static_cast<CCITT_2D_Code_Mode>(Vertical_0 + a1 - b1));
+                a0 = a1;
+            }
+            else
+            {
+                const int a2 = a1 < width ? findCCITTChangingElement(codingRow, a1, width, getCCITTPixel(codingRow, a1)) : width;
+                const bool isWhite = (a0 + a1 == 0) || !getCCITTPixel(codingRow, a0);
+
+                writeMode(writer, Horizontal);
+                writeRunLength(writer, a1 - a0, isWhite);
+                writeRunLength(writer, a2 - a1, !isWhite);
+                a0 = a2;
+            }
+
+            if (a0 >= width)
+            {
+                break;
+            }
+
+            const bool color = getCCITTPixel(codingRow, a0);
+            a1 = findCCITTChangingElement(codingRow, a0, width, color);
+            b1 = findCCITTChangingElement(referenceRow, a0, width, !color);
+            b1 = findCCITTChangingElement(referenceRow, b1, width, color);
         }
+
+        referenceRow = codingRow;
+    }
+
+    // End-of-facsimile block (two end-of-line codes)
+    writer.write(0b000000000001, 12);
+    writer.write(0b000000000001, 12);
+    writer.finishLine();
+
+    return writer.takeByteArray();
+}
+
+void PDFCCITTFaxEncoder::writeRunLength(PDFBitWriter& writer, int runLength, bool white)
+{
+    const PDFCCITTCode* codes = white ? CCITT_WHITE_CODES : CCITT_BLACK_CODES;
+
+    // Terminating codes are stored for run lengths 0-63, then make
+    // up codes follow for multiples of 64, up to 2560.
+    constexpr int MAX_MAKEUP_CODE_INDEX = 63 + 2560 / 64;
+
+    while (runLength >= 2560)
+    {
+        const PDFCCITTCode& code = codes[MAX_MAKEUP_CODE_INDEX];
+        writer.write(code.code, code.bits);
+        runLength -= code.length;
+    }
+
+    if (runLength >= 64)
+    {
+        const PDFCCITTCode& code = codes[63 + runLength / 64];
+        writer.write(code.code, code.bits);
+        runLength -= code.length;
     }
 
-    throw PDFException(PDFTranslationContext::tr("Invalid CCITT 2D mode."));
+    const PDFCCITTCode& code = codes[runLength];
+    writer.write(code.code, code.bits);
+}
+
+void PDFCCITTFaxEncoder::writeMode(PDFBitWriter& writer, CCITT_2D_Code_Mode mode)
+{
+    const PDFCCITT2DModeInfo& info = CCITT_2D_CODE_MODES[mode];
+    Q_ASSERT(info.mode == mode);
+    writer.write(info.code, info.bits);
 }
 
 }   // namespace pdf
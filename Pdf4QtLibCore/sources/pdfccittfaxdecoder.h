@@ -24,7 +24,7 @@
 namespace pdf
 {
 
-struct PDFCCITTCode;
+class PDFCCITTLookupTable;
 
 struct PDFCCITTFaxDecoderParameters
 {
@@ -86,7 +86,7 @@ enum CCITT_2D_Code_Mode
     Invalid
 };
 
-class PDFCCITTFaxDecoder
+class PDF4QTLIBCORESHARED_EXPORT PDFCCITTFaxDecoder
 {
 public:
     explicit PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTFaxDecoderParameters& parameters);
@@ -122,12 +122,44 @@ private:
     uint32_t getWhiteCode();
     uint32_t getBlackCode();
 
-    uint32_t getCode(const PDFCCITTCode* codes, size_t codeCount);
+    /// Reads code from the stream using the lookup table. If code
+    /// is invalid, then exception is thrown.
+    /// \param table Lookup table
+    uint32_t getCode(const PDFCCITTLookupTable& table);
+
+    /// Writes line as packed 1-bit pixels into the output row. Output
+    /// row must be filled with zeros.
+    /// \param line Line with changing element indices
+    /// \param outputRow Output row
+    void writeLine(const std::vector<int>& line, uint8_t* outputRow) const;
 
     PDFBitReader m_reader;
     PDFCCITTFaxDecoderParameters m_parameters;
 };
 
+/// Encoder of bilevel images to pure two dimensional CCITT Group 4 encoding (T.6).
+/// Each encoding starts with imaginary white reference line, so independently
+/// encoded parts of the image (for example, TIFF strips) can be decoded separately.
+class PDF4QTLIBCORESHARED_EXPORT PDFCCITTFaxEncoder
+{
+public:
+    /// Encodes bilevel image. Pixels are packed in rows, leftmost pixel is stored
+    /// in the most significant bit, and bit value 1 means black pixel. Encoded data
+    /// are terminated by end-of-facsimile block (EOFB) and aligned to byte boundary.
+    /// \param data Image data
+    /// \param width Width of the image in pixels
+    /// \param height Height of the image in pixels
+    /// \param bytesPerLine Number of bytes per one row of the image
+    static QByteArray encodeGroup4(const uint8_t* data, int width, int height, int bytesPerLine);
+
+private:
+    /// Writes run length of white or black pixels (makeup codes and terminating code)
+    static void writeRunLength(PDFBitWriter& writer, int runLength, bool white);
+
+    /// Writes 2D mode code
+    static void writeMode(PDFBitWriter& writer, CCITT_2D_Code_Mode mode);
+};
+
 }   // namespace pdf
 
 #endif // PDFCCITTFAXDECODER_H
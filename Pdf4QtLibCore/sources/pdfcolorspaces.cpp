@@ -2277,31 +2277,27 @@ std::vector<PDFColorComponent> PDFSeparationColorSpace::transformColorsToBaseCol
     const std::size_t colorComponentCount = m_alternateColorSpace->getColorComponentCount();
     std::vector<PDFColorComponent> result(buffer.size() * colorComponentCount, 0.0f);
 
-    std::vector<double> outputColor;
-    outputColor.resize(colorComponentCount, 0.0);
-
-    auto outputIt = result.begin();
-    for (PDFColorComponent input : buffer)
+    if (m_isAll)
     {
-        // Input value
-        double tint = input;
-
-        Q_ASSERT(outputIt + (colorComponentCount - 1) != result.cend());
-
-        if (m_isAll)
+        auto outputIt = result.begin();
+        for (PDFColorComponent input : buffer)
         {
-            const double inversedTint = qBound(0.0, 1.0 - tint, 1.0);
+            Q_ASSERT(outputIt + (colorComponentCount - 1) != result.cend());
+
+            const double inversedTint = qBound(0.0, 1.0 - double(input), 1.0);
             std::fill(outputIt, outputIt + colorComponentCount, inversedTint);
+            outputIt = std::next(outputIt, colorComponentCount);
         }
-        else
-        {
-            m_tintTransform->apply(&tint, &tint + 1, outputColor.data(), outputColor.data() + outputColor.size());
-            std::copy(outputColor.cbegin(), outputColor.cend(), outputIt);
-        }
-
-        outputIt = std::next(outputIt, colorComponentCount);
+        Q_ASSERT(outputIt == result.cend());
+    }
+    else
+    {
+        // Evaluate tint transform for all input values at once
+        std::vector<double> inputColors(buffer.cbegin(), buffer.cend());
+        std::vector<double> outputColors(result.size(), 0.0);
+        m_tintTransform->applyBatch(inputColors.data(), inputColors.data() + inputColors.size(), outputColors.data(), outputColors.data() + outputColors.size(), inputColors.size());
+        std::copy(outputColors.cbegin(), outputColors.cend(), result.begin());
     }
-    Q_ASSERT(outputIt == result.cend());
 
     return result;
 }
@@ -2518,18 +2514,11 @@ std::vector<PDFColorComponent> PDFDeviceNColorSpace::transformColorsToBaseColorS
         const std::size_t alternateColorSpaceComponentCount = m_alternateColorSpace->getColorComponentCount();
         result.resize(inputColorCount * alternateColorSpaceComponentCount, 0.0f);
 
-        std::vector<double> inputColor(colorantCount, 0.0);
-        std::vector<double> outputColor(alternateColorSpaceComponentCount, 0.0);
-
-        auto outputIt = result.begin();
-        for (auto it = buffer.begin(); it != buffer.end(); it = std::next(it, colorantCount))
-        {
-            std::copy(it, it + colorantCount, inputColor.begin());
-            m_tintTransform->apply(inputColor.data(), inputColor.data() + inputColor.size(), outputColor.data(), outputColor.data() + outputColor.size());
-            std::copy(outputColor.cbegin(), outputColor.cend(), outputIt);
-            outputIt = std::next(outputIt, alternateColorSpaceComponentCount);
-        }
-        Q_ASSERT(outputIt == result.cend());
+        // Evaluate tint transform for all input colors at once
+        std::vector<double> inputColors(buffer.cbegin(), std::next(buffer.cbegin(), inputColorCount * colorantCount));
+        std::vector<double> outputColors(result.size(), 0.0);
+        m_tintTransform->applyBatch(inputColors.data(), inputColors.data() + inputColors.size(), outputColors.data(), outputColors.data() + outputColors.size(), inputColorCount);
+        std::copy(outputColors.cbegin(), outputColors.cend(), result.begin());
     }
 
     return result;
@@ -74,6 +74,9 @@ static constexpr const int PDF_MAX_COLOR_COMPONENTS = 32;
 // Cache limits
 static constexpr size_t DEFAULT_FONT_CACHE_LIMIT = 32;
 static constexpr size_t DEFAULT_REALIZED_FONT_CACHE_LIMIT = 128;
+static constexpr size_t DEFAULT_MESH_CACHE_LIMIT = 64 * 1024 * 1024;
+static constexpr size_t DEFAULT_JBIG2_GLOBALS_CACHE_LIMIT = 64 * 1024 * 1024;
+static constexpr size_t DEFAULT_TILING_PATTERN_CACHE_LIMIT = 64 * 1024 * 1024;
 
 }   // namespace pdf
 
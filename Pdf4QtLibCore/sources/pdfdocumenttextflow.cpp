@@ -160,10 +160,16 @@ public:
     /// \param item Item
     const TextItems& getText(const PDFStructureItem* item) const;
 
+    /// Sets font cache used for text extraction. If it is not set,
+    /// then temporary font cache is used.
+    /// \param fontCache Font cache
+    void setFontCache(PDFFontCache* fontCache) { m_fontCache = fontCache; }
+
 private:
     QList<PDFRenderError> m_errors;
     const PDFDocument* m_document;
     const PDFStructureTree* m_tree;
+    PDFFontCache* m_fontCache = nullptr;
     QStringList m_unmatchedText;
     std::map<PDFInteger, PDFStructureTreeTextSequence> m_textSequences;
     std::map<const PDFStructureItem*, TextItems> m_textForItems;
@@ -427,15 +433,21 @@ void PDFStructureTreeTextExtractor::perform(const std::vector<PDFInteger>& pageI
     PDFStructureTreeReferenceCollector referenceCollector(&mapping);
     m_tree->accept(&referenceCollector);
 
-    PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+    PDFFontCache localFontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
 
     QMutex mutex;
     PDFCMSGeneric cms;
     PDFMeshQualitySettings mqs;
     PDFOptionalContentActivity oca(m_document, OCUsage::Export, nullptr);
-    pdf::PDFModifiedDocument md(const_cast<PDFDocument*>(m_document), &oca);
-    fontCache.setDocument(md);
-    fontCache.setCacheShrinkEnabled(nullptr, false);
+
+    PDFFontCache* fontCache = m_fontCache;
+    if (!fontCache)
+    {
+        pdf::PDFModifiedDocument md(const_cast<PDFDocument*>(m_document), &oca);
+        localFontCache.setDocument(md);
+        fontCache = &localFontCache;
+    }
+    fontCache->setCacheShrinkEnabled(this, false);
 
     auto generateTextLayout = [&, this](PDFInteger pageIndex)
     {
@@ -449,7 +461,7 @@ void PDFStructureTreeTextExtractor::perform(const std::vector<PDFInteger>& pageI
         const PDFPage* page = catalog->getPage(pageIndex);
         Q_ASSERT(page);
 
-        PDFStructureTreeTextContentProcessor processor(PDFRenderer::IgnoreOptionalContent, page, m_document, &fontCache, &cms, &oca, QTransform(), mqs, m_tree, &mapping, m_options);
+        PDFStructureTreeTextContentProcessor processor(PDFRenderer::IgnoreOptionalContent, page, m_document, fontCache, &cms, &oca, QTransform(), mqs, m_tree, &mapping, m_options);
         QList<PDFRenderError> errors = processor.processContents();
 
         QMutexLocker lock(&mutex);
@@ -460,7 +472,7 @@ void PDFStructureTreeTextExtractor::perform(const std::vector<PDFInteger>& pageI
 
     PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.begin(), pageIndices.end(), generateTextLayout);
 
-    fontCache.setCacheShrinkEnabled(nullptr, true);
+    fontCache->setCacheShrinkEnabled(this, true);
 
     if (m_options.testFlag(CreateTreeMapping))
     {
@@ -673,7 +685,7 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
     {
         case Algorithm::Layout:
         {
-            PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+            PDFFontCache localFontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
 
             std::map<PDFInteger, PDFDocumentTextFlow::Items> items;
 
@@ -681,11 +693,17 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
             PDFCMSGeneric cms;
             PDFMeshQualitySettings mqs;
             PDFOptionalContentActivity oca(document, OCUsage::Export, nullptr);
-            pdf::PDFModifiedDocument md(const_cast<PDFDocument*>(document), &oca);
-            fontCache.setDocument(md);
-            fontCache.setCacheShrinkEnabled(nullptr, false);
 
-            auto generateTextLayout = [this, &items, &mutex, &fontCache, &cms, &mqs, &oca, document, catalog](PDFInteger pageIndex)
+            PDFFontCache* fontCache = m_fontCache;
+            if (!fontCache)
+            {
+                pdf::PDFModifiedDocument md(const_cast<PDFDocument*>(document), &oca);
+                localFontCache.setDocument(md);
+                fontCache = &localFontCache;
+            }
+            fontCache->setCacheShrinkEnabled(this, false);
+
+            auto generateTextLayout = [this, &items, &mutex, fontCache, &cms, &mqs, &oca, document, catalog](PDFInteger pageIndex)
             {
                 if (!catalog->getPage(pageIndex))
                 {
@@ -696,7 +714,7 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
                 const PDFPage* page = catalog->getPage(pageIndex);
                 Q_ASSERT(page);
 
-                PDFTextLayoutGenerator generator(PDFRenderer::IgnoreOptionalContent, page, document, &fontCache, &cms, &oca, QTransform(), mqs);
+                PDFTextLayoutGenerator generator(PDFRenderer::IgnoreOptionalContent, page, document, fontCache, &cms, &oca, QTransform(), mqs);
                 QList<PDFRenderError> errors = generator.processContents();
                 PDFTextLayout textLayout = generator.createTextLayout();
                 PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, PDFTextFlow::FlowFlags(PDFTextFlow::SeparateBlocks) | PDFTextFlow::RemoveSoftHyphen, pageIndex);
@@ -716,7 +734,7 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
 
             PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.begin(), pageIndices.end(), generateTextLayout);
 
-            fontCache.setCacheShrinkEnabled(nullptr, true);
+            fontCache->setCacheShrinkEnabled(this, true);
 
             PDFDocumentTextFlow::Items flowItems;
             for (const auto& item : items)
@@ -739,6 +757,7 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
             PDFStructureTreeTextExtractor::Options options = PDFStructureTreeTextExtractor::SkipArtifact | PDFStructureTreeTextExtractor::AdjustReversedText | PDFStructureTreeTextExtractor::CreateTreeMapping;
             options.setFlag(PDFStructureTreeTextExtractor::BoundingBoxes, m_calculateBoundingBoxes);
             PDFStructureTreeTextExtractor extractor(document, &structureTree, options);
+            extractor.setFontCache(m_fontCache);
             extractor.perform(pageIndices);
 
             PDFDocumentTextFlow::Items flowItems;
@@ -755,6 +774,7 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
             PDFStructureTreeTextExtractor::Options options = PDFStructureTreeTextExtractor::None;
             options.setFlag(PDFStructureTreeTextExtractor::BoundingBoxes, m_calculateBoundingBoxes);
             PDFStructureTreeTextExtractor extractor(document, &structureTree, options);
+            extractor.setFontCache(m_fontCache);
             extractor.perform(pageIndices);
 
             PDFDocumentTextFlow::Items flowItems;
@@ -798,6 +818,11 @@ void PDFDocumentTextFlowFactory::setCalculateBoundingBoxes(bool calculateBoundin
     m_calculateBoundingBoxes = calculateBoundingBoxes;
 }
 
+void PDFDocumentTextFlowFactory::setFontCache(PDFFontCache* fontCache)
+{
+    m_fontCache = fontCache;
+}
+
 void PDFDocumentTextFlowEditor::setTextFlow(PDFDocumentTextFlow textFlow)
 {
     m_originalTextFlow = std::move(textFlow);
@@ -25,6 +25,7 @@
 namespace pdf
 {
 class PDFDocument;
+class PDFFontCache;
 
 /// Text flow extracted from document. Text flow can be created \p PDFDocumentTextFlowFactory.
 /// Flow can contain various items, not just text ones. Also, some manipulation functions
@@ -142,9 +143,17 @@ public:
     /// \param calculateBoundingBoxes Perform bounding box calculation?
     void setCalculateBoundingBoxes(bool calculateBoundingBoxes);
 
+    /// Sets font cache used for text analysis. If font cache is set, it must
+    /// be set to the analysed document and fonts are shared between multiple
+    /// calls of \p create (for example, when text is created in batches of pages).
+    /// If no font cache is set, then temporary font cache is used in each call.
+    /// \param fontCache Font cache
+    void setFontCache(PDFFontCache* fontCache);
+
 private:
     QList<PDFRenderError> m_errors;
     bool m_calculateBoundingBoxes = false;
+    PDFFontCache* m_fontCache = nullptr;
 };
 
 /// Editor which can edit document text flow, modify user text,
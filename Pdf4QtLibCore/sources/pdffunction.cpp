@@ -27,6 +27,7 @@
 
 #include "pdfdbgheap.h"
 
+#include <array>
 #include <stack>
 #include <iterator>
 #include <type_traits>
@@ -43,6 +44,37 @@ PDFFunction::PDFFunction(uint32_t m, uint32_t n, std::vector<PDFReal>&& domain,
 
 }
 
+PDFFunction::FunctionResult PDFFunction::applyBatch(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n, size_t count) const
+{
+    if (count == 0)
+    {
+        return true;
+    }
+
+    const size_t m = std::distance(x_1, x_m) / count;
+    const size_t n = std::distance(y_1, y_n) / count;
+
+    FunctionResult result(true);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const_iterator xSample = std::next(x_1, i * m);
+        iterator ySample = std::next(y_1, i * n);
+
+        FunctionResult sampleResult = apply(xSample, std::next(xSample, m), ySample, std::next(ySample, n));
+        if (!sampleResult)
+        {
+            std::fill(ySample, std::next(ySample, n), 0.0);
+
+            if (result)
+            {
+                result = qMove(sampleResult);
+            }
+        }
+    }
+
+    return result;
+}
+
 PDFFunctionPtr PDFFunction::createFunction(const PDFDocument* document, const PDFObject& object)
 {
     PDFParsingContext context(nullptr);
@@ -1580,234 +1612,1440 @@ void PDFPostScriptFunctionStack::checkUnderflow(size_t n) const
     }
 }
 
-PDFPostScriptFunction::Code PDFPostScriptFunction::getCode(const QByteArray& byteArray)
+/// Executes the compiled postscript program. Registers are stored for multiple
+/// samples (lanes) at once - register r of the lane l is stored at index r * lanes + l.
+/// Runtime errors (for example, division by zero) are not thrown, they are marked
+/// in the error array for each lane.
+class PDFPostScriptFunctionCompiledExecutor
 {
-    static constexpr const std::pair<Code, const  char*> codes[] =
-    {
-        // B.1 Arithmetic operators
-        std::pair<Code, const  char*>{ Code::Add, "add" },
-        std::pair<Code, const  char*>{ Code::Sub, "sub" },
-        std::pair<Code, const  char*>{ Code::Mul, "mul" },
-        std::pair<Code, const  char*>{ Code::Div, "div" },
-        std::pair<Code, const  char*>{ Code::Idiv, "idiv" },
-        std::pair<Code, const  char*>{ Code::Mod, "mod" },
-        std::pair<Code, const  char*>{ Code::Neg, "neg" },
-        std::pair<Code, const  char*>{ Code::Abs, "abs" },
-        std::pair<Code, const  char*>{ Code::Ceiling, "ceiling" },
-        std::pair<Code, const  char*>{ Code::Floor, "floor" },
-        std::pair<Code, const  char*>{ Code::Round, "round" },
-        std::pair<Code, const  char*>{ Code::Truncate, "truncate" },
-        std::pair<Code, const  char*>{ Code::Sqrt, "sqrt" },
-        std::pair<Code, const  char*>{ Code::Sin, "sin" },
-        std::pair<Code, const  char*>{ Code::Cos, "cos" },
-        std::pair<Code, const  char*>{ Code::Atan, "atan" },
-        std::pair<Code, const  char*>{ Code::Exp, "exp" },
-        std::pair<Code, const  char*>{ Code::Ln, "ln" },
-        std::pair<Code, const  char*>{ Code::Log, "log" },
-        std::pair<Code, const  char*>{ Code::Cvi, "cvi" },
-        std::pair<Code, const  char*>{ Code::Cvr, "cvr" },
-
-        // B.2 Relational, Boolean and Bitwise operators
-        std::pair<Code, const  char*>{ Code::Eq, "eq" },
-        std::pair<Code, const  char*>{ Code::Ne, "ne" },
-        std::pair<Code, const  char*>{ Code::Gt, "gt" },
-        std::pair<Code, const  char*>{ Code::Ge, "ge" },
-        std::pair<Code, const  char*>{ Code::Lt, "lt" },
-        std::pair<Code, const  char*>{ Code::Le, "le" },
-        std::pair<Code, const  char*>{ Code::And, "and" },
-        std::pair<Code, const  char*>{ Code::Or, "or" },
-        std::pair<Code, const  char*>{ Code::Xor, "xor" },
-        std::pair<Code, const  char*>{ Code::Not, "not" },
-        std::pair<Code, const  char*>{ Code::Bitshift, "bitshift" },
-        std::pair<Code, const  char*>{ Code::True, "true" },
-        std::pair<Code, const  char*>{ Code::False, "false" },
+public:
+    using CompiledCode = PDFPostScriptFunction::CompiledCode;
+    using CompiledInstruction = PDFPostScriptFunction::CompiledInstruction;
+    using CompiledProgram = PDFPostScriptFunction::CompiledProgram;
+    using Register = PDFPostScriptFunction::Register;
+    using PDFIntegerUnsigned = std::make_unsigned<PDFInteger>::type;
 
-        // B.3 Conditional operators
-        std::pair<Code, const  char*>{ Code::If, "if" },
-        std::pair<Code, const  char*>{ Code::IfElse, "ifelse" },
+    /// Executes the compiled program. If program contains jumps, then
+    /// only one lane can be executed at once.
+    /// \param program Compiled program
+    /// \param registers Registers
+    /// \param lanes Number of lanes
+    /// \param errors Error flags for each lane
+    static void execute(const CompiledProgram& program, Register* registers, size_t lanes, bool* errors);
+
+    /// Executes single instruction (jumps are not allowed)
+    /// \param instruction Instruction
+    /// \param registers Registers
+    /// \param lanes Number of lanes
+    /// \param errors Error flags for each lane
+    static void executeInstruction(const CompiledInstruction& instruction, Register* registers, size_t lanes, bool* errors);
+};
 
-        // B.4 Stack operators
-        std::pair<Code, const  char*>{ Code::Pop, "pop" },
-        std::pair<Code, const  char*>{ Code::Exch, "exch" },
-        std::pair<Code, const  char*>{ Code::Dup, "dup" },
-        std::pair<Code, const  char*>{ Code::Copy, "copy" },
-        std::pair<Code, const  char*>{ Code::Index, "index" },
-        std::pair<Code, const  char*>{ Code::Roll, "roll" }
-    };
+void PDFPostScriptFunctionCompiledExecutor::execute(const CompiledProgram& program, Register* registers, size_t lanes, bool* errors)
+{
+    Q_ASSERT(!program.hasJumps || lanes == 1);
 
-    for (const std::pair<Code, const  char*>& codeItem : codes)
+    const size_t codeSize = program.code.size();
+    size_t ip = 0;
+    while (ip < codeSize)
     {
-        if (byteArray == codeItem.second)
+        const CompiledInstruction& instruction = program.code[ip++];
+
+        switch (instruction.code)
         {
-            return codeItem.first;
+            case CompiledCode::Jump:
+                ip += instruction.target;
+                break;
+
+            case CompiledCode::JumpIfFalse:
+                if (!registers[instruction.operand1].boolean)
+                {
+                    ip += instruction.target;
+                }
+                break;
+
+            default:
+                executeInstruction(instruction, registers, lanes, errors);
+                break;
         }
     }
-
-    throw PDFException(PDFTranslationContext::tr("Invalid operator (PostScript function) '%1'.").arg(QString::fromLatin1(byteArray)));
 }
 
-PDFPostScriptFunction::PDFPostScriptFunction(uint32_t m, uint32_t n, std::vector<PDFReal>&& domain, std::vector<PDFReal>&& range, PDFPostScriptFunction::Program&& program) :
-    PDFFunction(m, n, std::move(domain), std::move(range)),
-    m_program(std::move(program))
+void PDFPostScriptFunctionCompiledExecutor::executeInstruction(const CompiledInstruction& instruction, Register* registers, size_t lanes, bool* errors)
 {
-    Q_ASSERT(!m_program.empty());
-}
+    Register* r = registers + instruction.target * lanes;
+    const Register* a = registers + instruction.operand1 * lanes;
+    const Register* b = registers + instruction.operand2 * lanes;
 
-PDFPostScriptFunction::~PDFPostScriptFunction()
-{
+    auto forEachLane = [lanes](auto operation)
+    {
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            operation(i);
+        }
+    };
 
-}
+    switch (instruction.code)
+    {
+        case CompiledCode::Move:
+            std::copy(a, a + lanes, r);
+            break;
 
-PDFPostScriptFunction::Program PDFPostScriptFunction::parseProgram(const QByteArray& byteArray)
-{
-    // Lexical analyzer can't handle when '{' or '}' is near next token (for example '{0' etc.)
-    QByteArray adjustedArray = byteArray;
-    adjustedArray.replace('{', " { ").replace('}', " } ");
+        case CompiledCode::IntToReal:
+            forEachLane([&](size_t i) { r[i].realNumber = a[i].integerNumber; });
+            break;
 
-    Program result;
-    PDFLexicalAnalyzer parser(adjustedArray.constBegin(), adjustedArray.constEnd());
-    parser.setTokenizingPostScriptFunction();
+        case CompiledCode::AddInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = a[i].integerNumber + b[i].integerNumber; });
+            break;
 
-    std::stack<InstructionPointer> blockCallStack;
-    while (true)
-    {
-        PDFLexicalAnalyzer::Token token = parser.fetch();
-        if (token.type == PDFLexicalAnalyzer::TokenType::EndOfFile)
-        {
-            // We are at end, stop the parsing
+        case CompiledCode::AddReal:
+            forEachLane([&](size_t i) { r[i].realNumber = a[i].realNumber + b[i].realNumber; });
             break;
-        }
 
-        switch (token.type)
-        {
-            case PDFLexicalAnalyzer::TokenType::Boolean:
-            {
-                result.emplace_back(OperandObject::createBoolean(token.data.toBool()), result.size() + 1);
-                break;
-            }
+        case CompiledCode::SubInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = a[i].integerNumber - b[i].integerNumber; });
+            break;
 
-            case PDFLexicalAnalyzer::TokenType::Integer:
+        case CompiledCode::SubReal:
+            forEachLane([&](size_t i) { r[i].realNumber = a[i].realNumber - b[i].realNumber; });
+            break;
+
+        case CompiledCode::MulInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = a[i].integerNumber * b[i].integerNumber; });
+            break;
+
+        case CompiledCode::MulReal:
+            forEachLane([&](size_t i) { r[i].realNumber = a[i].realNumber * b[i].realNumber; });
+            break;
+
+        case CompiledCode::DivReal:
+            forEachLane([&](size_t i)
             {
-                result.emplace_back(OperandObject::createInteger(token.data.toLongLong()), result.size() + 1);
-                break;
-            }
+                const bool isError = qFuzzyIsNull(b[i].realNumber);
+                errors[i] = errors[i] || isError;
+                r[i].realNumber = !isError ? a[i].realNumber / b[i].realNumber : 0.0;
+            });
+            break;
 
-            case PDFLexicalAnalyzer::TokenType::Real:
+        case CompiledCode::Idiv:
+            forEachLane([&](size_t i)
             {
-                result.emplace_back(OperandObject::createReal(token.data.toDouble()), result.size() + 1);
-                break;
-            }
+                const bool isError = b[i].integerNumber == 0;
+                errors[i] = errors[i] || isError;
+                r[i].integerNumber = !isError ? a[i].integerNumber / b[i].integerNumber : 0;
+            });
+            break;
 
-            case PDFLexicalAnalyzer::TokenType::Command:
+        case CompiledCode::Mod:
+            forEachLane([&](size_t i)
             {
-                QByteArray command = token.data.toByteArray();
-                if (command == "{")
-                {
-                    // Opening bracket - means start of block
-                    blockCallStack.push(result.size());
-                    result.emplace_back(Code::Call, INVALID_INSTRUCTION_POINTER);
-                    result.back().operand = OperandObject::createInstructionPointer(result.size());
-                }
-                else if (command == "}")
-                {
-                    // Closing bracket - means end of block
-                    if (blockCallStack.empty())
-                    {
-                        throw PDFException(PDFTranslationContext::tr("Invalid program - bad enclosing brackets (PostScript function)."));
-                    }
+                const bool isError = b[i].integerNumber == 0;
+                errors[i] = errors[i] || isError;
+                r[i].integerNumber = !isError ? a[i].integerNumber % b[i].integerNumber : 0;
+            });
+            break;
 
-                    result[blockCallStack.top()].next = result.size() + 1;
-                    blockCallStack.pop();
-                    result.emplace_back(Code::Return, INVALID_INSTRUCTION_POINTER);
-                }
-                else
-                {
-                    result.emplace_back(getCode(command), result.size() + 1);
-                }
+        case CompiledCode::NegInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = -a[i].integerNumber; });
+            break;
 
-                break;
-            }
+        case CompiledCode::NegReal:
+            forEachLane([&](size_t i) { r[i].realNumber = -a[i].realNumber; });
+            break;
 
-            default:
-            {
-                // All other tokens treat as invalid.
-                throw PDFException(PDFTranslationContext::tr("Invalid program (PostScript function)."));
-            }
-        }
-    }
+        case CompiledCode::AbsInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = qAbs(a[i].integerNumber); });
+            break;
 
-    if (result.empty())
-    {
-        throw PDFException(PDFTranslationContext::tr("Empty program (PostScript function)."));
-    }
+        case CompiledCode::AbsReal:
+            forEachLane([&](size_t i) { r[i].realNumber = qAbs(a[i].realNumber); });
+            break;
 
-    // We must insert execute instructions, where blocks without if/ifelse occurs.
-    // We can have following program "{ 2 3 add }" which must return 5. How to find blocks,
-    // after which instructions must be executed? Next instruction must be if, or next instruction
-    // must be a call and next-next instruction must be ifelse
+        case CompiledCode::Ceiling:
+            forEachLane([&](size_t i) { r[i].realNumber = std::ceil(a[i].realNumber); });
+            break;
 
-    auto isBlockUsed = [&result](InstructionPointer ip)
-    {
-        // We should call this function only on Call opcode
-        Q_ASSERT(result[ip].code == Code::Call);
+        case CompiledCode::Floor:
+            forEachLane([&](size_t i) { r[i].realNumber = std::floor(a[i].realNumber); });
+            break;
 
-        const InstructionPointer next = result[ip].next;
-        if (next < result.size())
-        {
-            switch (result[next].code)
+        case CompiledCode::Round:
+            forEachLane([&](size_t i) { r[i].realNumber = qRound(a[i].realNumber); });
+            break;
+
+        case CompiledCode::Truncate:
+            forEachLane([&](size_t i) { r[i].realNumber = std::trunc(a[i].realNumber); });
+            break;
+
+        case CompiledCode::Sqrt:
+            forEachLane([&](size_t i)
             {
-                case Code::If:
-                case Code::IfElse:
-                {
-                    // Block is used in 'If' statement
-                    return true;
-                }
+                const bool isError = a[i].realNumber < 0.0;
+                errors[i] = errors[i] || isError;
+                r[i].realNumber = !isError ? std::sqrt(a[i].realNumber) : 0.0;
+            });
+            break;
 
-                case Code::Call:
-                {
-                    // We must detect, if we use 'If-Else' statement
-                    const InstructionPointer nextnext = result[next].next;
+        case CompiledCode::Sin:
+            forEachLane([&](size_t i) { r[i].realNumber = qSin(qDegreesToRadians(a[i].realNumber)); });
+            break;
 
-                    if (nextnext < result.size())
-                    {
-                        return result[nextnext].code == Code::IfElse;
-                    }
-                    return false;
-                }
+        case CompiledCode::Cos:
+            forEachLane([&](size_t i) { r[i].realNumber = qCos(qDegreesToRadians(a[i].realNumber)); });
+            break;
 
-                default:
-                    return false;
-            }
-        }
+        case CompiledCode::Atan:
+            forEachLane([&](size_t i)
+            {
+                const PDFReal angles = qRadiansToDegrees(qAtan2(a[i].realNumber, b[i].realNumber));
+                r[i].realNumber = angles < 0.0 ? (angles + 360.0) : angles;
+            });
+            break;
 
-        return false;
-    };
+        case CompiledCode::Exp:
+            forEachLane([&](size_t i) { r[i].realNumber = qPow(a[i].realNumber, b[i].realNumber); });
+            break;
 
-    // Insert execute instructions, where there are call blocks, which are not used in if/ifelse statements
-    for (size_t i = 0; i < result.size(); ++i)
-    {
-        if (result[i].code == Code::Call && !isBlockUsed(i))
-        {
-            InstructionPointer insertPosition = result[i].next;
+        case CompiledCode::Ln:
+            forEachLane([&](size_t i)
+            {
+                const bool isError = a[i].realNumber < 0.0 || qFuzzyIsNull(a[i].realNumber);
+                errors[i] = errors[i] || isError;
+                r[i].realNumber = !isError ? qLn(a[i].realNumber) : 0.0;
+            });
+            break;
 
-            // We must update the instructions pointers for inserting the instruction
-            for (CodeObject& codeObject : result)
+        case CompiledCode::Log:
+            forEachLane([&](size_t i)
             {
-                if (codeObject.next > insertPosition && codeObject.next != INVALID_INSTRUCTION_POINTER)
-                {
-                    ++codeObject.next;
-                }
-                if (codeObject.operand.type == OperandType::InstructionPointer &&
-                    codeObject.operand.instructionPointer > insertPosition &&
-                    codeObject.operand.instructionPointer != INVALID_INSTRUCTION_POINTER)
-                {
-                    ++codeObject.operand.instructionPointer;
-                }
-            }
+                const bool isError = a[i].realNumber < 0.0 || qFuzzyIsNull(a[i].realNumber);
+                errors[i] = errors[i] || isError;
+                r[i].realNumber = !isError ? std::log10(a[i].realNumber) : 0.0;
+            });
+            break;
 
-            // We must insert an execute statement, block is not used in if/ifelse statement
-            result.insert(std::next(result.begin(), insertPosition), CodeObject(Code::Execute, insertPosition + 1));
-        }
+        case CompiledCode::Cvi:
+            forEachLane([&](size_t i) { r[i].integerNumber = static_cast<PDFInteger>(a[i].realNumber); });
+            break;
+
+        case CompiledCode::EqInt:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].integerNumber == b[i].integerNumber; });
+            break;
+
+        case CompiledCode::EqReal:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].realNumber == b[i].realNumber; });
+            break;
+
+        case CompiledCode::EqBool:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].boolean == b[i].boolean; });
+            break;
+
+        case CompiledCode::NeInt:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].integerNumber != b[i].integerNumber; });
+            break;
+
+        case CompiledCode::NeReal:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].realNumber != b[i].realNumber; });
+            break;
+
+        case CompiledCode::NeBool:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].boolean != b[i].boolean; });
+            break;
+
+        case CompiledCode::GtInt:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].integerNumber > b[i].integerNumber; });
+            break;
+
+        case CompiledCode::GtReal:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].realNumber > b[i].realNumber; });
+            break;
+
+        case CompiledCode::GeInt:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].integerNumber >= b[i].integerNumber; });
+            break;
+
+        case CompiledCode::GeReal:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].realNumber >= b[i].realNumber; });
+            break;
+
+        case CompiledCode::LtInt:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].integerNumber < b[i].integerNumber; });
+            break;
+
+        case CompiledCode::LtReal:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].realNumber < b[i].realNumber; });
+            break;
+
+        case CompiledCode::LeInt:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].integerNumber <= b[i].integerNumber; });
+            break;
+
+        case CompiledCode::LeReal:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].realNumber <= b[i].realNumber; });
+            break;
+
+        case CompiledCode::AndInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = static_cast<PDFIntegerUnsigned>(a[i].integerNumber) & static_cast<PDFIntegerUnsigned>(b[i].integerNumber); });
+            break;
+
+        case CompiledCode::AndBool:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].boolean && b[i].boolean; });
+            break;
+
+        case CompiledCode::OrInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = static_cast<PDFIntegerUnsigned>(a[i].integerNumber) | static_cast<PDFIntegerUnsigned>(b[i].integerNumber); });
+            break;
+
+        case CompiledCode::OrBool:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].boolean || b[i].boolean; });
+            break;
+
+        case CompiledCode::XorInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = static_cast<PDFIntegerUnsigned>(a[i].integerNumber) ^ static_cast<PDFIntegerUnsigned>(b[i].integerNumber); });
+            break;
+
+        case CompiledCode::XorBool:
+            forEachLane([&](size_t i) { r[i].boolean = a[i].boolean != b[i].boolean; });
+            break;
+
+        case CompiledCode::NotInt:
+            forEachLane([&](size_t i) { r[i].integerNumber = ~static_cast<PDFIntegerUnsigned>(a[i].integerNumber); });
+            break;
+
+        case CompiledCode::NotBool:
+            forEachLane([&](size_t i) { r[i].boolean = !a[i].boolean; });
+            break;
+
+        case CompiledCode::Bitshift:
+            forEachLane([&](size_t i)
+            {
+                const PDFInteger shift = b[i].integerNumber;
+                const PDFIntegerUnsigned value = static_cast<PDFIntegerUnsigned>(a[i].integerNumber);
+                PDFIntegerUnsigned shiftedValue = value;
+
+                if (shift > 0)
+                {
+                    // Positive is left
+                    shiftedValue = value << shift;
+                }
+                else if (shift < 0)
+                {
+                    // Negative is right
+                    shiftedValue = value >> -shift;
+                }
+
+                r[i].integerNumber = shiftedValue;
+            });
+            break;
+
+        case CompiledCode::Jump:
+        case CompiledCode::JumpIfFalse:
+            Q_ASSERT(false);
+            break;
+    }
+}
+
+/// Compiles the postscript program into the register code. Stack is simulated
+/// during the compilation, so each stack operation is resolved statically (stack
+/// contains only register indices). Operations with constant operands are
+/// evaluated during the compilation. If the program can't be compiled
+/// (stack depth or operand types can't be determined statically,
+/// or the program is erroneous), exception is thrown.
+class PDFPostScriptFunctionCompiler
+{
+public:
+    using Program = PDFPostScriptFunction::Program;
+    using CodeObject = PDFPostScriptFunction::CodeObject;
+    using Code = PDFPostScriptFunction::Code;
+    using OperandType = PDFPostScriptFunction::OperandType;
+    using OperandObject = PDFPostScriptFunction::OperandObject;
+    using InstructionPointer = PDFPostScriptFunction::InstructionPointer;
+    using CompiledCode = PDFPostScriptFunction::CompiledCode;
+    using CompiledInstruction = PDFPostScriptFunction::CompiledInstruction;
+    using CompiledProgram = PDFPostScriptFunction::CompiledProgram;
+    using Register = PDFPostScriptFunction::Register;
+    using RegisterIndex = PDFPostScriptFunction::RegisterIndex;
+
+    explicit inline PDFPostScriptFunctionCompiler(const Program& program) :
+        m_program(program),
+        m_processedInstructionCount(0)
+    {
+
+    }
+
+    /// Compiles the program
+    /// \param m Number of input variables
+    /// \param n Number of output variables
+    CompiledProgram compile(uint32_t m, uint32_t n);
+
+private:
+    static constexpr const size_t MAX_STACK_SIZE = 100;
+    static constexpr const size_t MAX_BLOCK_DEPTH = 32;
+    static constexpr const size_t MAX_PROCESSED_INSTRUCTIONS = 16384;
+    static constexpr const size_t MAX_REGISTERS = std::numeric_limits<RegisterIndex>::max();
+
+    using Stack = std::vector<RegisterIndex>;
+    using CompiledCodeBlock = std::vector<CompiledInstruction>;
+
+    struct RegisterInfo
+    {
+        OperandType type = OperandType::Real;
+        bool isConstant = false;
+    };
+
+    [[noreturn]] static void fail();
+
+    RegisterIndex addRegister(OperandType type, bool isConstant);
+    RegisterIndex addConstant(const OperandObject& operand);
+
+    RegisterIndex pop(Stack& stack);
+    void push(Stack& stack, RegisterIndex index);
+
+    bool isType(RegisterIndex index, OperandType type) const { return m_registerInfos[index].type == type; }
+    bool isConstant(RegisterIndex index) const { return m_registerInfos[index].isConstant; }
+
+    /// Converts integer register to the real register (real register is left unchanged),
+    /// other types are treated as error.
+    RegisterIndex toReal(RegisterIndex index, CompiledCodeBlock& code);
+
+    /// Emits instruction. If all operands are constant, instruction is evaluated
+    /// and constant register is returned instead.
+    RegisterIndex emit(CompiledCode compiledCode, OperandType resultType, RegisterIndex operand1, RegisterIndex operand2, bool isBinary, CompiledCodeBlock& code);
+    RegisterIndex emitUnary(CompiledCode compiledCode, OperandType resultType, RegisterIndex operand, CompiledCodeBlock& code) { return emit(compiledCode, resultType, operand, operand, false, code); }
+    RegisterIndex emitBinary(CompiledCode compiledCode, OperandType resultType, RegisterIndex operand1, RegisterIndex operand2, CompiledCodeBlock& code) { return emit(compiledCode, resultType, operand1, operand2, true, code); }
+
+    /// Compiles arithmetic operation with integer/real variant
+    void compileArithmetic(CompiledCode intCode, CompiledCode realCode, OperandType realResultType, Stack& stack, CompiledCodeBlock& code);
+
+    /// Compiles logical operation with integer/boolean variant
+    void compileLogical(CompiledCode intCode, CompiledCode boolCode, Stack& stack, CompiledCodeBlock& code);
+
+    /// Pops constant integer from the stack
+    PDFInteger popConstantInteger(Stack& stack);
+
+    /// Pops constant instruction pointer from the stack
+    InstructionPointer popConstantInstructionPointer(Stack& stack);
+
+    /// Compiles a sequence of instructions starting at \p ip. If \p isBlock is true,
+    /// then sequence must be terminated by return instruction.
+    void compileSequence(InstructionPointer ip, bool isBlock, size_t depth, Stack& stack, CompiledCodeBlock& code);
+
+    /// Compiles conditional statement. If \p falseBlock is invalid instruction pointer,
+    /// then if statement is compiled, otherwise if-else statement is compiled.
+    void compileConditional(RegisterIndex condition, InstructionPointer trueBlock, InstructionPointer falseBlock, size_t depth, Stack& stack, CompiledCodeBlock& code);
+
+    const Program& m_program;
+    size_t m_processedInstructionCount;
+    std::vector<RegisterInfo> m_registerInfos;
+    std::vector<Register> m_registers;
+};
+
+void PDFPostScriptFunctionCompiler::fail()
+{
+    throw PDFPostScriptFunction::PDFPostScriptFunctionException(QString());
+}
+
+PDFPostScriptFunctionCompiler::RegisterIndex PDFPostScriptFunctionCompiler::addRegister(OperandType type, bool isConstant)
+{
+    if (m_registers.size() >= MAX_REGISTERS)
+    {
+        fail();
+    }
+
+    RegisterInfo info;
+    info.type = type;
+    info.isConstant = isConstant;
+    m_registerInfos.push_back(info);
+    m_registers.emplace_back();
+    m_registers.back().realNumber = 0.0;
+    return static_cast<RegisterIndex>(m_registers.size() - 1);
+}
+
+PDFPostScriptFunctionCompiler::RegisterIndex PDFPostScriptFunctionCompiler::addConstant(const OperandObject& operand)
+{
+    const RegisterIndex index = addRegister(operand.type, true);
+    Register& value = m_registers[index];
+
+    switch (operand.type)
+    {
+        case OperandType::Real:
+            value.realNumber = operand.realNumber;
+            break;
+
+        case OperandType::Integer:
+            value.integerNumber = operand.integerNumber;
+            break;
+
+        case OperandType::Boolean:
+            value.boolean = operand.boolean;
+            break;
+
+        case OperandType::InstructionPointer:
+            value.instructionPointer = operand.instructionPointer;
+            break;
+    }
+
+    return index;
+}
+
+PDFPostScriptFunctionCompiler::RegisterIndex PDFPostScriptFunctionCompiler::pop(Stack& stack)
+{
+    if (stack.empty())
+    {
+        fail();
+    }
+
+    const RegisterIndex index = stack.back();
+    stack.pop_back();
+    return index;
+}
+
+void PDFPostScriptFunctionCompiler::push(Stack& stack, RegisterIndex index)
+{
+    stack.push_back(index);
+
+    if (stack.size() > MAX_STACK_SIZE)
+    {
+        fail();
+    }
+}
+
+PDFPostScriptFunctionCompiler::RegisterIndex PDFPostScriptFunctionCompiler::toReal(RegisterIndex index, CompiledCodeBlock& code)
+{
+    if (isType(index, OperandType::Real))
+    {
+        return index;
+    }
+
+    if (isType(index, OperandType::Integer))
+    {
+        return emitUnary(CompiledCode::IntToReal, OperandType::Real, index, code);
+    }
+
+    fail();
+}
+
+PDFPostScriptFunctionCompiler::RegisterIndex PDFPostScriptFunctionCompiler::emit(CompiledCode compiledCode,
+                                                                                 OperandType resultType,
+                                                                                 RegisterIndex operand1,
+                                                                                 RegisterIndex operand2,
+                                                                                 bool isBinary,
+                                                                                 CompiledCodeBlock& code)
+{
+    if (isConstant(operand1) && (!isBinary || isConstant(operand2)))
+    {
+        // Constant folding - evaluate the instruction now
+        std::array<Register, 3> registers = { m_registers[operand1], m_registers[operand2], Register() };
+
+        CompiledInstruction instruction;
+        instruction.code = compiledCode;
+        instruction.operand1 = 0;
+        instruction.operand2 = 1;
+        instruction.target = 2;
+
+        bool isError = false;
+        PDFPostScriptFunctionCompiledExecutor::executeInstruction(instruction, registers.data(), 1, &isError);
+
+        if (isError)
+        {
+            // Program fails always, let the interpreter report the error
+            fail();
+        }
+
+        const RegisterIndex index = addRegister(resultType, true);
+        m_registers[index] = registers[2];
+        return index;
+    }
+
+    const RegisterIndex index = addRegister(resultType, false);
+
+    CompiledInstruction instruction;
+    instruction.code = compiledCode;
+    instruction.target = index;
+    instruction.operand1 = operand1;
+    instruction.operand2 = operand2;
+    code.push_back(instruction);
+
+    return index;
+}
+
+void PDFPostScriptFunctionCompiler::compileArithmetic(CompiledCode intCode, CompiledCode realCode, OperandType realResultType, Stack& stack, CompiledCodeBlock& code)
+{
+    const RegisterIndex b = pop(stack);
+    const RegisterIndex a = pop(stack);
+
+    if (isType(a, OperandType::Integer) && isType(b, OperandType::Integer))
+    {
+        const OperandType intResultType = (realResultType == OperandType::Boolean) ? OperandType::Boolean : OperandType::Integer;
+        push(stack, emitBinary(intCode, intResultType, a, b, code));
+    }
+    else
+    {
+        const RegisterIndex aReal = toReal(a, code);
+        const RegisterIndex bReal = toReal(b, code);
+        push(stack, emitBinary(realCode, realResultType, aReal, bReal, code));
+    }
+}
+
+void PDFPostScriptFunctionCompiler::compileLogical(CompiledCode intCode, CompiledCode boolCode, Stack& stack, CompiledCodeBlock& code)
+{
+    const RegisterIndex b = pop(stack);
+    const RegisterIndex a = pop(stack);
+
+    if (isType(a, OperandType::Boolean) && isType(b, OperandType::Boolean))
+    {
+        push(stack, emitBinary(boolCode, OperandType::Boolean, a, b, code));
+    }
+    else if (isType(a, OperandType::Integer) && isType(b, OperandType::Integer))
+    {
+        push(stack, emitBinary(intCode, OperandType::Integer, a, b, code));
+    }
+    else
+    {
+        fail();
+    }
+}
+
+PDFInteger PDFPostScriptFunctionCompiler::popConstantInteger(Stack& stack)
+{
+    const RegisterIndex index = pop(stack);
+
+    if (!isType(index, OperandType::Integer) || !isConstant(index))
+    {
+        fail();
+    }
+
+    return m_registers[index].integerNumber;
+}
+
+PDFPostScriptFunctionCompiler::InstructionPointer PDFPostScriptFunctionCompiler::popConstantInstructionPointer(Stack& stack)
+{
+    const RegisterIndex index = pop(stack);
+
+    if (!isType(index, OperandType::InstructionPointer))
+    {
+        fail();
+    }
+
+    Q_ASSERT(isConstant(index));
+    return m_registers[index].instructionPointer;
+}
+
+void PDFPostScriptFunctionCompiler::compileConditional(RegisterIndex condition,
+                                                       InstructionPointer trueBlock,
+                                                       InstructionPointer falseBlock,
+                                                       size_t depth,
+                                                       Stack& stack,
+                                                       CompiledCodeBlock& code)
+{
+    if (isConstant(condition))
+    {
+        // Condition is known, compile only the executed branch
+        if (m_registers[condition].boolean)
+        {
+            compileSequence(trueBlock, true, depth + 1, stack, code);
+        }
+        else if (falseBlock != PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER)
+        {
+            compileSequence(falseBlock, true, depth + 1, stack, code);
+        }
+        return;
+    }
+
+    Stack trueStack = stack;
+    CompiledCodeBlock trueCode;
+    compileSequence(trueBlock, true, depth + 1, trueStack, trueCode);
+
+    Stack falseStack = stack;
+    CompiledCodeBlock falseCode;
+    if (falseBlock != PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER)
+    {
+        compileSequence(falseBlock, true, depth + 1, falseStack, falseCode);
+    }
+
+    // Both branches must leave the stack of the same shape. Values, which
+    // differ in the branches, are moved to the new (merge) registers.
+    if (trueStack.size() != falseStack.size())
+    {
+        fail();
+    }
+
+    for (size_t i = 0; i < trueStack.size(); ++i)
+    {
+        const RegisterIndex trueIndex = trueStack[i];
+        const RegisterIndex falseIndex = falseStack[i];
+
+        if (trueIndex == falseIndex)
+        {
+            continue;
+        }
+
+        const OperandType type = m_registerInfos[trueIndex].type;
+        if (type != m_registerInfos[falseIndex].type || type == OperandType::InstructionPointer)
+        {
+            fail();
+        }
+
+        const RegisterIndex mergeIndex = addRegister(type, false);
+
+        CompiledInstruction moveInstruction;
+        moveInstruction.code = CompiledCode::Move;
+        moveInstruction.target = mergeIndex;
+
+        moveInstruction.operand1 = trueIndex;
+        trueCode.push_back(moveInstruction);
+
+        moveInstruction.operand1 = falseIndex;
+        falseCode.push_back(moveInstruction);
+
+        trueStack[i] = mergeIndex;
+    }
+
+    if (trueCode.size() + falseCode.size() + code.size() + 2 >= MAX_REGISTERS)
+    {
+        fail();
+    }
+
+    CompiledInstruction jumpIfFalseInstruction;
+    jumpIfFalseInstruction.code = CompiledCode::JumpIfFalse;
+    jumpIfFalseInstruction.operand1 = condition;
+    jumpIfFalseInstruction.target = static_cast<RegisterIndex>(trueCode.size() + (falseCode.empty() ? 0 : 1));
+    code.push_back(jumpIfFalseInstruction);
+    code.insert(code.end(), trueCode.cbegin(), trueCode.cend());
+
+    if (!falseCode.empty())
+    {
+        CompiledInstruction jumpInstruction;
+        jumpInstruction.code = CompiledCode::Jump;
+        jumpInstruction.target = static_cast<RegisterIndex>(falseCode.size());
+        code.push_back(jumpInstruction);
+        code.insert(code.end(), falseCode.cbegin(), falseCode.cend());
+    }
+
+    stack = qMove(trueStack);
+}
+
+void PDFPostScriptFunctionCompiler::compileSequence(InstructionPointer ip, bool isBlock, size_t depth, Stack& stack, CompiledCodeBlock& code)
+{
+    if (depth > MAX_BLOCK_DEPTH)
+    {
+        fail();
+    }
+
+    while (ip != PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER)
+    {
+        if (ip >= m_program.size() || ++m_processedInstructionCount > MAX_PROCESSED_INSTRUCTIONS)
+        {
+            fail();
+        }
+
+        const CodeObject& instruction = m_program[ip];
+        switch (instruction.code)
+        {
+            case Code::Add:
+                compileArithmetic(CompiledCode::AddInt, CompiledCode::AddReal, OperandType::Real, stack, code);
+                break;
+
+            case Code::Sub:
+                compileArithmetic(CompiledCode::SubInt, CompiledCode::SubReal, OperandType::Real, stack, code);
+                break;
+
+            case Code::Mul:
+                compileArithmetic(CompiledCode::MulInt, CompiledCode::MulReal, OperandType::Real, stack, code);
+                break;
+
+            case Code::Div:
+            case Code::Atan:
+            case Code::Exp:
+            {
+                const RegisterIndex b = toReal(pop(stack), code);
+                const RegisterIndex a = toReal(pop(stack), code);
+
+                CompiledCode compiledCode = CompiledCode::DivReal;
+                if (instruction.code == Code::Atan)
+                {
+                    compiledCode = CompiledCode::Atan;
+                }
+                else if (instruction.code == Code::Exp)
+                {
+                    compiledCode = CompiledCode::Exp;
+                }
+
+                push(stack, emitBinary(compiledCode, OperandType::Real, a, b, code));
+                break;
+            }
+
+            case Code::Idiv:
+            case Code::Mod:
+            case Code::Bitshift:
+            {
+                const RegisterIndex b = pop(stack);
+                const RegisterIndex a = pop(stack);
+
+                if (!isType(a, OperandType::Integer) || !isType(b, OperandType::Integer))
+                {
+                    fail();
+                }
+
+                CompiledCode compiledCode = CompiledCode::Idiv;
+                if (instruction.code == Code::Mod)
+                {
+                    compiledCode = CompiledCode::Mod;
+                }
+                else if (instruction.code == Code::Bitshift)
+                {
+                    compiledCode = CompiledCode::Bitshift;
+                }
+
+                push(stack, emitBinary(compiledCode, OperandType::Integer, a, b, code));
+                break;
+            }
+
+            case Code::Neg:
+            case Code::Abs:
+            {
+                const RegisterIndex a = pop(stack);
+                const bool isNeg = instruction.code == Code::Neg;
+
+                if (isType(a, OperandType::Integer))
+                {
+                    push(stack, emitUnary(isNeg ? CompiledCode::NegInt : CompiledCode::AbsInt, OperandType::Integer, a, code));
+                }
+                else if (isType(a, OperandType::Real))
+                {
+                    push(stack, emitUnary(isNeg ? CompiledCode::NegReal : CompiledCode::AbsReal, OperandType::Real, a, code));
+                }
+                else
+                {
+                    fail();
+                }
+                break;
+            }
+
+            case Code::Ceiling:
+            case Code::Floor:
+            case Code::Round:
+            case Code::Truncate:
+            case Code::Cvi:
+            {
+                const RegisterIndex a = pop(stack);
+
+                if (isType(a, OperandType::Integer))
+                {
+                    // Integer value is left unchanged
+                    push(stack, a);
+                }
+                else if (isType(a, OperandType::Real))
+                {
+                    CompiledCode compiledCode = CompiledCode::Ceiling;
+                    OperandType resultType = OperandType::Real;
+                    switch (instruction.code)
+                    {
+                        case Code::Floor:
+                            compiledCode = CompiledCode::Floor;
+                            break;
+
+                        case Code::Round:
+                            compiledCode = CompiledCode::Round;
+                            break;
+
+                        case Code::Truncate:
+                            compiledCode = CompiledCode::Truncate;
+                            break;
+
+                        case Code::Cvi:
+                            compiledCode = CompiledCode::Cvi;
+                            resultType = OperandType::Integer;
+                            break;
+
+                        default:
+                            break;
+                    }
+
+                    push(stack, emitUnary(compiledCode, resultType, a, code));
+                }
+                else
+                {
+                    fail();
+                }
+                break;
+            }
+
+            case Code::Sqrt:
+            case Code::Sin:
+            case Code::Cos:
+            case Code::Ln:
+            case Code::Log:
+            {
+                const RegisterIndex a = toReal(pop(stack), code);
+
+                CompiledCode compiledCode = CompiledCode::Sqrt;
+                switch (instruction.code)
+                {
+                    case Code::Sin:
+                        compiledCode = CompiledCode::Sin;
+                        break;
+
+                    case Code::Cos:
+                        compiledCode = CompiledCode::Cos;
+                        break;
+
+                    case Code::Ln:
+                        compiledCode = CompiledCode::Ln;
+                        break;
+
+                    case Code::Log:
+                        compiledCode = CompiledCode::Log;
+                        break;
+
+                    default:
+                        break;
+                }
+
+                push(stack, emitUnary(compiledCode, OperandType::Real, a, code));
+                break;
+            }
+
+            case Code::Cvr:
+            {
+                const RegisterIndex a = pop(stack);
+
+                if (!isType(a, OperandType::Integer) && !isType(a, OperandType::Real))
+                {
+                    fail();
+                }
+
+                push(stack, toReal(a, code));
+                break;
+            }
+
+            case Code::Eq:
+            case Code::Ne:
+            {
+                const bool isEq = instruction.code == Code::Eq;
+                const RegisterIndex b = stack.size() >= 2 ? stack[stack.size() - 1] : 0;
+                const RegisterIndex a = stack.size() >= 2 ? stack[stack.size() - 2] : 0;
+
+                if (stack.size() >= 2 && isType(a, OperandType::Boolean) && isType(b, OperandType::Boolean))
+                {
+                    stack.resize(stack.size() - 2);
+                    push(stack, emitBinary(isEq ? CompiledCode::EqBool : CompiledCode::NeBool, OperandType::Boolean, a, b, code));
+                }
+                else if (isEq)
+                {
+                    compileArithmetic(CompiledCode::EqInt, CompiledCode::EqReal, OperandType::Boolean, stack, code);
+                }
+                else
+                {
+                    compileArithmetic(CompiledCode::NeInt, CompiledCode::NeReal, OperandType::Boolean, stack, code);
+                }
+                break;
+            }
+
+            case Code::Gt:
+                compileArithmetic(CompiledCode::GtInt, CompiledCode::GtReal, OperandType::Boolean, stack, code);
+                break;
+
+            case Code::Ge:
+                compileArithmetic(CompiledCode::GeInt, CompiledCode::GeReal, OperandType::Boolean, stack, code);
+                break;
+
+            case Code::Lt:
+                compileArithmetic(CompiledCode::LtInt, CompiledCode::LtReal, OperandType::Boolean, stack, code);
+                break;
+
+            case Code::Le:
+                compileArithmetic(CompiledCode::LeInt, CompiledCode::LeReal, OperandType::Boolean, stack, code);
+                break;
+
+            case Code::And:
+                compileLogical(CompiledCode::AndInt, CompiledCode::AndBool, stack, code);
+                break;
+
+            case Code::Or:
+                compileLogical(CompiledCode::OrInt, CompiledCode::OrBool, stack, code);
+                break;
+
+            case Code::Xor:
+                compileLogical(CompiledCode::XorInt, CompiledCode::XorBool, stack, code);
+                break;
+
+            case Code::Not:
+            {
+                const RegisterIndex a = pop(stack);
+
+                if (isType(a, OperandType::Integer))
+                {
+                    push(stack, emitUnary(CompiledCode::NotInt, OperandType::Integer, a, code));
+                }
+                else if (isType(a, OperandType::Boolean))
+                {
+                    push(stack, emitUnary(CompiledCode::NotBool, OperandType::Boolean, a, code));
+                }
+                else
+                {
+                    fail();
+                }
+                break;
+            }
+
+            case Code::True:
+                push(stack, addConstant(OperandObject::createBoolean(true)));
+                break;
+
+            case Code::False:
+                push(stack, addConstant(OperandObject::createBoolean(false)));
+                break;
+
+            case Code::If:
+            {
+                const InstructionPointer trueBlock = popConstantInstructionPointer(stack);
+                const RegisterIndex condition = pop(stack);
+
+                if (!isType(condition, OperandType::Boolean))
+                {
+                    fail();
+                }
+
+                compileConditional(condition, trueBlock, PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER, depth, stack, code);
+                break;
+            }
+
+            case Code::IfElse:
+            {
+                const InstructionPointer falseBlock = popConstantInstructionPointer(stack);
+                const InstructionPointer trueBlock = popConstantInstructionPointer(stack);
+                const RegisterIndex condition = pop(stack);
+
+                if (!isType(condition, OperandType::Boolean))
+                {
+                    fail();
+                }
+
+                compileConditional(condition, trueBlock, falseBlock, depth, stack, code);
+                break;
+            }
+
+            case Code::Pop:
+                pop(stack);
+                break;
+
+            case Code::Exch:
+            {
+                if (stack.size() < 2)
+                {
+                    fail();
+                }
+
+                std::swap(stack[stack.size() - 2], stack[stack.size() - 1]);
+                break;
+            }
+
+            case Code::Dup:
+            {
+                if (stack.empty())
+                {
+                    fail();
+                }
+
+                push(stack, stack.back());
+                break;
+            }
+
+            case Code::Copy:
+            {
+                const PDFInteger n = popConstantInteger(stack);
+
+                if (n < 0 || static_cast<size_t>(n) > stack.size())
+                {
+                    fail();
+                }
+
+                const size_t startIndex = stack.size() - n;
+                for (size_t i = 0; i < static_cast<size_t>(n); ++i)
+                {
+                    push(stack, stack[startIndex + i]);
+                }
+                break;
+            }
+
+            case Code::Index:
+            {
+                const PDFInteger n = popConstantInteger(stack);
+
+                if (n < 0 || static_cast<size_t>(n) >= stack.size())
+                {
+                    fail();
+                }
+
+                push(stack, stack[stack.size() - 1 - n]);
+                break;
+            }
+
+            case Code::Roll:
+            {
+                PDFInteger j = popConstantInteger(stack);
+                const PDFInteger n = popConstantInteger(stack);
+
+                if (n < 0)
+                {
+                    fail();
+                }
+
+                if (n == 0)
+                {
+                    break;
+                }
+
+                j = j % n;
+                if (j == 0)
+                {
+                    break;
+                }
+
+                if (static_cast<size_t>(n) > stack.size())
+                {
+                    fail();
+                }
+
+                auto first = std::next(stack.begin(), stack.size() - n);
+                if (j > 0)
+                {
+                    // Rotate left j times
+                    std::rotate(first, stack.end() - j, stack.end());
+                }
+                else
+                {
+                    // Rotate right j times
+                    std::rotate(first, first - j, stack.end());
+                }
+                break;
+            }
+
+            case Code::Call:
+                push(stack, addConstant(instruction.operand));
+                break;
+
+            case Code::Return:
+            {
+                if (!isBlock)
+                {
+                    fail();
+                }
+
+                return;
+            }
+
+            case Code::Push:
+                push(stack, addConstant(instruction.operand));
+                break;
+
+            case Code::Execute:
+            {
+                const InstructionPointer block = popConstantInstructionPointer(stack);
+                compileSequence(block, true, depth + 1, stack, code);
+                break;
+            }
+        }
+
+        ip = instruction.next;
+    }
+
+    if (isBlock)
+    {
+        // Block must be terminated by return
+        fail();
+    }
+}
+
+PDFPostScriptFunctionCompiler::CompiledProgram PDFPostScriptFunctionCompiler::compile(uint32_t m, uint32_t n)
+{
+    CompiledProgram compiledProgram;
+
+    try
+    {
+        if (m_program.empty() || m > MAX_STACK_SIZE)
+        {
+            fail();
+        }
+
+        Stack stack;
+        CompiledCodeBlock code;
+
+        // Input values are always real numbers
+        for (uint32_t i = 0; i < m; ++i)
+        {
+            push(stack, addRegister(OperandType::Real, false));
+        }
+
+        compileSequence(0, false, 0, stack, code);
+
+        if (stack.size() != n)
+        {
+            fail();
+        }
+
+        for (RegisterIndex index : stack)
+        {
+            if (!isType(index, OperandType::Integer) && !isType(index, OperandType::Real))
+            {
+                fail();
+            }
+
+            compiledProgram.outputRegisters.push_back(index);
+            compiledProgram.outputIsInteger.push_back(isType(index, OperandType::Integer));
+        }
+
+        compiledProgram.hasJumps = std::any_of(code.cbegin(), code.cend(), [](const CompiledInstruction& instruction) { return instruction.code == CompiledCode::Jump || instruction.code == CompiledCode::JumpIfFalse; });
+        compiledProgram.code = qMove(code);
+        compiledProgram.registers = qMove(m_registers);
+        compiledProgram.isValid = true;
+    }
+    catch (const PDFPostScriptFunction::PDFPostScriptFunctionException&)
+    {
+        // Program can't be compiled, it will be interpreted
+        compiledProgram = CompiledProgram();
+    }
+
+    return compiledProgram;
+}
+
+PDFPostScriptFunction::Code PDFPostScriptFunction::getCode(const QByteArray& byteArray)
+{
+    static constexpr const std::pair<Code, const  char*> codes[] =
+    {
+        // B.1 Arithmetic operators
+        std::pair<Code, const  char*>{ Code::Add, "add" },
+        std::pair<Code, const  char*>{ Code::Sub, "sub" },
+        std::pair<Code, const  char*>{ Code::Mul, "mul" },
+        std::pair<Code, const  char*>{ Code::Div, "div" },
+        std::pair<Code, const  char*>{ Code::Idiv, "idiv" },
+        std::pair<Code, const  char*>{ Code::Mod, "mod" },
+        std::pair<Code, const  char*>{ Code::Neg, "neg" },
+        std::pair<Code, const  char*>{ Code::Abs, "abs" },
+        std::pair<Code, const  char*>{ Code::Ceiling, "ceiling" },
+        std::pair<Code, const  char*>{ Code::Floor, "floor" },
+        std::pair<Code, const  char*>{ Code::Round, "round" },
+        std::pair<Code, const  char*>{ Code::Truncate, "truncate" },
+        std::pair<Code, const  char*>{ Code::Sqrt, "sqrt" },
+        std::pair<Code, const  char*>{ Code::Sin, "sin" },
+        std::pair<Code, const  char*>{ Code::Cos, "cos" },
+        std::pair<Code, const  char*>{ Code::Atan, "atan" },
+        std::pair<Code, const  char*>{ Code::Exp, "exp" },
+        std::pair<Code, const  char*>{ Code::Ln, "ln" },
+        std::pair<Code, const  char*>{ Code::Log, "log" },
+        std::pair<Code, const  char*>{ Code::Cvi, "cvi" },
+        std::pair<Code, const  char*>{ Code::Cvr, "cvr" },
+
+        // B.2 Relational, Boolean and Bitwise operators
+        std::pair<Code, const  char*>{ Code::Eq, "eq" },
+        std::pair<Code, const  char*>{ Code::Ne, "ne" },
+        std::pair<Code, const  char*>{ Code::Gt, "gt" },
+        std::pair<Code, const  char*>{ Code::Ge, "ge" },
+        std::pair<Code, const  char*>{ Code::Lt, "lt" },
+        std::pair<Code, const  char*>{ Code::Le, "le" },
+        std::pair<Code, const  char*>{ Code::And, "and" },
+        std::pair<Code, const  char*>{ Code::Or, "or" },
+        std::pair<Code, const  char*>{ Code::Xor, "xor" },
+        std::pair<Code, const  char*>{ Code::Not, "not" },
+        std::pair<Code, const  char*>{ Code::Bitshift, "bitshift" },
+        std::pair<Code, const  char*>{ Code::True, "true" },
+        std::pair<Code, const  char*>{ Code::False, "false" },
+
+        // B.3 Conditional operators
+        std::pair<Code, const  char*>{ Code::If, "if" },
+        std::pair<Code, const  char*>{ Code::IfElse, "ifelse" },
+
+        // B.4 Stack operators
+        std::pair<Code, const  char*>{ Code::Pop, "pop" },
+        std::pair<Code, const  char*>{ Code::Exch, "exch" },
+        std::pair<Code, const  char*>{ Code::Dup, "dup" },
+        std::pair<Code, const  char*>{ Code::Copy, "copy" },
+        std::pair<Code, const  char*>{ Code::Index, "index" },
+        std::pair<Code, const  char*>{ Code::Roll, "roll" }
+    };
+
+    for (const std::pair<Code, const  char*>& codeItem : codes)
+    {
+        if (byteArray == codeItem.second)
+        {
+            return codeItem.first;
+        }
+    }
+
+    throw PDFException(PDFTranslationContext::tr("Invalid operator (PostScript function) '%1'.").arg(QString::fromLatin1(byteArray)));
+}
+
+PDFPostScriptFunction::PDFPostScriptFunction(uint32_t m, uint32_t n, std::vector<PDFReal>&& domain, std::vector<PDFReal>&& range, PDFPostScriptFunction::Program&& program) :
+    PDFFunction(m, n, std::move(domain), std::move(range)),
+    m_program(std::move(program))
+{
+    Q_ASSERT(!m_program.empty());
+    m_compiledProgram = compile(m_program, m_m, m_n);
+}
+
+PDFPostScriptFunction::CompiledProgram PDFPostScriptFunction::compile(const Program& program, uint32_t m, uint32_t n)
+{
+    PDFPostScriptFunctionCompiler compiler(program);
+    return compiler.compile(m, n);
+}
+
+PDFPostScriptFunction::~PDFPostScriptFunction()
+{
+
+}
+
+PDFPostScriptFunction::Program PDFPostScriptFunction::parseProgram(const QByteArray& byteArray)
+{
+    // Lexical analyzer can't handle when '{' or '}' is near next token (for example '{0' etc.)
+    QByteArray adjustedArray = byteArray;
+    adjustedArray.replace('{', " { ").replace('}', " } ");
+
+    Program result;
+    PDFLexicalAnalyzer parser(adjustedArray.constBegin(), adjustedArray.constEnd());
+    parser.setTokenizingPostScriptFunction();
+
+    std::stack<InstructionPointer> blockCallStack;
+    while (true)
+    {
+        PDFLexicalAnalyzer::Token token = parser.fetch();
+        if (token.type == PDFLexicalAnalyzer::TokenType::EndOfFile)
+        {
+            // We are at end, stop the parsing
+            break;
+        }
+
+        switch (token.type)
+        {
+            case PDFLexicalAnalyzer::TokenType::Boolean:
+            {
+                result.emplace_back(OperandObject::createBoolean(token.data.toBool()), result.size() + 1);
+                break;
+            }
+
+            case PDFLexicalAnalyzer::TokenType::Integer:
+            {
+                result.emplace_back(OperandObject::createInteger(token.data.toLongLong()), result.size() + 1);
+                break;
+            }
+
+            case PDFLexicalAnalyzer::TokenType::Real:
+            {
+                result.emplace_back(OperandObject::createReal(token.data.toDouble()), result.size() + 1);
+                break;
+            }
+
+            case PDFLexicalAnalyzer::TokenType::Command:
+            {
+                QByteArray command = token.data.toByteArray();
+                if (command == "{")
+                {
+                    // Opening bracket - means start of block
+                    blockCallStack.push(result.size());
+                    result.emplace_back(Code::Call, INVALID_INSTRUCTION_POINTER);
+                    result.back().operand = OperandObject::createInstructionPointer(result.size());
+                }
+                else if (command == "}")
+                {
+                    // Closing bracket - means end of block
+                    if (blockCallStack.empty())
+                    {
+                        throw PDFException(PDFTranslationContext::tr("Invalid program - bad enclosing brackets (PostScript function)."));
+                    }
+
+                    result[blockCallStack.top()].next = result.size() + 1;
+                    blockCallStack.pop();
+                    result.emplace_back(Code::Return, INVALID_INSTRUCTION_POINTER);
+                }
+                else
+                {
+                    result.emplace_back(getCode(command), result.size() + 1);
+                }
+
+                break;
+            }
+
+            default:
+            {
+                // All other tokens treat as invalid.
+                throw PDFException(PDFTranslationContext::tr("Invalid program (PostScript function)."));
+            }
+        }
+    }
+
+    if (result.empty())
+    {
+        throw PDFException(PDFTranslationContext::tr("Empty program (PostScript function)."));
+    }
+
+    // We must insert execute instructions, where blocks without if/ifelse occurs.
+    // We can have following program "{ 2 3 add }" which must return 5. How to find blocks,
+    // after which instructions must be executed? Next instruction must be if, or next instruction
+    // must be a call and next-next instruction must be ifelse
+
+    auto isBlockUsed = [&result](InstructionPointer ip)
+    {
+        // We should call this function only on Call opcode
+        Q_ASSERT(result[ip].code == Code::Call);
+
+        const InstructionPointer next = result[ip].next;
+        if (next < result.size())
+        {
+            switch (result[next].code)
+            {
+                case Code::If:
+                case Code::IfElse:
+                {
+                    // Block is used in 'If' statement
+                    return true;
+                }
+
+                case Code::Call:
+                {
+                    // We must detect, if we use 'If-Else' statement
+                    const InstructionPointer nextnext = result[next].next;
+
+                    if (nextnext < result.size())
+                    {
+                        return result[nextnext].code == Code::IfElse;
+                    }
+                    return false;
+                }
+
+                default:
+                    return false;
+            }
+        }
+
+        return false;
+    };
+
+    // Insert execute instructions, where there are call blocks, which are not used in if/ifelse statements
+    for (size_t i = 0; i < result.size(); ++i)
+    {
+        if (result[i].code == Code::Call && !isBlockUsed(i))
+        {
+            InstructionPointer insertPosition = result[i].next;
+
+            // We must update the instructions pointers for inserting the instruction
+            for (CodeObject& codeObject : result)
+            {
+                if (codeObject.next > insertPosition && codeObject.next != INVALID_INSTRUCTION_POINTER)
+                {
+                    ++codeObject.next;
+                }
+                if (codeObject.operand.type == OperandType::InstructionPointer &&
+                    codeObject.operand.instructionPointer > insertPosition &&
+                    codeObject.operand.instructionPointer != INVALID_INSTRUCTION_POINTER)
+                {
+                    ++codeObject.operand.instructionPointer;
+                }
+            }
+
+            // We must insert an execute statement, block is not used in if/ifelse statement
+            result.insert(std::next(result.begin(), insertPosition), CodeObject(Code::Execute, insertPosition + 1));
+        }
     }
 
     // Mark we are at the end of the program
@@ -1829,6 +3067,137 @@ PDFFunction::FunctionResult PDFPostScriptFunction::apply(const_iterator x_1, con
     const size_t m = std::distance(x_1, x_m);
     const size_t n = std::distance(y_1, y_n);
 
+    if (!m_compiledProgram.isValid || m != m_m || n != m_n)
+    {
+        return applyInterpreted(x_1, x_m, y_1, y_n);
+    }
+
+    // Small register files are allocated on the stack
+    constexpr const size_t FLAT_REGISTER_COUNT = 128;
+    std::array<Register, FLAT_REGISTER_COUNT> flatRegisters;
+    std::vector<Register> variableRegisters;
+
+    const size_t registerCount = m_compiledProgram.registers.size();
+    Register* registers = flatRegisters.data();
+    if (registerCount <= FLAT_REGISTER_COUNT)
+    {
+        std::copy(m_compiledProgram.registers.cbegin(), m_compiledProgram.registers.cend(), flatRegisters.begin());
+    }
+    else
+    {
+        variableRegisters = m_compiledProgram.registers;
+        registers = variableRegisters.data();
+    }
+
+    for (uint32_t i = 0; i < m_m; ++i)
+    {
+        registers[i].realNumber = clampInput(i, *std::next(x_1, i));
+    }
+
+    bool isError = false;
+    PDFPostScriptFunctionCompiledExecutor::execute(m_compiledProgram, registers, 1, &isError);
+
+    if (isError)
+    {
+        // Let the interpreter report the error
+        return applyInterpreted(x_1, x_m, y_1, y_n);
+    }
+
+    for (uint32_t i = 0; i < m_n; ++i)
+    {
+        const Register& value = registers[m_compiledProgram.outputRegisters[i]];
+        const PDFReal y = m_compiledProgram.outputIsInteger[i] ? static_cast<PDFReal>(value.integerNumber) : value.realNumber;
+        *std::next(y_1, i) = clampOutput(i, y);
+    }
+
+    return true;
+}
+
+PDFFunction::FunctionResult PDFPostScriptFunction::applyBatch(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n, size_t count) const
+{
+    if (count == 0)
+    {
+        return true;
+    }
+
+    if (!m_compiledProgram.isValid ||
+        static_cast<size_t>(std::distance(x_1, x_m)) != count * m_m ||
+        static_cast<size_t>(std::distance(y_1, y_n)) != count * m_n)
+    {
+        return PDFFunction::applyBatch(x_1, x_m, y_1, y_n, count);
+    }
+
+    // Straight-line programs are evaluated for multiple samples at once (each
+    // instruction is evaluated for all samples in the batch), programs with
+    // jumps are evaluated sample by sample.
+    constexpr const size_t BATCH_SIZE = 64;
+    const size_t lanes = m_compiledProgram.hasJumps ? 1 : BATCH_SIZE;
+    const size_t registerCount = m_compiledProgram.registers.size();
+
+    std::vector<Register> registers(registerCount * lanes);
+    for (size_t i = 0; i < registerCount; ++i)
+    {
+        std::fill_n(std::next(registers.begin(), i * lanes), lanes, m_compiledProgram.registers[i]);
+    }
+
+    std::array<bool, BATCH_SIZE> errors = { };
+    FunctionResult result(true);
+
+    for (size_t batchStart = 0; batchStart < count; batchStart += lanes)
+    {
+        const size_t batchCount = qMin(lanes, count - batchStart);
+
+        for (uint32_t i = 0; i < m_m; ++i)
+        {
+            Register* inputRegisters = registers.data() + i * lanes;
+            for (size_t lane = 0; lane < batchCount; ++lane)
+            {
+                inputRegisters[lane].realNumber = clampInput(i, *std::next(x_1, (batchStart + lane) * m_m + i));
+            }
+        }
+
+        std::fill(errors.begin(), errors.end(), false);
+        PDFPostScriptFunctionCompiledExecutor::execute(m_compiledProgram, registers.data(), lanes, errors.data());
+
+        for (size_t lane = 0; lane < batchCount; ++lane)
+        {
+            const size_t sample = batchStart + lane;
+            iterator ySample = std::next(y_1, sample * m_n);
+
+            if (errors[lane])
+            {
+                const_iterator xSample = std::next(x_1, sample * m_m);
+                FunctionResult sampleResult = applyInterpreted(xSample, std::next(xSample, m_m), ySample, std::next(ySample, m_n));
+
+                if (!sampleResult)
+                {
+                    std::fill(ySample, std::next(ySample, m_n), 0.0);
+
+                    if (result)
+                    {
+                        result = qMove(sampleResult);
+                    }
+                }
+                continue;
+            }
+
+            for (uint32_t i = 0; i < m_n; ++i)
+            {
+                const Register& value = registers[m_compiledProgram.outputRegisters[i] * lanes + lane];
+                const PDFReal y = m_compiledProgram.outputIsInteger[i] ? static_cast<PDFReal>(value.integerNumber) : value.realNumber;
+                *std::next(ySample, i) = clampOutput(i, y);
+            }
+        }
+    }
+
+    return result;
+}
+
+PDFFunction::FunctionResult PDFPostScriptFunction::applyInterpreted(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const
+{
+    const size_t m = std::distance(x_1, x_m);
+    const size_t n = std::distance(y_1, y_n);
+
     if (m != m_m)
     {
         return PDFTranslationContext::tr("Invalid number of operands for function. Expected %1, provided %2.").arg(m_m).arg(m);
@@ -86,6 +86,18 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const = 0;
 
+    /// Transforms multiple input values to the output values. Input values of the samples
+    /// are stored consecutively (m values per sample), output values are stored
+    /// consecutively too (n values per sample). Default implementation calls \p apply
+    /// for each sample. If some sample can't be evaluated, its output values are set
+    /// to zero, and first error is returned.
+    /// \param x_1 Iterator to the first input value of the first sample
+    /// \param x_n Iterator to the end of the input values of the last sample
+    /// \param y_1 Iterator to the first output value of the first sample
+    /// \param y_n Iterator to the end of the output values of the last sample
+    /// \param count Number of samples
+    virtual FunctionResult applyBatch(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n, size_t count) const;
+
     /// Creates function from the object. If error occurs, exception is thrown.
     /// \param document Document, owning the pdf object
     /// \param object Object defining the function
@@ -448,6 +460,100 @@ public:
 
     using Program = std::vector<CodeObject>;
 
+    using RegisterIndex = uint16_t;
+
+    /// Codes of the compiled program. Compiled program is a register code,
+    /// where each operation has statically known types of its operands.
+    enum class CompiledCode : uint8_t
+    {
+        Move,
+        IntToReal,
+
+        AddInt,
+        AddReal,
+        SubInt,
+        SubReal,
+        MulInt,
+        MulReal,
+        DivReal,
+        Idiv,
+        Mod,
+        NegInt,
+        NegReal,
+        AbsInt,
+        AbsReal,
+        Ceiling,
+        Floor,
+        Round,
+        Truncate,
+        Sqrt,
+        Sin,
+        Cos,
+        Atan,
+        Exp,
+        Ln,
+        Log,
+        Cvi,
+
+        EqInt,
+        EqReal,
+        EqBool,
+        NeInt,
+        NeReal,
+        NeBool,
+        GtInt,
+        GtReal,
+        GeInt,
+        GeReal,
+        LtInt,
+        LtReal,
+        LeInt,
+        LeReal,
+        AndInt,
+        AndBool,
+        OrInt,
+        OrBool,
+        XorInt,
+        XorBool,
+        NotInt,
+        NotBool,
+        Bitshift,
+
+        // Control flow - target contains relative offset of the jump
+        Jump,
+        JumpIfFalse
+    };
+
+    struct CompiledInstruction
+    {
+        CompiledCode code = CompiledCode::Move;
+        RegisterIndex target = 0;   ///< Result register (or jump offset for jumps)
+        RegisterIndex operand1 = 0; ///< First operand register (or condition for jumps)
+        RegisterIndex operand2 = 0; ///< Second operand register
+    };
+
+    union Register
+    {
+        PDFReal realNumber;
+        PDFInteger integerNumber;
+        bool boolean;
+        InstructionPointer instructionPointer;
+    };
+
+    /// Program compiled to the register code. Each value, which appears on the stack,
+    /// has its own register. Stack operations are resolved during compilation, constant
+    /// expressions are folded. First m registers are input values, constants are stored
+    /// in initial values of the registers.
+    struct CompiledProgram
+    {
+        bool isValid = false;
+        bool hasJumps = false;
+        std::vector<CompiledInstruction> code;
+        std::vector<Register> registers;
+        std::vector<RegisterIndex> outputRegisters;
+        std::vector<bool> outputIsInteger;
+    };
+
     /// Construct new postscript function.
     /// \param m Number of input variables
     /// \param n Number of output variables
@@ -466,11 +572,33 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
+    /// Transforms multiple input values to the output values. Compiled program
+    /// is used, if it is available.
+    virtual FunctionResult applyBatch(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n, size_t count) const override;
+
+    /// Returns true, if program was compiled into the register code. If program
+    /// can't be compiled (for example, stack depth or operand types depends on
+    /// input values), then it is interpreted.
+    bool isCompiled() const { return m_compiledProgram.isValid; }
+
+    /// Compiles the program into the register code. If program can't be compiled,
+    /// invalid compiled program is returned.
+    /// \param program Program
+    /// \param m Number of input variables
+    /// \param n Number of output variables
+    static CompiledProgram compile(const Program& program, uint32_t m, uint32_t n);
+
 private:
+    /// Transforms input values to the output values using the interpreter
+    FunctionResult applyInterpreted(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const;
+
     Program m_program;
+    CompiledProgram m_compiledProgram;
 
     friend class PDFPostScriptFunctionStack;
     friend class PDFPostScriptFunctionExecutor;
+    friend class PDFPostScriptFunctionCompiler;
+    friend class PDFPostScriptFunctionCompiledExecutor;
 };
 
 }   // namespace pdf
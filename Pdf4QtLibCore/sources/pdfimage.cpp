@@ -54,7 +54,8 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
                                PDFColorSpacePointer colorSpace,
                                bool isSoftMask,
                                RenderingIntent renderingIntent,
-                               PDFRenderErrorReporter* errorReporter)
+                               PDFRenderErrorReporter* errorReporter,
+                               const PDFJBIG2GlobalsCache* jbig2GlobalsCache)
 {
     PDFImage image;
     image.m_colorSpace = colorSpace;
@@ -130,7 +131,7 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
         }
         else if (object.isStream())
         {
-            PDFImage softMaskImage = createImage(document, object.getStream(), PDFColorSpacePointer(new PDFDeviceGrayColorSpace()), false, renderingIntent, errorReporter);
+            PDFImage softMaskImage = createImage(document, object.getStream(), PDFColorSpacePointer(new PDFDeviceGrayColorSpace()), false, renderingIntent, errorReporter, jbig2GlobalsCache);
 
             if (softMaskImage.m_imageData.getMaskingType() != PDFImageData::MaskingType::ImageMask ||
                 softMaskImage.m_imageData.getColorChannels() != 1 ||
@@ -161,7 +162,7 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
 
         if (softMaskObject.isStream())
         {
-            PDFImage softMaskImage = createImage(document, softMaskObject.getStream(), PDFColorSpacePointer(new PDFDeviceGrayColorSpace()), true, renderingIntent, errorReporter);
+            PDFImage softMaskImage = createImage(document, softMaskObject.getStream(), PDFColorSpacePointer(new PDFDeviceGrayColorSpace()), true, renderingIntent, errorReporter, jbig2GlobalsCache);
             maskingType = PDFImageData::MaskingType::SoftMask;
             image.m_softMask = qMove(softMaskImage.m_imageData);
         }
@@ -679,17 +680,26 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
     else if (imageFilterName == "JBIG2Decode")
     {
         QByteArray data = document->getDecodedStream(stream);
-        QByteArray globalData;
+        PDFJBIG2GlobalsPointer globals;
         if (filterParamsDictionary)
         {
-            const PDFObject& globalDataObject = document->getObject(filterParamsDictionary->get("JBIG2Globals"));
-            if (globalDataObject.isStream())
+            const PDFObject& globalDataObjectReference = filterParamsDictionary->get("JBIG2Globals");
+            if (jbig2GlobalsCache && globalDataObjectReference.isReference())
             {
-                globalData = document->getDecodedStream(globalDataObject.getStream());
+                // Global segments are usually shared by many images, so we use already decoded ones
+                globals = jbig2GlobalsCache->getGlobals(document, globalDataObjectReference.getReference(), errorReporter);
+            }
+            else
+            {
+                const PDFObject& globalDataObject = document->getObject(globalDataObjectReference);
+                if (globalDataObject.isStream())
+                {
+                    globals = PDFJBIG2Decoder::decodeGlobals(document->getDecodedStream(globalDataObject.getStream()), errorReporter);
+                }
             }
         }
 
-        PDFJBIG2Decoder decoder(qMove(data), qMove(globalData), errorReporter);
+        PDFJBIG2Decoder decoder(qMove(data), qMove(globals), errorReporter);
         image.m_imageData = decoder.decode(maskingType);
         image.m_imageData.setDecode(!decode.empty() ? qMove(decode) : std::vector<PDFReal>({ 0.0, 1.0 }));
     }
@@ -31,6 +31,7 @@ namespace pdf
 class PDFStream;
 class PDFDocument;
 class PDFObjectStorage;
+class PDFJBIG2GlobalsCache;
 class PDFRenderErrorReporter;
 
 /// Alternate image object. Defines alternate image, which
@@ -67,12 +68,14 @@ public:
     /// \param isSoftMask Is it a soft mask image?
     /// \param renderingIntent Default rendering intent of the image
     /// \param errorReporter Error reporter for reporting errors (or warnings)
+    /// \param jbig2GlobalsCache Cache of decoded JBIG2 global segments (can be nullptr)
     static PDFImage createImage(const PDFDocument* document,
                                 const PDFStream* stream,
                                 PDFColorSpacePointer colorSpace,
                                 bool isSoftMask,
                                 RenderingIntent renderingIntent,
-                                PDFRenderErrorReporter* errorReporter);
+                                PDFRenderErrorReporter* errorReporter,
+                                const PDFJBIG2GlobalsCache* jbig2GlobalsCache = nullptr);
 
     /// Returns image transformed from image data and color space
     QImage getImage(const PDFCMS* cms,
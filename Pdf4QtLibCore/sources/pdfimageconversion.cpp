@@ -35,9 +35,6 @@ bool PDFImageConversion::convert()
         return false;
     }
 
-    QImage bitonal(m_image.width(), m_image.height(), QImage::Format_Mono);
-    bitonal.fill(0);
-
     // Thresholding
     int threshold = DEFAULT_THRESHOLD;
 
@@ -57,21 +54,57 @@ bool PDFImageConversion::convert()
             break;
     }
 
-    for (int y = 0; y < m_image.height(); ++y)
+    // Bilevel image with black/white colors is not changed by the thresholding,
+    // if threshold separates black and white colors.
+    if (m_image.format() == QImage::Format_Mono &&
+        m_image.colorTable() == QList<QRgb>({ qRgb(0, 0, 0), qRgb(255, 255, 255) }) &&
+        threshold > 0 && threshold <= 255)
     {
-        for (int x = 0; x < m_image.width(); ++x)
-        {
-            QColor pixelColor = m_image.pixelColor(x, y);
-            int pixelValue = pixelColor.lightness();
-            bool bit = (pixelValue >= threshold);
-            bitonal.setPixel(x, y, bit);
-        }
+        m_convertedImage = m_image;
+        return true;
     }
 
+    QImage bitonal(m_image.width(), m_image.height(), QImage::Format_Mono);
+    convertToBitonal(m_image, threshold, bitonal, 0);
+
     m_convertedImage = std::move(bitonal);
     return true;
 }
 
+void PDFImageConversion::convertToBitonal(const QImage& image, int threshold, QImage& bitonalImage, int targetRow)
+{
+    Q_ASSERT(bitonalImage.format() == QImage::Format_Mono);
+    Q_ASSERT(image.width() == bitonalImage.width());
+    Q_ASSERT(targetRow >= 0 && targetRow + image.height() <= bitonalImage.height());
+
+    // Format_Mono has color table with black color at index 0,
+    // and white color at index 1, so white pixels have bit set to 1.
+    const QImage argbImage = image.convertToFormat(QImage::Format_ARGB32);
+    const int width = argbImage.width();
+
+    for (int y = 0; y < argbImage.height(); ++y)
+    {
+        const QRgb* sourceRow = reinterpret_cast<const QRgb*>(argbImage.constScanLine(y));
+        uchar* targetScanLine = bitonalImage.scanLine(targetRow + y);
+
+        for (int x = 0; x < width; x += 8)
+        {
+            const int count = qMin(8, width - x);
+
+            uchar value = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                if (getLightness(sourceRow[x + i]) >= threshold)
+                {
+                    value |= uchar(0x80 >> i);
+                }
+            }
+
+            targetScanLine[x / 8] = value;
+        }
+    }
+}
+
 int PDFImageConversion::getThreshold() const
 {
     switch (m_conversionMethod)
@@ -105,15 +138,15 @@ int PDFImageConversion::calculateOtsu1DThreshold() const
     // Histogram of lightness occurences
     std::array<int, 256> histogram = { };
 
-    for (int x = 0; x < m_image.width(); ++x)
+    const QImage argbImage = m_image.convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < argbImage.height(); ++y)
     {
-        for (int y = 0; y < m_image.height(); ++y)
+        const QRgb* row = reinterpret_cast<const QRgb*>(argbImage.constScanLine(y));
+        for (int x = 0; x < argbImage.width(); ++x)
         {
-            int lightness = m_image.pixelColor(x, y).lightness();
+            const int lightness = getLightness(row[x]);
             Q_ASSERT(lightness >= 0 && lightness <= 255);
-
-            int clampedLightness = qBound(0, lightness, 255);
-            histogram[clampedLightness] += 1;
+            histogram[lightness] += 1;
         }
     }
 
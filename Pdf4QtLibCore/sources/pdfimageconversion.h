@@ -80,9 +80,29 @@ public:
     /// is undefined.
     QImage getConvertedImage() const;
 
+    /// Converts the image to the bitonal image using the threshold. Pixels, whose
+    /// lightness is greater or equal to the threshold, are white, other pixels
+    /// are black. Rows of the image are written to the rows of the bitonal image
+    /// starting at \p targetRow, so image can be converted by horizontal bands.
+    /// \param image Source image
+    /// \param threshold Lightness threshold
+    /// \param bitonalImage Target bitonal image (must have format QImage::Format_Mono and same width)
+    /// \param targetRow First row of target image
+    static void convertToBitonal(const QImage& image, int threshold, QImage& bitonalImage, int targetRow);
+
 private:
     int calculateOtsu1DThreshold() const;
 
+    /// Returns lightness of the color (HSL model), it is the same value
+    /// as returned by QColor::lightness(), but computed much faster.
+    static inline int getLightness(QRgb color)
+    {
+        const int red = qRed(color);
+        const int green = qGreen(color);
+        const int blue = qBlue(color);
+        return (qMax(red, qMax(green, blue)) + qMin(red, qMin(green, blue)) + 1) / 2;
+    }
+
     static constexpr int DEFAULT_THRESHOLD = 128;
 
     QImage m_image;
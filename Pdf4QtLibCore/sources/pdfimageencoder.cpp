@@ -0,0 +1,1322 @@
+//    Copyright (C) 2024 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "pdfimageencoder.h"
+#include "pdfrenderer.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfccittfaxdecoder.h"
+
+#include <QFile>
+#include <QHash>
+#include <QIODevice>
+#include <QImageWriter>
+
+#include <zlib.h>
+
+#include <set>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+
+#include "pdfdbgheap.h"
+
+namespace pdf
+{
+
+/// Approximate size of uncompressed data of one PNG chunk or TIFF strip
+static constexpr int ENCODER_CHUNK_SIZE = 256 * 1024;
+
+/// Size of the deflate window. Tail of the previous chunk of this
+/// size is used as a dictionary, when compressing PNG chunk.
+static constexpr int DEFLATE_WINDOW_SIZE = 32768;
+
+/// Maximal size of data of one IDAT chunk in PNG file
+static constexpr int PNG_IDAT_CHUNK_SIZE = 256 * 1024;
+
+/// Image prepared for encoding. Image is analyzed and the smallest pixel
+/// format, which represents the image without loss, is selected. Rows of
+/// the image are then provided packed in the selected pixel format.
+/// Bilevel, indexed and grayscale images are read directly using their
+/// color table, other images are converted to 32-bit ARGB format.
+class PDFEncoderImage
+{
+public:
+    enum class PixelFormat
+    {
+        Bilevel,    ///< Black and white image, 1 bit per pixel
+        Indexed,    ///< Image with palette, 1, 2, 4 or 8 bits per pixel
+        Gray,       ///< Grayscale image, 8 bits per pixel
+        GrayAlpha,  ///< Grayscale image with alpha channel
+        RGB,        ///< Color image
+        RGBA        ///< Color image with alpha channel
+    };
+
+    /// Analyzes the image
+    /// \param image Image
+    /// \param allowIndexedAlpha Allow palette entries with alpha channel
+    explicit PDFEncoderImage(const QImage& image, bool allowIndexedAlpha);
+
+    PixelFormat getPixelFormat() const { return m_pixelFormat; }
+    int getWidth() const { return m_image.width(); }
+    int getHeight() const { return m_image.height(); }
+    int getBitsPerComponent() const { return m_bitsPerComponent; }
+    int getComponentCount() const { return m_componentCount; }
+    int getBytesPerRow() const { return (getWidth() * m_componentCount * m_bitsPerComponent + 7) / 8; }
+    const std::vector<QRgb>& getPalette() const { return m_palette; }
+    const QImage& getImage() const { return m_image; }
+
+    /// Writes packed row of the image into the buffer, which must be
+    /// large enough to hold at least \p getBytesPerRow bytes.
+    /// \param row Row index
+    /// \param buffer Target buffer
+    /// \param isBlackOne For bilevel images, bit value 1 means black pixel (otherwise white pixel)
+    void writeRow(int row, uint8_t* buffer, bool isBlackOne) const;
+
+private:
+    /// Returns true, if pixels of the image are indices to the source color table
+    bool isSourceIndexed() const { return !m_sourceColorTable.empty(); }
+
+    /// Writes packed row of the image, colors of the pixels are provided by the accessor
+    /// \param width Width of the row
+    /// \param buffer Target buffer
+    /// \param isBlackOne For bilevel images, bit value 1 means black pixel (otherwise white pixel)
+    /// \param getColor Returns color of the pixel at given horizontal position
+    template<typename ColorAccessor>
+    void writeRowImpl(int width, uint8_t* buffer, bool isBlackOne, ColorAccessor getColor) const;
+
+    QImage m_image;
+    PixelFormat m_pixelFormat = PixelFormat::RGBA;
+    int m_bitsPerComponent = 8;
+    int m_componentCount = 4;
+    std::vector<QRgb> m_palette;
+    std::vector<QRgb> m_sourceColorTable;
+    QHash<QRgb, uint8_t> m_paletteIndices;
+};
+
+PDFEncoderImage::PDFEncoderImage(const QImage& image, bool allowIndexedAlpha) :
+    m_image(image)
+{
+    constexpr size_t MAX_PALETTE_SIZE = 256;
+
+    switch (image.format())
+    {
+        case QImage::Format_Mono:
+        case QImage::Format_MonoLSB:
+        case QImage::Format_Indexed8:
+        {
+            // Pixels outside of the color table are treated as black pixels
+            const int colorCount = (image.format() == QImage::Format_Indexed8) ? 256 : 2;
+            const QList<QRgb> colorTable = image.colorTable();
+            m_sourceColorTable.assign(colorTable.cbegin(), colorTable.cend());
+            m_sourceColorTable.resize(colorCount, 0xFF000000);
+            break;
+        }
+
+        case QImage::Format_Grayscale8:
+        {
+            m_sourceColorTable.resize(256);
+            for (int i = 0; i < 256; ++i)
+            {
+                m_sourceColorTable[i] = qRgb(i, i, i);
+            }
+            break;
+        }
+
+        default:
+            m_image = image.convertToFormat(QImage::Format_ARGB32);
+            break;
+    }
+
+    struct ImageInfo
+    {
+        bool isOpaque = true;
+        bool isGray = true;
+        bool isBilevel = true;
+        bool isPaletteOverflow = false;
+        std::set<QRgb> colors;
+    };
+
+    auto addColor = [](ImageInfo& info, QRgb color)
+    {
+        const int red = qRed(color);
+        info.isOpaque = info.isOpaque && qAlpha(color) == 255;
+        info.isGray = info.isGray && red == qGreen(color) && red == qBlue(color);
+        info.isBilevel = info.isBilevel && (color == 0xFF000000 || color == 0xFFFFFFFF);
+
+        if (!info.isPaletteOverflow)
+        {
+            info.colors.insert(color);
+            info.isPaletteOverflow = info.colors.size() > MAX_PALETTE_SIZE;
+        }
+    };
+
+    const int width = m_image.width();
+    const int height = m_image.height();
+    ImageInfo imageInfo;
+
+    if (m_sourceColorTable.size() == 2)
+    {
+        // Both colors of the bilevel image are used, scanning the pixels
+        // would not give us a smaller pixel format in practice.
+        for (QRgb color : m_sourceColorTable)
+        {
+            addColor(imageInfo, color);
+        }
+    }
+    else if (isSourceIndexed())
+    {
+        // Find used entries of the color table
+        const int rowsPerChunk = qMax(1, ENCODER_CHUNK_SIZE / qMax(1, width));
+        const int chunkCount = (height + rowsPerChunk - 1) / rowsPerChunk;
+        std::vector<std::array<bool, 256>> usedIndices(chunkCount, std::array<bool, 256>{ });
+
+        auto analyzeChunk = [&](int chunkIndex)
+        {
+            std::array<bool, 256>& used = usedIndices[chunkIndex];
+
+            const int firstRow = chunkIndex * rowsPerChunk;
+            const int lastRow = qMin(firstRow + rowsPerChunk, height);
+            for (int y = firstRow; y < lastRow; ++y)
+            {
+                const uchar* line = m_image.constScanLine(y);
+                for (int x = 0; x < width; ++x)
+                {
+                    used[line[x]] = true;
+                }
+            }
+        };
+
+        PDFIntegerRange<int> chunkRange(0, chunkCount);
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, chunkRange.begin(), chunkRange.end(), analyzeChunk);
+
+        for (size_t i = 0; i < m_sourceColorTable.size(); ++i)
+        {
+            const bool isUsed = std::any_of(usedIndices.cbegin(), usedIndices.cend(), [i](const std::array<bool, 256>& used) { return used[i]; });
+            if (isUsed)
+            {
+                addColor(imageInfo, m_sourceColorTable[i]);
+            }
+        }
+    }
+    else
+    {
+        const int rowsPerChunk = qMax(1, ENCODER_CHUNK_SIZE / qMax(1, width * 4));
+        const int chunkCount = (height + rowsPerChunk - 1) / rowsPerChunk;
+        std::vector<ImageInfo> infos(chunkCount);
+
+        auto analyzeChunk = [&](int chunkIndex)
+        {
+            ImageInfo& info = infos[chunkIndex];
+
+            const int firstRow = chunkIndex * rowsPerChunk;
+            const int lastRow = qMin(firstRow + rowsPerChunk, height);
+            for (int y = firstRow; y < lastRow; ++y)
+            {
+                const QRgb* line = reinterpret_cast<const QRgb*>(m_image.constScanLine(y));
+                QRgb lastColor = ~line[0];
+
+                for (int x = 0; x < width; ++x)
+                {
+                    const QRgb color = line[x];
+                    if (color == lastColor)
+                    {
+                        // Page images consist mostly of runs of the same color
+                        continue;
+                    }
+                    lastColor = color;
+                    addColor(info, color);
+                }
+            }
+        };
+
+        PDFIntegerRange<int> chunkRange(0, chunkCount);
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, chunkRange.begin(), chunkRange.end(), analyzeChunk);
+
+        for (ImageInfo& info : infos)
+        {
+            imageInfo.isOpaque = imageInfo.isOpaque && info.isOpaque;
+            imageInfo.isGray = imageInfo.isGray && info.isGray;
+            imageInfo.isBilevel = imageInfo.isBilevel && info.isBilevel;
+            imageInfo.isPaletteOverflow = imageInfo.isPaletteOverflow || info.isPaletteOverflow;
+
+            if (!imageInfo.isPaletteOverflow)
+            {
+                imageInfo.colors.insert(info.colors.cbegin(), info.colors.cend());
+                imageInfo.isPaletteOverflow = imageInfo.colors.size() > MAX_PALETTE_SIZE;
+            }
+        }
+    }
+
+    const bool isIndexedAllowed = !imageInfo.isPaletteOverflow && (imageInfo.isOpaque || allowIndexedAlpha);
+    const size_t colorCount = imageInfo.colors.size();
+
+    if (imageInfo.isBilevel)
+    {
+        m_pixelFormat = PixelFormat::Bilevel;
+    }
+    else if (isIndexedAllowed && colorCount <= 16)
+    {
+        // Indexed image with 4 or less bits per pixel is smaller than grayscale image
+        m_pixelFormat = PixelFormat::Indexed;
+    }
+    else if (imageInfo.isGray)
+    {
+        m_pixelFormat = imageInfo.isOpaque ? PixelFormat::Gray : PixelFormat::GrayAlpha;
+    }
+    else if (isIndexedAllowed)
+    {
+        m_pixelFormat = PixelFormat::Indexed;
+    }
+    else
+    {
+        m_pixelFormat = imageInfo.isOpaque ? PixelFormat::RGB : PixelFormat::RGBA;
+    }
+
+    switch (m_pixelFormat)
+    {
+        case PixelFormat::Bilevel:
+            m_bitsPerComponent = 1;
+            m_componentCount = 1;
+            break;
+
+        case PixelFormat::Indexed:
+        {
+            m_componentCount = 1;
+
+            if (colorCount <= 2)
+            {
+                m_bitsPerComponent = 1;
+            }
+            else if (colorCount <= 4)
+            {
+                m_bitsPerComponent = 2;
+            }
+            else if (colorCount <= 16)
+            {
+                m_bitsPerComponent = 4;
+            }
+            else
+            {
+                m_bitsPerComponent = 8;
+            }
+
+            // Colors are sorted, so colors with alpha channel are at the start of the palette
+            m_palette.assign(imageInfo.colors.cbegin(), imageInfo.colors.cend());
+            for (size_t i = 0; i < m_palette.size(); ++i)
+            {
+                m_paletteIndices[m_palette[i]] = uint8_t(i);
+            }
+            break;
+        }
+
+        case PixelFormat::Gray:
+            m_bitsPerComponent = 8;
+            m_componentCount = 1;
+            break;
+
+        case PixelFormat::GrayAlpha:
+            m_bitsPerComponent = 8;
+            m_componentCount = 2;
+            break;
+
+        case PixelFormat::RGB:
+            m_bitsPerComponent = 8;
+            m_componentCount = 3;
+            break;
+
+        case PixelFormat::RGBA:
+            m_bitsPerComponent = 8;
+            m_componentCount = 4;
+            break;
+    }
+}
+
+template<typename ColorAccessor>
+void PDFEncoderImage::writeRowImpl(int width, uint8_t* buffer, bool isBlackOne, ColorAccessor getColor) const
+{
+    switch (m_pixelFormat)
+    {
+        case PixelFormat::Bilevel:
+        {
+            std::memset(buffer, 0, getBytesPerRow());
+            const QRgb oneColor = isBlackOne ? 0xFF000000 : 0xFFFFFFFF;
+
+            for (int x = 0; x < width; ++x)
+            {
+                if (getColor(x) == oneColor)
+                {
+                    buffer[x >> 3] |= 0x80 >> (x & 7);
+                }
+            }
+            break;
+        }
+
+        case PixelFormat::Indexed:
+        {
+            std::memset(buffer, 0, getBytesPerRow());
+
+            const int pixelsPerByte = 8 / m_bitsPerComponent;
+            QRgb lastColor = ~getColor(0);
+            uint8_t index = 0;
+
+            for (int x = 0; x < width; ++x)
+            {
+                const QRgb color = getColor(x);
+                if (color != lastColor)
+                {
+                    lastColor = color;
+                    index = m_paletteIndices.value(color, 0);
+                }
+
+                const int shift = (pixelsPerByte - 1 - x % pixelsPerByte) * m_bitsPerComponent;
+                buffer[x / pixelsPerByte] |= index << shift;
+            }
+            break;
+        }
+
+        case PixelFormat::Gray:
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                buffer[x] = qRed(getColor(x));
+            }
+            break;
+        }
+
+        case PixelFormat::GrayAlpha:
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const QRgb color = getColor(x);
+                *buffer++ = qRed(color);
+                *buffer++ = qAlpha(color);
+            }
+            break;
+        }
+
+        case PixelFormat::RGB:
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const QRgb color = getColor(x);
+                *buffer++ = qRed(color);
+                *buffer++ = qGreen(color);
+                *buffer++ = qBlue(color);
+            }
+            break;
+        }
+
+        case PixelFormat::RGBA:
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const QRgb color = getColor(x);
+                *buffer++ = qRed(color);
+                *buffer++ = qGreen(color);
+                *buffer++ = qBlue(color);
+                *buffer++ = qAlpha(color);
+            }
+            break;
+        }
+    }
+}
+
+void PDFEncoderImage::writeRow(int row, uint8_t* buffer, bool isBlackOne) const
+{
+    const int width = getWidth();
+    const uchar* line = m_image.constScanLine(row);
+
+    switch (m_image.format())
+    {
+        case QImage::Format_Mono:
+        {
+            if (m_pixelFormat == PixelFormat::Bilevel)
+            {
+                // Bits of the row are copied, eventually inverted
+                const QRgb oneColor = isBlackOne ? 0xFF000000 : 0xFFFFFFFF;
+                const uint8_t oneMask = (m_sourceColorTable[1] == oneColor) ? 0xFF : 0x00;
+                const uint8_t zeroMask = (m_sourceColorTable[0] == oneColor) ? 0xFF : 0x00;
+
+                const int bytesPerRow = getBytesPerRow();
+                for (int i = 0; i < bytesPerRow; ++i)
+                {
+                    buffer[i] = (line[i] & oneMask) | (~line[i] & zeroMask);
+                }
+
+                if (const int remainingBits = width % 8)
+                {
+                    buffer[bytesPerRow - 1] &= uint8_t(0xFF << (8 - remainingBits));
+                }
+                break;
+            }
+
+            writeRowImpl(width, buffer, isBlackOne, [this, line](int x) { return m_sourceColorTable[(line[x >> 3] >> (7 - (x & 7))) & 1]; });
+            break;
+        }
+
+        case QImage::Format_MonoLSB:
+            writeRowImpl(width, buffer, isBlackOne, [this, line](int x) { return m_sourceColorTable[(line[x >> 3] >> (x & 7)) & 1]; });
+            break;
+
+        case QImage::Format_Grayscale8:
+        {
+            if (m_pixelFormat == PixelFormat::Gray)
+            {
+                std::memcpy(buffer, line, width);
+                break;
+            }
+
+            writeRowImpl(width, buffer, isBlackOne, [this, line](int x) { return m_sourceColorTable[line[x]]; });
+            break;
+        }
+
+        case QImage::Format_Indexed8:
+            writeRowImpl(width, buffer, isBlackOne, [this, line](int x) { return m_sourceColorTable[line[x]]; });
+            break;
+
+        default:
+        {
+            const QRgb* colorLine = reinterpret_cast<const QRgb*>(line);
+            writeRowImpl(width, buffer, isBlackOne, [colorLine](int x) { return colorLine[x]; });
+            break;
+        }
+    }
+}
+
+static void appendBigEndian32(QByteArray& data, uint32_t value)
+{
+    data.append(char((value >> 24) & 0xFF));
+    data.append(char((value >> 16) & 0xFF));
+    data.append(char((value >> 8) & 0xFF));
+    data.append(char(value & 0xFF));
+}
+
+static void appendLittleEndian16(QByteArray& data, uint16_t value)
+{
+    data.append(char(value & 0xFF));
+    data.append(char((value >> 8) & 0xFF));
+}
+
+static void appendLittleEndian32(QByteArray& data, uint32_t value)
+{
+    data.append(char(value & 0xFF));
+    data.append(char((value >> 8) & 0xFF));
+    data.append(char((value >> 16) & 0xFF));
+    data.append(char((value >> 24) & 0xFF));
+}
+
+static uint8_t getPaethPredictor(uint8_t a, uint8_t b, uint8_t c)
+{
+    const int p = int(a) + int(b) - int(c);
+    const int pa = std::abs(p - int(a));
+    const int pb = std::abs(p - int(b));
+    const int pc = std::abs(p - int(c));
+
+    if (pa <= pb && pa <= pc)
+    {
+        return a;
+    }
+
+    return (pb <= pc) ? b : c;
+}
+
+/// Applies PNG filter to the row and returns sum of absolute values
+/// of filtered bytes (interpreted as signed numbers), which is used
+/// as a heuristic for selection of the best filter.
+template<typename Predictor>
+static uint64_t applyPNGFilter(const uint8_t* previousRow, const uint8_t* currentRow, int size, int bytesPerPixel, uint8_t* output, Predictor predictor)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        const uint8_t a = i >= bytesPerPixel ? currentRow[i - bytesPerPixel] : 0;
+        const uint8_t b = previousRow[i];
+        const uint8_t c = i >= bytesPerPixel ? previousRow[i - bytesPerPixel] : 0;
+        const uint8_t value = currentRow[i] - predictor(a, b, c);
+        output[i] = value;
+        sum += std::abs(static_cast<int8_t>(value));
+    }
+    return sum;
+}
+
+/// Filters the row using filter with minimal sum of absolute differences.
+/// Output must have space for filter type byte and filtered row.
+static void filterPNGRow(const uint8_t* previousRow, const uint8_t* currentRow, int size, int bytesPerPixel, uint8_t* output, uint8_t* scratch)
+{
+    uint64_t bestSum = std::numeric_limits<uint64_t>::max();
+
+    auto tryFilter = [&](uint8_t filter, auto predictor)
+    {
+        const uint64_t sum = applyPNGFilter(previousRow, currentRow, size, bytesPerPixel, scratch, predictor);
+        if (sum < bestSum)
+        {
+            bestSum = sum;
+            output[0] = filter;
+            std::memcpy(output + 1, scratch, size);
+        }
+    };
+
+    tryFilter(0, [](uint8_t, uint8_t, uint8_t) -> uint8_t { return 0; });
+    tryFilter(1, [](uint8_t a, uint8_t, uint8_t) -> uint8_t { return a; });
+    tryFilter(2, [](uint8_t, uint8_t b, uint8_t) -> uint8_t { return b; });
+    tryFilter(3, [](uint8_t a, uint8_t b, uint8_t) -> uint8_t { return uint8_t((int(a) + int(b)) >> 1); });
+    tryFilter(4, getPaethPredictor);
+}
+
+static void writePNGChunk(QByteArray& output, const char* type, const QByteArray& data)
+{
+    appendBigEndian32(output, uint32_t(data.size()));
+
+    const qsizetype start = output.size();
+    output.append(type, 4);
+    output.append(data);
+
+    const uLong crc = crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(output.constData() + start), uInt(output.size() - start));
+    appendBigEndian32(output, uint32_t(crc));
+}
+
+/// Compresses data by deflate algorithm, producing raw deflate stream without
+/// zlib header. If \p isLast is false, stream is flushed to the byte boundary,
+/// but it is not finished, so independently compressed parts can be concatenated.
+/// \param data Data to be compressed
+/// \param dictionary Data preceding compressed data (can be empty)
+/// \param level Compression level
+/// \param strategy Compression strategy
+/// \param isLast Is it last part of the stream?
+/// \returns Compressed data, or empty byte array, if compression fails
+static QByteArray compressDeflateChunk(const QByteArray& data, QByteArrayView dictionary, int level, int strategy, bool isLast)
+{
+    z_stream stream = { };
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK)
+    {
+        return QByteArray();
+    }
+
+    if (!dictionary.isEmpty())
+    {
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.data()), uInt(dictionary.size()));
+    }
+
+    QByteArray output;
+    output.resize(deflateBound(&stream, uLong(data.size())) + 64);
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = uInt(data.size());
+
+    const int flush = isLast ? Z_FINISH : Z_SYNC_FLUSH;
+    int result = Z_OK;
+    do
+    {
+        if (stream.total_out == uLong(output.size()))
+        {
+            output.resize(output.size() * 2);
+        }
+
+        stream.next_out = reinterpret_cast<Bytef*>(output.data()) + stream.total_out;
+        stream.avail_out = uInt(output.size() - stream.total_out);
+        result = deflate(&stream, flush);
+    } while (result == Z_OK && stream.avail_out == 0);
+
+    // Z_BUF_ERROR is not fatal, it means that all pending output was already flushed
+    const bool isFinished = isLast ? (result == Z_STREAM_END) : (result == Z_OK || result == Z_BUF_ERROR);
+    output.resize(isFinished ? stream.total_out : 0);
+    deflateEnd(&stream);
+
+    return output;
+}
+
+QByteArray PDFImageEncoder::encodePNG(const QImage& image, int compression, float gamma)
+{
+    PDFEncoderImage encoderImage(image, true);
+
+    const int width = encoderImage.getWidth();
+    const int height = encoderImage.getHeight();
+    const int bytesPerRow = encoderImage.getBytesPerRow();
+    const int bitsPerComponent = encoderImage.getBitsPerComponent();
+    const int bytesPerPixel = qMax(1, encoderImage.getComponentCount() * bitsPerComponent / 8);
+    const PDFEncoderImage::PixelFormat pixelFormat = encoderImage.getPixelFormat();
+
+    const int level = qBound(0, (compression * 9 + 50) / 100, 9);
+
+    // Filters are not effective for images with palette or with less than 8 bits
+    // per pixel, so we follow the recommendation of the PNG specification.
+    const bool useFilters = level > 0 && bitsPerComponent == 8 && pixelFormat != PDFEncoderImage::PixelFormat::Indexed;
+
+    struct Chunk
+    {
+        QByteArray filteredData;
+        QByteArray compressedData;
+        uLong adler = 0;
+    };
+
+    const int rowsPerChunk = qMax(1, ENCODER_CHUNK_SIZE / (bytesPerRow + 1));
+    const int chunkCount = (height + rowsPerChunk - 1) / rowsPerChunk;
+    std::vector<Chunk> chunks(chunkCount);
+    PDFIntegerRange<int> chunkRange(0, chunkCount);
+
+    // Filter rows of each chunk. Filters use previous row, so previous
+    // row of the first row of the chunk must also be prepared.
+    auto filterChunk = [&](int chunkIndex)
+    {
+        Chunk& chunk = chunks[chunkIndex];
+
+        const int firstRow = chunkIndex * rowsPerChunk;
+        const int lastRow = qMin(firstRow + rowsPerChunk, height);
+
+        std::vector<uint8_t> previousRow(bytesPerRow, 0);
+        std::vector<uint8_t> currentRow(bytesPerRow, 0);
+        std::vector<uint8_t> scratch(bytesPerRow, 0);
+
+        if (firstRow > 0 && useFilters)
+        {
+            encoderImage.writeRow(firstRow - 1, previousRow.data(), false);
+        }
+
+        chunk.filteredData.resize(qsizetype(lastRow - firstRow) * (bytesPerRow + 1));
+        uint8_t* output = reinterpret_cast<uint8_t*>(chunk.filteredData.data());
+
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            encoderImage.writeRow(y, currentRow.data(), false);
+
+            if (useFilters)
+            {
+                filterPNGRow(previousRow.data(), currentRow.data(), bytesPerRow, bytesPerPixel, output, scratch.data());
+            }
+            else
+            {
+                output[0] = 0;
+                std::memcpy(output + 1, currentRow.data(), bytesPerRow);
+            }
+
+            output += bytesPerRow + 1;
+            std::swap(previousRow, currentRow);
+        }
+
+        chunk.adler = adler32(adler32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(chunk.filteredData.constData()), uInt(chunk.filteredData.size()));
+    };
+
+    // Compress each chunk. Tail of the previous chunk is used as a dictionary,
+    // so compression ratio is almost the same as if the image was compressed
+    // as a single stream.
+    auto compressChunk = [&](int chunkIndex)
+    {
+        Chunk& chunk = chunks[chunkIndex];
+
+        QByteArrayView dictionary;
+        if (chunkIndex > 0)
+        {
+            const QByteArray& previousData = chunks[chunkIndex - 1].filteredData;
+            const qsizetype dictionarySize = qMin<qsizetype>(previousData.size(), DEFLATE_WINDOW_SIZE);
+            dictionary = QByteArrayView(previousData.constData() + previousData.size() - dictionarySize, dictionarySize);
+        }
+
+        const int strategy = useFilters ? Z_FILTERED : Z_DEFAULT_STRATEGY;
+        chunk.compressedData = compressDeflateChunk(chunk.filteredData, dictionary, level, strategy, chunkIndex + 1 == chunkCount);
+    };
+
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, chunkRange.begin(), chunkRange.end(), filterChunk);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, chunkRange.begin(), chunkRange.end(), compressChunk);
+
+    if (std::any_of(chunks.cbegin(), chunks.cend(), [](const Chunk& chunk) { return chunk.compressedData.isEmpty(); }))
+    {
+        return QByteArray();
+    }
+
+    // Assemble zlib stream from compressed chunks
+    QByteArray zlibStream;
+    qsizetype zlibStreamSize = 6;
+    for (const Chunk& chunk : chunks)
+    {
+        zlibStreamSize += chunk.compressedData.size();
+    }
+    zlibStream.reserve(zlibStreamSize);
+
+    const uint32_t compressionMethod = 0x78;
+    const uint32_t compressionLevel = (level < 2) ? 0 : ((level < 6) ? 1 : ((level == 6) ? 2 : 3));
+    uint32_t flags = compressionLevel << 6;
+    flags += 31 - ((compressionMethod * 256 + flags) % 31);
+    zlibStream.append(char(compressionMethod));
+    zlibStream.append(char(flags));
+
+    uLong adler = adler32(0, Z_NULL, 0);
+    for (Chunk& chunk : chunks)
+    {
+        zlibStream.append(chunk.compressedData);
+        adler = adler32_combine(adler, chunk.adler, z_off_t(chunk.filteredData.size()));
+        chunk = Chunk();
+    }
+    appendBigEndian32(zlibStream, uint32_t(adler));
+
+    // Write the PNG file
+    QByteArray png;
+    png.reserve(zlibStream.size() + 1024);
+    png.append("\x89PNG\r\n\x1A\n", 8);
+
+    uint8_t colorType = 0;
+    switch (pixelFormat)
+    {
+        case PDFEncoderImage::PixelFormat::Bilevel:
+        case PDFEncoderImage::PixelFormat::Gray:
+            colorType = 0;
+            break;
+
+        case PDFEncoderImage::PixelFormat::RGB:
+            colorType = 2;
+            break;
+
+        case PDFEncoderImage::PixelFormat::Indexed:
+            colorType = 3;
+            break;
+
+        case PDFEncoderImage::PixelFormat::GrayAlpha:
+            colorType = 4;
+            break;
+
+        case PDFEncoderImage::PixelFormat::RGBA:
+            colorType = 6;
+            break;
+    }
+
+    QByteArray header;
+    appendBigEndian32(header, uint32_t(width));
+    appendBigEndian32(header, uint32_t(height));
+    header.append(char(bitsPerComponent));
+    header.append(char(colorType));
+    header.append(char(0)); // Compression method
+    header.append(char(0)); // Filter method
+    header.append(char(0)); // Interlace method
+    writePNGChunk(png, "IHDR", header);
+
+    if (gamma > 0.0f)
+    {
+        QByteArray gammaData;
+        appendBigEndian32(gammaData, uint32_t(qRound(100000.0f / gamma)));
+        writePNGChunk(png, "gAMA", gammaData);
+    }
+
+    if (pixelFormat == PDFEncoderImage::PixelFormat::Indexed)
+    {
+        QByteArray palette;
+        QByteArray transparency;
+        for (QRgb color : encoderImage.getPalette())
+        {
+            palette.append(char(qRed(color)));
+            palette.append(char(qGreen(color)));
+            palette.append(char(qBlue(color)));
+
+            // Colors with alpha channel are at the start of the palette
+            if (qAlpha(color) != 255)
+            {
+                transparency.append(char(qAlpha(color)));
+            }
+        }
+
+        writePNGChunk(png, "PLTE", palette);
+        if (!transparency.isEmpty())
+        {
+            writePNGChunk(png, "tRNS", transparency);
+        }
+    }
+
+    const QImage& sourceImage = encoderImage.getImage();
+    if (sourceImage.dotsPerMeterX() > 0 && sourceImage.dotsPerMeterY() > 0)
+    {
+        QByteArray physicalDimensions;
+        appendBigEndian32(physicalDimensions, uint32_t(sourceImage.dotsPerMeterX()));
+        appendBigEndian32(physicalDimensions, uint32_t(sourceImage.dotsPerMeterY()));
+        physicalDimensions.append(char(1)); // Unit is meter
+        writePNGChunk(png, "pHYs", physicalDimensions);
+    }
+
+    for (qsizetype offset = 0; offset < zlibStream.size(); offset += PNG_IDAT_CHUNK_SIZE)
+    {
+        writePNGChunk(png, "IDAT", zlibStream.mid(offset, PNG_IDAT_CHUNK_SIZE));
+    }
+
+    writePNGChunk(png, "IEND", QByteArray());
+    return png;
+}
+
+QByteArray PDFImageEncoder::encodeLZW(const uint8_t* data, qsizetype size)
+{
+    constexpr uint32_t CLEAR_CODE = 256;
+    constexpr uint32_t END_OF_INFORMATION = 257;
+    constexpr uint32_t FIRST_CODE = 258;
+    constexpr uint32_t MAX_CODE = 4095;
+    constexpr uint32_t MIN_BITS = 9;
+    constexpr uint32_t HASH_BITS = 14;
+    constexpr uint32_t HASH_SIZE = 1 << HASH_BITS;
+
+    // Hash table of strings, key is (prefix code, next byte)
+    std::vector<int32_t> keys(HASH_SIZE, -1);
+    std::vector<uint16_t> codes(HASH_SIZE, 0);
+
+    auto findSlot = [&keys](int32_t key) -> uint32_t
+    {
+        uint32_t slot = (uint32_t(key) * 2654435761u) >> (32 - HASH_BITS);
+        while (keys[slot] != -1 && keys[slot] != key)
+        {
+            slot = (slot + 1) & (HASH_SIZE - 1);
+        }
+        return slot;
+    };
+
+    PDFBitWriter writer(MIN_BITS);
+    writer.reserve(int(size / 2));
+
+    uint32_t bits = MIN_BITS;
+    uint32_t nextCode = FIRST_CODE;
+    writer.write(CLEAR_CODE, bits);
+
+    if (size > 0)
+    {
+        uint32_t prefix = data[0];
+        for (qsizetype i = 1; i < size; ++i)
+        {
+            const uint8_t byte = data[i];
+            const int32_t key = int32_t((prefix << 8) | byte);
+            const uint32_t slot = findSlot(key);
+
+            if (keys[slot] == key)
+            {
+                prefix = codes[slot];
+                continue;
+            }
+
+            writer.write(prefix, bits);
+            keys[slot] = key;
+            codes[slot] = uint16_t(nextCode++);
+
+            if (nextCode == MAX_CODE - 1)
+            {
+                // Table is full, emit clear code and reset the table
+                writer.write(CLEAR_CODE, bits);
+                std::fill(keys.begin(), keys.end(), -1);
+                nextCode = FIRST_CODE;
+                bits = MIN_BITS;
+            }
+            else if (nextCode > (1u << bits) - 1)
+            {
+                ++bits;
+            }
+
+            prefix = byte;
+        }
+
+        writer.write(prefix, bits);
+
+        // Decoder adds table entry also for the last code
+        ++nextCode;
+        if (nextCode == MAX_CODE - 1)
+        {
+            writer.write(CLEAR_CODE, bits);
+            bits = MIN_BITS;
+        }
+        else if (nextCode > (1u << bits) - 1)
+        {
+            ++bits;
+        }
+    }
+
+    writer.write(END_OF_INFORMATION, bits);
+    writer.finishLine();
+    return writer.takeByteArray();
+}
+
+QByteArray PDFImageEncoder::encodeTIFF(const QImage& image, TIFFCompression compression)
+{
+    // Tiff file format constants
+    constexpr uint16_t TIFF_SHORT = 3;
+    constexpr uint16_t TIFF_LONG = 4;
+    constexpr uint16_t TIFF_RATIONAL = 5;
+
+    constexpr uint16_t COMPRESSION_NONE = 1;
+    constexpr uint16_t COMPRESSION_CCITT_GROUP4 = 4;
+    constexpr uint16_t COMPRESSION_LZW = 5;
+    constexpr uint16_t COMPRESSION_DEFLATE = 8;
+
+    PDFEncoderImage encoderImage(image, false);
+
+    const int width = encoderImage.getWidth();
+    const int height = encoderImage.getHeight();
+    const int bytesPerRow = encoderImage.getBytesPerRow();
+    const int bitsPerComponent = encoderImage.getBitsPerComponent();
+    const int componentCount = encoderImage.getComponentCount();
+    const PDFEncoderImage::PixelFormat pixelFormat = encoderImage.getPixelFormat();
+    const bool isBilevel = pixelFormat == PDFEncoderImage::PixelFormat::Bilevel;
+
+    uint16_t compressionType = COMPRESSION_NONE;
+    switch (compression)
+    {
+        case TIFFCompression::None:
+            compressionType = COMPRESSION_NONE;
+            break;
+
+        case TIFFCompression::LZW:
+            compressionType = isBilevel ? COMPRESSION_CCITT_GROUP4 : COMPRESSION_LZW;
+            break;
+
+        case TIFFCompression::Deflate:
+            compressionType = isBilevel ? COMPRESSION_CCITT_GROUP4 : COMPRESSION_DEFLATE;
+            break;
+    }
+
+    // Horizontal differencing predictor improves compression of continuous tone images
+    const bool usePredictor = (compressionType == COMPRESSION_LZW || compressionType == COMPRESSION_DEFLATE) &&
+                              bitsPerComponent == 8 && pixelFormat != PDFEncoderImage::PixelFormat::Indexed;
+
+    const int rowsPerStrip = qMax(1, ENCODER_CHUNK_SIZE / bytesPerRow);
+    const int stripCount = (height + rowsPerStrip - 1) / rowsPerStrip;
+    std::vector<QByteArray> strips(stripCount);
+    std::atomic_bool isCompressionFailed = false;
+
+    auto encodeStrip = [&](int stripIndex)
+    {
+        const int firstRow = stripIndex * rowsPerStrip;
+        const int lastRow = qMin(firstRow + rowsPerStrip, height);
+        const int rowCount = lastRow - firstRow;
+
+        QByteArray stripData(qsizetype(rowCount) * bytesPerRow, 0);
+        uint8_t* rowData = reinterpret_cast<uint8_t*>(stripData.data());
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            // Bilevel images are written as WhiteIsZero, so black is one
+            encoderImage.writeRow(y, rowData, true);
+
+            if (usePredictor)
+            {
+                for (int i = bytesPerRow - 1; i >= componentCount; --i)
+                {
+                    rowData[i] -= rowData[i - componentCount];
+                }
+            }
+
+            rowData += bytesPerRow;
+        }
+
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(stripData.constData());
+        switch (compressionType)
+        {
+            case COMPRESSION_NONE:
+                strips[stripIndex] = qMove(stripData);
+                break;
+
+            case COMPRESSION_CCITT_GROUP4:
+                strips[stripIndex] = PDFCCITTFaxEncoder::encodeGroup4(data, width, rowCount, bytesPerRow);
+                break;
+
+            case COMPRESSION_LZW:
+                strips[stripIndex] = encodeLZW(data, stripData.size());
+                break;
+
+            case COMPRESSION_DEFLATE:
+            {
+                QByteArray compressedData;
+                uLongf compressedSize = compressBound(uLong(stripData.size()));
+                compressedData.resize(compressedSize);
+                if (compress2(reinterpret_cast<Bytef*>(compressedData.data()), &compressedSize, data, uLong(stripData.size()), Z_DEFAULT_COMPRESSION) == Z_OK)
+                {
+                    compressedData.resize(compressedSize);
+                }
+                else
+                {
+                    isCompressionFailed = true;
+                }
+                strips[stripIndex] = qMove(compressedData);
+                break;
+            }
+
+            default:
+                Q_ASSERT(false);
+                break;
+        }
+    };
+
+    PDFIntegerRange<int> stripRange(0, stripCount);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, stripRange.begin(), stripRange.end(), encodeStrip);
+
+    if (isCompressionFailed)
+    {
+        return QByteArray();
+    }
+
+    // Image file header, offset of the image file directory is written later
+    QByteArray tiff;
+    tiff.append("II", 2);
+    appendLittleEndian16(tiff, 42);
+    appendLittleEndian32(tiff, 0);
+
+    QByteArray stripOffsets;
+    QByteArray stripByteCounts;
+    for (QByteArray& strip : strips)
+    {
+        appendLittleEndian32(stripOffsets, uint32_t(tiff.size()));
+        appendLittleEndian32(stripByteCounts, uint32_t(strip.size()));
+        tiff.append(strip);
+        strip = QByteArray();
+    }
+
+    struct Entry
+    {
+        uint16_t tag = 0;
+        uint16_t type = 0;
+        uint32_t count = 0;
+        QByteArray data;
+    };
+
+    std::vector<Entry> entries;
+    auto addShortEntry = [&entries](uint16_t tag, std::initializer_list<uint16_t> values)
+    {
+        Entry entry{ tag, TIFF_SHORT, uint32_t(values.size()), QByteArray() };
+        for (uint16_t value : values)
+        {
+            appendLittleEndian16(entry.data, value);
+        }
+        entries.emplace_back(qMove(entry));
+    };
+    auto addLongEntry = [&entries](uint16_t tag, uint32_t value)
+    {
+        Entry entry{ tag, TIFF_LONG, 1, QByteArray() };
+        appendLittleEndian32(entry.data, value);
+        entries.emplace_back(qMove(entry));
+    };
+    auto addResolutionEntry = [&entries](uint16_t tag, int dotsPerMeter)
+    {
+        const uint32_t dpi = dotsPerMeter > 0 ? uint32_t(qRound(dotsPerMeter * 0.0254)) : 72;
+        Entry entry{ tag, TIFF_RATIONAL, 1, QByteArray() };
+        appendLittleEndian32(entry.data, dpi);
+        appendLittleEndian32(entry.data, 1);
+        entries.emplace_back(qMove(entry));
+    };
+
+    uint16_t photometricInterpretation = 0;
+    switch (pixelFormat)
+    {
+        case PDFEncoderImage::PixelFormat::Bilevel:
+            photometricInterpretation = 0; // WhiteIsZero
+            break;
+
+        case PDFEncoderImage::PixelFormat::Gray:
+        case PDFEncoderImage::PixelFormat::GrayAlpha:
+            photometricInterpretation = 1; // BlackIsZero
+            break;
+
+        case PDFEncoderImage::PixelFormat::RGB:
+        case PDFEncoderImage::PixelFormat::RGBA:
+            photometricInterpretation = 2; // RGB
+            break;
+
+        case PDFEncoderImage::PixelFormat::Indexed:
+            photometricInterpretation = 3; // Palette color
+            break;
+    }
+
+    const uint16_t bits = uint16_t(bitsPerComponent);
+    addLongEntry(256, uint32_t(width));
+    addLongEntry(257, uint32_t(height));
+    switch (componentCount)
+    {
+        case 1:
+            addShortEntry(258, { bits });
+            break;
+        case 2:
+            addShortEntry(258, { bits, bits });
+            break;
+        case 3:
+            addShortEntry(258, { bits, bits, bits });
+            break;
+        case 4:
+            addShortEntry(258, { bits, bits, bits, bits });
+            break;
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+    addShortEntry(259, { compressionType });
+    addShortEntry(262, { photometricInterpretation });
+    entries.push_back(Entry{ 273, TIFF_LONG, uint32_t(stripCount), stripOffsets });
+    addShortEntry(277, { uint16_t(componentCount) });
+    addLongEntry(278, uint32_t(rowsPerStrip));
+    entries.push_back(Entry{ 279, TIFF_LONG, uint32_t(stripCount), stripByteCounts });
+    addResolutionEntry(282, encoderImage.getImage().dotsPerMeterX());
+    addResolutionEntry(283, encoderImage.getImage().dotsPerMeterY());
+    addShortEntry(284, { 1 }); // Chunky planar configuration
+    addShortEntry(296, { 2 }); // Resolution unit is inch
+
+    if (usePredictor)
+    {
+        addShortEntry(317, { 2 }); // Horizontal differencing
+    }
+
+    if (pixelFormat == PDFEncoderImage::PixelFormat::Indexed)
+    {
+        const std::vector<QRgb>& palette = encoderImage.getPalette();
+        const uint32_t colorMapSize = 1u << bitsPerComponent;
+
+        Entry entry{ 320, TIFF_SHORT, 3 * colorMapSize, QByteArray() };
+        for (int (*channel)(QRgb) : { &qRed, &qGreen, &qBlue })
+        {
+            for (uint32_t i = 0; i < colorMapSize; ++i)
+            {
+                const int value = i < palette.size() ? channel(palette[i]) : 0;
+                appendLittleEndian16(entry.data, uint16_t(value * 257));
+            }
+        }
+        entries.emplace_back(qMove(entry));
+    }
+
+    if (componentCount == 2 || componentCount == 4)
+    {
+        addShortEntry(338, { 2 }); // Unassociated alpha
+    }
+
+    // Write values, which do not fit into the directory entry
+    std::vector<uint32_t> valueOffsets(entries.size(), 0);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (entries[i].data.size() > 4)
+        {
+            if (tiff.size() % 2 == 1)
+            {
+                tiff.append(char(0));
+            }
+
+            valueOffsets[i] = uint32_t(tiff.size());
+            tiff.append(entries[i].data);
+        }
+    }
+
+    // Write image file directory, it must start at word boundary
+    if (tiff.size() % 2 == 1)
+    {
+        tiff.append(char(0));
+    }
+
+    const uint32_t directoryOffset = uint32_t(tiff.size());
+    appendLittleEndian16(tiff, uint16_t(entries.size()));
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const Entry& entry = entries[i];
+        appendLittleEndian16(tiff, entry.tag);
+        appendLittleEndian16(tiff, entry.type);
+        appendLittleEndian32(tiff, entry.count);
+
+        if (entry.data.size() > 4)
+        {
+            appendLittleEndian32(tiff, valueOffsets[i]);
+        }
+        else
+        {
+            // Values are left justified in the value field
+            tiff.append(entry.data);
+            tiff.append(4 - entry.data.size(), char(0));
+        }
+    }
+    appendLittleEndian32(tiff, 0);
+
+    // Write the offset of the image file directory to the header
+    for (int i = 0; i < 4; ++i)
+    {
+        tiff[4 + i] = char((directoryOffset >> (8 * i)) & 0xFF);
+    }
+
+    return tiff;
+}
+
+bool PDFImageEncoder::isFormatSupported(const QByteArray& format)
+{
+    const QByteArray lowerFormat = format.toLower();
+    return lowerFormat == "png" || lowerFormat == "tif" || lowerFormat == "tiff";
+}
+
+PDFImageEncoder::TIFFCompression PDFImageEncoder::getTIFFCompression(int compression)
+{
+    switch (compression)
+    {
+        case 0:
+            return TIFFCompression::None;
+
+        case 1:
+            return TIFFCompression::LZW;
+
+        default:
+            return TIFFCompression::Deflate;
+    }
+}
+
+PDFOperationResult PDFImageEncoder::write(const QImage& image, const PDFImageWriterSettings& settings, QIODevice* device)
+{
+    const QByteArray format = settings.getCurrentFormat();
+
+    if (isFormatSupported(format) && !image.isNull())
+    {
+        QByteArray data;
+        if (format.toLower() == "png")
+        {
+            data = encodePNG(image, settings.getCompression(), settings.getGamma());
+        }
+        else
+        {
+            data = encodeTIFF(image, getTIFFCompression(settings.getCompression()));
+        }
+
+        if (data.isEmpty())
+        {
+            return PDFTranslationContext::tr("Compression of the image data failed.");
+        }
+
+        if (device->write(data) != data.size())
+        {
+            return device->errorString();
+        }
+
+        return true;
+    }
+
+    QImageWriter imageWriter(device, format);
+    imageWriter.setSubType(settings.getCurrentSubtype());
+    imageWriter.setCompression(settings.getCompression());
+    imageWriter.setQuality(settings.getQuality());
+    imageWriter.setOptimizedWrite(settings.hasOptimizedWrite());
+    imageWriter.setProgressiveScanWrite(settings.hasProgressiveScanWrite());
+
+    if (!imageWriter.write(image))
+    {
+        return imageWriter.errorString();
+    }
+
+    return true;
+}
+
+PDFOperationResult PDFImageEncoder::write(const QImage& image, const PDFImageWriterSettings& settings, const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        return file.errorString();
+    }
+
+    PDFOperationResult result = write(image, settings, &file);
+    file.close();
+    return result;
+}
+
+}   // namespace pdf
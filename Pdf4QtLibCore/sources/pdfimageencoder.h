@@ -0,0 +1,95 @@
+//    Copyright (C) 2024 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef PDFIMAGEENCODER_H
+#define PDFIMAGEENCODER_H
+
+#include "pdfglobal.h"
+#include "pdfutils.h"
+
+#include <QImage>
+
+class QIODevice;
+
+namespace pdf
+{
+class PDFImageWriterSettings;
+
+/// Built-in encoder of exported page images to PNG and TIFF formats. Image is
+/// analyzed at first and it is stored using the smallest pixel format, which
+/// represents the image without loss (1-bit, indexed, grayscale or true color).
+/// Image data are divided into chunks (PNG) or strips (TIFF), which are compressed
+/// in parallel. PNG row filters are selected adaptively for each row. TIFF images
+/// are compressed using LZW or Deflate, bilevel images using CCITT Group 4.
+class PDF4QTLIBCORESHARED_EXPORT PDFImageEncoder
+{
+public:
+
+    enum class TIFFCompression
+    {
+        None,
+        LZW,
+        Deflate
+    };
+
+    /// Returns true, if image format is supported by the built-in encoder
+    /// \param format Image format
+    static bool isFormatSupported(const QByteArray& format);
+
+    /// Writes image to the device. If current format of the settings is supported
+    /// by the built-in encoder, then it is used, otherwise QImageWriter is used.
+    /// \param image Image
+    /// \param settings Image writer settings
+    /// \param device Output device (must be opened for writing)
+    static PDFOperationResult write(const QImage& image, const PDFImageWriterSettings& settings, QIODevice* device);
+
+    /// Writes image to the file, see the function writing to the device.
+    /// \param image Image
+    /// \param settings Image writer settings
+    /// \param fileName File name
+    static PDFOperationResult write(const QImage& image, const PDFImageWriterSettings& settings, const QString& fileName);
+
+    /// Encodes image to the PNG format
+    /// \param image Image
+    /// \param compression Compression (0 - no compression, 100 - maximal compression)
+    /// \param gamma Gamma (if zero, gamma is not written)
+    /// \returns Encoded image, or empty byte array, if image data can't be compressed
+    static QByteArray encodePNG(const QImage& image, int compression, float gamma);
+
+    /// Encodes image to the TIFF format. Bilevel images are compressed using
+    /// CCITT Group 4 compression, unless compression is turned off.
+    /// \param image Image
+    /// \param compression Compression
+    /// \returns Encoded image, or empty byte array, if image data can't be compressed
+    static QByteArray encodeTIFF(const QImage& image, TIFFCompression compression);
+
+    /// Compresses data using LZW compression as defined in TIFF specification
+    /// (with early change of code length, as in libtiff). Compressed data
+    /// can be decoded by LZWDecode filter with default parameters.
+    /// \param data Data
+    /// \param size Size of the data in bytes
+    static QByteArray encodeLZW(const uint8_t* data, qsizetype size);
+
+    /// Returns TIFF compression for compression value of image writer settings.
+    /// Value 0 means no compression, 1 is LZW and higher values are Deflate.
+    /// \param compression Compression value
+    static TIFFCompression getTIFFCompression(int compression);
+};
+
+}   // namespace pdf
+
+#endif // PDFIMAGEENCODER_H
@@ -17,6 +17,7 @@
 
 #include "pdfjbig2decoder.h"
 #include "pdfexception.h"
+#include "pdfdocument.h"
 #include "pdfccittfaxdecoder.h"
 #include "pdfdbgheap.h"
 
@@ -32,6 +33,8 @@ public:
     virtual const PDFJBIG2HuffmanCodeTable* asHuffmanCodeTable() const override { return this; }
     virtual PDFJBIG2HuffmanCodeTable* asHuffmanCodeTable() override { return this; }
 
+    virtual qint64 getMemoryConsumptionEstimate() const override { return sizeof(*this) + m_entries.size() * sizeof(PDFJBIG2HuffmanTableEntry); }
+
     const std::vector<PDFJBIG2HuffmanTableEntry>& getEntries() const { return m_entries; }
 
     /// Builds prefixes using algorithm in annex B.3 of specification. Unused rows are removed.
@@ -59,6 +62,7 @@ public:
 
     virtual const PDFJBIG2SymbolDictionary* asSymbolDictionary() const override { return this; }
     virtual PDFJBIG2SymbolDictionary* asSymbolDictionary() override { return this; }
+    virtual qint64 getMemoryConsumptionEstimate() const override;
 
     const std::vector<PDFJBIG2Bitmap>& getBitmaps() const { return m_bitmaps; }
     const PDFJBIG2ArithmeticDecoderState& getGenericState() const { return m_genericState; }
@@ -82,6 +86,7 @@ public:
 
     virtual const PDFJBIG2PatternDictionary* asPatternDictionary() const override { return this; }
     virtual PDFJBIG2PatternDictionary* asPatternDictionary() override { return this; }
+    virtual qint64 getMemoryConsumptionEstimate() const override;
 
     const std::vector<PDFJBIG2Bitmap>& getBitmaps() const { return m_bitmaps; }
 
@@ -1119,26 +1124,47 @@ PDFImageData PDFJBIG2Decoder::decode(PDFImageData::MaskingType maskingType)
 
     if (m_pageBitmap.isValid())
     {
-        PDFBitWriter writer(1);
-
         const int columns = m_pageBitmap.getWidth();
         const int rows = m_pageBitmap.getHeight();
+        const int bytesPerRow = (columns + 7) / 8;
+        const uint8_t lastByteMask = (columns % 8) ? uint8_t(0xFF << (8 - columns % 8)) : 0xFF;
 
+        // Bitmap rows are packed in words, first pixel in the most significant bit,
+        // so we can just split words into bytes. Image data have inverted pixels
+        // (white is 1), padding bits must be zero.
+        QByteArray imageData(bytesPerRow * rows, 0);
         for (int row = 0; row < rows; ++row)
         {
-            for (int column = 0; column < columns; ++column)
+            const uint32_t* sourceRow = m_pageBitmap.getRow(row);
+            uint8_t* targetRow = reinterpret_cast<uint8_t*>(imageData.data()) + row * bytesPerRow;
+
+            for (int i = 0; i < bytesPerRow; ++i)
             {
-                writer.write(!m_pageBitmap.getPixel(column, row));
+                const uint32_t word = sourceRow[i / 4];
+                targetRow[i] = uint8_t(~(word >> (24 - 8 * (i % 4))));
             }
-            writer.finishLine();
+
+            targetRow[bytesPerRow - 1] &= lastByteMask;
         }
 
-        return PDFImageData(1, 1, static_cast<uint32_t>(columns), static_cast<uint32_t>(rows), static_cast<uint32_t>((columns + 7) / 8), maskingType, writer.takeByteArray(), { }, { }, { });
+        return PDFImageData(1, 1, static_cast<uint32_t>(columns), static_cast<uint32_t>(rows), static_cast<uint32_t>(bytesPerRow), maskingType, qMove(imageData), { }, { }, { });
     }
 
     return PDFImageData();
 }
 
+PDFJBIG2GlobalsPointer PDFJBIG2Decoder::decodeGlobals(QByteArray globalData, PDFRenderErrorReporter* errorReporter)
+{
+    PDFJBIG2Decoder decoder(QByteArray(), qMove(globalData), errorReporter);
+    if (!decoder.m_globalData.isEmpty())
+    {
+        decoder.m_reader = PDFBitReader(&decoder.m_globalData, 8);
+        decoder.processStream();
+    }
+
+    return std::make_shared<const PDFJBIG2Globals>(qMove(decoder.m_segments));
+}
+
 PDFImageData PDFJBIG2Decoder::decodeFileStream()
 {
     m_reader = PDFBitReader(&m_data, 8);
@@ -2381,7 +2407,8 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
     parameters.arithmeticDecoderState = &genericState;
     parameters.data = qMove(mmrData);
 
-    PDFJBIG2Bitmap GI(HGW, HGH, 0x00);
+    // Grayscale image contains multi-bit values, so we can't store it in the bitmap
+    std::vector<uint32_t> GI(HGW * HGH, 0);
     for (int J = HBPP - 1; J >= 0; --J)
     {
         PDFJBIG2Bitmap PLANE = readBitmap(parameters);
@@ -2418,9 +2445,9 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
             for (int y = 0; y < static_cast<int>(HGH); ++y)
             {
                 // Old bit is in the first position of grayscale image
-                const uint8_t oldPixel = GI.getPixel(x, y);
-                const uint8_t bit = (oldPixel ^ PLANE.getPixel(x, y)) & 0x01;
-                GI.setPixel(x, y, (oldPixel << 1) | bit);
+                uint32_t& grayValue = GI[y * HGW + x];
+                const uint32_t bit = (grayValue ^ PLANE.getPixel(x, y)) & 0x01;
+                grayValue = (grayValue << 1) | bit;
             }
         }
     }
@@ -2435,7 +2462,7 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
             const int y = (static_cast<int>(HGY) + MG * static_cast<int>(HRX) - NG * static_cast<int>(HRY)) / 256;
 
             /* 6.6.5.1 1) a) ii) */
-            const uint8_t index = GI.getPixel(NG, MG);
+            const uint32_t index = GI[MG * HGW + NG];
             if (Q_UNLIKELY(index >= HNUMPATS))
             {
                 throw PDFException(PDFTranslationContext::tr("JBIG2 halftoning pattern index %1 out of bounds [0, %2]").arg(index).arg(HNUMPATS));
@@ -2842,9 +2869,33 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::getBitmap(const uint32_t segmentIndex, bool remo
         return result;
     }
 
+    if (const PDFJBIG2Segment* globalSegment = m_globals ? m_globals->getSegment(segmentIndex) : nullptr)
+    {
+        // Global segments are shared, they are never removed
+        const PDFJBIG2Bitmap* bitmap = globalSegment->asBitmap();
+
+        if (!bitmap)
+        {
+            throw PDFException(PDFTranslationContext::tr("JBIG2 segment %1 is not a bitmap.").arg(segmentIndex));
+        }
+
+        return *bitmap;
+    }
+
     throw PDFException(PDFTranslationContext::tr("JBIG2 bitmap segment %1 not found.").arg(segmentIndex));
 }
 
+const PDFJBIG2Segment* PDFJBIG2Decoder::getSegment(uint32_t segmentNumber) const
+{
+    auto it = m_segments.find(segmentNumber);
+    if (it != m_segments.cend())
+    {
+        return it->second.get();
+    }
+
+    return m_globals ? m_globals->getSegment(segmentNumber) : nullptr;
+}
+
 PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& parameters)
 {
     if (parameters.MMR)
@@ -2983,7 +3034,116 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
         Q_ASSERT(parameters.arithmeticDecoder);
         PDFJBIG2ArithmeticDecoder& decoder = *parameters.arithmeticDecoder;
 
+        // Pixel context is created using rolling registers. Each register contains
+        // pixels of one row, lowest bit is the rightmost pixel of the row used in the
+        // context. Registers are shifted by one bit for each pixel, so just one new
+        // pixel is read from each row. Adaptative template pixels are read directly.
+        struct ContextTemplate
+        {
+            int currentRowCount = 0;    ///< Number of pixels left of x in row y
+            int row1Lead = 0;           ///< Rightmost pixel of row y-1 is x + row1Lead
+            int row1Count = 0;          ///< Number of pixels in row y-1
+            int row1Shift = 0;          ///< Position of row y-1 pixels in the context
+            int row2Lead = 0;           ///< Rightmost pixel of row y-2 is x + row2Lead
+            int row2Count = 0;          ///< Number of pixels in row y-2
+            int row2Shift = 0;          ///< Position of row y-2 pixels in the context
+            int atCount = 0;            ///< Number of adaptative template pixels
+            std::array<int, 4> atShift = { }; ///< Positions of adaptative template pixels in the context
+        };
+
+        ContextTemplate contextTemplate;
+        switch (parameters.GBTEMPLATE)
+        {
+            case 0:
+            {
+                //  Figure 8. Reused context for coding the SLTP value
+                //
+                //          ┌───┬───┬───┬───┬───┐
+                //          │A15│ 14│ 13│ 12│A11│
+                //      ┌───┼───┼───┼───┼───┼───┼───┐
+                //      │A10│ 9 │ 8 │ 7 │ 6 │ 5 │A4 │
+                //  ┌───┼───┼───┼───┼───┼───┴───┴───┘
+                //  │ 3 │ 2 │ 1 │ 0 │ X │
+                //  └───┴───┴───┴───┴───┘
+
+                // 16-bit context
+                contextTemplate = ContextTemplate{ 4, 2, 5, 5, 1, 3, 12, 4, { 4, 10, 11, 15 } };
+                break;
+            }
+
+            case 1:
+            {
+                //  Figure 9. Reused context for coding the SLTP value
+                //
+                //          ┌───┬───┬───┬───┐
+                //          │ 12│ 11│ 10│ 9 │
+                //      ┌───┼───┼───┼───┼───┼───┐
+                //      │ 8 │ 7 │ 6 │ 5 │ 4 │A3 │
+                //  ┌───┼───┼───┼───┼───┴───┴───┘
+                //  │ 2 │ 1 │ 0 │ x │
+                //  └───┴───┴───┴───┘
+
+                // 13-bit context
+                contextTemplate = ContextTemplate{ 3, 2, 5, 4, 2, 4, 9, 1, { 3, 0, 0, 0 } };
+                break;
+            }
+
+            case 2:
+            {
+                //  Figure 10. Reused context for coding the SLTP value
+                //
+                //          ┌───┬───┬───┐
+                //          │ 9 │ 8 │ 7 │
+                //      ┌───┼───┼───┼───┼───┐
+                //      │ 6 │ 5 │ 4 │ 3 │A2 │
+                //      ├───┼───┼───┼───┴───┘
+                //      │ 1 │ 0 │ x │
+                //      └───┴───┴───┘
+
+                // 10-bit context
+                contextTemplate = ContextTemplate{ 2, 1, 4, 3, 1, 3, 7, 1, { 2, 0, 0, 0 } };
+                break;
+            }
+
+            case 3:
+            {
+                //  Figure 11. Reused context for coding the SLTP value
+                //
+                //          ┌───┬───┬───┬───┬───┬───┐
+                //          │ 9 │ 8 │ 7 │ 6 │ 5 │A4 │
+                //      ┌───┼───┼───┼───┼───┼───┴───┘
+                //      │ 3 │ 2 │ 1 │ 0 │ x │
+                //      └───┴───┴───┴───┴───┘
+
+                // 10-bit context
+                contextTemplate = ContextTemplate{ 4, 1, 5, 5, 0, 0, 0, 1, { 4, 0, 0, 0 } };
+                break;
+            }
+
+            default:
+            {
+                Q_ASSERT(false);
+                break;
+            }
+        }
+
+        const uint32_t currentRowMask = (1U << contextTemplate.currentRowCount) - 1;
+        const uint32_t row1Mask = (1U << contextTemplate.row1Count) - 1;
+        const uint32_t row2Mask = (1U << contextTemplate.row2Count) - 1;
+
         PDFJBIG2Bitmap bitmap(parameters.GBW, parameters.GBH, 0x00);
+
+        // Loads register from the row, bit i contains pixel x - i
+        auto loadRegister = [&bitmap](int x, int y, int count) -> uint32_t
+        {
+            uint32_t value = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                value |= uint32_t(bitmap.getPixelSafe(x - i, y)) << i;
+            }
+            return value;
+        };
+
         for (int y = 0; y < parameters.GBH; ++y)
         {
             // Check TPGDON prediction - if we use same pixels as in previous line
@@ -3000,147 +3160,41 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
                 }
             }
 
+            // Registers are shifted before the pixel is decoded, so
+            // we must load them with pixels left to the first pixel.
+            uint32_t currentRow = 0;
+            uint32_t row1 = loadRegister(contextTemplate.row1Lead - 1, y - 1, contextTemplate.row1Count);
+            uint32_t row2 = loadRegister(contextTemplate.row2Lead - 1, y - 2, contextTemplate.row2Count);
+
             for (int x = 0; x < parameters.GBW; ++x)
             {
+                row1 = (row1 << 1) | bitmap.getPixelSafe(x + contextTemplate.row1Lead, y - 1);
+                row2 = (row2 << 1) | bitmap.getPixelSafe(x + contextTemplate.row2Lead, y - 2);
+
                 // Check, if we have to skip pixel. Pixel should be set to 0, but it is done
                 // in the initialization of the bitmap.
                 if (parameters.SKIP && parameters.SKIP->getPixelSafe(x, y))
                 {
+                    currentRow = currentRow << 1;
                     continue;
                 }
 
-                uint16_t pixelContext = 0;
-                uint16_t pixelContextShift = 0;
-                auto createContextBit = [&](int offsetX, int offsetY)
-                {
-                    uint16_t bit = bitmap.getPixelSafe(offsetX, offsetY) ? 1 : 0;
-                    bit = bit << pixelContextShift;
-                    pixelContext |= bit;
-                    ++pixelContextShift;
-                };
-
-                // Create pixel context based on used template
-                switch (parameters.GBTEMPLATE)
-                {
-                    case 0:
-                    {
-                        //  Figure 8. Reused context for coding the SLTP value
-                        //
-                        //          ┌───┬───┬───┬───┬───┐
-                        //          │A15│ 14│ 13│ 12│A11│
-                        //      ┌───┼───┼───┼───┼───┼───┼───┐
-                        //      │A10│ 9 │ 8 │ 7 │ 6 │ 5 │A4 │
-                        //  ┌───┼───┼───┼───┼───┼───┴───┴───┘
-                        //  │ 3 │ 2 │ 1 │ 0 │ X │
-                        //  └───┴───┴───┴───┴───┘
-
-                        // 16-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x - 4, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 2, y - 1);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + parameters.GBAT[1].x, y + parameters.GBAT[1].y);
-                        createContextBit(x + parameters.GBAT[2].x, y + parameters.GBAT[2].y);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
-                        createContextBit(x + parameters.GBAT[3].x, y + parameters.GBAT[3].y);
-                        break;
-                    }
-
-                    case 1:
-                    {
-                        //  Figure 9. Reused context for coding the SLTP value
-                        //
-                        //          ┌───┬───┬───┬───┐
-                        //          │ 12│ 11│ 10│ 9 │
-                        //      ┌───┼───┼───┼───┼───┼───┐
-                        //      │ 8 │ 7 │ 6 │ 5 │ 4 │A3 │
-                        //  ┌───┼───┼───┼───┼───┴───┴───┘
-                        //  │ 2 │ 1 │ 0 │ x │
-                        //  └───┴───┴───┴───┘
-
-                        // 13-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 2, y - 1);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + 2, y - 2);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
-                        break;
-                    }
-
-                    case 2:
-                    {
-                        //  Figure 10. Reused context for coding the SLTP value
-                        //
-                        //          ┌───┬───┬───┐
-                        //          │ 9 │ 8 │ 7 │
-                        //      ┌───┼───┼───┼───┼───┐
-                        //      │ 6 │ 5 │ 4 │ 3 │A2 │
-                        //      ├───┼───┼───┼───┴───┘
-                        //      │ 1 │ 0 │ x │
-                        //      └───┴───┴───┘
-
-                        // 10-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
-                        break;
-                    }
-
-                    case 3:
-                    {
-                        //  Figure 11. Reused context for coding the SLTP value
-                        //
-                        //          ┌───┬───┬───┬───┬───┬───┐
-                        //          │ 9 │ 8 │ 7 │ 6 │ 5 │A4 │
-                        //      ┌───┼───┼───┼───┼───┼───┴───┘
-                        //      │ 3 │ 2 │ 1 │ 0 │ x │
-                        //      └───┴───┴───┴───┴───┘
-
-                        // 10-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x - 4, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x - 3, y - 1);
-                        break;
-                    }
+                uint32_t pixelContext = (currentRow & currentRowMask) |
+                                        ((row1 & row1Mask) << contextTemplate.row1Shift) |
+                                        ((row2 & row2Mask) << contextTemplate.row2Shift);
 
-                    default:
-                    {
-                        Q_ASSERT(false);
-                        break;
-                    }
+                for (int i = 0; i < contextTemplate.atCount; ++i)
+                {
+                    const PDFJBIG2ATPosition& position = parameters.GBAT[i];
+                    pixelContext |= uint32_t(bitmap.getPixelSafe(x + position.x, y + position.y)) << contextTemplate.atShift[i];
                 }
 
-                bitmap.setPixel(x, y, (decoder.readBit(pixelContext, parameters.arithmeticDecoderState)) ? 0xFF : 0x00);
+                const uint32_t pixel = decoder.readBit(pixelContext, parameters.arithmeticDecoderState) ? 1 : 0;
+                if (pixel)
+                {
+                    bitmap.setPixel(x, y, 0xFF);
+                }
+                currentRow = (currentRow << 1) | pixel;
             }
         }
 
@@ -3161,76 +3215,16 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readRefinementBitmap(PDFJBIG2BitmapRefinementDec
 
     PDFJBIG2ArithmeticDecoder& decoder = *parameters.decoder;
 
-    auto createContext = [&](int x, int y) -> uint16_t
-    {
-        uint16_t pixelContext = 0;
-        uint16_t pixelContextShift = 0;
-        auto createContextBit = [&](const PDFJBIG2Bitmap* bitmap, int offsetX, int offsetY)
-        {
-            uint16_t bit = bitmap->getPixelSafe(offsetX, offsetY) ? 1 : 0;
-            bit = bit << pixelContextShift;
-            pixelContext |= bit;
-            ++pixelContextShift;
-        };
-
-        if (!parameters.GRTEMPLATE)
-        {
-            // 13-bit context
-            createContextBit(&GRREG, x - 1, y);
-            createContextBit(&GRREG, x + 1, y - 1);
-            createContextBit(&GRREG, x + 0, y - 1);
-            createContextBit(&GRREG, x + parameters.GRAT[0].x, y + parameters.GRAT[0].y);
-
-            const int refX = x - parameters.GRREFERENCEX;
-            const int refY = y - parameters.GRREFERENCEY;
+    const PDFJBIG2Bitmap* reference = parameters.GRREFERENCE;
 
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX - 1, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX - 1, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY - 1);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY - 1);
-            createContextBit(parameters.GRREFERENCE, refX + parameters.GRAT[1].x, refY + parameters.GRAT[1].y);
-        }
-        else
-        {
-            // 10-bit context
-            createContextBit(&GRREG, x - 1, y);
-            createContextBit(&GRREG, x + 1, y - 1);
-            createContextBit(&GRREG, x + 0, y - 1);
-            createContextBit(&GRREG, x - 1, y - 1);
-
-            const int refX = x - parameters.GRREFERENCEX;
-            const int refY = y - parameters.GRREFERENCEY;
-
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX - 1, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY - 1);
-        }
-
-        return pixelContext;
-    };
-
-    auto evaluateTPGRPIX = [&](int x, int y, uint8_t& value) -> bool
+    // Pixel context is created using rolling registers, similarly as in
+    // generic region decoding. Each register contains three pixels of the row,
+    // bit 0 is pixel x + 1 (or refX + 1), bit 1 is pixel x, and bit 2 is pixel x - 1.
+    auto loadRegister = [](const PDFJBIG2Bitmap* bitmap, int x, int y) -> uint32_t
     {
-        const int refX = x - parameters.GRREFERENCEX;
-        const int refY = y - parameters.GRREFERENCEY;
-
-        value = parameters.GRREFERENCE->getPixelSafe(refX, refY);
-
-        return parameters.GRREFERENCE->getPixelSafe(refX - 1, refY - 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 0, refY - 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 1, refY - 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX - 1, refY + 0) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 1, refY + 0) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX - 1, refY + 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 0, refY + 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 1, refY + 1) == value;
+        return (uint32_t(bitmap->getPixelSafe(x + 1, y)) << 0) |
+               (uint32_t(bitmap->getPixelSafe(x + 0, y)) << 1) |
+               (uint32_t(bitmap->getPixelSafe(x - 1, y)) << 2);
     };
 
     for (int32_t y = 0; y < static_cast<int32_t>(parameters.GRH); ++y)
@@ -3240,27 +3234,64 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readRefinementBitmap(PDFJBIG2BitmapRefinementDec
             LTP = LTP ^ decoder.readBit(LTPContext, parameters.arithmeticDecoderState);
         }
 
-        if (!LTP)
-        {
-            for (int32_t x = 0; x < static_cast<int32_t>(parameters.GRW); ++x)
-            {
-                GRREG.setPixel(x, y, (decoder.readBit(createContext(x, y), parameters.arithmeticDecoderState)) ? 0xFF : 0x00);
-            }
-        }
-        else
+        const int refY = y - parameters.GRREFERENCEY;
+        const int refX0 = -parameters.GRREFERENCEX;
+
+        // Registers are shifted before the pixel is decoded, so
+        // we must load them with pixels left to the first pixel.
+        uint32_t currentRow = 0;
+        uint32_t previousRow = loadRegister(&GRREG, -1, y - 1);
+        uint32_t referenceRowAbove = loadRegister(reference, refX0 - 1, refY - 1);
+        uint32_t referenceRow = loadRegister(reference, refX0 - 1, refY);
+        uint32_t referenceRowBelow = loadRegister(reference, refX0 - 1, refY + 1);
+
+        for (int32_t x = 0; x < static_cast<int32_t>(parameters.GRW); ++x)
         {
-            for (int32_t x = 0; x < static_cast<int32_t>(parameters.GRW); ++x)
+            const int refX = x + refX0;
+
+            previousRow = ((previousRow << 1) | GRREG.getPixelSafe(x + 1, y - 1)) & 0x07;
+            referenceRowAbove = ((referenceRowAbove << 1) | reference->getPixelSafe(refX + 1, refY - 1)) & 0x07;
+            referenceRow = ((referenceRow << 1) | reference->getPixelSafe(refX + 1, refY)) & 0x07;
+            referenceRowBelow = ((referenceRowBelow << 1) | reference->getPixelSafe(refX + 1, refY + 1)) & 0x07;
+
+            if (LTP)
             {
-                uint8_t TPGRVAL = 0;
-                if (evaluateTPGRPIX(x, y, TPGRVAL))
+                // TPGRPIX - all pixels of the 3x3 neighbourhood in the reference
+                // bitmap have the same value.
+                if (referenceRowAbove == referenceRow && referenceRow == referenceRowBelow && (referenceRow == 0 || referenceRow == 0x07))
                 {
+                    const uint32_t TPGRVAL = referenceRow & 0x01;
                     GRREG.setPixel(x, y, TPGRVAL);
+                    currentRow = TPGRVAL;
+                    continue;
                 }
-                else
-                {
-                    GRREG.setPixel(x, y, (decoder.readBit(createContext(x, y), parameters.arithmeticDecoderState)) ? 0xFF : 0x00);
-                }
             }
+
+            uint32_t pixelContext = 0;
+            if (!parameters.GRTEMPLATE)
+            {
+                // 13-bit context
+                pixelContext = (currentRow & 0x01) |
+                               ((previousRow & 0x03) << 1) |
+                               (uint32_t(GRREG.getPixelSafe(x + parameters.GRAT[0].x, y + parameters.GRAT[0].y)) << 3) |
+                               (referenceRowBelow << 4) |
+                               (referenceRow << 7) |
+                               ((referenceRowAbove & 0x03) << 10) |
+                               (uint32_t(reference->getPixelSafe(refX + parameters.GRAT[1].x, refY + parameters.GRAT[1].y)) << 12);
+            }
+            else
+            {
+                // 10-bit context
+                pixelContext = (currentRow & 0x01) |
+                               (previousRow << 1) |
+                               ((referenceRowBelow & 0x03) << 4) |
+                               (referenceRow << 6) |
+                               (((referenceRowAbove >> 1) & 0x01) << 9);
+            }
+
+            const uint32_t pixel = decoder.readBit(pixelContext, parameters.arithmeticDecoderState) ? 1 : 0;
+            GRREG.setPixel(x, y, pixel);
+            currentRow = pixel;
         }
     }
 
@@ -3562,10 +3593,8 @@ PDFJBIG2ReferencedSegments PDFJBIG2Decoder::getReferencedSegments(const PDFJBIG2
 
     for (const uint32_t referredSegmentId : header.getReferredSegments())
     {
-        auto it = m_segments.find(referredSegmentId);
-        if (it != m_segments.cend() && it->second)
+        if (const PDFJBIG2Segment* referredSegment = getSegment(referredSegmentId))
         {
-            const PDFJBIG2Segment* referredSegment = it->second.get();
             if (const PDFJBIG2Bitmap* bitmap = referredSegment->asBitmap())
             {
                 segments.bitmaps.push_back(bitmap);
@@ -3636,23 +3665,27 @@ int32_t PDFJBIG2Decoder::checkInteger(std::optional<int32_t> value)
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap() :
     m_width(0),
-    m_height(0)
+    m_height(0),
+    m_wordsPerRow(0)
 {
 
 }
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap(int width, int height) :
     m_width(width),
-    m_height(height)
+    m_height(height),
+    m_wordsPerRow((qMax(width, 0) + 31) / 32)
 {
-    m_data.resize(width * height, 0);
+    m_data.resize(m_wordsPerRow * qMax(height, 0), 0);
 }
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap(int width, int height, uint8_t fill) :
-    m_width(width),
-    m_height(height)
+    PDFJBIG2Bitmap(width, height)
 {
-    m_data.resize(width * height, fill);
+    if (fill)
+    {
+        fillOne();
+    }
 }
 
 PDFJBIG2Bitmap::~PDFJBIG2Bitmap()
@@ -3660,16 +3693,68 @@ PDFJBIG2Bitmap::~PDFJBIG2Bitmap()
 
 }
 
+qint64 PDFJBIG2Bitmap::getMemoryConsumptionEstimate() const
+{
+    return sizeof(*this) + m_data.size() * sizeof(uint32_t);
+}
+
+void PDFJBIG2Bitmap::fill(uint8_t value)
+{
+    std::fill(m_data.begin(), m_data.end(), value ? 0xFFFFFFFFU : 0U);
+
+    if (value)
+    {
+        clearPadding(0);
+    }
+}
+
+uint32_t PDFJBIG2Bitmap::getLastWordMask() const
+{
+    const int validBits = m_width & 31;
+    return validBits ? (0xFFFFFFFFU << (32 - validBits)) : 0xFFFFFFFFU;
+}
+
+void PDFJBIG2Bitmap::clearPadding(int startRow)
+{
+    if (m_wordsPerRow == 0)
+    {
+        return;
+    }
+
+    const uint32_t mask = getLastWordMask();
+    for (int y = startRow; y < m_height; ++y)
+    {
+        getRow(y)[m_wordsPerRow - 1] &= mask;
+    }
+}
+
 PDFJBIG2Bitmap PDFJBIG2Bitmap::getSubbitmap(int offsetX, int offsetY, int width, int height) const
 {
     PDFJBIG2Bitmap result(width, height, 0x00);
 
+    if (!result.isValid())
+    {
+        return result;
+    }
+
+    const uint32_t lastWordMask = result.getLastWordMask();
     for (int y = 0; y < height; ++y)
     {
-        for (int x = 0; x < width; ++x)
+        const int sourceY = y + offsetY;
+        if (sourceY < 0 || sourceY >= m_height)
+        {
+            continue;
+        }
+
+        const uint32_t* sourceRow = getRow(sourceY);
+        uint32_t* targetRow = result.getRow(y);
+
+        for (int i = 0; i < result.m_wordsPerRow; ++i)
         {
-            result.setPixel(x, y, getPixelSafe(x + offsetX, y + offsetY));
+            targetRow[i] = getRowWord(sourceRow, offsetX + i * 32);
         }
+
+        targetRow[result.m_wordsPerRow - 1] &= lastWordMask;
     }
 
     return result;
@@ -3685,8 +3770,14 @@ void PDFJBIG2Bitmap::paint(const PDFJBIG2Bitmap& bitmap, int offsetX, int offset
     // Expand, if it is allowed and target bitmap has too low height
     if (expandY && offsetY + bitmap.getHeight() > m_height)
     {
+        const int oldHeight = m_height;
         m_height = offsetY + bitmap.getHeight();
-        m_data.resize(getPixelCount(), expandPixel);
+        m_data.resize(m_wordsPerRow * m_height, expandPixel ? 0xFFFFFFFFU : 0U);
+
+        if (expandPixel)
+        {
+            clearPadding(oldHeight);
+        }
     }
 
     // Check out pathological cases
@@ -3695,48 +3786,71 @@ void PDFJBIG2Bitmap::paint(const PDFJBIG2Bitmap& bitmap, int offsetX, int offset
         return;
     }
 
-    const int targetStartX = offsetX;
+    const int targetStartX = qMax(offsetX, 0);
     const int targetEndX = qMin(offsetX + bitmap.getWidth(), m_width);
-    const int targetStartY = offsetY;
+    const int targetStartY = qMax(offsetY, 0);
     const int targetEndY = qMin(offsetY + bitmap.getHeight(), m_height);
 
+    if (targetStartX >= targetEndX)
+    {
+        return;
+    }
+
+    // Target area is processed by words, first and last word of each
+    // row are masked, so pixels outside of target area are not changed.
+    const int firstWord = targetStartX >> 5;
+    const int lastWord = (targetEndX - 1) >> 5;
+    const uint32_t firstWordMask = 0xFFFFFFFFU >> (targetStartX & 31);
+    const uint32_t lastWordMask = 0xFFFFFFFFU << (31 - ((targetEndX - 1) & 31));
+
     for (int targetY = targetStartY; targetY < targetEndY; ++targetY)
     {
-        for (int targetX = targetStartX; targetX < targetEndX; ++targetX)
-        {
-            const int sourceX = targetX - targetStartX;
-            const int sourceY = targetY - targetStartY;
+        const uint32_t* sourceRow = bitmap.getRow(targetY - offsetY);
+        uint32_t* targetRow = getRow(targetY);
 
-            if (targetX < 0 || targetX >= m_width || targetY < 0 || targetY >= m_height)
+        for (int i = firstWord; i <= lastWord; ++i)
+        {
+            uint32_t mask = 0xFFFFFFFFU;
+            if (i == firstWord)
             {
-                continue;
+                mask &= firstWordMask;
+            }
+            if (i == lastWord)
+            {
+                mask &= lastWordMask;
             }
 
+            const uint32_t source = bitmap.getRowWord(sourceRow, i * 32 - offsetX);
+            const uint32_t target = targetRow[i];
+            uint32_t result = 0;
+
             switch (operation)
             {
                 case PDFJBIG2BitOperation::Or:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) | bitmap.getPixel(sourceX, sourceY));
+                    result = target | source;
                     break;
 
                 case PDFJBIG2BitOperation::And:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) & bitmap.getPixel(sourceX, sourceY));
+                    result = target & source;
                     break;
 
                 case PDFJBIG2BitOperation::Xor:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) ^ bitmap.getPixel(sourceX, sourceY));
+                    result = target ^ source;
                     break;
 
                 case PDFJBIG2BitOperation::NotXor:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) ^ (~bitmap.getPixel(sourceX, sourceY)));
+                    result = ~(target ^ source);
                     break;
 
                 case PDFJBIG2BitOperation::Replace:
-                    setPixel(targetX, targetY, bitmap.getPixel(sourceX, sourceY));
+                    result = source;
                     break;
 
                 default:
                     throw PDFException(PDFTranslationContext::tr("JBIG2 - invalid bitmap paint operation."));
             }
+
+            targetRow[i] = (target & ~mask) | (result & mask);
         }
     }
 }
@@ -3748,10 +3862,8 @@ void PDFJBIG2Bitmap::copyRow(int target, int source)
         throw PDFException(PDFTranslationContext::tr("JBIG2 - invalid bitmap copy row operation."));
     }
 
-    auto itSource = std::next(m_data.cbegin(), source * m_width);
-    auto itSourceEnd = std::next(itSource, m_width);
-    auto itTarget = std::next(m_data.begin(), target * m_width);
-    std::copy(itSource, itSourceEnd, itTarget);
+    const uint32_t* sourceRow = getRow(source);
+    std::copy(sourceRow, sourceRow + m_wordsPerRow, getRow(target));
 }
 
 PDFJBIG2HuffmanCodeTable::PDFJBIG2HuffmanCodeTable(std::vector<PDFJBIG2HuffmanTableEntry>&& entries) :
@@ -3819,6 +3931,168 @@ PDFJBIG2Segment::~PDFJBIG2Segment()
 
 }
 
+qint64 PDFJBIG2SymbolDictionary::getMemoryConsumptionEstimate() const
+{
+    qint64 memoryConsumption = sizeof(*this);
+    for (const PDFJBIG2Bitmap& bitmap : m_bitmaps)
+    {
+        memoryConsumption += bitmap.getMemoryConsumptionEstimate();
+    }
+    memoryConsumption += m_genericState.getMemoryConsumptionEstimate();
+    memoryConsumption += m_genericRefinementState.getMemoryConsumptionEstimate();
+    return memoryConsumption;
+}
+
+qint64 PDFJBIG2PatternDictionary::getMemoryConsumptionEstimate() const
+{
+    qint64 memoryConsumption = sizeof(*this);
+    for (const PDFJBIG2Bitmap& bitmap : m_bitmaps)
+    {
+        memoryConsumption += bitmap.getMemoryConsumptionEstimate();
+    }
+    return memoryConsumption;
+}
+
+PDFJBIG2Globals::PDFJBIG2Globals(std::map<uint32_t, std::unique_ptr<PDFJBIG2Segment>>&& segments) :
+    m_segments(qMove(segments)),
+    m_memoryConsumption(sizeof(*this))
+{
+    for (const auto& item : m_segments)
+    {
+        if (item.second)
+        {
+            m_memoryConsumption += item.second->getMemoryConsumptionEstimate();
+        }
+    }
+}
+
+PDFJBIG2Globals::~PDFJBIG2Globals()
+{
+
+}
+
+const PDFJBIG2Segment* PDFJBIG2Globals::getSegment(uint32_t segmentNumber) const
+{
+    auto it = m_segments.find(segmentNumber);
+    if (it != m_segments.cend())
+    {
+        return it->second.get();
+    }
+
+    return nullptr;
+}
+
+void PDFJBIG2GlobalsCache::setDocument(const PDFModifiedDocument& document)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_document != document)
+    {
+        m_document = document;
+
+        // Global streams can be changed only, if page contents has been changed
+        if (document.hasReset() || document.hasPageContentsChanged())
+        {
+            m_globals.clear();
+            m_memoryConsumption = 0;
+        }
+    }
+}
+
+PDFJBIG2GlobalsPointer PDFJBIG2GlobalsCache::getGlobals(const PDFDocument* document,
+                                                        PDFObjectReference reference,
+                                                        PDFRenderErrorReporter* errorReporter) const
+{
+    auto decodeGlobals = [document, reference, errorReporter]() -> PDFJBIG2GlobalsPointer
+    {
+        const PDFObject& globalDataObject = document->getObjectByReference(reference);
+        if (!globalDataObject.isStream())
+        {
+            return nullptr;
+        }
+
+        return PDFJBIG2Decoder::decodeGlobals(document->getDecodedStream(globalDataObject.getStream()), errorReporter);
+    };
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if (document != m_document)
+        {
+            // Cache belongs to another document (or document is being modified),
+            // do not store the global segments.
+            lock.unlock();
+            return decodeGlobals();
+        }
+
+        auto it = m_globals.find(reference);
+        if (it != m_globals.cend())
+        {
+            return it->second;
+        }
+    }
+
+    // Decode global segments outside of the lock, so other images can be
+    // decoded meanwhile. If global segments are decoded by multiple threads
+    // at once, only the first result is stored.
+    PDFJBIG2GlobalsPointer globals = decodeGlobals();
+    if (!globals)
+    {
+        return globals;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    if (document != m_document)
+    {
+        return globals;
+    }
+
+    auto it = m_globals.find(reference);
+    if (it != m_globals.cend())
+    {
+        return it->second;
+    }
+
+    const qint64 memoryConsumption = globals->getMemoryConsumptionEstimate();
+    if (m_memoryConsumption + memoryConsumption > m_cacheLimit)
+    {
+        // We have exceeded the cache limit. Clear the cache.
+        m_globals.clear();
+        m_memoryConsumption = 0;
+    }
+
+    if (memoryConsumption <= m_cacheLimit)
+    {
+        m_globals[reference] = globals;
+        m_memoryConsumption += memoryConsumption;
+    }
+
+    return globals;
+}
+
+void PDFJBIG2GlobalsCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_globals.clear();
+    m_memoryConsumption = 0;
+}
+
+void PDFJBIG2GlobalsCache::setCacheLimit(qint64 cacheLimit)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cacheLimit = cacheLimit;
+
+    if (m_memoryConsumption > m_cacheLimit)
+    {
+        m_globals.clear();
+        m_memoryConsumption = 0;
+    }
+}
+
+qint64 PDFJBIG2GlobalsCache::getMemoryConsumptionEstimate() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_memoryConsumption;
+}
+
 PDFJBIG2HuffmanDecoder::PDFJBIG2HuffmanDecoder(PDFBitReader* reader, const PDFJBIG2HuffmanCodeTable* table) :
     m_reader(reader)
 {
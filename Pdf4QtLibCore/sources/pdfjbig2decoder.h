@@ -21,11 +21,17 @@
 #include "pdfutils.h"
 #include "pdfcolorspaces.h"
 
+#include <QMutex>
+
+#include <map>
+#include <memory>
 #include <optional>
 
 namespace pdf
 {
+class PDFDocument;
 class PDFJBIG2Bitmap;
+class PDFModifiedDocument;
 class PDFRenderErrorReporter;
 class PDFJBIG2HuffmanCodeTable;
 class PDFJBIG2SymbolDictionary;
@@ -131,6 +137,9 @@ public:
         m_state[context] = (QeRowIndex << 1) + MPS;
     }
 
+    /// Returns estimate of number of bytes, which context states occupy in memory
+    inline qint64 getMemoryConsumptionEstimate() const { return static_cast<qint64>(m_state.size()); }
+
 private:
     std::vector<uint8_t> m_state;
 };
@@ -275,6 +284,9 @@ public:
 
     virtual const PDFJBIG2PatternDictionary* asPatternDictionary() const { return nullptr; }
     virtual PDFJBIG2PatternDictionary* asPatternDictionary() { return nullptr; }
+
+    /// Returns estimate of number of bytes, which segment occupies in memory
+    virtual qint64 getMemoryConsumptionEstimate() const = 0;
 };
 
 /// Huffman decoder - can decode integers / out of band values from huffman table.
@@ -323,6 +335,10 @@ private:
     std::vector<PDFJBIG2HuffmanTableEntry> m_entries;
 };
 
+/// Monochrome bitmap. Pixels are packed into 32-bit words, the leftmost pixel
+/// of the word is stored in the most significant bit. Each row starts at the word
+/// boundary, padding bits at the end of the row are always zero. Pixel value is
+/// 1 (black) or 0 (white).
 class PDF4QTLIBCORESHARED_EXPORT PDFJBIG2Bitmap : public PDFJBIG2Segment
 {
 public:
@@ -333,12 +349,28 @@ public:
 
     virtual const PDFJBIG2Bitmap* asBitmap() const override { return this; }
     virtual PDFJBIG2Bitmap* asBitmap() override { return this; }
+    virtual qint64 getMemoryConsumptionEstimate() const override;
 
     inline int getWidth() const { return m_width; }
     inline int getHeight() const { return m_height; }
     inline int getPixelCount() const { return m_width * m_height; }
-    inline uint8_t getPixel(int x, int y) const { return m_data[y * m_width + x]; }
-    inline void setPixel(int x, int y, uint8_t value) { m_data[y * m_width + x] = value; }
+    inline int getWordsPerRow() const { return m_wordsPerRow; }
+    inline uint8_t getPixel(int x, int y) const { return (m_data[y * m_wordsPerRow + (x >> 5)] >> (31 - (x & 31))) & 0x01; }
+
+    inline void setPixel(int x, int y, uint8_t value)
+    {
+        uint32_t& word = m_data[y * m_wordsPerRow + (x >> 5)];
+        const uint32_t mask = 0x80000000U >> (x & 31);
+
+        if (value)
+        {
+            word |= mask;
+        }
+        else
+        {
+            word &= ~mask;
+        }
+    }
 
     inline uint8_t getPixelSafe(int x, int y) const
     {
@@ -350,7 +382,15 @@ public:
         return getPixel(x, y);
     }
 
-    inline void fill(uint8_t value) { std::fill(m_data.begin(), m_data.end(), value); }
+    /// Returns packed pixels of the row
+    /// \param y Row index
+    inline const uint32_t* getRow(int y) const { return m_data.data() + y * m_wordsPerRow; }
+
+    /// Returns packed pixels of the row
+    /// \param y Row index
+    inline uint32_t* getRow(int y) { return m_data.data() + y * m_wordsPerRow; }
+
+    void fill(uint8_t value);
     inline void fillZero() { fill(0); }
     inline void fillOne() { fill(0xFF); }
 
@@ -366,6 +406,7 @@ public:
 
     /// Paints another bitmap onto this bitmap. If bitmap is invalid, nothing is done.
     /// If \p expandY is true, height of target bitmap is expanded to fit source draw area.
+    /// Bitmaps are combined word by word.
     /// \param bitmap Bitmap to be painted on this
     /// \param offsetX Horizontal offset of paint area
     /// \param offsetY Vertical offset of paint area
@@ -381,9 +422,41 @@ public:
     void copyRow(int target, int source);
 
 private:
+    /// Returns 32 pixels of the row of this bitmap, starting at pixel \p x
+    /// (first pixel is in the most significant bit). Pixels outside
+    /// of the row are zero.
+    /// \param row Row of this bitmap
+    /// \param x Horizontal coordinate of the first pixel
+    inline uint32_t getRowWord(const uint32_t* row, int x) const
+    {
+        const int wordIndex = x >> 5;
+        const int shift = x & 31;
+
+        auto getWord = [this, row](int index) -> uint32_t
+        {
+            return (index >= 0 && index < m_wordsPerRow) ? row[index] : 0;
+        };
+
+        if (!shift)
+        {
+            return getWord(wordIndex);
+        }
+
+        return (getWord(wordIndex) << shift) | (getWord(wordIndex + 1) >> (32 - shift));
+    }
+
+    /// Returns mask of valid pixels in the last word of the row
+    uint32_t getLastWordMask() const;
+
+    /// Resets padding bits at the end of each row to zero,
+    /// starting with row \p startRow.
+    /// \param startRow First row
+    void clearPadding(int startRow);
+
     int m_width;
     int m_height;
-    std::vector<uint8_t> m_data;
+    int m_wordsPerRow;
+    std::vector<uint32_t> m_data;
 };
 
 struct PDFJBIG2ReferencedSegments
@@ -424,6 +497,80 @@ struct PDFJBIG2ATPosition
 
 using PDFJBIG2ATPositions = std::array<PDFJBIG2ATPosition, 4>;
 
+/// Decoded global segments of JBIG2 data stream (JBIG2Globals stream in PDF). Global
+/// segments (typically symbol dictionaries, pattern dictionaries and huffman tables)
+/// are shared by many images, and they are immutable, once they are decoded,
+/// so they can be referenced from decoders running in multiple threads.
+class PDF4QTLIBCORESHARED_EXPORT PDFJBIG2Globals
+{
+public:
+    explicit PDFJBIG2Globals(std::map<uint32_t, std::unique_ptr<PDFJBIG2Segment>>&& segments);
+    ~PDFJBIG2Globals();
+
+    PDFJBIG2Globals(const PDFJBIG2Globals&) = delete;
+    PDFJBIG2Globals& operator=(const PDFJBIG2Globals&) = delete;
+
+    /// Returns global segment with given segment number, or nullptr,
+    /// if global segment with this number doesn't exist.
+    /// \param segmentNumber Segment number
+    const PDFJBIG2Segment* getSegment(uint32_t segmentNumber) const;
+
+    /// Returns estimate of number of bytes, which global segments occupy in memory
+    qint64 getMemoryConsumptionEstimate() const { return m_memoryConsumption; }
+
+private:
+    std::map<uint32_t, std::unique_ptr<PDFJBIG2Segment>> m_segments;
+    qint64 m_memoryConsumption;
+};
+
+using PDFJBIG2GlobalsPointer = std::shared_ptr<const PDFJBIG2Globals>;
+
+/// Cache of decoded JBIG2 global segments. Scanned documents usually share one
+/// JBIG2Globals stream (with large symbol dictionary) by all page images, so global
+/// segments are decoded only once and then referenced by all images. Global segments
+/// are cached by reference of the JBIG2Globals stream. Cache is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFJBIG2GlobalsCache
+{
+public:
+    inline explicit PDFJBIG2GlobalsCache(qint64 cacheLimit) :
+        m_cacheLimit(cacheLimit),
+        m_memoryConsumption(0)
+    {
+
+    }
+
+    /// Sets the document to the cache. Whole cache is cleared,
+    /// if it is needed.
+    /// \param document Document to be setted
+    void setDocument(const PDFModifiedDocument& document);
+
+    /// Returns decoded global segments of JBIG2Globals stream. If global segments
+    /// are not in the cache, they are decoded and stored in the cache. If they
+    /// can't be decoded, exception is thrown.
+    /// \param document Document
+    /// \param reference Reference to the JBIG2Globals stream
+    /// \param errorReporter Error reporter
+    PDFJBIG2GlobalsPointer getGlobals(const PDFDocument* document,
+                                      PDFObjectReference reference,
+                                      PDFRenderErrorReporter* errorReporter) const;
+
+    /// Clears the cache
+    void clear();
+
+    /// Sets cache limit (in bytes)
+    void setCacheLimit(qint64 cacheLimit);
+
+    /// Returns estimate of number of bytes, which cached global segments occupy in memory
+    qint64 getMemoryConsumptionEstimate() const;
+
+private:
+    qint64 m_cacheLimit;
+    mutable qint64 m_memoryConsumption;
+    mutable QMutex m_mutex;
+    const PDFDocument* m_document = nullptr;
+    mutable std::map<PDFObjectReference, PDFJBIG2GlobalsPointer> m_globals;
+};
+
 /// Decoder of JBIG2 data streams. Decodes the black/white monochrome image.
 /// Handles also global segments. Decoder decodes data using the specification
 /// ISO/IEC 14492:2001, T.88.
@@ -443,6 +590,16 @@ public:
 
     }
 
+    /// Creates decoder, which uses already decoded global segments
+    /// \param data JBIG2 data stream
+    /// \param globals Decoded global segments (can be nullptr)
+    /// \param errorReporter Error reporter
+    explicit inline PDFJBIG2Decoder(QByteArray data, PDFJBIG2GlobalsPointer globals, PDFRenderErrorReporter* errorReporter) :
+        PDFJBIG2Decoder(qMove(data), QByteArray(), errorReporter)
+    {
+        m_globals = qMove(globals);
+    }
+
     PDFJBIG2Decoder(const PDFJBIG2Decoder&) = delete;
     PDFJBIG2Decoder(PDFJBIG2Decoder&&) = default;
 
@@ -461,6 +618,13 @@ public:
     /// If number of pages is invalid, then exception is thrown.
     PDFImageData decodeFileStream();
 
+    /// Decodes global segments (JBIG2Globals stream). Decoded global segments
+    /// can be then shared by decoders of multiple images. If global segments
+    /// cannot be decoded, exception is thrown.
+    /// \param globalData Data of JBIG2Globals stream
+    /// \param errorReporter Error reporter
+    static PDFJBIG2GlobalsPointer decodeGlobals(QByteArray globalData, PDFRenderErrorReporter* errorReporter);
+
 private:
     static constexpr const uint32_t MAX_BITMAP_SIZE = 65536;
 
@@ -482,6 +646,12 @@ private:
     void processCodeTables(const PDFJBIG2SegmentHeader& header);
     void processExtension(const PDFJBIG2SegmentHeader& header);
 
+    /// Returns segment with given number. Segments of the decoded data stream
+    /// are searched first, then global segments. If segment doesn't exist,
+    /// then nullptr is returned.
+    /// \param segmentNumber Segment number
+    const PDFJBIG2Segment* getSegment(uint32_t segmentNumber) const;
+
     /// Returns bitmap for given segment index. If bitmap is not found, or segment
     /// is of different type, then exception is thrown.
     /// \param segmentIndex Segment index with bitmap
@@ -523,6 +693,7 @@ private:
     PDFRenderErrorReporter* m_errorReporter;
     PDFBitReader m_reader;
     std::map<uint32_t, std::unique_ptr<PDFJBIG2Segment>> m_segments;
+    PDFJBIG2GlobalsPointer m_globals;
     uint8_t m_pageDefaultPixelValue;
     PDFJBIG2BitOperation m_pageDefaultCompositionOperator;
     bool m_pageDefaultCompositionOperatorOverriden;
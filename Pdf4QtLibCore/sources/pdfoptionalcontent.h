@@ -167,6 +167,9 @@ public:
     /// \param ocg Optional content group
     OCState getState(PDFObjectReference ocg) const;
 
+    /// Returns states of all optional content groups
+    const std::map<PDFObjectReference, OCState>& getStates() const { return m_states; }
+
     /// Sets document to this object. Optional content settings
     /// must be compatible and applicable to new document.
     /// \param document Document
@@ -236,6 +236,8 @@ PDFPageContentProcessor::PDFPageContentProcessor(const PDFPage* page,
     m_CMS(CMS),
     m_optionalContentActivity(optionalContentActivity),
     m_operationControl(nullptr),
+    m_meshCache(nullptr),
+    m_jbig2GlobalsCache(nullptr),
     m_colorSpaceDictionary(nullptr),
     m_fontDictionary(nullptr),
     m_xobjectDictionary(nullptr),
@@ -356,6 +358,73 @@ QList<PDFRenderError> PDFPageContentProcessor::processContents()
     return m_errorList;
 }
 
+QList<PDFRenderError> PDFPageContentProcessor::processFormContents(const PDFStream* stream, const PDFPageContentProcessorState& graphicState)
+{
+    // Initialize stream processor
+    initializeProcessor();
+
+    // Clipping area of the graphic state belongs to the caller's device
+    // space, form content is processed without it.
+    m_graphicState = graphicState;
+    m_graphicState.setClipBoundingRect(std::nullopt);
+    m_graphicState.setStateFlags(PDFPageContentProcessorState::StateAll);
+    updateGraphicState();
+
+    processForm(stream);
+
+    finishMarkedContent();
+    return m_errorList;
+}
+
+QList<PDFRenderError> PDFPageContentProcessor::processTilingPatternContents(const PDFTilingPattern* tilingPattern,
+                                                                           const QTransform& cellMatrix,
+                                                                           const QRect& cells,
+                                                                           PDFColorSpacePointer uncoloredPatternColorSpace,
+                                                                           PDFColor uncoloredPatternColor)
+{
+    // Initialize stream processor
+    initializeProcessor();
+
+    try
+    {
+        processTilingPatternCells(tilingPattern, cellMatrix, cells, qMove(uncoloredPatternColorSpace), qMove(uncoloredPatternColor));
+    }
+    catch (const PDFException& exception)
+    {
+        m_errorList.append(PDFRenderError(RenderErrorType::Error, exception.getMessage()));
+    }
+    catch (const PDFRendererException& exception)
+    {
+        m_errorList.append(exception.getError());
+    }
+
+    finishMarkedContent();
+    return m_errorList;
+}
+
+QList<PDFRenderError> PDFPageContentProcessor::processType3GlyphContents(const PDFType3Font* font, const QByteArray& contentStream, const PDFPageContentProcessorState& graphicState)
+{
+    // Initialize stream processor
+    initializeProcessor();
+
+    const PDFObject& resources = font->getResources();
+    if (!resources.isNull())
+    {
+        initDictionaries(resources);
+    }
+
+    m_graphicState = graphicState;
+    m_graphicState.setCurrentTransformationMatrix(QTransform());
+    m_graphicState.setClipBoundingRect(std::nullopt);
+    m_graphicState.setStateFlags(PDFPageContentProcessorState::StateAll);
+    updateGraphicState();
+
+    processContent(contentStream);
+
+    finishMarkedContent();
+    return m_errorList;
+}
+
 void PDFPageContentProcessor::reportRenderError(RenderErrorType type, QString message)
 {
     m_errorList.append(PDFRenderError(type, qMove(message)));
@@ -380,6 +449,52 @@ bool PDFPageContentProcessor::performPathPaintingUsingShading(const QPainterPath
     return false;
 }
 
+bool PDFPageContentProcessor::performFormPainting(PDFObjectReference formReference, const PDFStream* stream)
+{
+    Q_UNUSED(formReference);
+    Q_UNUSED(stream);
+
+    return false;
+}
+
+bool PDFPageContentProcessor::performType3GlyphPainting(const PDFType3Font* font, const QByteArray* contentStream, const QTransform& glyphMatrix)
+{
+    Q_UNUSED(font);
+    Q_UNUSED(contentStream);
+    Q_UNUSED(glyphMatrix);
+
+    return false;
+}
+
+bool PDFPageContentProcessor::performPathPaintingUsingTilingPattern(const QPainterPath& path,
+                                                                    const PDFTilingPattern* tilingPattern,
+                                                                    const QTransform& cellMatrix,
+                                                                    const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                                    const PDFColor& uncoloredPatternColor)
+{
+    Q_UNUSED(path);
+    Q_UNUSED(tilingPattern);
+    Q_UNUSED(cellMatrix);
+    Q_UNUSED(uncoloredPatternColorSpace);
+    Q_UNUSED(uncoloredPatternColor);
+
+    return false;
+}
+
+PDFMeshQualitySettings PDFPageContentProcessor::getShadingMeshQualitySettings() const
+{
+    PDFMeshQualitySettings settings = m_meshQualitySettings;
+    settings.deviceSpaceMeshingArea = getPageBoundingRectDeviceSpace();
+    if (m_regionOfInterest.has_value())
+    {
+        // Mesh is not needed outside of the region of interest
+        settings.deviceSpaceMeshingArea = settings.deviceSpaceMeshingArea.intersected(*m_regionOfInterest);
+    }
+    settings.userSpaceToDeviceSpaceMatrix = getPatternBaseMatrix();
+    settings.initResolution();
+    return settings;
+}
+
 void PDFPageContentProcessor::performFinishPathPainting()
 {
 
@@ -398,6 +513,12 @@ bool PDFPageContentProcessor::performOriginalImagePainting(const PDFImage& image
     return false;
 }
 
+bool PDFPageContentProcessor::performXObjectImagePainting(const PDFStream* stream)
+{
+    Q_UNUSED(stream);
+    return false;
+}
+
 void PDFPageContentProcessor::performImagePainting(const QImage& image)
 {
     Q_UNUSED(image);
@@ -444,6 +565,16 @@ void PDFPageContentProcessor::performMarkedContentEnd()
 
 }
 
+void PDFPageContentProcessor::performOptionalContentBegin(PDFObjectReference ocgOrOcmd)
+{
+    Q_UNUSED(ocgOrOcmd);
+}
+
+void PDFPageContentProcessor::performOptionalContentEnd()
+{
+
+}
+
 void PDFPageContentProcessor::performSetCharWidth(PDFReal wx, PDFReal wy)
 {
     Q_UNUSED(wx);
@@ -510,6 +641,43 @@ bool PDFPageContentProcessor::isContentSuppressed() const
     return std::any_of(m_markedContentStack.cbegin(), m_markedContentStack.cend(), [](const MarkedContentState& state) { return state.contentSuppressed; });
 }
 
+bool PDFPageContentProcessor::isClippedContentRejected() const
+{
+    return false;
+}
+
+bool PDFPageContentProcessor::isContentClippedOut(const QRectF& deviceRect) const
+{
+    // We add a small margin to the content bounding rectangle, so degenerated
+    // content (for example, horizontal hairline) is not rejected.
+    const QRectF adjustedDeviceRect = deviceRect.adjusted(-1.0, -1.0, 1.0, 1.0);
+
+    if (m_regionOfInterest.has_value() && !m_regionOfInterest->intersects(adjustedDeviceRect))
+    {
+        return true;
+    }
+
+    const std::optional<QRectF>& clipBoundingRect = m_graphicState.getClipBoundingRect();
+    if (!clipBoundingRect.has_value() || !isClippedContentRejected())
+    {
+        return false;
+    }
+
+    return !clipBoundingRect->intersects(adjustedDeviceRect);
+}
+
+void PDFPageContentProcessor::intersectClipBoundingRect(const QRectF& deviceRect)
+{
+    const std::optional<QRectF>& clipBoundingRect = m_graphicState.getClipBoundingRect();
+    m_graphicState.setClipBoundingRect(clipBoundingRect.has_value() ? clipBoundingRect->intersected(deviceRect) : deviceRect);
+}
+
+void PDFPageContentProcessor::processClipping(const QPainterPath& path, Qt::FillRule fillRule)
+{
+    intersectClipBoundingRect(getCurrentWorldMatrix().mapRect(path.controlPointRect()));
+    performClipping(path, fillRule);
+}
+
 PDFPageContentProcessor::PDFTransparencyGroup PDFPageContentProcessor::parseTransparencyGroup(const PDFObject& object)
 {
     PDFTransparencyGroup group;
@@ -801,7 +969,13 @@ void PDFPageContentProcessor::processForm(const QTransform& matrix,
     {
         QPainterPath path;
         path.addRect(boundingBox);
-        performClipping(path, path.fillRule());
+        processClipping(path, path.fillRule());
+
+        if (isContentClippedOut(getCurrentWorldMatrix().mapRect(boundingBox)))
+        {
+            // Form lies outside of the clipping area
+            return;
+        }
     }
 
     // Initialize the resources, if we have them
@@ -827,6 +1001,24 @@ void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool
         return;
     }
 
+    if (isClippedContentRejected() || m_regionOfInterest.has_value())
+    {
+        QRectF boundingRect = path.controlPointRect();
+        if (stroke)
+        {
+            // Stroke can exceed the path by miter joins (limited by miter limit)
+            // or by square caps, we use conservative estimate of both.
+            const PDFReal strokeOffset = 0.5 * m_graphicState.getLineWidth() * qMax(m_graphicState.getMitterLimit(), 2.0);
+            boundingRect.adjust(-strokeOffset, -strokeOffset, strokeOffset, strokeOffset);
+        }
+
+        if (isContentClippedOut(getCurrentWorldMatrix().mapRect(boundingRect)))
+        {
+            // Path lies outside of the clipping area, do not paint anything
+            return;
+        }
+    }
+
     if (fill)
     {
         if (const PDFPatternColorSpace* patternColorSpace = getGraphicState()->getFillColorSpace()->asPatternColorSpace())
@@ -868,14 +1060,11 @@ void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool
                         }
 
                         // We must create a mesh and then draw pattern
-                        PDFMeshQualitySettings settings = m_meshQualitySettings;
-                        settings.deviceSpaceMeshingArea = getPageBoundingRectDeviceSpace();
-                        settings.userSpaceToDeviceSpaceMatrix = getPatternBaseMatrix();
-                        settings.initResolution();
+                        PDFMeshQualitySettings settings = getShadingMeshQualitySettings();
 
                         if (!performPathPaintingUsingShading(path, false, true, shadingPattern))
                         {
-                            PDFMesh mesh = shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+                            PDFMesh mesh = createShadingMesh(shadingPattern, settings);
 
                             // Now, merge the current path to the mesh clipping path
                             QPainterPath boundingPath = mesh.getBoundingPath();
@@ -968,10 +1157,7 @@ void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool
                         }
 
                         // We must create a mesh and then draw pattern
-                        PDFMeshQualitySettings settings = m_meshQualitySettings;
-                        settings.deviceSpaceMeshingArea = getPageBoundingRectDeviceSpace();
-                        settings.userSpaceToDeviceSpaceMatrix = getPatternBaseMatrix();
-                        settings.initResolution();
+                        PDFMeshQualitySettings settings = getShadingMeshQualitySettings();
 
                         // We must stroke the path.
                         QPainterPathStroker stroker;
@@ -990,7 +1176,7 @@ void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool
 
                         if (!performPathPaintingUsingShading(strokedPath, true, false, shadingPattern))
                         {
-                            PDFMesh mesh = shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+                            PDFMesh mesh = createShadingMesh(shadingPattern, settings);
 
                             QPainterPath boundingPath = mesh.getBoundingPath();
                             if (boundingPath.isEmpty())
@@ -1040,7 +1226,39 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
                                                             PDFColor uncoloredPatternColor)
 {
     PDFPageContentProcessorStateGuard guard(this);
-    performClipping(path, path.fillRule());
+    processClipping(path, path.fillRule());
+
+    Q_ASSERT(m_pagePointToDevicePointMatrix.isInvertible());
+
+    // Initialize rendering matrix
+    QTransform patternMatrix = tilingPattern->getMatrix() * getPatternBaseMatrix();
+    QTransform matrix = patternMatrix * m_pagePointToDevicePointMatrix.inverted();
+    QTransform pathTransformationMatrix = m_graphicState.getCurrentTransformationMatrix() * matrix.inverted();
+
+    // Tiling parameters
+    const QRectF tilingArea = pathTransformationMatrix.map(path).boundingRect();
+    const PDFReal xStep = qAbs(tilingPattern->getXStep());
+    const PDFReal yStep = qAbs(tilingPattern->getYStep());
+    const QTransform cellMatrix = QTransform::fromTranslate(tilingArea.left(), tilingArea.top()) * patternMatrix;
+
+    if (performPathPaintingUsingTilingPattern(path, tilingPattern, cellMatrix, uncoloredPatternColorSpace, uncoloredPatternColor))
+    {
+        return;
+    }
+
+    // Draw the tiling
+    const PDFInteger columns = qMax<PDFInteger>(qCeil(tilingArea.width() / xStep), 1);
+    const PDFInteger rows = qMax<PDFInteger>(qCeil(tilingArea.height() / yStep), 1);
+    processTilingPatternCells(tilingPattern, cellMatrix, QRect(0, 0, columns, rows), qMove(uncoloredPatternColorSpace), qMove(uncoloredPatternColor));
+}
+
+void PDFPageContentProcessor::processTilingPatternCells(const PDFTilingPattern* tilingPattern,
+                                                        const QTransform& cellMatrix,
+                                                        const QRect& cells,
+                                                        PDFColorSpacePointer uncoloredPatternColorSpace,
+                                                        PDFColor uncoloredPatternColor)
+{
+    PDFPageContentProcessorStateGuard guard(this);
 
     // Initialize resources
     const PDFObject& resources = tilingPattern->getResources();
@@ -1052,9 +1270,7 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
     Q_ASSERT(m_pagePointToDevicePointMatrix.isInvertible());
 
     // Initialize rendering matrix
-    QTransform patternMatrix = tilingPattern->getMatrix() * getPatternBaseMatrix();
-    QTransform matrix = patternMatrix * m_pagePointToDevicePointMatrix.inverted();
-    QTransform pathTransformationMatrix = m_graphicState.getCurrentTransformationMatrix() * matrix.inverted();
+    QTransform matrix = cellMatrix * m_pagePointToDevicePointMatrix.inverted();
     m_graphicState.setCurrentTransformationMatrix(matrix);
 
     int uncoloredTilingPatternFlag = 0;
@@ -1093,7 +1309,6 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
     PDFTemporaryValueChange guard2(&m_drawingUncoloredTilingPatternState, m_drawingUncoloredTilingPatternState + uncoloredTilingPatternFlag);
 
     // Tiling parameters
-    const QRectF tilingArea = pathTransformationMatrix.map(path).boundingRect();
     const QRectF boundingBox = tilingPattern->getBoundingBox();
     const PDFReal xStep = qAbs(tilingPattern->getXStep());
     const PDFReal yStep = qAbs(tilingPattern->getYStep());
@@ -1102,18 +1317,14 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
     boundingPath.addRect(boundingBox);
 
     // Draw the tiling
-    const PDFInteger columns = qMax<PDFInteger>(qCeil(tilingArea.width() / xStep), 1);
-    const PDFInteger rows = qMax<PDFInteger>(qCeil(tilingArea.height() / yStep), 1);
-
     QTransform baseTransformationMatrix = m_graphicState.getCurrentTransformationMatrix();
-    for (PDFInteger column = 0; column < columns; ++column)
+    for (PDFInteger column = cells.left(); column <= cells.right(); ++column)
     {
-        for (PDFInteger row = 0; row < rows; ++row)
+        for (PDFInteger row = cells.top(); row <= cells.bottom(); ++row)
         {
             PDFPageContentProcessorGraphicStateSaveRestoreGuard guard3(this);
 
             QTransform transformationMatrix = baseTransformationMatrix;
-            transformationMatrix.translate(tilingArea.left(), tilingArea.top());
             transformationMatrix.translate(column * xStep, row * yStep);
 
             QTransform currentPatternMatrix = transformationMatrix * m_pagePointToDevicePointMatrix;
@@ -1122,7 +1333,7 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
             m_graphicState.setCurrentTransformationMatrix(transformationMatrix);
             updateGraphicState();
 
-            performClipping(boundingPath, boundingPath.fillRule());
+            processClipping(boundingPath, boundingPath.fillRule());
             processContent(content);
 
             if (isProcessingCancelled())
@@ -1876,6 +2087,31 @@ void PDFPageContentProcessor::setOperationControl(const PDFOperationControl* new
     m_operationControl = newOperationControl;
 }
 
+void PDFPageContentProcessor::setMeshCache(const PDFMeshCache* meshCache)
+{
+    m_meshCache = meshCache;
+}
+
+void PDFPageContentProcessor::setJBIG2GlobalsCache(const PDFJBIG2GlobalsCache* jbig2GlobalsCache)
+{
+    m_jbig2GlobalsCache = jbig2GlobalsCache;
+}
+
+void PDFPageContentProcessor::setRegionOfInterest(const QRectF& regionOfInterest)
+{
+    m_regionOfInterest = regionOfInterest;
+}
+
+PDFMesh PDFPageContentProcessor::createShadingMesh(const PDFShadingPattern* shadingPattern, const PDFMeshQualitySettings& settings)
+{
+    if (m_meshCache)
+    {
+        return m_meshCache->getMesh(shadingPattern, settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+    }
+
+    return shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+}
+
 bool PDFPageContentProcessor::isProcessingCancelled() const
 {
     return m_operationControl && m_operationControl->isOperationCancelled();
@@ -2364,7 +2600,7 @@ void PDFPageContentProcessor::operatorClipWinding()
     if (!m_currentPath.isEmpty())
     {
         m_currentPath.setFillRule(Qt::WindingFill);
-        performClipping(m_currentPath, Qt::WindingFill);
+        processClipping(m_currentPath, Qt::WindingFill);
     }
 }
 
@@ -2373,7 +2609,7 @@ void PDFPageContentProcessor::operatorClipEvenOdd()
     if (!m_currentPath.isEmpty())
     {
         m_currentPath.setFillRule(Qt::OddEvenFill);
-        performClipping(m_currentPath, Qt::OddEvenFill);
+        processClipping(m_currentPath, Qt::OddEvenFill);
     }
 }
 
@@ -2701,7 +2937,7 @@ void PDFPageContentProcessor::operatorTextEnd()
     if (!m_textClippingPath.isEmpty())
     {
         QPainterPath clippingPath = m_graphicState.getCurrentTransformationMatrix().inverted().map(m_textClippingPath);
-        performClipping(clippingPath, clippingPath.fillRule());
+        processClipping(clippingPath, clippingPath.fillRule());
         m_textClippingPath = QPainterPath();
     }
     performTextEnd(ProcessOrder::AfterOperation);
@@ -2986,23 +3222,19 @@ void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream)
         return;
     }
 
-    PDFColorSpacePointer colorSpace;
+    if (performXObjectImagePainting(stream))
+    {
+        // Image was processed by the client
+        return;
+    }
 
-    const PDFDictionary* streamDictionary = stream->getDictionary();
-    if (streamDictionary->hasKey("ColorSpace"))
+    if (isContentClippedOut(getCurrentWorldMatrix().mapRect(QRectF(0.0, 0.0, 1.0, 1.0))))
     {
-        const PDFObject& colorSpaceObject = m_document->getObject(streamDictionary->get("ColorSpace"));
-        if (colorSpaceObject.isName() || colorSpaceObject.isArray())
-        {
-            colorSpace = PDFAbstractColorSpace::createColorSpace(m_colorSpaceDictionary, m_document, colorSpaceObject);
-        }
-        else if (!colorSpaceObject.isNull())
-        {
-            throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Invalid color space of the image."));
-        }
+        // Image lies outside of the clipping area, so we do not decode it
+        return;
     }
 
-    PDFImage pdfImage = PDFImage::createImage(m_document, stream, qMove(colorSpace), false, m_graphicState.getRenderingIntent(), this);
+    PDFImage pdfImage = createXObjectImage(stream);
 
     if (!performOriginalImagePainting(pdfImage, stream))
     {
@@ -3036,6 +3268,27 @@ void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream)
     }
 }
 
+PDFImage PDFPageContentProcessor::createXObjectImage(const PDFStream* stream)
+{
+    PDFColorSpacePointer colorSpace;
+
+    const PDFDictionary* streamDictionary = stream->getDictionary();
+    if (streamDictionary->hasKey("ColorSpace"))
+    {
+        const PDFObject& colorSpaceObject = m_document->getObject(streamDictionary->get("ColorSpace"));
+        if (colorSpaceObject.isName() || colorSpaceObject.isArray())
+        {
+            colorSpace = PDFAbstractColorSpace::createColorSpace(m_colorSpaceDictionary, m_document, colorSpaceObject);
+        }
+        else if (!colorSpaceObject.isNull())
+        {
+            throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Invalid color space of the image."));
+        }
+    }
+
+    return PDFImage::createImage(m_document, stream, qMove(colorSpace), false, m_graphicState.getRenderingIntent(), this, m_jbig2GlobalsCache);
+}
+
 void PDFPageContentProcessor::reportWarningAboutColorOperatorsInUTP()
 {
     reportRenderErrorOnce(RenderErrorType::Warning, PDFTranslationContext::tr("Color operators are not allowed in uncolored tilling pattern."));
@@ -3080,13 +3333,15 @@ void PDFPageContentProcessor::operatorPaintXObject(PDFOperandName name)
 
     if (m_xobjectDictionary)
     {
-        const PDFObject& object = m_document->getObject(m_xobjectDictionary->get(name.name));
+        const PDFObject& xobject = m_xobjectDictionary->get(name.name);
+        const PDFObject& object = m_document->getObject(xobject);
         if (object.isStream())
         {
             const PDFStream* stream = object.getStream();
             const PDFDictionary* streamDictionary = stream->getDictionary();
 
             // According to the specification, XObjects are skipped entirely, as no operator was invoked.
+            std::unique_ptr<PDFOptionalContentGuard> optionalContentGuard;
             if (streamDictionary->hasKey("OC"))
             {
                 const PDFObject& optionalContentObject = streamDictionary->get("OC");
@@ -3096,6 +3351,8 @@ void PDFPageContentProcessor::operatorPaintXObject(PDFOperandName name)
                     {
                         return;
                     }
+
+                    optionalContentGuard.reset(new PDFOptionalContentGuard(this, optionalContentObject.getReference()));
                 }
                 else
                 {
@@ -3117,7 +3374,11 @@ void PDFPageContentProcessor::operatorPaintXObject(PDFOperandName name)
                     throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Form of type %1 not supported.").arg(formType));
                 }
 
-                processForm(stream);
+                const PDFObjectReference formReference = xobject.isReference() ? xobject.getReference() : PDFObjectReference();
+                if (isContentKindSuppressed(ContentKind::Forms) || !performFormPainting(formReference, stream))
+                {
+                    processForm(stream);
+                }
             }
             else
             {
@@ -3166,6 +3427,13 @@ void PDFPageContentProcessor::operatorMarkedContentBeginWithProperties(PDFOperan
         }
 
         m_markedContentStack.emplace_back(name.name, MarkedContentKind::OptionalContent, isContentSuppressedByOC(ocg));
+
+        MarkedContentState& state = m_markedContentStack.back();
+        if (!state.contentSuppressed && ocg.isValid())
+        {
+            state.optionalContentBegun = true;
+            performOptionalContentBegin(ocg);
+        }
     }
     else
     {
@@ -3182,8 +3450,14 @@ void PDFPageContentProcessor::operatorMarkedContentEnd()
         throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Mismatched begin/end of marked content."));
     }
 
+    const bool optionalContentBegun = m_markedContentStack.back().optionalContentBegun;
     m_markedContentStack.pop_back();
     performMarkedContentEnd();
+
+    if (optionalContentBegun)
+    {
+        performOptionalContentEnd();
+    }
 }
 
 void PDFPageContentProcessor::operatorCompatibilityBegin()
@@ -3349,16 +3623,20 @@ void PDFPageContentProcessor::drawText(const TextSequence& textSequence)
 
                 if (item.characterContentStream && (fill || stroke))
                 {
-                    PDFPageContentProcessorStateGuard guard2(this);
+                    QTransform worldMatrix = fontAdjustedMatrix * textMatrix * m_graphicState.getCurrentTransformationMatrix();
 
-                    // We must clear operands, because we are processing a new content stream
-                    m_operands.clear();
+                    if (!performType3GlyphPainting(parentFont, item.characterContentStream, worldMatrix))
+                    {
+                        PDFPageContentProcessorStateGuard guard2(this);
 
-                    QTransform worldMatrix = fontAdjustedMatrix * textMatrix * m_graphicState.getCurrentTransformationMatrix();
-                    m_graphicState.setCurrentTransformationMatrix(worldMatrix);
-                    updateGraphicState();
+                        // We must clear operands, because we are processing a new content stream
+                        m_operands.clear();
 
-                    processContent(*item.characterContentStream);
+                        m_graphicState.setCurrentTransformationMatrix(worldMatrix);
+                        updateGraphicState();
+
+                        processContent(*item.characterContentStream);
+                    }
 
                     if (!item.character.isNull())
                     {
@@ -3553,6 +3831,7 @@ void PDFPageContentProcessorState::setState(const PDFPageContentProcessorState&
     setTransferFunction(state.getTransferFunction());
     setHalftone(state.getHalftone());
     setHalftoneOrigin(state.getHalftoneOrigin());
+    setClipBoundingRect(state.getClipBoundingRect());
 }
 
 void PDFPageContentProcessorState::setCurrentTransformationMatrix(const QTransform& currentTransformationMatrix)
@@ -3848,6 +4127,20 @@ void PDFPageContentProcessorState::setHalftoneOrigin(const QPointF& halftoneOrig
     }
 }
 
+const std::optional<QRectF>& PDFPageContentProcessorState::getClipBoundingRect() const
+{
+    return m_clipBoundingRect;
+}
+
+void PDFPageContentProcessorState::setClipBoundingRect(const std::optional<QRectF>& clipBoundingRect)
+{
+    if (m_clipBoundingRect != clipBoundingRect)
+    {
+        m_clipBoundingRect = clipBoundingRect;
+        m_stateFlags |= StateClipBoundingRect;
+    }
+}
+
 PDFObject PDFPageContentProcessorState::getTransferFunction() const
 {
     return m_transferFunction;
@@ -3998,6 +4291,17 @@ PDFPageContentProcessor::PDFTransparencyGroupGuard::~PDFTransparencyGroupGuard()
     m_processor->performEndTransparencyGroup(ProcessOrder::AfterOperation, group);
 }
 
+PDFPageContentProcessor::PDFOptionalContentGuard::PDFOptionalContentGuard(PDFPageContentProcessor* processor, PDFObjectReference ocgOrOcmd) :
+    m_processor(processor)
+{
+    m_processor->performOptionalContentBegin(ocgOrOcmd);
+}
+
+PDFPageContentProcessor::PDFOptionalContentGuard::~PDFOptionalContentGuard()
+{
+    m_processor->performOptionalContentEnd();
+}
+
 PDFLineDashPattern::PDFLineDashPattern(const std::vector<PDFReal>& dashArray, PDFReal dashOffset) :
     m_dashArray(dashArray),
     m_dashOffset(dashOffset)
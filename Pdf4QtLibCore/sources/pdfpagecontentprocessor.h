@@ -35,12 +35,15 @@
 
 #include <stack>
 #include <tuple>
+#include <optional>
 #include <type_traits>
 
 namespace pdf
 {
 class PDFCMS;
 class PDFMesh;
+class PDFMeshCache;
+class PDFJBIG2GlobalsCache;
 class PDFImage;
 class PDFTilingPattern;
 class PDFShadingPattern;
@@ -151,6 +154,7 @@ public:
         StateTransferFunction               = 0x0000000800000000,
         StateHalftone                       = 0x0000001000000000,
         StateHalftoneOrigin                 = 0x0000002000000000,
+        StateClipBoundingRect               = 0x0000004000000000,
         StateAll                            = 0xFFFFFFFFFFFFFFFF
     };
 
@@ -162,9 +166,11 @@ public:
     void setCurrentTransformationMatrix(const QTransform& currentTransformationMatrix);
 
     const PDFAbstractColorSpace* getStrokeColorSpace() const { return m_strokeColorSpace.data(); }
+    const QSharedPointer<PDFAbstractColorSpace>& getStrokeColorSpacePointer() const { return m_strokeColorSpace; }
     void setStrokeColorSpace(const QSharedPointer<PDFAbstractColorSpace>& strokeColorSpace);
 
     const PDFAbstractColorSpace* getFillColorSpace() const { return m_fillColorSpace.data(); }
+    const QSharedPointer<PDFAbstractColorSpace>& getFillColorSpacePointer() const { return m_fillColorSpace; }
     void setFillColorSpace(const QSharedPointer<PDFAbstractColorSpace>& fillColorSpace);
 
     const QColor& getStrokeColor() const { return m_strokeColor; }
@@ -283,6 +289,12 @@ public:
     QPointF getHalftoneOrigin() const;
     void setHalftoneOrigin(const QPointF& halftoneOrigin);
 
+    /// Returns bounding rectangle of the current clipping area in the device space.
+    /// Content outside of this rectangle is not visible. If no clipping is active,
+    /// empty optional is returned.
+    const std::optional<QRectF>& getClipBoundingRect() const;
+    void setClipBoundingRect(const std::optional<QRectF>& clipBoundingRect);
+
 private:
     QTransform m_currentTransformationMatrix;
     PDFColorSpacePointer m_strokeColorSpace;
@@ -324,6 +336,7 @@ private:
     PDFObject m_transferFunction;
     PDFObject m_halftone;
     QPointF m_halftoneOrigin;
+    std::optional<QRectF> m_clipBoundingRect;
     StateFlags m_stateFlags;
 };
 
@@ -484,6 +497,54 @@ public:
                      const QByteArray& content,
                      PDFInteger formStructuralParent);
 
+    /// Processes the form XObject as standalone content, i.e. processor is initialized,
+    /// graphic state is set to the \p graphicState and then form is processed. It is
+    /// used to process the form, which inherits graphic state from another content stream,
+    /// separately (for example, to compile the form once and reuse it).
+    /// \param stream Stream of the form XObject
+    /// \param graphicState Graphic state inherited by the form
+    /// \returns List of rendering errors
+    QList<PDFRenderError> processFormContents(const PDFStream* stream, const PDFPageContentProcessorState& graphicState);
+
+    /// Processes the glyph procedure of the Type 3 font as standalone content in the
+    /// glyph space, i.e. processor is initialized, graphic state is set to the \p graphicState
+    /// with identity current transformation matrix and then glyph procedure is processed.
+    /// \param font Type 3 font
+    /// \param contentStream Glyph procedure
+    /// \param graphicState Graphic state inherited by the glyph
+    /// \returns List of rendering errors
+    QList<PDFRenderError> processType3GlyphContents(const PDFType3Font* font, const QByteArray& contentStream, const PDFPageContentProcessorState& graphicState);
+
+    /// Processes cells of the tiling pattern. Cell (column, row) is placed at the point
+    /// (column * xStep, row * yStep) of the cell space, which is mapped to the device space
+    /// using the \p cellMatrix. Cells are painted for all columns and rows of the \p cells
+    /// rectangle, in the column order.
+    /// \param tilingPattern Tiling pattern
+    /// \param cellMatrix Transformation matrix from the cell space to the device space
+    /// \param cells Columns and rows of the painted cells
+    /// \param uncoloredPatternColorSpace Color space for uncolored color patterns
+    /// \param uncoloredPatternColor Uncolored color pattern color
+    void processTilingPatternCells(const PDFTilingPattern* tilingPattern,
+                                   const QTransform& cellMatrix,
+                                   const QRect& cells,
+                                   PDFColorSpacePointer uncoloredPatternColorSpace,
+                                   PDFColor uncoloredPatternColor);
+
+    /// Processes cells of the tiling pattern as standalone content, i.e. processor
+    /// is initialized and then cells are processed (see processTilingPatternCells).
+    /// \param tilingPattern Tiling pattern
+    /// \param cellMatrix Transformation matrix from the cell space to the device space
+    /// \param cells Columns and rows of the painted cells
+    /// \param uncoloredPatternColorSpace Color space for uncolored color patterns
+    /// \param uncoloredPatternColor Uncolored color pattern color
+    /// 
+eturns List of rendering errors
+    QList<PDFRenderError> processTilingPatternContents(const PDFTilingPattern* tilingPattern,
+                                                       const QTransform& cellMatrix,
+                                                       const QRect& cells,
+                                                       PDFColorSpacePointer uncoloredPatternColorSpace,
+                                                       PDFColor uncoloredPatternColor);
+
     /// Initialize stream processor for processing content streams. For example,
     /// graphic state is initialized to default, and default color spaces are initialized.
     void initializeProcessor();
@@ -498,6 +559,33 @@ public:
     /// \param newOperationControl Operation control object
     void setOperationControl(const PDFOperationControl* newOperationControl);
 
+    /// Sets mesh cache, which is used to reuse meshes of the mesh based
+    /// shadings. If mesh cache is not set, meshes are always created.
+    /// \param meshCache Mesh cache
+    void setMeshCache(const PDFMeshCache* meshCache);
+
+    /// Sets cache of decoded JBIG2 global segments, which are shared by
+    /// JBIG2 images. If cache is not set, global segments are always decoded.
+    /// \param jbig2GlobalsCache JBIG2 globals cache
+    void setJBIG2GlobalsCache(const PDFJBIG2GlobalsCache* jbig2GlobalsCache);
+
+    /// Sets region of interest in device space. If it is set, then only content
+    /// intersecting the region is processed, content lying completely outside
+    /// of the region (paths, text, images, shadings and forms with bounding box)
+    /// is skipped. It is useful, when only part of the page is being rendered
+    /// (for example, a tile of zoomed page).
+    /// \param regionOfInterest Region of interest in device space
+    void setRegionOfInterest(const QRectF& regionOfInterest);
+
+    /// Returns operation control object (can be nullptr)
+    const PDFOperationControl* getOperationControl() const { return m_operationControl; }
+
+    /// Returns mesh cache (can be nullptr)
+    const PDFMeshCache* getMeshCache() const { return m_meshCache; }
+
+    /// Returns cache of decoded JBIG2 global segments (can be nullptr)
+    const PDFJBIG2GlobalsCache* getJBIG2GlobalsCache() const { return m_jbig2GlobalsCache; }
+
     /// Returns true, if page content processing is being cancelled
     bool isProcessingCancelled() const;
 
@@ -599,6 +687,37 @@ protected:
     /// \param shadingPattern Shading pattern
     virtual bool performPathPaintingUsingShading(const QPainterPath& path, bool stroke, bool fill, const PDFShadingPattern* shadingPattern);
 
+    /// This function is used, when we want to implement custom painting of the form XObject (for
+    /// example, reuse of already compiled form). If form is successfully painted, then true should be
+    /// returned, otherwise form content is processed.
+    /// \param formReference Reference to the form XObject (invalid, if form is a direct object)
+    /// \param stream Stream of the form XObject
+    virtual bool performFormPainting(PDFObjectReference formReference, const PDFStream* stream);
+
+    /// This function is used, when we want to implement custom painting of the Type 3 font
+    /// glyph (for example, reuse of already compiled glyph procedure). If glyph is successfully
+    /// painted, then true should be returned, otherwise glyph procedure is processed.
+    /// \param font Type 3 font
+    /// \param contentStream Glyph procedure
+    /// \param glyphMatrix Matrix, which maps glyph space to the user space of the page
+    virtual bool performType3GlyphPainting(const PDFType3Font* font, const QByteArray* contentStream, const QTransform& glyphMatrix);
+
+    /// This function is used, when we want to implement custom fill using tiling pattern (for
+    /// example, using the rasterized pattern cell). If path is successfully filled by the tiling
+    /// pattern, then true should be returned, otherwise pattern cells are processed one by one.
+    /// Path is already set as clipping path, when this function is called.
+    /// \param path Path to be filled
+    /// \param tilingPattern Tiling pattern
+    /// \param cellMatrix Transformation matrix from the cell space to the device space (cell
+    ///                   with column and row indices (0, 0) is placed at the origin)
+    /// \param uncoloredPatternColorSpace Color space for uncolored color patterns
+    /// \param uncoloredPatternColor Uncolored color pattern color
+    virtual bool performPathPaintingUsingTilingPattern(const QPainterPath& path,
+                                                       const PDFTilingPattern* tilingPattern,
+                                                       const QTransform& cellMatrix,
+                                                       const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                       const PDFColor& uncoloredPatternColor);
+
     /// This function is called after path paintig is finished
     virtual void performFinishPathPainting();
 
@@ -614,6 +733,17 @@ protected:
     /// \returns true, if image is successfully processed
     virtual bool performOriginalImagePainting(const PDFImage& image, const PDFStream* stream);
 
+    /// Performs painting of image XObject directly from its stream, before
+    /// the image is decoded by the content processor. Processor can decode the image
+    /// by itself (for example, it can use decoded images shared with another processor).
+    /// If processor processes the image, it should return true, so image
+    /// is not decoded by the content processor. It is called also for images
+    /// lying outside of the clipping area (see \p isContentClippedOut), which
+    /// are not painted at all, if this function returns false.
+    /// \param stream Image stream
+    /// \returns true, if image is successfully processed
+    virtual bool performXObjectImagePainting(const PDFStream* stream);
+
     /// This function has to be implemented in the client drawing implementation, it should
     /// draw the image.
     /// \param image Image to be painted
@@ -656,6 +786,15 @@ protected:
     /// Implement to react on marked content end
     virtual void performMarkedContentEnd();
 
+    /// Implement to react on optional content begin. It is called for optional content
+    /// (marked content or XObject), which is not suppressed by \p isContentSuppressedByOC,
+    /// so implementation can evaluate its visibility later.
+    /// \param ocgOrOcmd Optional content group or optional content membership dictionary
+    virtual void performOptionalContentBegin(PDFObjectReference ocgOrOcmd);
+
+    /// Implement to react on optional content end
+    virtual void performOptionalContentEnd();
+
     /// Implement to react on set char width request
     virtual void performSetCharWidth(PDFReal wx, PDFReal wy);
 
@@ -698,6 +837,12 @@ protected:
     /// shading, images, ...)
     virtual bool isContentKindSuppressed(ContentKind kind) const;
 
+    /// Override this function to enable early rejection of the content, which
+    /// lies completely outside of the current clipping area. Such content is then
+    /// not processed at all (for example, images are not decoded). Processors, which
+    /// need all content of the page (not only visible content), should not enable it.
+    virtual bool isClippedContentRejected() const;
+
     /// Sets current graphic state and updates data
     /// \param state New graphic state
     void setGraphicsState(const PDFPageContentProcessorState& state);
@@ -715,9 +860,23 @@ protected:
     /// Returns true, if graphic content is suppressed
     bool isContentSuppressed() const;
 
+    /// Returns true, if content with given bounding rectangle lies completely
+    /// outside of the current clipping area, and clipped content rejection is enabled.
+    /// \param deviceRect Bounding rectangle of the content in device space
+    bool isContentClippedOut(const QRectF& deviceRect) const;
+
+    /// Intersects bounding rectangle of the current clipping area with given rectangle.
+    /// It doesn't perform clipping itself, it should be used, when client clips
+    /// the content by other means (for example, to the crop box).
+    /// \param deviceRect Clipping rectangle in device space
+    void intersectClipBoundingRect(const QRectF& deviceRect);
+
     /// Returns page point to device point matrix
     const QTransform& getPagePointToDevicePointMatrix() const { return m_pagePointToDevicePointMatrix; }
 
+    /// Returns true, if uncolored tiling pattern is being drawn (color operators are ignored)
+    bool isDrawingUncoloredTilingPattern() const { return m_drawingUncoloredTilingPatternState > 0; }
+
     /// Returns base matrix for patterns
     const QTransform& getPatternBaseMatrix() const { return m_patternBaseMatrix; }
 
@@ -727,6 +886,10 @@ protected:
     /// Returns page bounding rectangle in device space
     const QRectF& getPageBoundingRectDeviceSpace() const { return m_pageBoundingRectDeviceSpace; }
 
+    /// Returns mesh quality settings for shading patterns, initialized
+    /// for the current page (meshing area and pattern base matrix).
+    PDFMeshQualitySettings getShadingMeshQualitySettings() const;
+
     /// Returns current procedure sets. Procedure sets are deprecated in PDF 2.0 and are here
     /// only for compatibility purposes. See chapter 14.2 in PDF 2.0 specification.
     ProcedureSets getProcedureSets() const { return m_procedureSets; }
@@ -759,9 +922,24 @@ protected:
         PDFPageContentProcessor* m_processor;
     };
 
+    class PDF4QTLIBCORESHARED_EXPORT PDFOptionalContentGuard
+    {
+    public:
+        explicit PDFOptionalContentGuard(PDFPageContentProcessor* processor, PDFObjectReference ocgOrOcmd);
+        ~PDFOptionalContentGuard();
+
+    private:
+        PDFPageContentProcessor* m_processor;
+    };
+
     /// Process form using form stream
     void processForm(const PDFStream* stream);
 
+    /// Creates image from image XObject stream, using current
+    /// color space dictionary and rendering intent.
+    /// \param stream Image stream
+    PDFImage createXObjectImage(const PDFStream* stream);
+
     const PDFDictionary* getColorSpaceDictionary() const { return m_colorSpaceDictionary; }
     const PDFDictionary* getFontDictionary() const { return m_fontDictionary; }
     const PDFDictionary* getXObjectDictionary() const { return m_xobjectDictionary; }
@@ -825,6 +1003,7 @@ private:
         QByteArray tag;
         MarkedContentKind kind = MarkedContentKind::Other;
         bool contentSuppressed = false;
+        bool optionalContentBegun = false;
     };
 
     class PDFPageContentProcessorStateGuard
@@ -1040,6 +1219,11 @@ private:
     /// Implementation of painting of XObject image
     void paintXObjectImage(const PDFStream* stream);
 
+    /// Updates bounding rectangle of the clipping area and performs clipping
+    /// \param path Clipping path (in current user space)
+    /// \param fillRule Fill rule
+    void processClipping(const QPainterPath& path, Qt::FillRule fillRule);
+
     /// Report warning about color operators in uncolored tiling pattern
     void reportWarningAboutColorOperatorsInUTP();
 
@@ -1049,12 +1233,19 @@ private:
     /// Finishes marked content (if end of marked content is missing)
     void finishMarkedContent();
 
+    /// Creates mesh of the shading pattern (using mesh cache, if it is set)
+    /// \param shadingPattern Shading pattern
+    /// \param settings Meshing settings
+    PDFMesh createShadingMesh(const PDFShadingPattern* shadingPattern, const PDFMeshQualitySettings& settings);
+
     const PDFPage* m_page;
     const PDFDocument* m_document;
     const PDFFontCache* m_fontCache;
     const PDFCMS* m_CMS;
     const PDFOptionalContentActivity* m_optionalContentActivity;
     const PDFOperationControl* m_operationControl;
+    const PDFMeshCache* m_meshCache;
+    const PDFJBIG2GlobalsCache* m_jbig2GlobalsCache;
     const PDFDictionary* m_colorSpaceDictionary;
     const PDFDictionary* m_fontDictionary;
     const PDFDictionary* m_xobjectDictionary;
@@ -1117,6 +1308,9 @@ private:
     /// is zero, then it corresponds to the scaled media box of the page.
     QRectF m_pageBoundingRectDeviceSpace;
 
+    /// Region of interest in device space, content outside of it is skipped
+    std::optional<QRectF> m_regionOfInterest;
+
     /// Mesh quality settings
     PDFMeshQualitySettings m_meshQualitySettings;
 
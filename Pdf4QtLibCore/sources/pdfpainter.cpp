@@ -19,11 +19,16 @@
 #include "pdfpattern.h"
 #include "pdfcms.h"
 #include "pdfpainterutils.h"
+#include "pdfdocument.h"
+#include "pdfoptionalcontent.h"
 
 #include <QPainter>
 #include <QCryptographicHash>
 #include <QtMath>
 
+#include <set>
+#include <cmath>
+
 #include "pdfdbgheap.h"
 
 namespace pdf
@@ -102,6 +107,11 @@ void PDFPainterBase::performUpdateGraphicsState(const PDFPageContentProcessorSta
     BaseClass::performUpdateGraphicsState(state);
 }
 
+bool PDFPainterBase::isClippedContentRejected() const
+{
+    return true;
+}
+
 bool PDFPainterBase::isContentSuppressedByOC(PDFObjectReference ocgOrOcmd)
 {
     if (m_features.testFlag(PDFRenderer::IgnoreOptionalContent))
@@ -117,6 +127,11 @@ QPen PDFPainterBase::getCurrentPenImpl() const
     return PDFPainterHelper::createPenFromState(getGraphicState(), getEffectiveStrokingAlpha());
 }
 
+PDFShadingGradient PDFPainterBase::createShadingGradient(const PDFShadingPattern* shadingPattern)
+{
+    return shadingPattern->createGradient(getShadingMeshQualitySettings(), getCMS(), getGraphicState()->getRenderingIntent(), this);
+}
+
 QBrush PDFPainterBase::getCurrentBrushImpl() const
 {
     return PDFPainterHelper::createBrushFromState(getGraphicState(), getEffectiveFillingAlpha());
@@ -220,7 +235,8 @@ PDFPainter::PDFPainter(QPainter* painter,
             QPainterPath path;
             path.addPolygon(pagePointToDevicePointMatrix.map(cropBox));
 
-            m_painter->setClipPath(path, Qt::IntersectClip);
+            PDFPainterHelper::applyClipPath(m_painter, path);
+            intersectClipBoundingRect(path.controlPointRect());
         }
     }
 
@@ -265,7 +281,7 @@ void PDFPainter::performPathPainting(const QPainterPath& path, bool stroke, bool
 void PDFPainter::performClipping(const QPainterPath& path, Qt::FillRule fillRule)
 {
     Q_ASSERT(path.fillRule() == fillRule);
-    m_painter->setClipPath(path, Qt::IntersectClip);
+    PDFPainterHelper::applyClipPath(m_painter, path);
 }
 
 void PDFPainter::performImagePainting(const QImage& image)
@@ -322,6 +338,34 @@ void PDFPainter::performImagePainting(const QImage& image)
     m_painter->restore();
 }
 
+bool PDFPainter::performPathPaintingUsingShading(const QPainterPath& path, bool stroke, bool fill, const PDFShadingPattern* shadingPattern)
+{
+    Q_UNUSED(stroke);
+    Q_UNUSED(fill);
+
+    PDFShadingGradient gradient = createShadingGradient(shadingPattern);
+    if (!gradient.isValid())
+    {
+        // Shading must be painted using the mesh
+        return false;
+    }
+
+    m_isPlacementDependent = true;
+
+    // Gradient is in device space coordinates, so we paint it with identity world matrix
+    QPainterPath devicePath = gradient.getPaintedPath(getCurrentWorldMatrix().map(path));
+
+    m_painter->save();
+    m_painter->setWorldTransform(QTransform());
+    m_painter->setRenderHint(QPainter::Antialiasing, hasFeature(PDFRenderer::Antialiasing));
+    m_painter->setPen(Qt::NoPen);
+    m_painter->setBrush(gradient.createBrush(getEffectiveFillingAlpha()));
+    m_painter->drawPath(devicePath);
+    m_painter->restore();
+
+    return true;
+}
+
 void PDFPainter::performMeshPainting(const PDFMesh& mesh)
 {
     m_painter->save();
@@ -356,6 +400,27 @@ void PDFPainter::setCompositionMode(QPainter::CompositionMode mode)
     m_painter->setCompositionMode(mode);
 }
 
+/// Painter of the rasterized tiling pattern cell. It records, if cell content
+/// contains optional content, because such content can't be rasterized, when
+/// optional content is evaluated at the time the page is drawn.
+class PDFTilingPatternCellPainter : public PDFPainter
+{
+public:
+    using PDFPainter::PDFPainter;
+
+    virtual bool isContentSuppressedByOC(PDFObjectReference ocgOrOcmd) override
+    {
+        m_hasOptionalContent = true;
+        return PDFPainter::isContentSuppressedByOC(ocgOrOcmd);
+    }
+
+    /// Returns true, if optional content was encountered
+    bool hasOptionalContent() const { return m_hasOptionalContent; }
+
+private:
+    bool m_hasOptionalContent = false;
+};
+
 PDFPrecompiledPageGenerator::PDFPrecompiledPageGenerator(PDFPrecompiledPage* precompiledPage,
                                                          PDFRenderer::Features features,
                                                          const PDFPage* page,
@@ -363,12 +428,70 @@ PDFPrecompiledPageGenerator::PDFPrecompiledPageGenerator(PDFPrecompiledPage* pre
                                                          const PDFFontCache* fontCache,
                                                          const PDFCMS* cms,
                                                          const PDFOptionalContentActivity* optionalContentActivity,
-                                                         const PDFMeshQualitySettings& meshQualitySettings) :
-    BaseClass(features, page, document, fontCache, cms, optionalContentActivity, QTransform(), meshQualitySettings),
-    m_precompiledPage(precompiledPage)
+                                                         const PDFMeshQualitySettings& meshQualitySettings,
+                                                         QTransform pagePointToDevicePointMatrix) :
+    BaseClass(features, page, document, fontCache, cms, optionalContentActivity, pagePointToDevicePointMatrix, meshQualitySettings),
+    m_precompiledPage(precompiledPage),
+    m_isOptionalContentRecorded(optionalContentActivity && !features.testFlag(PDFRenderer::IgnoreOptionalContent))
 {
     m_precompiledPage->setPaperColor(cms->getPaperColor());
     m_precompiledPage->getSnapInfo()->addPageMediaBox(page->getRotatedMediaBox());
+    m_precompiledPage->setOptionalContentActivity(m_isOptionalContentRecorded ? optionalContentActivity : nullptr);
+}
+
+bool PDFPrecompiledPageGenerator::isContentSuppressedByOC(PDFObjectReference ocgOrOcmd)
+{
+    if (m_isOptionalContentRecorded)
+    {
+        // Optional content is evaluated, when page is drawn
+        return false;
+    }
+
+    return BaseClass::isContentSuppressedByOC(ocgOrOcmd);
+}
+
+void PDFPrecompiledPageGenerator::performOptionalContentBegin(PDFObjectReference ocgOrOcmd)
+{
+    if (!m_isOptionalContentRecorded)
+    {
+        return;
+    }
+
+    if (getOptionalContentActivity()->getProperties()->hasOptionalContentGroup(ocgOrOcmd))
+    {
+        m_precompiledPage->addBeginOptionalContent(ocgOrOcmd, nullptr);
+        return;
+    }
+
+    auto it = m_optionalContentMemberships.find(ocgOrOcmd);
+    if (it == m_optionalContentMemberships.end())
+    {
+        std::shared_ptr<const PDFOptionalContentMembershipObject> ocmd;
+        try
+        {
+            auto membershipObject = std::make_shared<PDFOptionalContentMembershipObject>(PDFOptionalContentMembershipObject::create(getDocument(), PDFObject::createReference(ocgOrOcmd)));
+            if (membershipObject->isValid())
+            {
+                ocmd = qMove(membershipObject);
+            }
+        }
+        catch (const PDFException &e)
+        {
+            reportRenderError(RenderErrorType::Error, e.getMessage());
+        }
+
+        it = m_optionalContentMemberships.emplace(ocgOrOcmd, qMove(ocmd)).first;
+    }
+
+    m_precompiledPage->addBeginOptionalContent(ocgOrOcmd, it->second);
+}
+
+void PDFPrecompiledPageGenerator::performOptionalContentEnd()
+{
+    if (m_isOptionalContentRecorded)
+    {
+        m_precompiledPage->addEndOptionalContent();
+    }
 }
 
 void PDFPrecompiledPageGenerator::performPathPainting(const QPainterPath& path, bool stroke, bool fill, bool text, Qt::FillRule fillRule)
@@ -430,8 +553,343 @@ void PDFPrecompiledPageGenerator::performImagePainting(const QImage& image)
     m_precompiledPage->addImage(image);
 }
 
+bool PDFPrecompiledPageGenerator::performPathPaintingUsingShading(const QPainterPath& path, bool stroke, bool fill, const PDFShadingPattern* shadingPattern)
+{
+    Q_UNUSED(stroke);
+    Q_UNUSED(fill);
+
+    PDFShadingGradient gradient = createShadingGradient(shadingPattern);
+    if (!gradient.isValid())
+    {
+        // Shading must be painted using the mesh
+        return false;
+    }
+
+    // Gradient is in device space coordinates, so we paint it with identity world matrix
+    QPainterPath devicePath = gradient.getPaintedPath(getCurrentWorldMatrix().map(path));
+
+    m_precompiledPage->addSaveGraphicState();
+    m_precompiledPage->addSetWorldMatrix(QTransform());
+    m_precompiledPage->addPath(Qt::NoPen, gradient.createBrush(getEffectiveFillingAlpha()), qMove(devicePath), false);
+    m_precompiledPage->addRestoreGraphicState();
+
+    return true;
+}
+
+bool PDFPrecompiledPageGenerator::performPathPaintingUsingTilingPattern(const QPainterPath& path,
+                                                                        const PDFTilingPattern* tilingPattern,
+                                                                        const QTransform& cellMatrix,
+                                                                        const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                                        const PDFColor& uncoloredPatternColor)
+{
+    // Page is usually compiled in page space, but it is displayed zoomed, so cells
+    // are rasterized with this resolution (in pixels per page point). Small cells
+    // are rasterized with higher resolution, up to the maximal resolution.
+    constexpr PDFReal CELL_IMAGE_RESOLUTION = 4.0;
+    constexpr PDFReal MAX_CELL_IMAGE_RESOLUTION = 16.0;
+    constexpr int MIN_CELL_IMAGE_SIZE = 32;
+    constexpr int MAX_CELL_IMAGE_SIZE = 2048;
+    constexpr qint64 MAX_CELL_IMAGE_PIXELS = 1024 * 1024;
+    constexpr PDFInteger MAX_OVERLAPPING_CELLS = 16;
+
+    if (!m_tilingPatternCache ||
+        !tilingPattern->getPatternReference().isValid() ||
+        !cellMatrix.isAffine() ||
+        !cellMatrix.isInvertible() ||
+        getEffectiveFillingAlpha() != 1.0)
+    {
+        // Pattern is painted as vector graphics
+        return false;
+    }
+
+    const bool isUncolored = tilingPattern->getPaintingType() == PDFTilingPattern::PaintType::Uncolored;
+    if (isUncolored && !uncoloredPatternColorSpace)
+    {
+        return false;
+    }
+
+    const QRectF boundingBox = tilingPattern->getBoundingBox();
+    const PDFReal xStep = qAbs(tilingPattern->getXStep());
+    const PDFReal yStep = qAbs(tilingPattern->getYStep());
+
+    // Cell image contains rectangle [0, xStep] x [0, yStep] of the cell space, so we
+    // must paint all cells, which bounding boxes are overlapping this rectangle.
+    const PDFInteger firstColumn = qFloor(-boundingBox.right() / xStep) + 1;
+    const PDFInteger lastColumn = qCeil((xStep - boundingBox.left()) / xStep) - 1;
+    const PDFInteger firstRow = qFloor(-boundingBox.bottom() / yStep) + 1;
+    const PDFInteger lastRow = qCeil((yStep - boundingBox.top()) / yStep) - 1;
+    const PDFInteger cellCount = (lastColumn - firstColumn + 1) * (lastRow - firstRow + 1);
+    if (cellCount <= 0 || cellCount > MAX_OVERLAPPING_CELLS)
+    {
+        return false;
+    }
+
+    // Resolution (in pixels per device space unit) is given by the scale of the page's pattern
+    // base matrix (page space to device space), so cells of pages compiled in the device space
+    // are not oversampled. Resolution is rounded to power of two, so cell images can be reused
+    // by pages compiled with similar scale.
+    const QTransform& pagePointToDevicePointMatrix = getPagePointToDevicePointMatrix();
+    const PDFReal deviceScale = qSqrt(qAbs(pagePointToDevicePointMatrix.determinant()));
+    const PDFReal xStepLength = QLineF(cellMatrix.map(QPointF(0.0, 0.0)), cellMatrix.map(QPointF(xStep, 0.0))).length();
+    const PDFReal yStepLength = QLineF(cellMatrix.map(QPointF(0.0, 0.0)), cellMatrix.map(QPointF(0.0, yStep))).length();
+    if (qFuzzyIsNull(deviceScale) || qFuzzyIsNull(xStepLength) || qFuzzyIsNull(yStepLength))
+    {
+        return false;
+    }
+
+    const PDFReal minResolution = qMax(CELL_IMAGE_RESOLUTION / deviceScale, 1.0);
+    const PDFReal maxResolution = qMax(MAX_CELL_IMAGE_RESOLUTION / deviceScale, 1.0);
+    const PDFReal minStepLength = qMin(xStepLength, yStepLength);
+    const PDFReal requiredResolution = qBound(minResolution, MIN_CELL_IMAGE_SIZE / minStepLength, maxResolution);
+    const PDFReal resolution = std::exp2(qMax(std::floor(std::log2(requiredResolution)), 0.0));
+
+    // Image size is rounded, so the image period is exactly one step. If image is too large,
+    // then pattern is painted as vector graphics.
+    const PDFReal imageWidth = qMax(std::round(xStepLength * resolution), 1.0);
+    const PDFReal imageHeight = qMax(std::round(yStepLength * resolution), 1.0);
+    if (imageWidth > MAX_CELL_IMAGE_SIZE || imageHeight > MAX_CELL_IMAGE_SIZE || imageWidth * imageHeight > MAX_CELL_IMAGE_PIXELS)
+    {
+        return false;
+    }
+
+    const int width = static_cast<int>(imageWidth);
+    const int height = static_cast<int>(imageHeight);
+
+    QColor color;
+    if (isUncolored)
+    {
+        color = uncoloredPatternColorSpace->getCheckedColor(uncoloredPatternColor, getCMS(), getGraphicState()->getRenderingIntent(), this);
+    }
+
+    PDFRenderer::Features features = getFeatures() & PDFRenderer::Features(PDFRenderer::Antialiasing | PDFRenderer::TextAntialiasing | PDFRenderer::SmoothImages | PDFRenderer::IgnoreOptionalContent);
+    const QTransform cellToImageMatrix = QTransform::fromScale(width / xStep, height / yStep);
+
+    auto createImage = [&]() -> PDFTilingPatternCache::CellImage
+    {
+        PDFTilingPatternCache::CellImage cellImage;
+        cellImage.image = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+        cellImage.image.fill(Qt::transparent);
+
+        QPainter painter(&cellImage.image);
+
+        {
+            const QTransform pagePointToImagePointMatrix = cellMatrix.inverted() * cellToImageMatrix;
+            PDFTilingPatternCellPainter pdfPainter(&painter, features, pagePointToImagePointMatrix, getPage(), getDocument(), getFontCache(), getCMS(), getOptionalContentActivity(), getShadingMeshQualitySettings());
+            cellImage.errors = pdfPainter.processTilingPatternContents(tilingPattern, cellToImageMatrix, QRect(QPoint(firstColumn, firstRow), QPoint(lastColumn, lastRow)), uncoloredPatternColorSpace, uncoloredPatternColor);
+            cellImage.hasOptionalContent = pdfPainter.hasOptionalContent();
+        }
+
+        painter.end();
+        return cellImage;
+    };
+
+    PDFTilingPatternCache::CellImage cellImage = m_tilingPatternCache->getImage(tilingPattern, QSize(width, height), color, features, getOptionalContentActivity(), createImage);
+    if (cellImage.image.isNull())
+    {
+        return false;
+    }
+
+    if (cellImage.hasOptionalContent && m_isOptionalContentRecorded)
+    {
+        // Optional content is evaluated, when page is drawn, so it can't
+        // be rasterized into the cell image.
+        return false;
+    }
+
+    for (const PDFRenderError& error : cellImage.errors)
+    {
+        reportRenderError(error.type, error.message);
+    }
+
+    // Brush is in device space coordinates, so we paint it with identity world matrix
+    QBrush brush(cellImage.image);
+    brush.setTransform(cellToImageMatrix.inverted() * cellMatrix);
+    QPainterPath devicePath = getCurrentWorldMatrix().map(path);
+
+    m_precompiledPage->addSaveGraphicState();
+    m_precompiledPage->addSetWorldMatrix(QTransform());
+    m_precompiledPage->addPath(Qt::NoPen, qMove(brush), qMove(devicePath), false);
+    m_precompiledPage->addRestoreGraphicState();
+
+    return true;
+}
+
+bool PDFPrecompiledPageGenerator::performFormPainting(PDFObjectReference formReference, const PDFStream* stream)
+{
+    const QTransform worldMatrix = getCurrentWorldMatrix();
+    if (!formReference.isValid() || !canInstanceContent(worldMatrix))
+    {
+        // Form is processed as a part of the page
+        return false;
+    }
+
+    ContentKey key = createContentKey(true);
+    key.reference = formReference;
+    key.worldMatrix = { worldMatrix.m11(), worldMatrix.m12(), worldMatrix.m21(), worldMatrix.m22() };
+
+    // Form is compiled without the translation part of the world matrix,
+    // which is then applied, when instance is drawn.
+    const QTransform placement = QTransform::fromTranslate(worldMatrix.dx(), worldMatrix.dy());
+
+    auto it = m_compiledContents.find(key);
+    if (it == m_compiledContents.end())
+    {
+        const PDFPageContentProcessorState graphicState = *getGraphicState();
+        auto process = [stream, &graphicState](PDFPrecompiledPageGenerator& generator) { return generator.processFormContents(stream, graphicState); };
+
+        CompiledContent content = compileContent(getPagePointToDevicePointMatrix() * placement.inverted(), true, process);
+        content.placement = placement;
+        it = m_compiledContents.emplace(key, qMove(content)).first;
+    }
+
+    return addContentInstance(it->second, placement);
+}
+
+bool PDFPrecompiledPageGenerator::performType3GlyphPainting(const PDFType3Font* font, const QByteArray* contentStream, const QTransform& glyphMatrix)
+{
+    const QTransform worldMatrix = glyphMatrix * getPagePointToDevicePointMatrix();
+    if (!worldMatrix.isInvertible() || !canInstanceContent(worldMatrix))
+    {
+        // Glyph procedure is processed as a part of the page
+        return false;
+    }
+
+    // Text state (font size, spacing, rise, ...) is applied by the glyph matrix,
+    // by which compiled glyph is placed, glyph procedure itself is processed in the
+    // glyph space. So the same glyph is compiled only once for all font sizes.
+    ContentKey key = createContentKey(false);
+    key.glyphProcedure = contentStream;
+    key.worldMatrix = { 1.0, 0.0, 0.0, 1.0 };
+
+    auto it = m_compiledContents.find(key);
+    if (it == m_compiledContents.end())
+    {
+        // Glyph is compiled in the glyph space, so we do not use rasterized tiling
+        // pattern cells, because their resolution is given by the device space.
+        const PDFPageContentProcessorState graphicState = *getGraphicState();
+        auto process = [font, contentStream, &graphicState](PDFPrecompiledPageGenerator& generator) { return generator.processType3GlyphContents(font, *contentStream, graphicState); };
+
+        CompiledContent content = compileContent(QTransform(), false, process);
+        content.font = graphicState.getTextFont();
+        content.placement = worldMatrix;
+        it = m_compiledContents.emplace(key, qMove(content)).first;
+    }
+
+    return addContentInstance(it->second, worldMatrix);
+}
+
+bool PDFPrecompiledPageGenerator::canInstanceContent(const QTransform& worldMatrix) const
+{
+    const PDFPageContentProcessorState* graphicState = getGraphicState();
+    return !isContentSuppressed() &&
+           !isTransparencyGroupActive() &&
+           !isDrawingUncoloredTilingPattern() &&
+           worldMatrix.isAffine() &&
+           !graphicState->getSoftMask() &&
+           graphicState->getLineDashPattern().isSolid() &&
+           graphicState->getStrokeColorSpace() && !graphicState->getStrokeColorSpace()->asPatternColorSpace() &&
+           graphicState->getFillColorSpace() && !graphicState->getFillColorSpace()->asPatternColorSpace();
+}
+
+PDFPrecompiledPageGenerator::ContentKey PDFPrecompiledPageGenerator::createContentKey(bool isTextStateIncluded) const
+{
+    const PDFPageContentProcessorState* graphicState = getGraphicState();
+
+    ContentKey key;
+    key.strokeColor = graphicState->getStrokeColor().rgba();
+    key.fillColor = graphicState->getFillColor().rgba();
+    key.strokeColorSpace = graphicState->getStrokeColorSpacePointer();
+    key.fillColorSpace = graphicState->getFillColorSpacePointer();
+    key.alphaStroking = graphicState->getAlphaStroking();
+    key.alphaFilling = graphicState->getAlphaFilling();
+    key.lineWidth = graphicState->getLineWidth();
+    key.mitterLimit = graphicState->getMitterLimit();
+    key.lineCapStyle = graphicState->getLineCapStyle();
+    key.lineJoinStyle = graphicState->getLineJoinStyle();
+    key.blendMode = static_cast<int>(graphicState->getBlendMode());
+    key.renderingIntent = static_cast<int>(graphicState->getRenderingIntent());
+    key.textFont = graphicState->getTextFont().get();
+
+    if (isTextStateIncluded)
+    {
+        key.textFontSize = graphicState->getTextFontSize();
+        key.textCharacterSpacing = graphicState->getTextCharacterSpacing();
+        key.textWordSpacing = graphicState->getTextWordSpacing();
+        key.textHorizontalScaling = graphicState->getTextHorizontalScaling();
+        key.textLeading = graphicState->getTextLeading();
+        key.textRise = graphicState->getTextRise();
+        key.textRenderingMode = static_cast<int>(graphicState->getTextRenderingMode());
+    }
+
+    return key;
+}
+
+PDFPrecompiledPageGenerator::CompiledContent PDFPrecompiledPageGenerator::compileContent(const QTransform& pagePointToDevicePointMatrix,
+                                                                                         bool useTilingPatternCache,
+                                                                                         const std::function<QList<PDFRenderError>(PDFPrecompiledPageGenerator&)>& process)
+{
+    auto page = std::make_shared<PDFPrecompiledPage>();
+    PDFPrecompiledPageGenerator generator(page.get(), getFeatures(), getPage(), getDocument(), getFontCache(), getCMS(), getOptionalContentActivity(), getShadingMeshQualitySettings(), pagePointToDevicePointMatrix);
+    generator.setOperationControl(getOperationControl());
+    generator.setMeshCache(getMeshCache());
+    generator.setJBIG2GlobalsCache(getJBIG2GlobalsCache());
+    generator.setTilingPatternCache(useTilingPatternCache ? m_tilingPatternCache : nullptr);
+
+    QList<PDFRenderError> errors = process(generator);
+    for (const PDFRenderError& error : errors)
+    {
+        reportRenderError(error.type, error.message);
+    }
+
+    page->optimize();
+    page->finalize(0, QList<PDFRenderError>());
+
+    CompiledContent content;
+    content.snapImages = page->getSnapInfo()->getSnapImages();
+    content.page = qMove(page);
+    content.isPlacementDependent = generator.m_isPlacementDependent;
+    return content;
+}
+
+bool PDFPrecompiledPageGenerator::addContentInstance(const CompiledContent& content, const QTransform& placement)
+{
+    if (content.isPlacementDependent && content.placement != placement)
+    {
+        return false;
+    }
+
+    if (content.page->isValid())
+    {
+        m_precompiledPage->addInstance(content.page, placement);
+    }
+
+    // Snap info of the instanced page is not used, so images
+    // are added to the snap info of this page for each instance.
+    PDFSnapInfo* snapInfo = m_precompiledPage->getSnapInfo();
+    for (const PDFSnapInfo::SnapImage& snapImage : content.snapImages)
+    {
+        if (snapImage.imagePath.elementCount() < 4)
+        {
+            continue;
+        }
+
+        std::array<QPointF, 5> points;
+        for (int i = 0; i < 4; ++i)
+        {
+            points[i] = placement.map(QPointF(snapImage.imagePath.elementAt(i)));
+        }
+        points[4] = (points[0] + points[2]) * 0.5;
+
+        snapInfo->addImage(points, snapImage.image);
+    }
+
+    m_isPlacementDependent = m_isPlacementDependent || content.isPlacementDependent;
+    return true;
+}
+
 void PDFPrecompiledPageGenerator::performMeshPainting(const PDFMesh& mesh)
 {
+    m_isPlacementDependent = true;
     m_precompiledPage->addMesh(mesh, getEffectiveFillingAlpha());
 }
 
@@ -465,7 +923,8 @@ void PDFPrecompiledPage::draw(QPainter* painter,
                               const QRectF& cropBox,
                               const QTransform& pagePointToDevicePointMatrix,
                               PDFRenderer::Features features,
-                              PDFReal opacity) const
+                              PDFReal opacity,
+                              const PDFColorConvertor& colorConvertor) const
 {
     Q_ASSERT(painter);
     Q_ASSERT(pagePointToDevicePointMatrix.isInvertible());
@@ -480,15 +939,40 @@ void PDFPrecompiledPage::draw(QPainter* painter,
         {
             QPainterPath path;
             path.addPolygon(pagePointToDevicePointMatrix.map(cropBox));
-            painter->setClipPath(path, Qt::IntersectClip);
+            PDFPainterHelper::applyClipPath(painter, path);
         }
     }
 
     painter->setRenderHint(QPainter::SmoothPixmapTransform, features.testFlag(PDFRenderer::SmoothImages));
 
+    drawInstructions(painter, pagePointToDevicePointMatrix, features, colorConvertor);
+
+    painter->restore();
+}
+
+void PDFPrecompiledPage::drawInstructions(QPainter* painter,
+                                          const QTransform& pagePointToDevicePointMatrix,
+                                          PDFRenderer::Features features,
+                                          const PDFColorConvertor& colorConvertor) const
+{
+    // Optional content is evaluated here, so it can be turned on/off without
+    // recompilation of the page. Hidden content is not painted, but graphic
+    // state instructions must be processed.
+    std::stack<bool> optionalContentStack;
+    int suppressedOptionalContentCount = 0;
+
+    // Colors are also converted here, so color mode can be changed without
+    // recompilation of the page. Expensive conversions are cached.
+    const bool isColorConverted = colorConvertor.isActive();
+
     // Process all instructions
     for (const Instruction& instruction : m_instructions)
     {
+        if (suppressedOptionalContentCount > 0 && isPaintingInstruction(instruction.type))
+        {
+            continue;
+        }
+
         switch (instruction.type)
         {
             case InstructionType::DrawPath:
@@ -498,16 +982,25 @@ void PDFPrecompiledPage::draw(QPainter* painter,
                 // Set antialiasing
                 const bool antialiasing = (data.isText && features.testFlag(PDFRenderer::TextAntialiasing)) || (!data.isText && features.testFlag(PDFRenderer::Antialiasing));
                 painter->setRenderHint(QPainter::Antialiasing, antialiasing);
-                painter->setPen(data.pen);
-                painter->setBrush(data.brush);
+
+                if (isColorConverted)
+                {
+                    painter->setPen(data.pen.style() != Qt::NoPen ? colorConvertor.convert(data.pen, false, data.isText) : data.pen);
+                    painter->setBrush(getConvertedBrush(instruction.dataIndex, colorConvertor));
+                }
+                else
+                {
+                    painter->setPen(data.pen);
+                    painter->setBrush(data.brush);
+                }
+
                 painter->drawPath(data.path);
                 break;
             }
 
             case InstructionType::DrawImage:
             {
-                const ImageData& data = m_images[instruction.dataIndex];
-                const QImage& image = data.image;
+                const QImage image = isColorConverted ? getConvertedImage(instruction.dataIndex, colorConvertor) : m_images[instruction.dataIndex].image;
 
                 painter->save();
 
@@ -528,17 +1021,27 @@ void PDFPrecompiledPage::draw(QPainter* painter,
             case InstructionType::DrawMesh:
             {
                 const MeshPaintData& data = m_meshes[instruction.dataIndex];
+                std::shared_ptr<const PDFMesh> convertedMesh = isColorConverted ? getConvertedMesh(instruction.dataIndex, colorConvertor) : nullptr;
+                const PDFMesh& mesh = convertedMesh ? *convertedMesh : data.mesh;
 
                 painter->save();
                 painter->setWorldTransform(QTransform(pagePointToDevicePointMatrix));
-                data.mesh.paint(painter, data.alpha);
+                mesh.paint(painter, data.alpha);
                 painter->restore();
                 break;
             }
 
             case InstructionType::Clip:
             {
-                painter->setClipPath(m_clips[instruction.dataIndex].clipPath, Qt::IntersectClip);
+                const ClipData& data = m_clips[instruction.dataIndex];
+                if (data.clipRect.has_value())
+                {
+                    painter->setClipRect(*data.clipRect, Qt::IntersectClip);
+                }
+                else
+                {
+                    painter->setClipPath(data.clipPath, Qt::IntersectClip);
+                }
                 break;
             }
 
@@ -566,6 +1069,34 @@ void PDFPrecompiledPage::draw(QPainter* painter,
                 break;
             }
 
+            case InstructionType::DrawInstance:
+            {
+                const InstanceData& data = m_instances[instruction.dataIndex];
+
+                painter->save();
+                data.page->drawInstructions(painter, data.matrix * pagePointToDevicePointMatrix, features, colorConvertor);
+                painter->restore();
+                break;
+            }
+
+            case InstructionType::BeginOptionalContent:
+            {
+                const bool isSuppressed = isOptionalContentSuppressed(m_optionalContents[instruction.dataIndex]);
+                optionalContentStack.push(isSuppressed);
+                suppressedOptionalContentCount += isSuppressed ? 1 : 0;
+                break;
+            }
+
+            case InstructionType::EndOptionalContent:
+            {
+                if (!optionalContentStack.empty())
+                {
+                    suppressedOptionalContentCount -= optionalContentStack.top() ? 1 : 0;
+                    optionalContentStack.pop();
+                }
+                break;
+            }
+
             default:
             {
                 Q_ASSERT(false);
@@ -573,8 +1104,6 @@ void PDFPrecompiledPage::draw(QPainter* painter,
             }
         }
     }
-
-    painter->restore();
 }
 
 void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matrix, QColor color)
@@ -585,6 +1114,10 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
         return;
     }
 
+    // Instanced pages are shared, so they must be converted to instructions of this page
+    flattenInstances();
+    m_nativeCache.clear();
+
     std::stack<QTransform> worldMatrixStack;
     worldMatrixStack.push(matrix);
 
@@ -635,7 +1168,9 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
             {
                 QTransform currentMatrix = worldMatrixStack.top().inverted();
                 QPainterPath mappedRedactPath = currentMatrix.map(redactPath);
-                m_clips[instruction.dataIndex].clipPath = m_clips[instruction.dataIndex].clipPath.subtracted(mappedRedactPath);
+                ClipData& data = m_clips[instruction.dataIndex];
+                data.clipPath = data.clipPath.subtracted(mappedRedactPath);
+                data.updateClipRect();
                 break;
             }
 
@@ -652,6 +1187,8 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
                 break;
 
             case InstructionType::SetCompositionMode:
+            case InstructionType::BeginOptionalContent:
+            case InstructionType::EndOptionalContent:
                 break;
 
             default:
@@ -681,6 +1218,11 @@ void PDFPrecompiledPage::addClip(QPainterPath path)
     m_clips.emplace_back(qMove(path));
 }
 
+void PDFPrecompiledPage::ClipData::updateClipRect()
+{
+    clipRect = PDFPainterHelper::getRectangle(clipPath);
+}
+
 void PDFPrecompiledPage::addImage(QImage image)
 {
     m_instructions.emplace_back(InstructionType::DrawImage, m_images.size());
@@ -705,6 +1247,179 @@ void PDFPrecompiledPage::addSetCompositionMode(QPainter::CompositionMode composi
     m_compositionModes.push_back(compositionMode);
 }
 
+void PDFPrecompiledPage::addInstance(std::shared_ptr<const PDFPrecompiledPage> page, const QTransform& matrix)
+{
+    m_instructions.emplace_back(InstructionType::DrawInstance, m_instances.size());
+    m_instances.emplace_back(qMove(page), matrix);
+}
+
+size_t PDFPrecompiledPage::getInstancedPageCount() const
+{
+    std::set<const PDFPrecompiledPage*> instancedPages;
+    for (const InstanceData& data : m_instances)
+    {
+        instancedPages.insert(data.page.get());
+    }
+
+    return instancedPages.size();
+}
+
+void PDFPrecompiledPage::addBeginOptionalContent(PDFObjectReference ocg, std::shared_ptr<const PDFOptionalContentMembershipObject> ocmd)
+{
+    m_instructions.emplace_back(InstructionType::BeginOptionalContent, m_optionalContents.size());
+    m_optionalContents.emplace_back(ocg, qMove(ocmd));
+}
+
+bool PDFPrecompiledPage::isPaintingInstruction(InstructionType type)
+{
+    switch (type)
+    {
+        case InstructionType::DrawPath:
+        case InstructionType::DrawImage:
+        case InstructionType::DrawMesh:
+        case InstructionType::DrawInstance:
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+bool PDFPrecompiledPage::isOptionalContentSuppressed(const OptionalContentData& data) const
+{
+    if (!m_optionalContentActivity)
+    {
+        return false;
+    }
+
+    if (data.ocmd)
+    {
+        return data.ocmd->evaluate(m_optionalContentActivity) == OCState::OFF;
+    }
+
+    return m_optionalContentActivity->getState(data.ocg) == OCState::OFF;
+}
+
+void PDFPrecompiledPage::flattenInstances()
+{
+    if (m_instances.empty())
+    {
+        return;
+    }
+
+    std::vector<Instruction> instructions = qMove(m_instructions);
+    std::vector<InstanceData> instances = qMove(m_instances);
+    m_instructions.clear();
+    m_instances.clear();
+
+    for (const Instruction& instruction : instructions)
+    {
+        if (instruction.type == InstructionType::DrawInstance)
+        {
+            const InstanceData& data = instances[instruction.dataIndex];
+            addSaveGraphicState();
+            appendInstructions(*data.page, data.matrix);
+            addRestoreGraphicState();
+        }
+        else
+        {
+            m_instructions.push_back(instruction);
+        }
+    }
+}
+
+void PDFPrecompiledPage::appendInstructions(const PDFPrecompiledPage& page, const QTransform& matrix)
+{
+    for (const Instruction& instruction : page.m_instructions)
+    {
+        switch (instruction.type)
+        {
+            case InstructionType::DrawPath:
+            {
+                const PathPaintData& data = page.m_paths[instruction.dataIndex];
+                addPath(data.pen, data.brush, data.path, data.isText);
+                break;
+            }
+
+            case InstructionType::DrawImage:
+            {
+                addImage(page.m_images[instruction.dataIndex].image);
+                break;
+            }
+
+            case InstructionType::DrawMesh:
+            {
+                // Meshes are in the device space of the instanced page
+                const MeshPaintData& data = page.m_meshes[instruction.dataIndex];
+                PDFMesh mesh = data.mesh;
+                mesh.transform(matrix);
+                addMesh(qMove(mesh), data.alpha);
+                break;
+            }
+
+            case InstructionType::Clip:
+            {
+                addClip(page.m_clips[instruction.dataIndex].clipPath);
+                break;
+            }
+
+            case InstructionType::SaveGraphicState:
+            {
+                addSaveGraphicState();
+                break;
+            }
+
+            case InstructionType::RestoreGraphicState:
+            {
+                addRestoreGraphicState();
+                break;
+            }
+
+            case InstructionType::SetWorldMatrix:
+            {
+                addSetWorldMatrix(page.m_matrices[instruction.dataIndex] * matrix);
+                break;
+            }
+
+            case InstructionType::SetCompositionMode:
+            {
+                addSetCompositionMode(page.m_compositionModes[instruction.dataIndex]);
+                break;
+            }
+
+            case InstructionType::DrawInstance:
+            {
+                const InstanceData& data = page.m_instances[instruction.dataIndex];
+                addSaveGraphicState();
+                appendInstructions(*data.page, data.matrix * matrix);
+                addRestoreGraphicState();
+                break;
+            }
+
+            case InstructionType::BeginOptionalContent:
+            {
+                const OptionalContentData& data = page.m_optionalContents[instruction.dataIndex];
+                addBeginOptionalContent(data.ocg, data.ocmd);
+                break;
+            }
+
+            case InstructionType::EndOptionalContent:
+            {
+                addEndOptionalContent();
+                break;
+            }
+
+            default:
+            {
+                Q_ASSERT(false);
+                break;
+            }
+        }
+    }
+}
+
 void PDFPrecompiledPage::optimize()
 {
     m_instructions.shrink_to_fit();
@@ -714,6 +1429,8 @@ void PDFPrecompiledPage::optimize()
     m_meshes.shrink_to_fit();
     m_matrices.shrink_to_fit();
     m_compositionModes.shrink_to_fit();
+    m_instances.shrink_to_fit();
+    m_optionalContents.shrink_to_fit();
 }
 
 void PDFPrecompiledPage::convertColors(const PDFColorConvertor& colorConvertor)
@@ -728,16 +1445,17 @@ void PDFPrecompiledPage::convertColors(const PDFColorConvertor& colorConvertor)
         return;
     }
 
+    // Colors converted at draw time are no longer valid
+    m_convertedColors.clear();
+    m_nativeCache.clear();
+
     for (PathPaintData& pathData : m_paths)
     {
         if (pathData.pen.style() != Qt::NoPen)
         {
             pathData.pen.setColor(colorConvertor.convert(pathData.pen.color(), false, pathData.isText));
         }
-        if (pathData.brush.style() == Qt::SolidPattern)
-        {
-            pathData.brush.setColor(colorConvertor.convert(pathData.brush.color(), false, pathData.isText));
-        }
+        pathData.brush = convertBrush(pathData.brush, colorConvertor, pathData.isText);
     }
 
     for (ImageData& imageData : m_images)
@@ -750,9 +1468,131 @@ void PDFPrecompiledPage::convertColors(const PDFColorConvertor& colorConvertor)
         meshPaintData.mesh.convertColors(colorConvertor);
     }
 
+    // Instanced pages are shared, so we must create converted copies of them
+    std::map<const PDFPrecompiledPage*, std::shared_ptr<const PDFPrecompiledPage>> convertedPages;
+    for (InstanceData& instanceData : m_instances)
+    {
+        std::shared_ptr<const PDFPrecompiledPage>& convertedPage = convertedPages[instanceData.page.get()];
+        if (!convertedPage)
+        {
+            auto page = std::make_shared<PDFPrecompiledPage>(*instanceData.page);
+            page->convertColors(colorConvertor);
+            page->finalize(page->getCompilingTimeNS(), page->getErrors());
+            convertedPage = qMove(page);
+        }
+        instanceData.page = convertedPage;
+    }
+
     m_paperColor = colorConvertor.convert(m_paperColor, true, false);
 }
 
+QBrush PDFPrecompiledPage::convertBrush(const QBrush& brush, const PDFColorConvertor& colorConvertor, bool isText)
+{
+    if (brush.style() == Qt::SolidPattern)
+    {
+        return colorConvertor.convert(brush, false, isText);
+    }
+    else if (brush.style() == Qt::TexturePattern)
+    {
+        // Rasterized cells of the tiling patterns
+        QBrush convertedBrush(colorConvertor.convert(brush.textureImage()));
+        convertedBrush.setTransform(brush.transform());
+        return convertedBrush;
+    }
+    else if (const QGradient* gradient = brush.gradient())
+    {
+        // Native gradients of the shadings
+        QGradient convertedGradient = *gradient;
+        QGradientStops stops = convertedGradient.stops();
+        for (QGradientStop& stop : stops)
+        {
+            stop.second = colorConvertor.convert(stop.second, false, isText);
+        }
+        convertedGradient.setStops(stops);
+        return QBrush(convertedGradient);
+    }
+
+    return brush;
+}
+
+QBrush PDFPrecompiledPage::getConvertedBrush(size_t index, const PDFColorConvertor& colorConvertor) const
+{
+    const PathPaintData& data = m_paths[index];
+    if (data.brush.style() != Qt::TexturePattern && !data.brush.gradient())
+    {
+        // Simple brush, conversion is cheap
+        return convertBrush(data.brush, colorConvertor, data.isText);
+    }
+
+    {
+        QMutexLocker lock(&m_convertedColors.mutex);
+        m_convertedColors.setColorConvertor(colorConvertor);
+
+        auto it = m_convertedColors.brushes.find(index);
+        if (it != m_convertedColors.brushes.end())
+        {
+            return it->second;
+        }
+    }
+
+    QBrush brush = convertBrush(data.brush, colorConvertor, data.isText);
+
+    qint64 memoryConsumptionEstimate = sizeof(QBrush);
+    if (brush.style() == Qt::TexturePattern)
+    {
+        memoryConsumptionEstimate += brush.textureImage().sizeInBytes();
+    }
+    else if (const QGradient* gradient = brush.gradient())
+    {
+        memoryConsumptionEstimate += sizeof(QGradient) + gradient->stops().size() * sizeof(QGradientStop);
+    }
+
+    QMutexLocker lock(&m_convertedColors.mutex);
+    m_convertedColors.insert(m_convertedColors.brushes, index, brush, colorConvertor, memoryConsumptionEstimate);
+    return brush;
+}
+
+QImage PDFPrecompiledPage::getConvertedImage(size_t index, const PDFColorConvertor& colorConvertor) const
+{
+    {
+        QMutexLocker lock(&m_convertedColors.mutex);
+        m_convertedColors.setColorConvertor(colorConvertor);
+
+        auto it = m_convertedColors.images.find(index);
+        if (it != m_convertedColors.images.end())
+        {
+            return it->second;
+        }
+    }
+
+    QImage image = colorConvertor.convert(m_images[index].image);
+
+    QMutexLocker lock(&m_convertedColors.mutex);
+    m_convertedColors.insert(m_convertedColors.images, index, image, colorConvertor, sizeof(QImage) + image.sizeInBytes());
+    return image;
+}
+
+std::shared_ptr<const PDFMesh> PDFPrecompiledPage::getConvertedMesh(size_t index, const PDFColorConvertor& colorConvertor) const
+{
+    {
+        QMutexLocker lock(&m_convertedColors.mutex);
+        m_convertedColors.setColorConvertor(colorConvertor);
+
+        auto it = m_convertedColors.meshes.find(index);
+        if (it != m_convertedColors.meshes.end())
+        {
+            return it->second;
+        }
+    }
+
+    auto mesh = std::make_shared<PDFMesh>(m_meshes[index].mesh);
+    mesh->convertColors(colorConvertor);
+
+    QMutexLocker lock(&m_convertedColors.mutex);
+    m_convertedColors.insert<std::shared_ptr<const PDFMesh>>(m_convertedColors.meshes, index, mesh, colorConvertor, mesh->getMemoryConsumptionEstimate());
+    return mesh;
+}
+
 void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError> errors)
 {
     m_compilingTimeNS = compilingTimeNS;
@@ -767,6 +1607,8 @@ void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError>
     m_memoryConsumptionEstimate += sizeof(MeshPaintData) * m_meshes.capacity();
     m_memoryConsumptionEstimate += sizeof(QTransform) * m_matrices.capacity();
     m_memoryConsumptionEstimate += sizeof(QPainter::CompositionMode) * m_compositionModes.capacity();
+    m_memoryConsumptionEstimate += sizeof(InstanceData) * m_instances.capacity();
+    m_memoryConsumptionEstimate += sizeof(OptionalContentData) * m_optionalContents.capacity();
     m_memoryConsumptionEstimate += sizeof(PDFRenderError) * m_errors.size();
 
     auto calculateQPathMemoryConsumption = [](const QPainterPath& path)
@@ -776,6 +1618,11 @@ void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError>
     for (const PathPaintData& data : m_paths)
     {
         m_memoryConsumptionEstimate += calculateQPathMemoryConsumption(data.path);
+
+        if (data.brush.style() == Qt::TexturePattern)
+        {
+            m_memoryConsumptionEstimate += data.brush.textureImage().sizeInBytes();
+        }
     }
     for (const ClipData& data : m_clips)
     {
@@ -789,11 +1636,28 @@ void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError>
     {
         m_memoryConsumptionEstimate += data.mesh.getMemoryConsumptionEstimate();
     }
+
+    // Each instanced page is counted only once
+    std::set<const PDFPrecompiledPage*> instancedPages;
+    for (const InstanceData& data : m_instances)
+    {
+        if (instancedPages.insert(data.page.get()).second)
+        {
+            m_memoryConsumptionEstimate += data.page->getMemoryConsumptionEstimate();
+        }
+    }
 }
 
 PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceInfos(QRectF mediaBox,
                                                                                      PDFReal epsilon) const
 {
+    if (!m_instances.empty())
+    {
+        PDFPrecompiledPage page(*this);
+        page.flattenInstances();
+        return page.calculateGraphicPieceInfos(mediaBox, epsilon);
+    }
+
     GraphicPieceInfos infos;
 
     struct State
@@ -812,9 +1676,18 @@ PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceI
 
     QImage shadingTestImage;
 
+    // Hidden optional content is not painted, so it is skipped
+    std::stack<bool> optionalContentStack;
+    int suppressedOptionalContentCount = 0;
+
     // Process all instructions
     for (const Instruction& instruction : m_instructions)
     {
+        if (suppressedOptionalContentCount > 0 && isPaintingInstruction(instruction.type))
+        {
+            continue;
+        }
+
         switch (instruction.type)
         {
             case InstructionType::DrawPath:
@@ -1000,6 +1873,24 @@ PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceI
                 break;
             }
 
+            case InstructionType::BeginOptionalContent:
+            {
+                const bool isSuppressed = isOptionalContentSuppressed(m_optionalContents[instruction.dataIndex]);
+                optionalContentStack.push(isSuppressed);
+                suppressedOptionalContentCount += isSuppressed ? 1 : 0;
+                break;
+            }
+
+            case InstructionType::EndOptionalContent:
+            {
+                if (!optionalContentStack.empty())
+                {
+                    suppressedOptionalContentCount -= optionalContentStack.top() ? 1 : 0;
+                    optionalContentStack.pop();
+                }
+                break;
+            }
+
             default:
             {
                 Q_ASSERT(false);
@@ -1011,4 +1902,112 @@ PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceI
     return infos;
 }
 
+void PDFTilingPatternCache::setDocument(const PDFModifiedDocument& document)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_document != document)
+    {
+        m_document = document;
+
+        // Patterns can be changed only, if page contents has been changed
+        if (document.hasReset() || document.hasPageContentsChanged())
+        {
+            m_images.clear();
+            m_memoryConsumption = 0;
+        }
+    }
+}
+
+PDFTilingPatternCache::CellImage PDFTilingPatternCache::getImage(const PDFTilingPattern* tilingPattern,
+                                                                  QSize size,
+                                                                  QColor color,
+                                                                  PDFRenderer::Features features,
+                                                                  const PDFOptionalContentActivity* optionalContentActivity,
+                                                                  const std::function<CellImage(void)>& createImage) const
+{
+    const PDFObjectReference reference = tilingPattern->getPatternReference();
+    if (!reference.isValid())
+    {
+        return createImage();
+    }
+
+    Key key;
+    key.reference = reference;
+    key.width = size.width();
+    key.height = size.height();
+    key.color = color.isValid() ? color.rgba() : 0;
+    key.features = features.toInt();
+
+    if (optionalContentActivity && !features.testFlag(PDFRenderer::IgnoreOptionalContent))
+    {
+        key.optionalContentStates = optionalContentActivity->getStates();
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_images.find(key);
+        if (it != m_images.cend())
+        {
+            return it->second;
+        }
+    }
+
+    // Rasterize the cell outside of the lock, so other pages can be
+    // compiled meanwhile. If cell is rasterized by multiple threads
+    // at once, only the first result is stored.
+    CellImage cellImage = createImage();
+    if (cellImage.image.isNull())
+    {
+        return cellImage;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    auto it = m_images.find(key);
+    if (it != m_images.cend())
+    {
+        return it->second;
+    }
+
+    const qint64 memoryConsumption = cellImage.image.sizeInBytes();
+    if (m_memoryConsumption + memoryConsumption > m_cacheLimit)
+    {
+        // We have exceeded the cache limit. Clear the cache.
+        m_images.clear();
+        m_memoryConsumption = 0;
+    }
+
+    if (memoryConsumption <= m_cacheLimit)
+    {
+        m_images[key] = cellImage;
+        m_memoryConsumption += memoryConsumption;
+    }
+
+    return cellImage;
+}
+
+void PDFTilingPatternCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_images.clear();
+    m_memoryConsumption = 0;
+}
+
+void PDFTilingPatternCache::setCacheLimit(qint64 cacheLimit)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cacheLimit = cacheLimit;
+
+    if (m_memoryConsumption > m_cacheLimit)
+    {
+        m_images.clear();
+        m_memoryConsumption = 0;
+    }
+}
+
+qint64 PDFTilingPatternCache::getMemoryConsumptionEstimate() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_memoryConsumption;
+}
+
 }   // namespace pdf
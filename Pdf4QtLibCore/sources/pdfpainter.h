@@ -29,9 +29,18 @@
 #include <QPen>
 #include <QBrush>
 #include <QElapsedTimer>
+#include <QMutex>
+
+#include <map>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <functional>
 
 namespace pdf
 {
+class PDFBLPageCache;
+class PDFOptionalContentMembershipObject;
 
 /// Base painter, encapsulating common functionality for all PDF painters (for example,
 /// direct painter, or painter, which generates list of graphic commands).
@@ -52,6 +61,7 @@ public:
     virtual bool isContentSuppressedByOC(PDFObjectReference ocgOrOcmd) override;
 
 protected:
+    virtual bool isClippedContentRejected() const override;
     virtual void performUpdateGraphicsState(const PDFPageContentProcessorState& state) override;
     virtual void performBeginTransparencyGroup(ProcessOrder order, const PDFTransparencyGroup& transparencyGroup) override;
     virtual void performEndTransparencyGroup(ProcessOrder order, const PDFTransparencyGroup& transparencyGroup) override;
@@ -73,12 +83,20 @@ protected:
     /// Returns true, if blend mode can be set according the transparency group stack
     bool canSetBlendMode(BlendMode mode) const;
 
+    /// Returns renderer features
+    PDFRenderer::Features getFeatures() const { return m_features; }
+
     /// Returns, if feature is turned on
     bool hasFeature(PDFRenderer::Feature feature) const { return m_features.testFlag(feature); }
 
     /// Is transparency group active?
     bool isTransparencyGroupActive() const { return !m_transparencyGroupDataStack.empty(); }
 
+    /// Creates native gradient (in device space) for the shading pattern. If shading
+    /// can't be represented by the gradient, then invalid gradient is returned.
+    /// \param shadingPattern Shading pattern
+    PDFShadingGradient createShadingGradient(const PDFShadingPattern* shadingPattern);
+
 private:
     /// Returns current pen (implementation)
     QPen getCurrentPenImpl() const;
@@ -133,6 +151,7 @@ public:
 protected:
     virtual void performPathPainting(const QPainterPath& path, bool stroke, bool fill, bool text, Qt::FillRule fillRule) override;
     virtual void performClipping(const QPainterPath& path, Qt::FillRule fillRule) override;
+    virtual bool performPathPaintingUsingShading(const QPainterPath& path, bool stroke, bool fill, const PDFShadingPattern* shadingPattern) override;
     virtual void performImagePainting(const QImage& image) override;
     virtual void performMeshPainting(const PDFMesh& mesh) override;
     virtual void performSaveGraphicState(ProcessOrder order) override;
@@ -149,6 +168,8 @@ private:
 /// and interpreted from the PDF stream, but they are just "played" on the painter.
 class PDF4QTLIBCORESHARED_EXPORT PDFPrecompiledPage
 {
+    friend class PDFBLPageRenderer;
+
 public:
     explicit inline PDFPrecompiledPage() = default;
 
@@ -167,7 +188,10 @@ public:
         SaveGraphicState,
         RestoreGraphicState,
         SetWorldMatrix,
-        SetCompositionMode
+        SetCompositionMode,
+        DrawInstance,
+        BeginOptionalContent,
+        EndOptionalContent
     };
 
     struct Instruction
@@ -190,11 +214,13 @@ public:
     /// \param pagePointToDevicePointMatrix Page point to device point transformation matrix
     /// \param features Renderer features
     /// \param opacity Opacity of page graphics
+    /// \param colorConvertor Color convertor, which is applied to the colors, when page is drawn
     void draw(QPainter* painter,
               const QRectF& cropBox,
               const QTransform& pagePointToDevicePointMatrix,
               PDFRenderer::Features features,
-              PDFReal opacity) const;
+              PDFReal opacity,
+              const PDFColorConvertor& colorConvertor) const;
 
     /// Redact path - remove all content intersecting given path,
     /// and fill redact path with given color.
@@ -211,6 +237,25 @@ public:
     void addSetWorldMatrix(const QTransform& matrix);
     void addSetCompositionMode(QPainter::CompositionMode compositionMode);
 
+    /// Adds instance of another precompiled page (for example, compiled form XObject,
+    /// which is painted multiple times). Instanced page is shared, it is drawn
+    /// with the \p matrix, which maps its page space to the page space of this page.
+    /// \param page Instanced page
+    /// \param matrix Transformation matrix of the instance
+    void addInstance(std::shared_ptr<const PDFPrecompiledPage> page, const QTransform& matrix);
+
+    /// Returns number of distinct instanced pages (each compiled form
+    /// or glyph is counted once, regardless of number of its instances)
+    size_t getInstancedPageCount() const;
+
+    /// Begins content, which visibility is given by optional content group
+    /// or optional content membership dictionary. Visibility is evaluated, when page
+    /// is drawn, using optional content activity of the page.
+    /// \param ocg Optional content group
+    /// \param ocmd Optional content membership dictionary (if content isn't in single group)
+    void addBeginOptionalContent(PDFObjectReference ocg, std::shared_ptr<const PDFOptionalContentMembershipObject> ocmd);
+    void addEndOptionalContent() { m_instructions.emplace_back(InstructionType::EndOptionalContent, 0); }
+
     /// Optimizes page memory allocation to contain less space
     void optimize();
 
@@ -231,8 +276,9 @@ public:
     /// Returns true, if page is valid (i.e. has nonzero instruction count)
     bool isValid() const { return !m_instructions.empty(); }
 
-    /// Returns memory consumption estimate
-    qint64 getMemoryConsumptionEstimate() const { return m_memoryConsumptionEstimate; }
+    /// Returns memory consumption estimate. Estimate includes caches created
+    /// when the page is drawn, so it can grow after the page is compiled.
+    qint64 getMemoryConsumptionEstimate() const { return m_memoryConsumptionEstimate + m_convertedColors.memoryConsumptionEstimate.load() + m_nativeCache.memoryConsumptionEstimate.load(); }
 
     /// Returns paper color
     QColor getPaperColor() const { return m_paperColor; }
@@ -241,6 +287,11 @@ public:
     PDFSnapInfo* getSnapInfo() { return &m_snapInfo; }
     const PDFSnapInfo* getSnapInfo() const { return &m_snapInfo; }
 
+    /// Returns optional content activity, which is used to evaluate
+    /// visibility of the optional content, when page is drawn.
+    const PDFOptionalContentActivity* getOptionalContentActivity() const { return m_optionalContentActivity; }
+    void setOptionalContentActivity(const PDFOptionalContentActivity* optionalContentActivity) { m_optionalContentActivity = optionalContentActivity; }
+
     /// Mark this precompiled page as accessed at a current time
     void markAccessed() { m_expirationTimer.start(); }
 
@@ -291,6 +342,55 @@ public:
                                                  PDFReal epsilon) const;
 
 private:
+    /// Plays instructions on the painter, which is already initialized
+    /// \param painter Painter, onto which are instructions played
+    /// \param pagePointToDevicePointMatrix Page point to device point transformation matrix
+    /// \param features Renderer features
+    /// \param colorConvertor Color convertor
+    void drawInstructions(QPainter* painter,
+                          const QTransform& pagePointToDevicePointMatrix,
+                          PDFRenderer::Features features,
+                          const PDFColorConvertor& colorConvertor) const;
+
+    /// Converts colors of the brush (solid colors, textures and gradients)
+    /// \param brush Brush
+    /// \param colorConvertor Color convertor
+    /// \param isText Is brush used to paint text?
+    static QBrush convertBrush(const QBrush& brush, const PDFColorConvertor& colorConvertor, bool isText);
+
+    /// Returns converted brush of the path. Converted textures and gradients
+    /// are cached. This function is thread safe.
+    /// \param index Index of the path
+    /// \param colorConvertor Color convertor
+    QBrush getConvertedBrush(size_t index, const PDFColorConvertor& colorConvertor) const;
+
+    /// Returns converted image (converted images are cached).
+    /// This function is thread safe.
+    /// \param index Index of the image
+    /// \param colorConvertor Color convertor
+    QImage getConvertedImage(size_t index, const PDFColorConvertor& colorConvertor) const;
+
+    /// Returns converted mesh (converted meshes are cached).
+    /// This function is thread safe.
+    /// \param index Index of the mesh
+    /// \param colorConvertor Color convertor
+    std::shared_ptr<const PDFMesh> getConvertedMesh(size_t index, const PDFColorConvertor& colorConvertor) const;
+
+    /// Replaces instances by the instructions of the instanced pages
+    void flattenInstances();
+
+    /// Returns true, if instruction paints something, so it is skipped, when
+    /// optional content is hidden. Clipping is not a painting instruction, it
+    /// is applied even in hidden optional content, as it affects visible content.
+    static bool isPaintingInstruction(InstructionType type);
+
+    /// Appends instructions of the \p page, instructions are transformed
+    /// using the \p matrix (page space of the \p page to the page space
+    /// of this page).
+    /// \param page Page, whose instructions are appended
+    /// \param matrix Transformation matrix
+    void appendInstructions(const PDFPrecompiledPage& page, const QTransform& matrix);
+
     struct PathPaintData
     {
         inline PathPaintData() = default;
@@ -315,10 +415,13 @@ private:
         inline ClipData(QPainterPath path) :
             clipPath(qMove(path))
         {
-
+            updateClipRect();
         }
 
+        void updateClipRect();
+
         QPainterPath clipPath;
+        std::optional<QRectF> clipRect; ///< Clipping rectangle, if clipping path is a rectangle
     };
 
     struct ImageData
@@ -347,6 +450,106 @@ private:
         PDFReal alpha = 1.0;
     };
 
+    struct InstanceData
+    {
+        inline InstanceData() = default;
+        inline InstanceData(std::shared_ptr<const PDFPrecompiledPage> page, const QTransform& matrix) :
+            page(qMove(page)),
+            matrix(matrix)
+        {
+
+        }
+
+        std::shared_ptr<const PDFPrecompiledPage> page;
+        QTransform matrix;
+    };
+
+    struct OptionalContentData
+    {
+        inline OptionalContentData() = default;
+        inline OptionalContentData(PDFObjectReference ocg, std::shared_ptr<const PDFOptionalContentMembershipObject> ocmd) :
+            ocg(ocg),
+            ocmd(qMove(ocmd))
+        {
+
+        }
+
+        PDFObjectReference ocg;
+        std::shared_ptr<const PDFOptionalContentMembershipObject> ocmd;
+    };
+
+    /// Colors converted by the color convertor, when page is drawn. Only items,
+    /// which are expensive to convert (images, textures, gradients and meshes) are
+    /// stored, for single color convertor. Cache is not copied with the page.
+    /// Mutex is locked only when items are searched or inserted, items are
+    /// converted without the lock.
+    struct ConvertedColorsCache
+    {
+        inline ConvertedColorsCache() = default;
+        inline ConvertedColorsCache(const ConvertedColorsCache&) { }
+        inline ConvertedColorsCache& operator=(const ConvertedColorsCache&) { clear(); return *this; }
+
+        void clear()
+        {
+            colorConvertor = PDFColorConvertor();
+            brushes.clear();
+            images.clear();
+            meshes.clear();
+            memoryConsumptionEstimate = 0;
+        }
+
+        /// Clears the cache, if it was created for another color convertor,
+        /// mutex must be locked.
+        void setColorConvertor(const PDFColorConvertor& convertor)
+        {
+            if (colorConvertor != convertor)
+            {
+                clear();
+                colorConvertor = convertor;
+            }
+        }
+
+        /// Inserts converted item into the cache, mutex must be locked. Item is not
+        /// inserted, if color convertor was changed in the meantime by another thread.
+        template<typename T>
+        void insert(std::map<size_t, T>& items, size_t index, T item, const PDFColorConvertor& convertor, qint64 itemMemoryConsumptionEstimate)
+        {
+            if (colorConvertor == convertor && items.emplace(index, qMove(item)).second)
+            {
+                memoryConsumptionEstimate += itemMemoryConsumptionEstimate;
+            }
+        }
+
+        QMutex mutex;
+        PDFColorConvertor colorConvertor;
+        std::map<size_t, QBrush> brushes;
+        std::map<size_t, QImage> images;
+        std::map<size_t, std::shared_ptr<const PDFMesh>> meshes;
+        std::atomic<qint64> memoryConsumptionEstimate = 0;
+    };
+
+    /// Graphic objects of the Blend2D renderer (paths, styles and images),
+    /// which are created, when the page is drawn natively using Blend2D.
+    /// Objects are shared with the drawing threads. Cache is not copied with the page.
+    /// Memory consumption estimate is updated, when the cache is built.
+    struct NativeCache
+    {
+        inline NativeCache() = default;
+        inline NativeCache(const NativeCache&) { }
+        inline NativeCache& operator=(const NativeCache&) { clear(); return *this; }
+
+        void clear() { data.reset(); memoryConsumptionEstimate = 0; }
+
+        QMutex mutex;
+        std::shared_ptr<PDFBLPageCache> data;
+        std::atomic<qint64> memoryConsumptionEstimate = 0;
+    };
+
+    /// Returns true, if optional content is hidden in current
+    /// state of the optional content activity.
+    /// \param data Optional content
+    bool isOptionalContentSuppressed(const OptionalContentData& data) const;
+
     qint64 m_compilingTimeNS = 0;
     qint64 m_memoryConsumptionEstimate = 0;
     QColor m_paperColor = QColor(Qt::white);
@@ -357,11 +560,92 @@ private:
     std::vector<MeshPaintData> m_meshes;
     std::vector<QTransform> m_matrices;
     std::vector<QPainter::CompositionMode> m_compositionModes;
+    std::vector<InstanceData> m_instances;
+    std::vector<OptionalContentData> m_optionalContents;
+    const PDFOptionalContentActivity* m_optionalContentActivity = nullptr;
+    mutable ConvertedColorsCache m_convertedColors;
+    mutable NativeCache m_nativeCache;
     QList<PDFRenderError> m_errors;
     PDFSnapInfo m_snapInfo;
     QElapsedTimer m_expirationTimer;
 };
 
+/// Cache of rasterized cells of the tiling patterns. Cell image contains exactly one
+/// period of the pattern (all overlapping cells are painted into it), so area can be filled
+/// using the image as tiled brush. Images are stored for each pattern, image size (which
+/// represents the resolution of the device space), color (for uncolored patterns only)
+/// and state of the optional content. Cache is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFTilingPatternCache
+{
+public:
+    inline explicit PDFTilingPatternCache(qint64 cacheLimit) :
+        m_cacheLimit(cacheLimit),
+        m_memoryConsumption(0)
+    {
+
+    }
+
+    /// Rasterized cell of the tiling pattern
+    struct CellImage
+    {
+        QImage image;
+        QList<PDFRenderError> errors;       ///< Errors reported, when cell was rasterized
+        bool hasOptionalContent = false;    ///< Cell content contains optional content
+    };
+
+    /// Sets the document to the cache. Whole cache is cleared,
+    /// if it is needed.
+    /// \param document Document to be setted
+    void setDocument(const PDFModifiedDocument& document);
+
+    /// Returns rasterized cell of the tiling pattern. If image is not in the cache,
+    /// it is created using function \p createImage and stored in the cache. Patterns,
+    /// which are not indirect objects, are not cached.
+    /// \param tilingPattern Tiling pattern
+    /// \param size Size of the image in pixels
+    /// \param color Color of uncolored pattern (invalid color for colored pattern)
+    /// \param features Renderer features used when rasterizing the image
+    /// \param optionalContentActivity Optional content activity used when rasterizing the image
+    /// \param createImage Function, which creates the image
+    CellImage getImage(const PDFTilingPattern* tilingPattern,
+                       QSize size,
+                       QColor color,
+                       PDFRenderer::Features features,
+                       const PDFOptionalContentActivity* optionalContentActivity,
+                       const std::function<CellImage(void)>& createImage) const;
+
+    /// Clears the cache (for example, when color management system is changed)
+    void clear();
+
+    /// Sets cache limit (in bytes)
+    void setCacheLimit(qint64 cacheLimit);
+
+    /// Returns estimate of number of bytes, which cached images occupy in memory
+    qint64 getMemoryConsumptionEstimate() const;
+
+private:
+    struct Key
+    {
+        PDFObjectReference reference;
+        int width = 0;
+        int height = 0;
+        QRgb color = 0;
+        int features = 0;
+        std::map<PDFObjectReference, OCState> optionalContentStates;
+
+        bool operator<(const Key& other) const
+        {
+            return std::tie(reference, width, height, color, features, optionalContentStates) < std::tie(other.reference, other.width, other.height, other.color, other.features, other.optionalContentStates);
+        }
+    };
+
+    qint64 m_cacheLimit;
+    mutable qint64 m_memoryConsumption;
+    mutable QMutex m_mutex;
+    const PDFDocument* m_document = nullptr;
+    mutable std::map<Key, CellImage> m_images;
+};
+
 /// Processor, which processes PDF's page commands and writes them to the precompiled page.
 /// Precompiled page then can be used to execute these commands on QPainter.
 class PDF4QTLIBCORESHARED_EXPORT PDFPrecompiledPageGenerator : public PDFPainterBase
@@ -376,11 +660,30 @@ public:
                                          const PDFFontCache* fontCache,
                                          const PDFCMS* cms,
                                          const PDFOptionalContentActivity* optionalContentActivity,
-                                         const PDFMeshQualitySettings& meshQualitySettings);
+                                         const PDFMeshQualitySettings& meshQualitySettings,
+                                         QTransform pagePointToDevicePointMatrix = QTransform());
+
+    /// Sets cache of rasterized tiling pattern cells. If cache is set, then tiling
+    /// patterns are painted using the rasterized cells, otherwise they are
+    /// painted as vector graphics.
+    /// \param tilingPatternCache Tiling pattern cache
+    void setTilingPatternCache(const PDFTilingPatternCache* tilingPatternCache) { m_tilingPatternCache = tilingPatternCache; }
+
+    virtual bool isContentSuppressedByOC(PDFObjectReference ocgOrOcmd) override;
 
 protected:
     virtual void performPathPainting(const QPainterPath& path, bool stroke, bool fill, bool text, Qt::FillRule fillRule) override;
     virtual void performClipping(const QPainterPath& path, Qt::FillRule fillRule) override;
+    virtual bool performPathPaintingUsingShading(const QPainterPath& path, bool stroke, bool fill, const PDFShadingPattern* shadingPattern) override;
+    virtual bool performPathPaintingUsingTilingPattern(const QPainterPath& path,
+                                                       const PDFTilingPattern* tilingPattern,
+                                                       const QTransform& cellMatrix,
+                                                       const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                       const PDFColor& uncoloredPatternColor) override;
+    virtual bool performFormPainting(PDFObjectReference formReference, const PDFStream* stream) override;
+    virtual bool performType3GlyphPainting(const PDFType3Font* font, const QByteArray* contentStream, const QTransform& glyphMatrix) override;
+    virtual void performOptionalContentBegin(PDFObjectReference ocgOrOcmd) override;
+    virtual void performOptionalContentEnd() override;
     virtual void performImagePainting(const QImage& image) override;
     virtual void performMeshPainting(const PDFMesh& mesh) override;
     virtual void performSaveGraphicState(ProcessOrder order) override;
@@ -389,7 +692,100 @@ protected:
     virtual void setCompositionMode(QPainter::CompositionMode mode) override;
 
 private:
+    /// Graphic state inputs, which affect the output of the compiled content (form XObject
+    /// or Type 3 glyph procedure). Content is compiled once for each combination of these
+    /// inputs, and then it is instanced. Forms are identified by the reference and world
+    /// matrix is included without translation, which is applied by the instance. Glyphs are
+    /// identified by the glyph procedure and they are compiled in the glyph space.
+    struct ContentKey
+    {
+        PDFObjectReference reference;
+        const QByteArray* glyphProcedure = nullptr;
+        std::array<PDFReal, 4> worldMatrix = { };
+        QRgb strokeColor = 0;
+        QRgb fillColor = 0;
+
+        /// Color spaces are held by the key, so their identity can't be taken
+        /// by another color space, while the compiled content is cached.
+        PDFColorSpacePointer strokeColorSpace;
+        PDFColorSpacePointer fillColorSpace;
+        PDFReal alphaStroking = 1.0;
+        PDFReal alphaFilling = 1.0;
+        PDFReal lineWidth = 0.0;
+        PDFReal mitterLimit = 0.0;
+        int lineCapStyle = 0;
+        int lineJoinStyle = 0;
+        int blendMode = 0;
+        int renderingIntent = 0;
+        const PDFFont* textFont = nullptr;
+        PDFReal textFontSize = 0.0;
+        PDFReal textCharacterSpacing = 0.0;
+        PDFReal textWordSpacing = 0.0;
+        PDFReal textHorizontalScaling = 0.0;
+        PDFReal textLeading = 0.0;
+        PDFReal textRise = 0.0;
+        int textRenderingMode = 0;
+
+        bool operator<(const ContentKey& other) const
+        {
+            const PDFAbstractColorSpace* strokeColorSpaceIdentity = strokeColorSpace.data();
+            const PDFAbstractColorSpace* fillColorSpaceIdentity = fillColorSpace.data();
+            const PDFAbstractColorSpace* otherStrokeColorSpaceIdentity = other.strokeColorSpace.data();
+            const PDFAbstractColorSpace* otherFillColorSpaceIdentity = other.fillColorSpace.data();
+
+            return std::tie(reference, glyphProcedure, worldMatrix, strokeColor, fillColor, strokeColorSpaceIdentity, fillColorSpaceIdentity, alphaStroking, alphaFilling, lineWidth, mitterLimit, lineCapStyle, lineJoinStyle, blendMode, renderingIntent,
+                            textFont, textFontSize, textCharacterSpacing, textWordSpacing, textHorizontalScaling, textLeading, textRise, textRenderingMode) <
+                   std::tie(other.reference, other.glyphProcedure, other.worldMatrix, other.strokeColor, other.fillColor, otherStrokeColorSpaceIdentity, otherFillColorSpaceIdentity, other.alphaStroking, other.alphaFilling, other.lineWidth, other.mitterLimit, other.lineCapStyle, other.lineJoinStyle, other.blendMode, other.renderingIntent,
+                            other.textFont, other.textFontSize, other.textCharacterSpacing, other.textWordSpacing, other.textHorizontalScaling, other.textLeading, other.textRise, other.textRenderingMode);
+        }
+    };
+
+    struct CompiledContent
+    {
+        std::shared_ptr<const PDFPrecompiledPage> page;
+        PDFFontPointer font;
+        QTransform placement;
+
+        /// Shadings are meshed in the area of the page, so the compiled content
+        /// can be instanced only at the placement, where it was compiled.
+        bool isPlacementDependent = false;
+
+        /// Images of the compiled content (in its coordinate system), they are
+        /// added to the snap info of the page for each instance of the content.
+        std::vector<PDFSnapInfo::SnapImage> snapImages;
+    };
+
+    /// Returns true, if content painted with the current graphic state
+    /// can be compiled separately and instanced.
+    /// \param worldMatrix World matrix of the content
+    bool canInstanceContent(const QTransform& worldMatrix) const;
+
+    /// Creates key of the content from the current graphic state
+    /// \param isTextStateIncluded Include text state parameters (font size, spacing, ...)
+    ContentKey createContentKey(bool isTextStateIncluded) const;
+
+    /// Compiles content using the nested generator
+    /// \param pagePointToDevicePointMatrix Page point to device point matrix of the nested generator
+    /// \param useTilingPatternCache Use tiling pattern cache in the nested generator
+    /// \param process Processes content by the nested generator
+    CompiledContent compileContent(const QTransform& pagePointToDevicePointMatrix,
+                                   bool useTilingPatternCache,
+                                   const std::function<QList<PDFRenderError>(PDFPrecompiledPageGenerator&)>& process);
+
+    /// Adds instance of compiled content to the page. If content can't
+    /// be instanced at the \p placement, then false is returned.
+    /// \param content Compiled content
+    /// \param placement Transformation matrix of the instance
+    bool addContentInstance(const CompiledContent& content, const QTransform& placement);
+
     PDFPrecompiledPage* m_precompiledPage;
+    const PDFTilingPatternCache* m_tilingPatternCache = nullptr;
+    std::map<ContentKey, CompiledContent> m_compiledContents;
+    std::map<PDFObjectReference, std::shared_ptr<const PDFOptionalContentMembershipObject>> m_optionalContentMemberships;
+    bool m_isPlacementDependent = false;
+
+    /// Optional content is recorded to the page and it is evaluated, when page is drawn
+    bool m_isOptionalContentRecorded = false;
 };
 
 }   // namespace pdf
@@ -21,6 +21,8 @@
 #include <QPainterPath>
 #include <QFontMetrics>
 
+#include <array>
+
 #include "pdfdbgheap.h"
 
 namespace pdf
@@ -232,4 +234,57 @@ QTransform PDFPainterHelper::composeTransform(const PDFTransformationDecompositi
     return QTransform(m11, m12, m21, m22, dx, dy);
 }
 
+std::optional<QRectF> PDFPainterHelper::getRectangle(const QPainterPath& path)
+{
+    // Rectangle consists of move to the first corner followed by lines to
+    // the other corners, it can be closed by line to the first corner.
+    const int elementCount = path.elementCount();
+    if (elementCount < 4 || elementCount > 5)
+    {
+        return std::nullopt;
+    }
+
+    std::array<QPointF, 5> points;
+    for (int i = 0; i < elementCount; ++i)
+    {
+        const QPainterPath::Element& element = path.elementAt(i);
+        const QPainterPath::ElementType expectedType = (i == 0) ? QPainterPath::MoveToElement : QPainterPath::LineToElement;
+        if (element.type != expectedType)
+        {
+            return std::nullopt;
+        }
+        points[i] = QPointF(element.x, element.y);
+    }
+
+    if (elementCount == 5 && points[4] != points[0])
+    {
+        return std::nullopt;
+    }
+
+    // Edges must be alternately horizontal and vertical
+    const bool isHorizontalFirst = points[0].y() == points[1].y() && points[1].x() == points[2].x() &&
+                                   points[2].y() == points[3].y() && points[3].x() == points[0].x();
+    const bool isVerticalFirst = points[0].x() == points[1].x() && points[1].y() == points[2].y() &&
+                                 points[2].x() == points[3].x() && points[3].y() == points[0].y();
+
+    if (!isHorizontalFirst && !isVerticalFirst)
+    {
+        return std::nullopt;
+    }
+
+    return QRectF(points[0], points[2]).normalized();
+}
+
+void PDFPainterHelper::applyClipPath(QPainter* painter, const QPainterPath& path)
+{
+    if (std::optional<QRectF> rectangle = getRectangle(path))
+    {
+        painter->setClipRect(*rectangle, Qt::IntersectClip);
+    }
+    else
+    {
+        painter->setClipPath(path, Qt::IntersectClip);
+    }
+}
+
 }   // namespace pdf
@@ -22,6 +22,8 @@
 
 #include <QPainter>
 
+#include <optional>
+
 namespace pdf
 {
 class PDFPageContentProcessorState;
@@ -81,6 +83,17 @@ public:
 
     /// Compose transform
     static QTransform composeTransform(const PDFTransformationDecomposition& decomposition);
+
+    /// Returns rectangle, if path consists of a single axis-aligned rectangle,
+    /// otherwise empty optional is returned.
+    /// \param path Path
+    static std::optional<QRectF> getRectangle(const QPainterPath& path);
+
+    /// Intersects clipping area of the painter with the path. If path is
+    /// a rectangle, rectangle clipping is used instead of path clipping.
+    /// \param painter Painter
+    /// \param path Clipping path
+    static void applyClipPath(QPainter* painter, const QPainterPath& path);
 };
 
 }   // namespace pdf
@@ -23,6 +23,7 @@
 #include "pdfexecutionpolicy.h"
 #include "pdfconstants.h"
 #include "pdfpainterutils.h"
+#include "pdfoperationcontrol.h"
 
 #include <QMutex>
 #include <QPainter>
@@ -61,6 +62,179 @@ PDFShadingSampler* PDFShadingPattern::createSampler(QTransform userSpaceToDevice
     return nullptr;
 }
 
+PDFShadingGradient PDFShadingPattern::createGradient(const PDFMeshQualitySettings& settings,
+                                                     const PDFCMS* cms,
+                                                     RenderingIntent intent,
+                                                     PDFRenderErrorReporter* reporter) const
+{
+    Q_UNUSED(settings);
+    Q_UNUSED(cms);
+    Q_UNUSED(intent);
+    Q_UNUSED(reporter);
+
+    // Generic shading can't be represented by native gradient
+    return PDFShadingGradient();
+}
+
+bool PDFSingleDimensionShading::getColorForParameter(PDFReal t, PDFColor& color) const
+{
+    if (!m_colorSpace)
+    {
+        return false;
+    }
+
+    std::vector<PDFReal> colorBuffer(m_colorSpace->getColorComponentCount(), 0.0);
+    if (m_functions.size() == 1)
+    {
+        if (!m_functions.front()->apply(&t, &t + 1, colorBuffer.data(), colorBuffer.data() + colorBuffer.size()))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if (m_functions.size() != colorBuffer.size())
+        {
+            return false;
+        }
+
+        for (size_t i = 0, count = colorBuffer.size(); i < count; ++i)
+        {
+            if (!m_functions[i]->apply(&t, &t + 1, colorBuffer.data() + i, colorBuffer.data() + i + 1))
+            {
+                return false;
+            }
+        }
+    }
+
+    color = PDFAbstractColorSpace::convertToColor(colorBuffer);
+    return true;
+}
+
+bool PDFSingleDimensionShading::createGradientStops(const PDFMeshQualitySettings& settings,
+                                                    const PDFCMS* cms,
+                                                    RenderingIntent intent,
+                                                    PDFRenderErrorReporter* reporter,
+                                                    PDFReal positionStart,
+                                                    PDFReal positionEnd,
+                                                    PDFReal deviceLength,
+                                                    QGradientStops& stops) const
+{
+    // Maximal number of gradient stops. If color functions can't be approximated
+    // by this number of stops, then mesh is used instead.
+    constexpr size_t MAX_GRADIENT_STOPS = 256;
+
+    // Number of initial segments of the domain. We do not test only the domain
+    // as a whole, because some functions (for example, symmetric ones) can match
+    // the linear interpolation in the test points by accident.
+    constexpr int INITIAL_SEGMENT_COUNT = 8;
+
+    struct Sample
+    {
+        PDFReal s = 0.0;
+        PDFColor color;
+    };
+
+    // Parameter s is in range [0, 1], it is mapped onto the domain of the functions
+    auto getSample = [this](PDFReal s, Sample& sample)
+    {
+        sample.s = s;
+        return getColorForParameter(interpolate(s, 0.0, 1.0, m_domainStart, m_domainEnd), sample.color);
+    };
+
+    // Intervals shorter than minimal mesh resolution are not subdivided further,
+    // mesh can't represent them better (for example, jumps in stitching functions).
+    const PDFReal minimalLength = (deviceLength > settings.minimalMeshResolution) ? settings.minimalMeshResolution / deviceLength : 1.0;
+
+    std::vector<Sample> samples;
+    std::vector<Sample> pendingSamples;
+    pendingSamples.reserve(INITIAL_SEGMENT_COUNT + 32);
+
+    Sample sample;
+    for (int i = INITIAL_SEGMENT_COUNT; i > 0; --i)
+    {
+        if (!getSample(PDFReal(i) / PDFReal(INITIAL_SEGMENT_COUNT), sample))
+        {
+            return false;
+        }
+        pendingSamples.push_back(sample);
+    }
+
+    if (!getSample(0.0, sample))
+    {
+        return false;
+    }
+    samples.push_back(sample);
+
+    // Adaptive subdivision - we take the nearest pending sample and test, if color
+    // between last accepted sample and pending sample is linearly interpolated
+    // within the tolerance. If yes, then pending sample is accepted, otherwise
+    // interval is subdivided.
+    while (!pendingSamples.empty())
+    {
+        const Sample left = samples.back();
+        const Sample right = pendingSamples.back();
+        const PDFReal length = right.s - left.s;
+
+        Sample middle;
+        if (!getSample(left.s + length * 0.5, middle))
+        {
+            return false;
+        }
+
+        bool isLinear = length <= minimalLength;
+        if (!isLinear)
+        {
+            isLinear = PDFAbstractColorSpace::isColorEqual(middle.color, PDFAbstractColorSpace::mixColors(left.color, right.color, 0.5), settings.tolerance);
+
+            for (const PDFReal ratio : { 0.25, 0.75 })
+            {
+                if (!isLinear)
+                {
+                    break;
+                }
+
+                Sample quarter;
+                if (!getSample(left.s + length * ratio, quarter))
+                {
+                    return false;
+                }
+                isLinear = PDFAbstractColorSpace::isColorEqual(quarter.color, PDFAbstractColorSpace::mixColors(left.color, right.color, ratio), settings.tolerance);
+            }
+        }
+
+        if (isLinear)
+        {
+            samples.push_back(right);
+            pendingSamples.pop_back();
+
+            if (samples.size() > MAX_GRADIENT_STOPS)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            pendingSamples.push_back(middle);
+        }
+    }
+
+    stops.clear();
+    stops.reserve(int(samples.size()));
+    for (const Sample& item : samples)
+    {
+        const PDFReal position = qBound(0.0, interpolate(item.s, 0.0, 1.0, positionStart, positionEnd), 1.0);
+        stops.emplace_back(position, m_colorSpace->getColor(item.color, cms, intent, reporter, true));
+    }
+
+    if (positionStart > positionEnd)
+    {
+        std::reverse(stops.begin(), stops.end());
+    }
+
+    return true;
+}
+
 ShadingType PDFAxialShading::getShadingType() const
 {
     return ShadingType::Axial;
@@ -124,6 +298,7 @@ PDFPatternPtr PDFPattern::createPattern(const PDFDictionary* colorSpaceDictionar
                 }
 
                 PDFTilingPattern* pattern = new PDFTilingPattern();
+                pattern->m_patternReference = object.isReference() ? object.getReference() : PDFObjectReference();
                 pattern->m_boundingBox = boundingBox;
                 pattern->m_matrix = matrix;
                 pattern->m_paintType = paintType;
@@ -465,6 +640,7 @@ PDFPatternPtr PDFPattern::createShadingPattern(const PDFDictionary* colorSpaceDi
             type4567Shading->m_colorComponentCount = !functions.empty() ? 1 : colorSpace->getColorComponentCount();
             type4567Shading->m_functions = qMove(functions);
             type4567Shading->m_data = document->getDecodedStream(stream);
+            type4567Shading->m_shadingReference = shadingObject.isReference() ? shadingObject.getReference() : PDFObjectReference();
 
             switch (shadingType)
             {
@@ -1314,6 +1490,96 @@ PDFShadingSampler* PDFAxialShading::createSampler(QTransform userSpaceToDeviceSp
     return new PDFAxialShadingSampler(this, userSpaceToDeviceSpaceMatrix);
 }
 
+PDFShadingGradient PDFAxialShading::createGradient(const PDFMeshQualitySettings& settings,
+                                                   const PDFCMS* cms,
+                                                   RenderingIntent intent,
+                                                   PDFRenderErrorReporter* reporter) const
+{
+    PDFShadingGradient gradient;
+
+    if (m_backgroundColor.isValid() && (!m_extendStart || !m_extendEnd))
+    {
+        // Background is painted outside of the shading, we use mesh in this case
+        return gradient;
+    }
+
+    // We use the same geometry as the mesh, i.e. shading axis in device space
+    // and lines of constant color perpendicular to it.
+    QTransform patternSpaceToDeviceSpaceMatrix = getPatternSpaceToDeviceSpaceMatrix(settings);
+    QPointF p1 = patternSpaceToDeviceSpaceMatrix.map(m_startPoint);
+    QPointF p2 = patternSpaceToDeviceSpaceMatrix.map(m_endPoint);
+
+    const PDFReal length = QLineF(p1, p2).length();
+    if (isZero(length))
+    {
+        return gradient;
+    }
+
+    QGradientStops stops;
+    if (!createGradientStops(settings, cms, intent, reporter, 0.0, 1.0, length, stops))
+    {
+        return gradient;
+    }
+
+    QLinearGradient linearGradient(p1, p2);
+    linearGradient.setSpread(QGradient::PadSpread);
+    linearGradient.setStops(stops);
+    gradient.setGradient(linearGradient);
+
+    QPainterPath areaPath;
+    if (!m_extendStart || !m_extendEnd)
+    {
+        // Shading is painted only in the strip between lines perpendicular to the
+        // shading axis. Strip must be large enough to cover the whole meshing area.
+        QPolygonF boundingPolygon(settings.deviceSpaceMeshingArea);
+        boundingPolygon << p1 << p2;
+        const QRectF boundingRect = boundingPolygon.boundingRect();
+        const PDFReal size = QLineF(boundingRect.topLeft(), boundingRect.bottomRight()).length() + 1.0;
+
+        const QPointF axis = (p2 - p1) / length;
+        const QPointF normal(-axis.y(), axis.x());
+        const QPointF start = m_extendStart ? p1 - axis * size : p1;
+        const QPointF end = m_extendEnd ? p2 + axis * size : p2;
+
+        QPolygonF strip;
+        strip << start + normal * size << end + normal * size << end - normal * size << start - normal * size;
+        areaPath.addPolygon(strip);
+        areaPath.closeSubpath();
+    }
+
+    if (m_boundingBox.isValid())
+    {
+        QPainterPath boundingPath;
+        boundingPath.addPolygon(patternSpaceToDeviceSpaceMatrix.map(m_boundingBox));
+        areaPath = areaPath.isEmpty() ? boundingPath : areaPath.intersected(boundingPath);
+    }
+
+    gradient.setAreaPath(areaPath);
+    return gradient;
+}
+
+QBrush PDFShadingGradient::createBrush(PDFReal alpha) const
+{
+    QGradient gradient = m_gradient;
+    QGradientStops stops = gradient.stops();
+    for (QGradientStop& stop : stops)
+    {
+        stop.second.setAlphaF(alpha);
+    }
+    gradient.setStops(stops);
+    return QBrush(gradient);
+}
+
+QPainterPath PDFShadingGradient::getPaintedPath(const QPainterPath& devicePath) const
+{
+    if (m_areaPath.isEmpty())
+    {
+        return devicePath;
+    }
+
+    return devicePath.intersected(m_areaPath);
+}
+
 void PDFMesh::paint(QPainter* painter, PDFReal alpha) const
 {
     if (m_triangles.empty())
@@ -1421,6 +1687,266 @@ void PDFMesh::convertColors(const PDFColorConvertor& colorConvertor)
     m_backgroundColor = colorConvertor.convert(m_backgroundColor, true, false);
 }
 
+void PDFMeshCache::setDocument(const PDFModifiedDocument& document)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_document != document)
+    {
+        m_document = document;
+
+        // Shadings can be changed only, if page contents has been changed
+        if (document.hasReset() || document.hasPageContentsChanged())
+        {
+            m_meshes.clear();
+            m_memoryConsumption = 0;
+        }
+    }
+}
+
+PDFMesh PDFMeshCache::getMesh(const PDFShadingPattern* shadingPattern,
+                              const PDFMeshQualitySettings& settings,
+                              const PDFCMS* cms,
+                              RenderingIntent intent,
+                              PDFRenderErrorReporter* reporter,
+                              const PDFOperationControl* operationControl) const
+{
+    // Cached mesh is reused, if its resolution (after transformation to the
+    // device space) differs at most by this factor from the required resolution.
+    constexpr PDFReal MESH_RESOLUTION_HYSTERESIS = 2.0;
+    constexpr PDFReal SIMILARITY_TOLERANCE = 0.0001;
+
+    const PDFType4567Shading* meshShading = dynamic_cast<const PDFType4567Shading*>(shadingPattern);
+    const PDFObjectReference reference = meshShading ? meshShading->getShadingReference() : PDFObjectReference();
+    if (!reference.isValid())
+    {
+        // Only mesh based shadings are cached. Meshes of other shadings
+        // depend on the meshing area and they are fast to create.
+        return shadingPattern->createMesh(settings, cms, intent, reporter, operationControl);
+    }
+
+    // Returns scale of the transformation, if it is a similarity transformation
+    // (uniform scale, rotation and translation), otherwise zero is returned.
+    auto getSimilarityScale = [](const QTransform& transform) -> PDFReal
+    {
+        if (!transform.isAffine())
+        {
+            return 0.0;
+        }
+
+        const PDFReal scale = qSqrt(qAbs(transform.determinant()));
+        const PDFReal squaredScale = scale * scale;
+        const PDFReal tolerance = squaredScale * SIMILARITY_TOLERANCE;
+        if (isZero(scale) ||
+            qAbs(transform.m11() * transform.m11() + transform.m12() * transform.m12() - squaredScale) > tolerance ||
+            qAbs(transform.m21() * transform.m21() + transform.m22() * transform.m22() - squaredScale) > tolerance ||
+            qAbs(transform.m11() * transform.m21() + transform.m12() * transform.m22()) > tolerance)
+        {
+            return 0.0;
+        }
+
+        return scale;
+    };
+
+    // Returns transformation from the cached mesh device space to the current
+    // device space and its scale, if cached mesh has the same matrix class
+    // (transformations differ only by similarity transformation).
+    const QTransform patternSpaceToDeviceSpaceMatrix = shadingPattern->getPatternSpaceToDeviceSpaceMatrix(settings);
+    auto getCachedMeshTransform = [&](const CachedMesh& cachedMesh, QTransform& transform) -> PDFReal
+    {
+        if (cachedMesh.intent != intent || cachedMesh.tolerance != settings.tolerance)
+        {
+            return 0.0;
+        }
+
+        bool isInvertible = false;
+        transform = cachedMesh.patternSpaceToDeviceSpaceMatrix.inverted(&isInvertible) * patternSpaceToDeviceSpaceMatrix;
+        return isInvertible ? getSimilarityScale(transform) : 0.0;
+    };
+
+    auto setBackground = [shadingPattern, &settings](PDFMesh& mesh)
+    {
+        if (shadingPattern->getBackgroundColor().isValid())
+        {
+            QPainterPath path;
+            path.addRect(settings.deviceSpaceMeshingArea);
+            mesh.setBackgroundPath(path);
+            mesh.setBackgroundColor(shadingPattern->getBackgroundColor());
+        }
+    };
+
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_meshes.find(reference);
+        if (it != m_meshes.cend())
+        {
+            for (const CachedMesh& cachedMesh : it->second)
+            {
+                QTransform transform;
+                const PDFReal scale = getCachedMeshTransform(cachedMesh, transform);
+                if (isZero(scale))
+                {
+                    continue;
+                }
+
+                const PDFReal resolutionRatio = cachedMesh.minimalMeshResolution * scale / settings.minimalMeshResolution;
+                if (resolutionRatio * MESH_RESOLUTION_HYSTERESIS >= 1.0 && resolutionRatio <= MESH_RESOLUTION_HYSTERESIS)
+                {
+                    PDFMesh mesh = createMesh(cachedMesh, transform);
+                    setBackground(mesh);
+                    return mesh;
+                }
+            }
+        }
+    }
+
+    PDFMesh mesh = shadingPattern->createMesh(settings, cms, intent, reporter, operationControl);
+
+    if (!operationControl || !operationControl->isOperationCancelled())
+    {
+        CachedMesh cachedMesh = createCachedMesh(mesh);
+        cachedMesh.intent = intent;
+        cachedMesh.tolerance = settings.tolerance;
+        cachedMesh.minimalMeshResolution = settings.minimalMeshResolution;
+        cachedMesh.patternSpaceToDeviceSpaceMatrix = patternSpaceToDeviceSpaceMatrix;
+        const qint64 memoryConsumption = cachedMesh.getMemoryConsumptionEstimate();
+
+        QMutexLocker lock(&m_mutex);
+        std::vector<CachedMesh>& cachedMeshes = m_meshes[reference];
+
+        // Replace meshes of the same matrix class, which were created
+        // for another resolution, so we do not keep meshes for each zoom level.
+        auto isReplaced = [&](const CachedMesh& item)
+        {
+            QTransform transform;
+            return !isZero(getCachedMeshTransform(item, transform));
+        };
+        for (const CachedMesh& item : cachedMeshes)
+        {
+            if (isReplaced(item))
+            {
+                m_memoryConsumption -= item.getMemoryConsumptionEstimate();
+            }
+        }
+        cachedMeshes.erase(std::remove_if(cachedMeshes.begin(), cachedMeshes.end(), isReplaced), cachedMeshes.end());
+
+        if (m_memoryConsumption + memoryConsumption > m_cacheLimit)
+        {
+            // We have exceeded the cache limit. Clear the cache.
+            m_meshes.clear();
+            m_memoryConsumption = 0;
+        }
+
+        if (memoryConsumption <= m_cacheLimit)
+        {
+            m_meshes[reference].push_back(qMove(cachedMesh));
+            m_memoryConsumption += memoryConsumption;
+        }
+    }
+
+    return mesh;
+}
+
+void PDFMeshCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_meshes.clear();
+    m_memoryConsumption = 0;
+}
+
+void PDFMeshCache::setCacheLimit(qint64 cacheLimit)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cacheLimit = cacheLimit;
+
+    if (m_memoryConsumption > m_cacheLimit)
+    {
+        m_meshes.clear();
+        m_memoryConsumption = 0;
+    }
+}
+
+qint64 PDFMeshCache::getMemoryConsumptionEstimate() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_memoryConsumption;
+}
+
+PDFMeshCache::CachedMesh PDFMeshCache::createCachedMesh(const PDFMesh& mesh)
+{
+    CachedMesh cachedMesh;
+
+    const std::vector<QPointF>& vertices = mesh.getVertices();
+    if (!vertices.empty())
+    {
+        PDFReal xMin = vertices.front().x();
+        PDFReal xMax = xMin;
+        PDFReal yMin = vertices.front().y();
+        PDFReal yMax = yMin;
+
+        for (const QPointF& vertex : vertices)
+        {
+            xMin = qMin(xMin, vertex.x());
+            xMax = qMax(xMax, vertex.x());
+            yMin = qMin(yMin, vertex.y());
+            yMax = qMax(yMax, vertex.y());
+        }
+
+        cachedMesh.vertexBoundingRect = QRectF(xMin, yMin, xMax - xMin, yMax - yMin);
+
+        const PDFReal xFactor = !isZero(xMax - xMin) ? 65535.0 / (xMax - xMin) : 0.0;
+        const PDFReal yFactor = !isZero(yMax - yMin) ? 65535.0 / (yMax - yMin) : 0.0;
+
+        cachedMesh.vertices.reserve(vertices.size() * 2);
+        for (const QPointF& vertex : vertices)
+        {
+            cachedMesh.vertices.push_back(static_cast<uint16_t>(qBound(0, qRound((vertex.x() - xMin) * xFactor), 65535)));
+            cachedMesh.vertices.push_back(static_cast<uint16_t>(qBound(0, qRound((vertex.y() - yMin) * yFactor), 65535)));
+        }
+    }
+
+    cachedMesh.triangles = mesh.getTriangles();
+    cachedMesh.triangles.shrink_to_fit();
+    cachedMesh.boundingPath = mesh.getBoundingPath();
+    return cachedMesh;
+}
+
+PDFMesh PDFMeshCache::createMesh(const CachedMesh& cachedMesh, const QTransform& transform)
+{
+    PDFMesh mesh;
+
+    const QRectF& boundingRect = cachedMesh.vertexBoundingRect;
+    const PDFReal xFactor = boundingRect.width() / 65535.0;
+    const PDFReal yFactor = boundingRect.height() / 65535.0;
+
+    std::vector<QPointF> vertices;
+    vertices.reserve(cachedMesh.vertices.size() / 2);
+    for (size_t i = 0, count = cachedMesh.vertices.size(); i + 1 < count; i += 2)
+    {
+        const QPointF vertex(boundingRect.left() + cachedMesh.vertices[i] * xFactor, boundingRect.top() + cachedMesh.vertices[i + 1] * yFactor);
+        vertices.push_back(transform.map(vertex));
+    }
+
+    std::vector<PDFMesh::Triangle> triangles = cachedMesh.triangles;
+    mesh.setVertices(qMove(vertices));
+    mesh.setTriangles(qMove(triangles));
+
+    if (!cachedMesh.boundingPath.isEmpty())
+    {
+        mesh.setBoundingPath(transform.map(cachedMesh.boundingPath));
+    }
+
+    return mesh;
+}
+
+qint64 PDFMeshCache::CachedMesh::getMemoryConsumptionEstimate() const
+{
+    qint64 memoryConsumption = sizeof(*this);
+    memoryConsumption += sizeof(uint16_t) * vertices.capacity();
+    memoryConsumption += sizeof(PDFMesh::Triangle) * triangles.capacity();
+    memoryConsumption += sizeof(QPainterPath::Element) * boundingPath.capacity();
+    return memoryConsumption;
+}
+
 void PDFMeshQualitySettings::initResolution()
 {
     Q_ASSERT(deviceSpaceMeshingArea.isValid());
@@ -2130,6 +2656,134 @@ private:
     std::vector<Triangle> m_triangles;
 };
 
+PDFShadingGradient PDFRadialShading::createGradient(const PDFMeshQualitySettings& settings,
+                                                    const PDFCMS* cms,
+                                                    RenderingIntent intent,
+                                                    PDFRenderErrorReporter* reporter) const
+{
+    PDFShadingGradient gradient;
+
+    // Circles are mapped onto circles only by similarity transformation
+    // (translation, rotation and uniform scale). Native radial gradient
+    // can't represent ellipses.
+    QTransform patternSpaceToDeviceSpaceMatrix = getPatternSpaceToDeviceSpaceMatrix(settings);
+    const QPointF xAxis = patternSpaceToDeviceSpaceMatrix.map(QPointF(1, 0)) - patternSpaceToDeviceSpaceMatrix.map(QPointF(0, 0));
+    const QPointF yAxis = patternSpaceToDeviceSpaceMatrix.map(QPointF(0, 1)) - patternSpaceToDeviceSpaceMatrix.map(QPointF(0, 0));
+    const PDFReal scale = qSqrt(QPointF::dotProduct(xAxis, xAxis));
+    const PDFReal scaleY = qSqrt(QPointF::dotProduct(yAxis, yAxis));
+    constexpr PDFReal SIMILARITY_TOLERANCE = 0.0001;
+
+    if (isZero(scale) ||
+        qAbs(scale - scaleY) > scale * SIMILARITY_TOLERANCE ||
+        qAbs(QPointF::dotProduct(xAxis, yAxis)) > scale * scaleY * SIMILARITY_TOLERANCE)
+    {
+        return gradient;
+    }
+
+    const QPointF c0 = patternSpaceToDeviceSpaceMatrix.map(m_startPoint);
+    const QPointF c1 = patternSpaceToDeviceSpaceMatrix.map(m_endPoint);
+    const PDFReal r0 = m_r0 * scale;
+    const PDFReal r1 = m_r1 * scale;
+    const PDFReal centerDistance = QLineF(m_startPoint, m_endPoint).length();
+
+    // Native radial gradient (with zero focal radius) can represent these cases:
+    //  1) concentric circles with different radii
+    //  2) starting circle is a point lying inside the ending circle
+    //  3) ending circle is a point lying inside the starting circle
+    // In all cases, circles are nested, so we have the outer circle, which
+    // is extended outwards, and the inner circle, which is extended inwards.
+    // Focal point must lie strictly inside the circle, otherwise paint
+    // engines move it inside (and the result differs from the shading).
+    constexpr PDFReal FOCAL_POINT_LIMIT = 0.99;
+
+    QPointF center;
+    QPointF focalPoint;
+    PDFReal innerRadius = 0.0;
+    PDFReal outerRadius = 0.0;
+    bool isInnerExtended = false;
+    bool isOuterExtended = false;
+
+    if (isZero(centerDistance) && !isZero(m_r0 - m_r1))
+    {
+        center = c0;
+        focalPoint = c0;
+        innerRadius = qMin(r0, r1);
+        outerRadius = qMax(r0, r1);
+        isInnerExtended = (r0 < r1) ? m_extendStart : m_extendEnd;
+        isOuterExtended = (r0 < r1) ? m_extendEnd : m_extendStart;
+    }
+    else if (isZero(m_r0) && centerDistance < m_r1 * FOCAL_POINT_LIMIT)
+    {
+        center = c1;
+        focalPoint = c0;
+        outerRadius = r1;
+        isOuterExtended = m_extendEnd;
+    }
+    else if (isZero(m_r1) && centerDistance < m_r0 * FOCAL_POINT_LIMIT)
+    {
+        center = c0;
+        focalPoint = c1;
+        outerRadius = r0;
+        isOuterExtended = m_extendStart;
+    }
+    else
+    {
+        return gradient;
+    }
+
+    if (isZero(outerRadius))
+    {
+        return gradient;
+    }
+
+    const bool isInnerCovered = isInnerExtended || isZero(innerRadius);
+    if (m_backgroundColor.isValid() && (!isInnerCovered || !isOuterExtended))
+    {
+        // Background is painted outside of the shading, we use mesh in this case
+        return gradient;
+    }
+
+    QGradientStops stops;
+    if (!createGradientStops(settings, cms, intent, reporter, r0 / outerRadius, r1 / outerRadius, qAbs(r1 - r0), stops))
+    {
+        return gradient;
+    }
+
+    QRadialGradient radialGradient(center, outerRadius, focalPoint);
+    radialGradient.setSpread(QGradient::PadSpread);
+    radialGradient.setStops(stops);
+    gradient.setGradient(radialGradient);
+
+    QPainterPath areaPath;
+    if (!isOuterExtended)
+    {
+        areaPath.addEllipse(center, outerRadius, outerRadius);
+    }
+    else if (!isInnerCovered)
+    {
+        QPolygonF boundingPolygon(settings.deviceSpaceMeshingArea);
+        boundingPolygon << center;
+        areaPath.addRect(boundingPolygon.boundingRect().adjusted(-outerRadius, -outerRadius, outerRadius, outerRadius));
+    }
+
+    if (!isInnerCovered)
+    {
+        QPainterPath innerCirclePath;
+        innerCirclePath.addEllipse(center, innerRadius, innerRadius);
+        areaPath = areaPath.subtracted(innerCirclePath);
+    }
+
+    if (m_boundingBox.isValid())
+    {
+        QPainterPath boundingPath;
+        boundingPath.addPolygon(patternSpaceToDeviceSpaceMatrix.map(m_boundingBox));
+        areaPath = areaPath.isEmpty() ? boundingPath : areaPath.intersected(boundingPath);
+    }
+
+    gradient.setAreaPath(areaPath);
+    return gradient;
+}
+
 ShadingType PDFFreeFormGouradTriangleShading::getShadingType() const
 {
     return ShadingType::FreeFormGouradTriangle;
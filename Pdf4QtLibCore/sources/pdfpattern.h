@@ -24,6 +24,8 @@
 #include "pdfmeshqualitysettings.h"
 #include "pdfcolorconvertor.h"
 
+#include <QBrush>
+#include <QMutex>
 #include <QTransform>
 #include <QPainterPath>
 
@@ -34,6 +36,8 @@ namespace pdf
 class PDFPattern;
 class PDFTilingPattern;
 class PDFShadingPattern;
+class PDFModifiedDocument;
+class PDFOperationControl;
 
 using PDFPatternPtr = std::shared_ptr<PDFPattern>;
 
@@ -125,6 +129,12 @@ public:
     /// \param index Index of the vertex
     const QPointF& getVertex(size_t index) const { return m_vertices[index]; }
 
+    /// Returns vertex array of the mesh
+    const std::vector<QPointF>& getVertices() const { return m_vertices; }
+
+    /// Returns triangle array of the mesh
+    const std::vector<Triangle>& getTriangles() const { return m_triangles; }
+
     /// Returns triangle center. Triangles vertice indices must be valid.
     /// \param triangle Triangle
     QPointF getTriangleCenter(const Triangle& triangle) const;
@@ -156,8 +166,122 @@ private:
     QColor m_backgroundColor;
 };
 
+/// Cache of meshes of the mesh based shadings (type 4-7 shadings). Meshing of these
+/// shadings can be very slow (especially for tensor product patch meshes), so meshes
+/// are reused, when page is compiled again (for example, when zoom is changed). Mesh
+/// is reused, if device space transformation differs only by uniform scale/rotation
+/// and translation from the transformation of the cached mesh, and resolution of the
+/// transformed mesh is within the factor of the resolution of the current settings.
+/// Meshes are stored in the compact format, vertices are quantized to 16-bit integers
+/// relative to the mesh bounding rectangle. Cache is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFMeshCache
+{
+public:
+    inline explicit PDFMeshCache(qint64 cacheLimit) :
+        m_cacheLimit(cacheLimit),
+        m_memoryConsumption(0)
+    {
+
+    }
+
+    /// Sets the document to the cache. Whole cache is cleared,
+    /// if it is needed.
+    /// \param document Document to be setted
+    void setDocument(const PDFModifiedDocument& document);
+
+    /// Returns mesh of the shading in device space. If suitable mesh exists
+    /// in the cache, it is transformed to the device space and returned,
+    /// otherwise new mesh is created and stored in the cache. If mesh can't
+    /// be created, exception is thrown.
+    /// \param shadingPattern Shading pattern
+    /// \param settings Meshing settings
+    /// \param cms Color management system
+    /// \param intent Rendering intent
+    /// \param reporter Error reporter
+    /// \param operationControl Operation control
+    PDFMesh getMesh(const PDFShadingPattern* shadingPattern,
+                    const PDFMeshQualitySettings& settings,
+                    const PDFCMS* cms,
+                    RenderingIntent intent,
+                    PDFRenderErrorReporter* reporter,
+                    const PDFOperationControl* operationControl) const;
+
+    /// Clears the cache (for example, when color management system is changed)
+    void clear();
+
+    /// Sets cache limit (in bytes)
+    void setCacheLimit(qint64 cacheLimit);
+
+    /// Returns estimate of number of bytes, which cached meshes occupy in memory
+    qint64 getMemoryConsumptionEstimate() const;
+
+private:
+    struct CachedMesh
+    {
+        RenderingIntent intent = RenderingIntent::Unknown;
+        PDFReal tolerance = 0.0;
+        PDFReal minimalMeshResolution = 0.0;
+        QTransform patternSpaceToDeviceSpaceMatrix;
+        QRectF vertexBoundingRect;
+        std::vector<uint16_t> vertices; ///< Quantized vertices, x and y coordinates interleaved
+        std::vector<PDFMesh::Triangle> triangles;
+        QPainterPath boundingPath;
+
+        qint64 getMemoryConsumptionEstimate() const;
+    };
+
+    /// Creates compact cached mesh from the mesh
+    static CachedMesh createCachedMesh(const PDFMesh& mesh);
+
+    /// Creates mesh from the compact cached mesh, vertices and bounding
+    /// path are transformed using the \p transform.
+    static PDFMesh createMesh(const CachedMesh& cachedMesh, const QTransform& transform);
+
+    qint64 m_cacheLimit;
+    mutable qint64 m_memoryConsumption;
+    mutable QMutex m_mutex;
+    const PDFDocument* m_document = nullptr;
+    mutable std::map<PDFObjectReference, std::vector<CachedMesh>> m_meshes;
+};
+
+/// Native gradient (linear or radial), which approximates axial or radial shading
+/// within the color tolerance. Gradient is defined in device space coordinates, so
+/// it must be painted with identity world transformation matrix. Painting using
+/// the gradient is much faster than painting of the mesh, and it is also supported
+/// directly by the paint engines (Qt raster engine, Blend2D).
+class PDFShadingGradient
+{
+public:
+    explicit PDFShadingGradient() = default;
+
+    /// Returns true, if gradient is valid (shading can be painted using the gradient)
+    bool isValid() const { return m_gradient.type() != QGradient::NoGradient; }
+
+    const QGradient& getGradient() const { return m_gradient; }
+    void setGradient(const QGradient& gradient) { m_gradient = gradient; }
+
+    /// Returns area in device space, in which shading is painted. If area
+    /// is empty, then shading is painted everywhere.
+    const QPainterPath& getAreaPath() const { return m_areaPath; }
+    void setAreaPath(const QPainterPath& areaPath) { m_areaPath = areaPath; }
+
+    /// Creates brush from the gradient, opacity of the gradient stops
+    /// is set to the \p alpha.
+    /// \param alpha Opacity
+    QBrush createBrush(PDFReal alpha) const;
+
+    /// Returns path (in device space), which should be filled by gradient brush,
+    /// i.e. intersection of the \p devicePath with the area path.
+    /// \param devicePath Filled path in device space
+    QPainterPath getPaintedPath(const QPainterPath& devicePath) const;
+
+private:
+    QGradient m_gradient;
+    QPainterPath m_areaPath;
+};
+
 /// Represents tiling/shading pattern
-class PDFPattern
+class PDF4QTLIBCORESHARED_EXPORT PDFPattern
 {
 public:
     explicit PDFPattern() = default;
@@ -255,9 +379,13 @@ public:
     const PDFObject& getResources() const { return m_resources; }
     const QByteArray& getContent() const { return m_content; }
 
+    /// Returns reference to the pattern object (invalid, if pattern is a direct object)
+    PDFObjectReference getPatternReference() const { return m_patternReference; }
+
 private:
     friend class PDFPattern;
 
+    PDFObjectReference m_patternReference;
     PaintType m_paintType = PaintType::Colored;
     TilingType m_tilingType = TilingType::ConstantSpacing;
     PDFReal m_xStep = 0.0;
@@ -318,6 +446,19 @@ public:
                                PDFRenderErrorReporter* reporter,
                                const PDFOperationControl* operationControl) const = 0;
 
+    /// Creates native gradient, which approximates the shading within the color
+    /// tolerance of the settings. Gradient is created in device space coordinate system.
+    /// If shading can't be represented by a gradient, then invalid gradient is returned
+    /// and shading should be painted using the mesh.
+    /// \param settings Meshing settings
+    /// \param cms Color management system
+    /// \param intent Rendering intent
+    /// \param reporter Error reporter
+    virtual PDFShadingGradient createGradient(const PDFMeshQualitySettings& settings,
+                                              const PDFCMS* cms,
+                                              RenderingIntent intent,
+                                              PDFRenderErrorReporter* reporter) const;
+
     /// Returns patterns graphic state. This state must be applied before
     /// the shading pattern is painted to the target device.
     const PDFObject& getPatternGraphicState() const { return m_patternGraphicState; }
@@ -376,6 +517,34 @@ public:
 protected:
     friend class PDFPattern;
 
+    /// Evaluates color functions for parameter \p t. If functions
+    /// can't be evaluated, then false is returned.
+    /// \param t Parameter of the color functions
+    /// \param color Output color
+    bool getColorForParameter(PDFReal t, PDFColor& color) const;
+
+    /// Creates gradient stops approximating color functions on the whole domain
+    /// within the color tolerance. Domain start is mapped onto gradient position
+    /// \p positionStart, domain end onto gradient position \p positionEnd.
+    /// If color functions can't be approximated by reasonable count of stops,
+    /// then false is returned.
+    /// \param settings Meshing settings
+    /// \param cms Color management system
+    /// \param intent Rendering intent
+    /// \param reporter Error reporter
+    /// \param positionStart Gradient position of the domain start
+    /// \param positionEnd Gradient position of the domain end
+    /// \param deviceLength Length of the domain in device space pixels
+    /// \param stops Output gradient stops
+    bool createGradientStops(const PDFMeshQualitySettings& settings,
+                             const PDFCMS* cms,
+                             RenderingIntent intent,
+                             PDFRenderErrorReporter* reporter,
+                             PDFReal positionStart,
+                             PDFReal positionEnd,
+                             PDFReal deviceLength,
+                             QGradientStops& stops) const;
+
     std::vector<PDFFunctionPtr> m_functions;
     QPointF m_startPoint;
     QPointF m_endPoint;
@@ -421,6 +590,10 @@ public:
                                RenderingIntent intent,
                                PDFRenderErrorReporter* reporter,
                                const PDFOperationControl* operationControl) const override;
+    virtual PDFShadingGradient createGradient(const PDFMeshQualitySettings& settings,
+                                              const PDFCMS* cms,
+                                              RenderingIntent intent,
+                                              PDFRenderErrorReporter* reporter) const override;
     virtual PDFShadingSampler* createSampler(QTransform userSpaceToDeviceSpaceMatrix) const override;
 
 private:
@@ -438,6 +611,10 @@ public:
                                RenderingIntent intent,
                                PDFRenderErrorReporter* reporter,
                                const PDFOperationControl* operationControl) const override;
+    virtual PDFShadingGradient createGradient(const PDFMeshQualitySettings& settings,
+                                              const PDFCMS* cms,
+                                              RenderingIntent intent,
+                                              PDFRenderErrorReporter* reporter) const override;
     virtual PDFShadingSampler* createSampler(QTransform userSpaceToDeviceSpaceMatrix) const override;
 
     PDFReal getR0() const { return m_r0; }
@@ -458,6 +635,10 @@ public:
     /// Returns color for given color or function parameter
     PDFColor getColor(PDFColor colorOrFunctionParameter) const;
 
+    /// Returns reference to the shading object (if shading is an indirect object),
+    /// otherwise invalid reference is returned.
+    PDFObjectReference getShadingReference() const { return m_shadingReference; }
+
 protected:
     friend class PDFPattern;
 
@@ -482,6 +663,7 @@ protected:
     PDFReal m_ymax = 0.0;
     std::vector<PDFReal> m_limits;
     size_t m_colorComponentCount = 0;
+    PDFObjectReference m_shadingReference;
 
     /// Color functions. This array can be empty. If it is empty,
     /// then colors should be determined directly from color space.
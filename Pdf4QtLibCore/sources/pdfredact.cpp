@@ -107,7 +107,7 @@ PDFDocument PDFRedact::perform(Options options)
 
         QPainter* painter = contentStreamBuilder.begin(newPageReference);
         compiledPage.redact(redactPath, matrix, m_redactFillColor);
-        compiledPage.draw(painter, QRectF(), matrix, PDFRenderer::None, 1.0);
+        compiledPage.draw(painter, QRectF(), matrix, PDFRenderer::None, 1.0, PDFColorConvertor());
         contentStreamBuilder.end(painter);
     }
 
@@ -22,11 +22,19 @@
 #include "pdfprogress.h"
 #include "pdfannotation.h"
 #include "pdfblpainter.h"
+#include "pdfimageconversion.h"
+#include "pdfimageencoder.h"
+#include "pdfconstants.h"
 
 #include <QDir>
 #include <QElapsedTimer>
+#include <QWaitCondition>
 #include <QtMath>
 
+#include <map>
+#include <numeric>
+#include <optional>
+
 #include "pdfdbgheap.h"
 
 namespace pdf
@@ -43,6 +51,9 @@ PDFRenderer::PDFRenderer(const PDFDocument* document,
     m_cms(cms),
     m_optionalContentActivity(optionalContentActivity),
     m_operationControl(nullptr),
+    m_meshCache(nullptr),
+    m_jbig2GlobalsCache(nullptr),
+    m_tilingPatternCache(nullptr),
     m_features(features),
     m_meshQualitySettings(meshQualitySettings)
 {
@@ -153,6 +164,36 @@ void PDFRenderer::setOperationControl(const PDFOperationControl* newOperationCon
     m_operationControl = newOperationControl;
 }
 
+const PDFMeshCache* PDFRenderer::getMeshCache() const
+{
+    return m_meshCache;
+}
+
+void PDFRenderer::setMeshCache(const PDFMeshCache* newMeshCache)
+{
+    m_meshCache = newMeshCache;
+}
+
+const PDFJBIG2GlobalsCache* PDFRenderer::getJBIG2GlobalsCache() const
+{
+    return m_jbig2GlobalsCache;
+}
+
+void PDFRenderer::setJBIG2GlobalsCache(const PDFJBIG2GlobalsCache* newJBIG2GlobalsCache)
+{
+    m_jbig2GlobalsCache = newJBIG2GlobalsCache;
+}
+
+const PDFTilingPatternCache* PDFRenderer::getTilingPatternCache() const
+{
+    return m_tilingPatternCache;
+}
+
+void PDFRenderer::setTilingPatternCache(const PDFTilingPatternCache* newTilingPatternCache)
+{
+    m_tilingPatternCache = newTilingPatternCache;
+}
+
 QList<PDFRenderError> PDFRenderer::render(QPainter* painter, const QRectF& rectangle, size_t pageIndex) const
 {
     const PDFCatalog* catalog = m_document->getCatalog();
@@ -169,6 +210,15 @@ QList<PDFRenderError> PDFRenderer::render(QPainter* painter, const QRectF& recta
 
     PDFPainter processor(painter, m_features, matrix, page, m_document, m_fontCache, m_cms, m_optionalContentActivity, m_meshQualitySettings);
     processor.setOperationControl(m_operationControl);
+    processor.setMeshCache(m_meshCache);
+    processor.setJBIG2GlobalsCache(m_jbig2GlobalsCache);
+
+    if (painter->hasClipping())
+    {
+        // Content outside of the painter's clipping area is not visible
+        processor.setRegionOfInterest(painter->transform().mapRect(painter->clipBoundingRect()));
+    }
+
     return processor.processContents();
 }
 
@@ -186,10 +236,46 @@ QList<PDFRenderError> PDFRenderer::render(QPainter* painter, const QTransform& m
 
     PDFPainter processor(painter, m_features, matrix, page, m_document, m_fontCache, m_cms, m_optionalContentActivity, m_meshQualitySettings);
     processor.setOperationControl(m_operationControl);
+    processor.setMeshCache(m_meshCache);
+    processor.setJBIG2GlobalsCache(m_jbig2GlobalsCache);
+
+    if (painter->hasClipping())
+    {
+        // Content outside of the painter's clipping area is not visible
+        processor.setRegionOfInterest(painter->transform().mapRect(painter->clipBoundingRect()));
+    }
+
     return processor.processContents();
 }
 
 void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex) const
+{
+    compileImpl(precompiledPage, pageIndex, std::nullopt);
+}
+
+void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex, const QRectF& regionOfInterest) const
+{
+    compileImpl(precompiledPage, pageIndex, regionOfInterest);
+}
+
+void PDFRenderer::compileVisibleContent(PDFPrecompiledPage* precompiledPage, size_t pageIndex) const
+{
+    const PDFCatalog* catalog = m_document->getCatalog();
+    const PDFPage* page = pageIndex < catalog->getPageCount() ? catalog->getPage(pageIndex) : nullptr;
+    if (page && m_features.testFlag(ClipToCropBox))
+    {
+        const QRectF cropBox = page->getCropBox();
+        if (cropBox.isValid() && !cropBox.contains(page->getMediaBox()))
+        {
+            compileImpl(precompiledPage, pageIndex, cropBox);
+            return;
+        }
+    }
+
+    compileImpl(precompiledPage, pageIndex, std::nullopt);
+}
+
+void PDFRenderer::compileImpl(PDFPrecompiledPage* precompiledPage, size_t pageIndex, const std::optional<QRectF>& regionOfInterest) const
 {
     const PDFCatalog* catalog = m_document->getCatalog();
     if (pageIndex >= catalog->getPageCount() || !catalog->getPage(pageIndex))
@@ -207,12 +293,19 @@ void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex)
 
     PDFPrecompiledPageGenerator generator(precompiledPage, m_features, page, m_document, m_fontCache, m_cms, m_optionalContentActivity, m_meshQualitySettings);
     generator.setOperationControl(m_operationControl);
-    QList<PDFRenderError> errors = generator.processContents();
+    generator.setMeshCache(m_meshCache);
+    generator.setJBIG2GlobalsCache(m_jbig2GlobalsCache);
+    generator.setTilingPatternCache(m_tilingPatternCache);
+
+    if (regionOfInterest.has_value())
+    {
+        // Precompiled page is generated in page coordinates
+        generator.setRegionOfInterest(*regionOfInterest);
+    }
 
-    PDFColorConvertor colorConvertor = m_cms->getColorConvertor();
-    PDFRenderer::applyFeaturesToColorConvertor(m_features, colorConvertor);
-    precompiledPage->convertColors(colorConvertor);
+    QList<PDFRenderError> errors = generator.processContents();
 
+    // Colors are converted by the color convertor, when page is drawn
     precompiledPage->optimize();
     precompiledPage->finalize(timer.nsecsElapsed(), qMove(errors));
     timer.invalidate();
@@ -244,42 +337,98 @@ QImage PDFRasterizer::render(PDFInteger pageIndex,
                              const PDFCMS* cms,
                              PageRotation extraRotation)
 {
-    QImage image(size, QImage::Format_ARGB32_Premultiplied);
-
     PDFColorConvertor convertor = cms->getColorConvertor();
     PDFRenderer::applyFeaturesToColorConvertor(features, convertor);
     QTransform matrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), size), extraRotation);
 
-    if (m_rendererEngine == RendererEngine::Blend2D_MultiThread ||
-        m_rendererEngine == RendererEngine::Blend2D_SingleThread)
+    // If image is not cleared, then it is already filled with the background
+    auto drawPage = [&](QImage& image, const QTransform& pagePointToDevicePointMatrix, bool isClearedOnBegin)
     {
-        PDFBLPaintDevice blPaintDevice(image, false);
+        if (m_rendererEngine == RendererEngine::Blend2D_MultiThread ||
+            m_rendererEngine == RendererEngine::Blend2D_SingleThread)
+        {
+            // Page is drawn directly by Blend2D, paint engine is used for annotations,
+            // or as a fallback, when page can't be drawn directly.
+            const bool isMultithreaded = m_rendererEngine == RendererEngine::Blend2D_MultiThread;
+            const bool isPageDrawn = PDFBLPageRenderer::draw(image, compiledPage, page->getCropBox(), pagePointToDevicePointMatrix, features, 1.0, convertor, isMultithreaded, isClearedOnBegin);
 
-        QPainter painter(&blPaintDevice);
-        compiledPage->draw(&painter, page->getCropBox(), matrix, features, 1.0);
+            if (!isPageDrawn || annotationManager)
+            {
+                PDFBLPaintDevice blPaintDevice(image, false, !isPageDrawn && isClearedOnBegin);
+                QPainter painter(&blPaintDevice);
 
-        if (annotationManager)
-        {
-            QList<PDFRenderError> errors;
-            PDFTextLayoutGetter textLayoutGetter(nullptr, pageIndex);
-            annotationManager->drawPage(&painter, pageIndex, compiledPage, textLayoutGetter, matrix, convertor, errors);
+                if (!isPageDrawn)
+                {
+                    compiledPage->draw(&painter, page->getCropBox(), pagePointToDevicePointMatrix, features, 1.0, convertor);
+                }
+
+                if (annotationManager)
+                {
+                    QList<PDFRenderError> errors;
+                    PDFTextLayoutGetter textLayoutGetter(nullptr, pageIndex);
+                    annotationManager->drawPage(&painter, pageIndex, compiledPage, textLayoutGetter, pagePointToDevicePointMatrix, convertor, errors);
+                }
+            }
         }
-    }
-    else
-    {
-        // Use standard software rasterizer.
-        image.fill(Qt::white);
+        else
+        {
+            // Use standard software rasterizer.
+            if (isClearedOnBegin)
+            {
+                image.fill(Qt::white);
+            }
+
+            QPainter painter(&image);
+            compiledPage->draw(&painter, page->getCropBox(), pagePointToDevicePointMatrix, features, 1.0, convertor);
 
-        QPainter painter(&image);
-        compiledPage->draw(&painter, page->getCropBox(), matrix, features, 1.0);
+            if (annotationManager)
+            {
+                QList<PDFRenderError> errors;
+                PDFTextLayoutGetter textLayoutGetter(nullptr, pageIndex);
+                annotationManager->drawPage(&painter, pageIndex, compiledPage, textLayoutGetter, pagePointToDevicePointMatrix, convertor, errors);
+            }
+        }
+    };
 
-        if (annotationManager)
+    QImage image;
+    if (features.testFlag(PDFRenderer::ColorAdjust_Bitonal))
+    {
+        // Colors (and images) of the compiled page are already bitonal, so we do not
+        // need to keep full color page image. Page is rasterized by horizontal bands
+        // into small color buffer, and each band is thresholded into packed 1-bit
+        // page image. Gray pixels on the edges of the filled areas are results
+        // of antialiasing, so threshold at the half of the lightness range
+        // corresponds to the half coverage of the pixel. Band image is reused, so
+        // each band is filled with the paper color before it is drawn, otherwise
+        // unpainted pixels would be transparent (thresholded as black) or they
+        // would contain the previous band.
+        constexpr int BITONAL_BAND_PIXEL_COUNT = 4 * 1024 * 1024;
+        constexpr int BITONAL_COVERAGE_THRESHOLD = 128;
+
+        image = QImage(size, QImage::Format_Mono);
+        const QColor paperColor = convertor.convert(compiledPage->getPaperColor(), true, false);
+
+        const int bandHeight = qBound(1, BITONAL_BAND_PIXEL_COUNT / qMax(size.width(), 1), size.height());
+        QImage bandImage(size.width(), bandHeight, QImage::Format_ARGB32_Premultiplied);
+
+        for (int top = 0; top < size.height(); top += bandHeight)
         {
-            QList<PDFRenderError> errors;
-            PDFTextLayoutGetter textLayoutGetter(nullptr, pageIndex);
-            annotationManager->drawPage(&painter, pageIndex, compiledPage, textLayoutGetter, matrix, convertor, errors);
+            const int currentBandHeight = qMin(bandHeight, size.height() - top);
+            if (currentBandHeight != bandImage.height())
+            {
+                bandImage = QImage(size.width(), currentBandHeight, QImage::Format_ARGB32_Premultiplied);
+            }
+
+            bandImage.fill(paperColor);
+            drawPage(bandImage, matrix * QTransform::fromTranslate(0, -top), false);
+            PDFImageConversion::convertToBitonal(bandImage, BITONAL_COVERAGE_THRESHOLD, image, top);
         }
     }
+    else
+    {
+        image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+        drawPage(image, matrix, true);
+    }
 
     // Calculate image DPI
     QSizeF rotatedSizeInMeters = page->getRotatedMediaBoxMM().size() / 1000.0;
@@ -318,6 +467,20 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
                                const PDFRasterizerPool::PageImageSizeGetter& imageSizeGetter,
                                const PDFRasterizerPool::ProcessImageMethod& processImage,
                                PDFProgress* progress)
+{
+    Q_ASSERT(processImage);
+
+    // Processing of the image is done in the encode stage, so it runs in parallel
+    // and rasterizers are not blocked by it.
+    render(pageIndices, imageSizeGetter, processImage, ProcessImageMethod(), PDFRasterizerPipelineSettings(), progress);
+}
+
+void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
+                               const PDFRasterizerPool::PageImageSizeGetter& imageSizeGetter,
+                               const PDFRasterizerPool::ProcessImageMethod& encodeImage,
+                               const PDFRasterizerPool::ProcessImageMethod& writeImage,
+                               const PDFRasterizerPipelineSettings& settings,
+                               PDFProgress* progress)
 {
     if (pageIndices.empty())
     {
@@ -325,7 +488,10 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
     }
 
     Q_ASSERT(imageSizeGetter);
-    Q_ASSERT(processImage);
+
+    const int compileThreadCount = settings.compileThreadCount > 0 ? settings.compileThreadCount : PDFExecutionPolicy::getMaxThreadCount(PDFExecutionPolicy::Scope::Page);
+    const int encodeThreadCount = settings.encodeThreadCount > 0 ? settings.encodeThreadCount : getDefaultRasterizerCount();
+    const size_t maxPagesInFlight = settings.maxPagesInFlight > 0 ? settings.maxPagesInFlight : 2 * (m_rasterizerCount + encodeThreadCount);
 
     QElapsedTimer timer;
     timer.start();
@@ -339,47 +505,119 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
         info.text = PDFTranslationContext::tr("Rendering document into images.");
         progress->start(pageIndices.size(), qMove(info));
     }
-    auto processPage = [this, progress, &imageSizeGetter, &processImage](const PDFInteger pageIndex)
+
+    // Pages are identified by their position in the page indices array,
+    // because write stage must process them in this order. Finished pages
+    // are held in the map until all previous pages are written. Empty
+    // value means that page was not rendered at all.
+    QMutex mutex;
+    QWaitCondition pageWrittenCondition;
+    std::map<size_t, std::optional<PDFRenderedPageImage>> finishedPages;
+    size_t pagesWritten = 0;
+    bool isWriting = false;
+
+    // We can const-cast here, because we do not modify the document in annotation manager.
+    // Annotations are just rendered to the target picture.
+    PDFModifiedDocument modifiedDocument(const_cast<PDFDocument*>(m_document), const_cast<PDFOptionalContentActivity*>(m_optionalContentActivity));
+
+    // Annotation manager is shared by all pages of this render job. Annotations
+    // of the page are parsed, when page is drawn for the first time, and are
+    // cached in the annotation manager, so we do not pay the setup cost
+    // for the whole document on each page.
+    PDFAnnotationManager annotationManager(m_fontCache, m_cmsManager, m_optionalContentActivity, m_meshQualitySettings, m_features, PDFAnnotationManager::Target::Print, nullptr);
+    annotationManager.setDocument(modifiedDocument);
+
+    QSemaphore compileSemaphore(compileThreadCount);
+    QThreadPool encodeThreadPool;
+    encodeThreadPool.setMaxThreadCount(encodeThreadCount);
+
+    auto writePages = [&](size_t position, std::optional<PDFRenderedPageImage> renderedPageImage)
     {
-        const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
+        QMutexLocker lock(&mutex);
+        finishedPages.emplace(position, qMove(renderedPageImage));
 
-        if (!page)
+        // Only one thread writes the pages, the others just store
+        // their finished page, it will be written by the writing thread.
+        if (isWriting)
         {
+            return;
+        }
+        isWriting = true;
+
+        auto it = finishedPages.begin();
+        while (it != finishedPages.end() && it->first == pagesWritten)
+        {
+            std::optional<PDFRenderedPageImage> image = qMove(it->second);
+            finishedPages.erase(it);
+            lock.unlock();
+
+            if (image && writeImage)
+            {
+                writeImage(*image);
+            }
+
             if (progress)
             {
                 progress->step();
             }
+
+            lock.relock();
+            ++pagesWritten;
+            pageWrittenCondition.wakeAll();
+            it = finishedPages.begin();
+        }
+
+        isWriting = false;
+    };
+
+    auto processPage = [&, this](const size_t position)
+    {
+        const PDFInteger pageIndex = pageIndices[position];
+        const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
+
+        if (!page)
+        {
             Q_EMIT renderError(pageIndex, PDFRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Page %1 not found.").arg(pageIndex)));
+            writePages(position, std::nullopt);
             return;
         }
 
-        QElapsedTimer totalPageTimer;
-        totalPageTimer.start();
-
         QElapsedTimer pageTimer;
         pageTimer.start();
 
+        // Back-pressure - wait until previous pages are written, so we do not
+        // hold too many rendered images in the memory. Pages wait for their
+        // position, so page with lowest position can always continue.
+        {
+            QMutexLocker lock(&mutex);
+            while (position >= pagesWritten + maxPagesInFlight)
+            {
+                pageWrittenCondition.wait(&mutex);
+            }
+        }
+
+        qint64 pageQueueTime = pageTimer.restart();
+
+        QElapsedTimer totalPageTimer;
+        totalPageTimer.start();
+
         // Precompile the page
         PDFPrecompiledPage precompiledPage;
         PDFCMSPointer cms = m_cmsManager->getCurrentCMS();
         PDFRenderer renderer(m_document, m_fontCache, cms.data(), m_optionalContentActivity, m_features, m_meshQualitySettings);
-        renderer.compile(&precompiledPage, pageIndex);
+        renderer.setJBIG2GlobalsCache(&m_jbig2GlobalsCache);
 
+        compileSemaphore.acquire();
+        pageTimer.restart();
+        renderer.compileVisibleContent(&precompiledPage, pageIndex);
         qint64 pageCompileTime = pageTimer.restart();
+        compileSemaphore.release();
 
         for (const PDFRenderError& error : precompiledPage.getErrors())
         {
             Q_EMIT renderError(pageIndex, error);
         }
 
-        // We can const-cast here, because we do not modify the document in annotation manager.
-        // Annotations are just rendered to the target picture.
-        PDFModifiedDocument modifiedDocument(const_cast<PDFDocument*>(m_document), const_cast<PDFOptionalContentActivity*>(m_optionalContentActivity));
-
-        // Annotation manager
-        PDFAnnotationManager annotationManager(m_fontCache, m_cmsManager, m_optionalContentActivity, m_meshQualitySettings, m_features, PDFAnnotationManager::Target::Print, nullptr);
-        annotationManager.setDocument(modifiedDocument);
-
         // Render page to image
         pageTimer.restart();
         PDFRasterizer* rasterizer = acquire();
@@ -388,22 +626,41 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
         qint64 pageRenderTime = pageTimer.elapsed();
         release(rasterizer);
 
-        // Now, process the image
         PDFRenderedPageImage renderedPageImage;
         renderedPageImage.pageIndex = pageIndex;
         renderedPageImage.pageImage = qMove(image);
+        renderedPageImage.pageQueueTime = pageQueueTime;
         renderedPageImage.pageCompileTime = pageCompileTime;
         renderedPageImage.pageWaitTime = pageWaitTime;
         renderedPageImage.pageRenderTime = pageRenderTime;
         renderedPageImage.pageTotalTime = totalPageTimer.elapsed();
-        processImage(renderedPageImage);
 
-        if (progress)
+        // Encode the image in the encode thread pool, so this thread
+        // can continue with compilation and rendering of next page.
+        auto encodePage = [&, position, renderedPageImage]() mutable
         {
-            progress->step();
-        }
+            QElapsedTimer encodeTimer;
+            encodeTimer.start();
+
+            if (encodeImage)
+            {
+                encodeImage(renderedPageImage);
+            }
+
+            renderedPageImage.pageEncodeTime = encodeTimer.elapsed();
+            renderedPageImage.pageTotalTime += renderedPageImage.pageEncodeTime;
+            writePages(position, qMove(renderedPageImage));
+        };
+        encodeThreadPool.start(qMove(encodePage));
     };
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.cbegin(), pageIndices.cend(), processPage);
+
+    std::vector<size_t> positions(pageIndices.size(), 0);
+    std::iota(positions.begin(), positions.end(), 0);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, positions.cbegin(), positions.cend(), processPage);
+    encodeThreadPool.waitForDone();
+
+    Q_ASSERT(pagesWritten == pageIndices.size());
+    Q_ASSERT(finishedPages.empty());
 
     if (progress)
     {
@@ -429,6 +686,16 @@ PDFImageWriterSettings::PDFImageWriterSettings()
 {
     m_formats = QImageWriter::supportedImageFormats();
 
+    // Formats of the built-in encoder are always available
+    for (const char* format : { "png", "tiff" })
+    {
+        if (!m_formats.contains(format))
+        {
+            m_formats.append(format);
+        }
+    }
+    std::sort(m_formats.begin(), m_formats.end());
+
     constexpr const char* DEFAULT_FORMAT = "png";
     if (m_formats.count(DEFAULT_FORMAT))
     {
@@ -490,6 +757,20 @@ void PDFImageWriterSettings::selectFormat(const QByteArray& format)
                 m_supportedOptions.insert(imageOption);
             }
         }
+
+        if (PDFImageEncoder::isFormatSupported(format))
+        {
+            // Built-in encoder is used for this format, it supports only compression
+            // (and gamma for PNG). Subtypes of the image writer are not used.
+            m_supportedOptions = { QImageIOHandler::CompressionRatio };
+            if (format == "png")
+            {
+                m_supportedOptions.insert(QImageIOHandler::Gamma);
+            }
+
+            m_subtypes.clear();
+            m_currentSubtype = QByteArray();
+        }
     }
 }
 
@@ -818,8 +1099,12 @@ PDFRasterizerPool::PDFRasterizerPool(const PDFDocument* document,
     m_optionalContentActivity(optionalContentActivity),
     m_features(features),
     m_meshQualitySettings(meshQualitySettings),
+    m_rasterizerCount(rasterizerCount),
+    m_jbig2GlobalsCache(DEFAULT_JBIG2_GLOBALS_CACHE_LIMIT),
     m_semaphore(rasterizerCount)
 {
+    m_jbig2GlobalsCache.setDocument(PDFModifiedDocument(const_cast<PDFDocument*>(document), const_cast<PDFOptionalContentActivity*>(optionalContentActivity)));
+
     m_rasterizers.reserve(rasterizerCount);
     for (int i = 0; i < rasterizerCount; ++i)
     {
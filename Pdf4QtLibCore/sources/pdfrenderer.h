@@ -24,12 +24,15 @@
 #include "pdfmeshqualitysettings.h"
 #include "pdfutils.h"
 #include "pdfcolorconvertor.h"
+#include "pdfjbig2decoder.h"
 
 #include <QMutex>
 #include <QSemaphore>
 #include <QImageWriter>
 #include <QImage>
 
+#include <optional>
+
 class QPainter;
 
 namespace pdf
@@ -37,6 +40,9 @@ namespace pdf
 class PDFCMS;
 class PDFProgress;
 class PDFFontCache;
+class PDFMeshCache;
+class PDFJBIG2GlobalsCache;
+class PDFTilingPatternCache;
 class PDFCMSManager;
 class PDFPrecompiledPage;
 class PDFAnnotationManager;
@@ -81,6 +87,7 @@ public:
     /// Paints desired page onto the painter. Page is painted in the rectangle using best-fit method.
     /// If the page doesn't exist, then error is returned. No exception is thrown. Rendering errors
     /// are reported and returned in the error list. If no error occured, empty list is returned.
+    /// If painter has clipping, content outside of the clipping area is not processed.
     /// \param painter Painter
     /// \param rectangle Paint area for the page
     /// \param pageIndex Index of the page to be painted
@@ -89,6 +96,7 @@ public:
     /// Paints desired page onto the painter. Page is painted using \p matrix, which maps page coordinates
     /// to the device coordinates. If the page doesn't exist, then error is returned. No exception is thrown.
     /// Rendering errors are reported and returned in the error list. If no error occured, empty list is returned.
+    /// If painter has clipping, content outside of the clipping area is not processed.
     QList<PDFRenderError> render(QPainter* painter, const QTransform& matrix, size_t pageIndex) const;
 
     /// Compiles page (i.e. prepares compiled page). \p page should be empty page, onto which
@@ -98,6 +106,23 @@ public:
     /// \param pageIndex Index of page to be compiled
     void compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex) const;
 
+    /// Compiles only part of the page, which intersects the region of interest. Content lying
+    /// completely outside of the region is skipped, so compiled page can't be used to draw
+    /// other parts of the page. It is useful, when only small region of the page is drawn
+    /// (for example, a tile of the zoomed page).
+    /// \param precompiledPage Precompiled page pointer
+    /// \param pageIndex Index of page to be compiled
+    /// \param regionOfInterest Region of interest in page coordinates
+    void compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex, const QRectF& regionOfInterest) const;
+
+    /// Compiles only content, which is visible, when page is drawn with renderer's features.
+    /// If page graphics is clipped to the crop box, then crop box is used as region of interest,
+    /// so content lying completely outside of the crop box is skipped. Compiled page must be
+    /// drawn with clipping to the crop box.
+    /// \param precompiledPage Precompiled page pointer
+    /// \param pageIndex Index of page to be compiled
+    void compileVisibleContent(PDFPrecompiledPage* precompiledPage, size_t pageIndex) const;
+
     /// Creates page point to device point matrix for the given rectangle. It creates transformation
     /// from page's media box to the target rectangle.
     /// \param page Page, for which we want to create matrix
@@ -127,12 +152,27 @@ public:
     const PDFOperationControl* getOperationControl() const;
     void setOperationControl(const PDFOperationControl* newOperationControl);
 
+    const PDFMeshCache* getMeshCache() const;
+    void setMeshCache(const PDFMeshCache* newMeshCache);
+
+    const PDFJBIG2GlobalsCache* getJBIG2GlobalsCache() const;
+    void setJBIG2GlobalsCache(const PDFJBIG2GlobalsCache* newJBIG2GlobalsCache);
+
+    const PDFTilingPatternCache* getTilingPatternCache() const;
+    void setTilingPatternCache(const PDFTilingPatternCache* newTilingPatternCache);
+
 private:
+    /// Compiles page, if region of interest is set, only content intersecting it is compiled
+    void compileImpl(PDFPrecompiledPage* precompiledPage, size_t pageIndex, const std::optional<QRectF>& regionOfInterest) const;
+
     const PDFDocument* m_document;
     const PDFFontCache* m_fontCache;
     const PDFCMS* m_cms;
     const PDFOptionalContentActivity* m_optionalContentActivity;
     const PDFOperationControl* m_operationControl;
+    const PDFMeshCache* m_meshCache;
+    const PDFJBIG2GlobalsCache* m_jbig2GlobalsCache;
+    const PDFTilingPatternCache* m_tilingPatternCache;
     Features m_features;
     PDFMeshQualitySettings m_meshQualitySettings;
 };
@@ -166,6 +206,8 @@ public:
     /// \param annotationManager Annotation manager (can be nullptr)
     /// \param cms Color management system
     /// \param extraRotation Extra page rotation
+    /// \returns Rendered image, if bitonal colors are requested in \p features,
+    ///          then image has format QImage::Format_Mono (packed 1-bit pixels)
     QImage render(PDFInteger pageIndex,
                   const PDFPage* page,
                   const PDFPrecompiledPage* compiledPage,
@@ -182,12 +224,26 @@ private:
 /// Simple structure for storing rendered page images
 struct PDFRenderedPageImage
 {
+    qint64 pageQueueTime = 0;       ///< Time spent waiting for free slot in the pipeline (back-pressure)
     qint64 pageCompileTime = 0;
     qint64 pageWaitTime = 0;
     qint64 pageRenderTime = 0;
+    qint64 pageEncodeTime = 0;
     qint64 pageTotalTime = 0;
     PDFInteger pageIndex;
     QImage pageImage;
+    QByteArray encodedImage;        ///< Encoded image data (filled by encode stage, if it is used)
+};
+
+/// Settings of the rendering pipeline of the rasterizer pool. Pages are processed
+/// in stages compile → rasterize → encode → write. Rasterize stage is limited
+/// by the number of rasterizers in the pool, other stages use budgets from this
+/// structure. Zero value means, that default value is used.
+struct PDFRasterizerPipelineSettings
+{
+    int compileThreadCount = 0;     ///< Maximal number of pages being compiled at once
+    int encodeThreadCount = 0;      ///< Number of threads used to encode rendered images
+    int maxPagesInFlight = 0;       ///< Maximal number of pages between start of compilation and write
 };
 
 /// Pool of page image renderers. It can use predefined number of renderers to
@@ -247,6 +303,25 @@ public:
                 const ProcessImageMethod& processImage,
                 PDFProgress* progress);
 
+    /// Renders pages asynchronously using pipeline compile → rasterize → encode → write.
+    /// Each stage has its own thread budget, so rasterizers are not blocked by slow
+    /// image encoding. Number of pages in the pipeline is bounded, so rendering
+    /// waits, if encoding or writing can't keep up. Encode function is called
+    /// in parallel in arbitrary order, write function is called sequentially
+    /// in the order of \p pageIndices.
+    /// \param pageIndices Page indices for rendered pages
+    /// \param imageSizeGetter Getter, which computes image size from page index
+    /// \param encodeImage Method, which encodes rendered page images (can be empty)
+    /// \param writeImage Method, which writes encoded page images (can be empty)
+    /// \param settings Pipeline settings
+    /// \param progress Progress indicator
+    void render(const std::vector<PDFInteger>& pageIndices,
+                const PageImageSizeGetter& imageSizeGetter,
+                const ProcessImageMethod& encodeImage,
+                const ProcessImageMethod& writeImage,
+                const PDFRasterizerPipelineSettings& settings,
+                PDFProgress* progress);
+
     /// Returns default rasterizer count
     static int getDefaultRasterizerCount();
 
@@ -267,6 +342,11 @@ private:
     const PDFOptionalContentActivity* m_optionalContentActivity;
     PDFRenderer::Features m_features;
     const PDFMeshQualitySettings& m_meshQualitySettings;
+    int m_rasterizerCount;
+
+    /// Decoded JBIG2 global segments are shared by all pages rendered
+    /// by this pool (scanned documents share one JBIG2Globals stream).
+    PDFJBIG2GlobalsCache m_jbig2GlobalsCache;
 
     QSemaphore m_semaphore;
     QMutex m_mutex;
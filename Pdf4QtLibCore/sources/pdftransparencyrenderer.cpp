@@ -26,9 +26,374 @@
 #include <QtMath>
 #include <iterator>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PDF4QT_TRANSPARENCY_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace pdf
 {
 
+static constexpr PDFColorComponent FIXED_POINT_ONE = 65535.0f;
+static constexpr PDFColorComponent FIXED_POINT_COEFFICIENT_ONE = 32768.0f;
+static constexpr PDFColorComponent FIXED_POINT_ALPHA_EPSILON = 1.0e-5f;
+static constexpr int FIXED_POINT_COEFFICIENT_SHIFT = 15;
+
+static inline uint16_t convertToFixedPoint(PDFColorComponent value)
+{
+    return static_cast<uint16_t>(qBound(0.0f, value, 1.0f) * FIXED_POINT_ONE + 0.5f);
+}
+
+static inline PDFColorComponent convertFromFixedPoint(uint16_t value)
+{
+    return value * (1.0f / FIXED_POINT_ONE);
+}
+
+/// Coefficients of the fixed point compositing have 15 fractional bits,
+/// so they can represent values from 0.0 to 2.0 (including 1.0 exactly).
+static inline uint16_t convertToFixedPointCoefficient(PDFColorComponent value)
+{
+    return static_cast<uint16_t>(qBound(0.0f, value * FIXED_POINT_COEFFICIENT_ONE, FIXED_POINT_ONE) + 0.5f);
+}
+
+/// Row buffers used by fixed point blending. Rows are padded,
+/// so SIMD kernels always process whole vectors of values.
+struct PDFFixedPointBlendRow
+{
+    explicit PDFFixedPointBlendRow(size_t size) :
+        sourceShape(size, 0),
+        sourceOpacity(size, 0),
+        softMask(size, 0),
+        initialOpacity(size, 0),
+        shape(size, 0),
+        opacity(size, 0),
+        isDefined(size, 0),
+        k_i_1(size, 0),
+        k_b(size, 0),
+        k_s(size, 0),
+        k_B(size, 0),
+        sourceColor(size, 0),
+        backdropColor(size, 0),
+        blendedColor(size, 0),
+        color(size, 0)
+    {
+
+    }
+
+    std::vector<uint16_t> sourceShape;
+    std::vector<uint16_t> sourceOpacity;
+    std::vector<uint16_t> softMask;
+    std::vector<uint16_t> initialOpacity;
+    std::vector<uint16_t> shape;            ///< f_g_i_1 on input, f_g_i on output
+    std::vector<uint16_t> opacity;          ///< alpha_g_i_1 on input, alpha_g_i on output
+    std::vector<uint16_t> isDefined;        ///< 0xFFFF, if color of the pixel is defined (alpha_g_i is nonzero), 0 otherwise
+    std::vector<uint16_t> k_i_1;            ///< Coefficient of the old color C_i_1
+    std::vector<uint16_t> k_b;              ///< Coefficient of the backdrop color C_b
+    std::vector<uint16_t> k_s;              ///< Coefficient of the source color C_s_i
+    std::vector<uint16_t> k_B;              ///< Coefficient of the blended color B(C_b, C_s_i)
+    std::vector<uint16_t> sourceColor;
+    std::vector<uint16_t> backdropColor;
+    std::vector<uint16_t> blendedColor;
+    std::vector<uint16_t> color;            ///< C_i_1 on input, C_i on output
+};
+
+#ifdef PDF4QT_TRANSPARENCY_USE_SSE2
+static inline __m128 loadFixedPoint4(const uint16_t* values)
+{
+    const __m128i integers = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(values)), _mm_setzero_si128());
+    return _mm_mul_ps(_mm_cvtepi32_ps(integers), _mm_set1_ps(1.0f / FIXED_POINT_ONE));
+}
+
+/// Packs 32-bit integers to unsigned 16-bit integers with saturation (SSE2
+/// has only signed saturation, so values are shifted before and after packing).
+static inline __m128i packFixedPoint(__m128i low, __m128i high)
+{
+    const __m128i offset = _mm_set1_epi32(32768);
+    const __m128i packed = _mm_packs_epi32(_mm_sub_epi32(low, offset), _mm_sub_epi32(high, offset));
+    return _mm_xor_si128(packed, _mm_set1_epi16(static_cast<short>(0x8000)));
+}
+
+static inline void storeFixedPoint4(uint16_t* values, __m128 value, PDFColorComponent scale)
+{
+    const __m128 scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(value, _mm_set1_ps(scale)), _mm_setzero_ps()), _mm_set1_ps(FIXED_POINT_ONE));
+    const __m128i integers = _mm_cvtps_epi32(scaled);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(values), packFixedPoint(integers, integers));
+}
+
+static inline __m128 uniteVectors(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_add_ps(a, b), _mm_mul_ps(a, b));
+}
+
+static inline __m128i loadFixedPoint8(const uint16_t* values)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+}
+
+static inline void storeFixedPoint8(uint16_t* values, __m128i value)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values), value);
+}
+
+/// Returns a * b / 65535, rounded to nearest integer
+static inline __m128i multiplyFixedPoint(__m128i a, __m128i b)
+{
+    const __m128i low = _mm_mullo_epi16(a, b);
+    const __m128i high = _mm_mulhi_epu16(a, b);
+    const __m128i rounding = _mm_set1_epi32(32768);
+    __m128i product0 = _mm_add_epi32(_mm_unpacklo_epi16(low, high), rounding);
+    __m128i product1 = _mm_add_epi32(_mm_unpackhi_epi16(low, high), rounding);
+    product0 = _mm_srli_epi32(_mm_add_epi32(product0, _mm_srli_epi32(product0, 16)), 16);
+    product1 = _mm_srli_epi32(_mm_add_epi32(product1, _mm_srli_epi32(product1, 16)), 16);
+    return packFixedPoint(product0, product1);
+}
+
+static inline __m128i screenFixedPoint(__m128i Cb, __m128i Cs)
+{
+    return _mm_adds_epu16(_mm_sub_epi16(Cb, multiplyFixedPoint(Cb, Cs)), Cs);
+}
+
+static inline __m128i hardLightFixedPoint(__m128i Cb, __m128i Cs)
+{
+    // Source value greater than 0.5 has the highest bit set. Then 2 * Cs - 1.0
+    // is equal to (2 * Cs mod 65536) + 1, otherwise 2 * Cs doesn't overflow.
+    const __m128i isScreen = _mm_srai_epi16(Cs, 15);
+    const __m128i doubled = _mm_slli_epi16(Cs, 1);
+    const __m128i multiplied = multiplyFixedPoint(Cb, doubled);
+    const __m128i screened = screenFixedPoint(Cb, _mm_add_epi16(doubled, _mm_set1_epi16(1)));
+    return _mm_or_si128(_mm_and_si128(isScreen, screened), _mm_andnot_si128(isScreen, multiplied));
+}
+
+/// Adds value * coefficient (coefficient has 15 fractional bits) to 32-bit sums
+static inline void accumulateFixedPoint(__m128i value, __m128i coefficient, __m128i& sum0, __m128i& sum1)
+{
+    const __m128i low = _mm_mullo_epi16(value, coefficient);
+    const __m128i high = _mm_mulhi_epu16(value, coefficient);
+    const __m128i rounding = _mm_set1_epi32(1 << (FIXED_POINT_COEFFICIENT_SHIFT - 1));
+    sum0 = _mm_add_epi32(sum0, _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi16(low, high), rounding), FIXED_POINT_COEFFICIENT_SHIFT));
+    sum1 = _mm_add_epi32(sum1, _mm_srli_epi32(_mm_add_epi32(_mm_unpackhi_epi16(low, high), rounding), FIXED_POINT_COEFFICIENT_SHIFT));
+}
+#endif
+
+/// Calculates compositing coefficients of the row (see 11.4.8 in PDF 2.0 specification),
+/// resulting shape and opacity. Resulting color of the pixel is then calculated as
+/// C_i = k_i_1 * C_i_1 + k_b * C_b + k_s * C_s_i + k_B * B(C_b, C_s_i).
+/// \param row Row buffers
+/// \param count Number of pixels
+/// \param alphaIsShape Both soft mask and constant alpha are shapes and not opacity?
+/// \param constantAlpha Constant alpha, can mean shape or opacity
+/// \param knockoutGroup Is group knockout?
+static void calculateFixedPointCoefficients(PDFFixedPointBlendRow& row,
+                                            size_t count,
+                                            bool alphaIsShape,
+                                            PDFColorComponent constantAlpha,
+                                            bool knockoutGroup)
+{
+    size_t i = 0;
+
+#ifdef PDF4QT_TRANSPARENCY_USE_SSE2
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 alpha = _mm_set1_ps(constantAlpha);
+    const __m128 epsilon = _mm_set1_ps(FIXED_POINT_ALPHA_EPSILON);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 softMaskAlpha = _mm_mul_ps(loadFixedPoint4(row.softMask.data() + i), alpha);
+        const __m128 f_j_i = loadFixedPoint4(row.sourceShape.data() + i);
+        const __m128 alpha_j_i = loadFixedPoint4(row.sourceOpacity.data() + i);
+        const __m128 alpha_g_i_1 = loadFixedPoint4(row.opacity.data() + i);
+        const __m128 alpha_0 = loadFixedPoint4(row.initialOpacity.data() + i);
+        const __m128 f_g_i_1 = loadFixedPoint4(row.shape.data() + i);
+
+        const __m128 f_s_i = alphaIsShape ? _mm_mul_ps(f_j_i, softMaskAlpha) : f_j_i;
+        const __m128 alpha_s_i = _mm_mul_ps(alpha_j_i, softMaskAlpha);
+        const __m128 alpha_g_b = knockoutGroup ? _mm_setzero_ps() : alpha_g_i_1;
+        const __m128 f_s_i_inverted = _mm_sub_ps(one, f_s_i);
+
+        const __m128 f_g_i = uniteVectors(f_g_i_1, f_s_i);
+        const __m128 alpha_g_i = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f_s_i_inverted, alpha_g_i_1), _mm_mul_ps(_mm_sub_ps(f_s_i, alpha_s_i), alpha_g_b)), alpha_s_i);
+        const __m128 alpha_i_1 = uniteVectors(alpha_0, alpha_g_i_1);
+        const __m128 alpha_i = uniteVectors(alpha_0, alpha_g_i);
+        const __m128 alpha_b = knockoutGroup ? alpha_0 : alpha_i_1;
+
+        // If alpha_g_i is zero, color is undefined and we leave it unchanged
+        const __m128 isDefined = _mm_cmpgt_ps(alpha_g_i, epsilon);
+        const __m128 alpha_i_inverted = _mm_and_ps(isDefined, _mm_div_ps(one, _mm_max_ps(alpha_i, epsilon)));
+        const __m128 k_i_1 = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(f_s_i_inverted, alpha_i_1), alpha_i_inverted), _mm_andnot_ps(isDefined, one));
+        const __m128 k_b = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(f_s_i, alpha_s_i), alpha_b), alpha_i_inverted);
+        const __m128 k_s = _mm_mul_ps(_mm_mul_ps(alpha_s_i, _mm_sub_ps(one, alpha_b)), alpha_i_inverted);
+        const __m128 k_B = _mm_mul_ps(_mm_mul_ps(alpha_s_i, alpha_b), alpha_i_inverted);
+
+        storeFixedPoint4(row.shape.data() + i, f_g_i, FIXED_POINT_ONE);
+        storeFixedPoint4(row.opacity.data() + i, alpha_g_i, FIXED_POINT_ONE);
+        storeFixedPoint4(row.isDefined.data() + i, _mm_and_ps(isDefined, one), FIXED_POINT_ONE);
+        storeFixedPoint4(row.k_i_1.data() + i, k_i_1, FIXED_POINT_COEFFICIENT_ONE);
+        storeFixedPoint4(row.k_b.data() + i, k_b, FIXED_POINT_COEFFICIENT_ONE);
+        storeFixedPoint4(row.k_s.data() + i, k_s, FIXED_POINT_COEFFICIENT_ONE);
+        storeFixedPoint4(row.k_B.data() + i, k_B, FIXED_POINT_COEFFICIENT_ONE);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const PDFColorComponent softMaskAlpha = convertFromFixedPoint(row.softMask[i]) * constantAlpha;
+        const PDFColorComponent f_j_i = convertFromFixedPoint(row.sourceShape[i]);
+        const PDFColorComponent alpha_j_i = convertFromFixedPoint(row.sourceOpacity[i]);
+        const PDFColorComponent alpha_g_i_1 = convertFromFixedPoint(row.opacity[i]);
+        const PDFColorComponent alpha_0 = convertFromFixedPoint(row.initialOpacity[i]);
+        const PDFColorComponent f_g_i_1 = convertFromFixedPoint(row.shape[i]);
+
+        const PDFColorComponent f_s_i = alphaIsShape ? f_j_i * softMaskAlpha : f_j_i;
+        const PDFColorComponent alpha_s_i = alpha_j_i * softMaskAlpha;
+        const PDFColorComponent alpha_g_b = knockoutGroup ? 0.0f : alpha_g_i_1;
+
+        const PDFColorComponent f_g_i = PDFBlendFunction::blend_Union(f_g_i_1, f_s_i);
+        const PDFColorComponent alpha_g_i = (1.0f - f_s_i) * alpha_g_i_1 + (f_s_i - alpha_s_i) * alpha_g_b + alpha_s_i;
+        const PDFColorComponent alpha_i_1 = PDFBlendFunction::blend_Union(alpha_0, alpha_g_i_1);
+        const PDFColorComponent alpha_i = PDFBlendFunction::blend_Union(alpha_0, alpha_g_i);
+        const PDFColorComponent alpha_b = knockoutGroup ? alpha_0 : alpha_i_1;
+
+        // If alpha_g_i is zero, color is undefined and we leave it unchanged
+        const bool isDefined = alpha_g_i > FIXED_POINT_ALPHA_EPSILON;
+        const PDFColorComponent alpha_i_inverted = isDefined ? 1.0f / alpha_i : 0.0f;
+
+        row.shape[i] = convertToFixedPoint(f_g_i);
+        row.opacity[i] = convertToFixedPoint(alpha_g_i);
+        row.isDefined[i] = isDefined ? 0xFFFF : 0;
+        row.k_i_1[i] = convertToFixedPointCoefficient(isDefined ? (1.0f - f_s_i) * alpha_i_1 * alpha_i_inverted : 1.0f);
+        row.k_b[i] = convertToFixedPointCoefficient((f_s_i - alpha_s_i) * alpha_b * alpha_i_inverted);
+        row.k_s[i] = convertToFixedPointCoefficient(alpha_s_i * (1.0f - alpha_b) * alpha_i_inverted);
+        row.k_B[i] = convertToFixedPointCoefficient(alpha_s_i * alpha_b * alpha_i_inverted);
+    }
+}
+
+/// Blends backdrop and source colors of the row using separable blend mode. Subtractive
+/// colors are complemented before and after blending. Modes color dodge, color burn
+/// and soft light (and all modes, if SIMD instructions are not available) are blended
+/// in floats, other modes are blended in fixed point.
+/// \param mode Separable blend mode
+/// \param isSubtractive Are colors subtractive?
+/// \param count Number of pixels
+/// \param backdrop Backdrop colors
+/// \param source Source colors
+/// \param blended Blended colors
+static void blendFixedPointColors(BlendMode mode,
+                                  bool isSubtractive,
+                                  size_t count,
+                                  const uint16_t* backdrop,
+                                  const uint16_t* source,
+                                  uint16_t* blended)
+{
+    size_t i = 0;
+
+#ifdef PDF4QT_TRANSPARENCY_USE_SSE2
+    auto blendVectors = [&](auto blendFunction)
+    {
+        const __m128i complement = isSubtractive ? _mm_set1_epi16(-1) : _mm_setzero_si128();
+
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m128i Cb = _mm_xor_si128(loadFixedPoint8(backdrop + i), complement);
+            const __m128i Cs = _mm_xor_si128(loadFixedPoint8(source + i), complement);
+            storeFixedPoint8(blended + i, _mm_xor_si128(blendFunction(Cb, Cs), complement));
+        }
+    };
+
+    switch (mode)
+    {
+        case BlendMode::Normal:
+        case BlendMode::Compatible:
+            blendVectors([](__m128i, __m128i Cs) { return Cs; });
+            break;
+
+        case BlendMode::Multiply:
+            blendVectors([](__m128i Cb, __m128i Cs) { return multiplyFixedPoint(Cb, Cs); });
+            break;
+
+        case BlendMode::Screen:
+            blendVectors([](__m128i Cb, __m128i Cs) { return screenFixedPoint(Cb, Cs); });
+            break;
+
+        case BlendMode::Overlay:
+            blendVectors([](__m128i Cb, __m128i Cs) { return hardLightFixedPoint(Cs, Cb); });
+            break;
+
+        case BlendMode::Darken:
+            blendVectors([](__m128i Cb, __m128i Cs) { return _mm_sub_epi16(Cb, _mm_subs_epu16(Cb, Cs)); });
+            break;
+
+        case BlendMode::Lighten:
+            blendVectors([](__m128i Cb, __m128i Cs) { return _mm_add_epi16(Cs, _mm_subs_epu16(Cb, Cs)); });
+            break;
+
+        case BlendMode::HardLight:
+            blendVectors([](__m128i Cb, __m128i Cs) { return hardLightFixedPoint(Cb, Cs); });
+            break;
+
+        case BlendMode::Difference:
+            blendVectors([](__m128i Cb, __m128i Cs) { return _mm_or_si128(_mm_subs_epu16(Cb, Cs), _mm_subs_epu16(Cs, Cb)); });
+            break;
+
+        case BlendMode::Exclusion:
+        {
+            blendVectors([](__m128i Cb, __m128i Cs)
+            {
+                const __m128i product = multiplyFixedPoint(Cb, Cs);
+                return _mm_adds_epu16(_mm_sub_epi16(Cb, product), _mm_sub_epi16(Cs, product));
+            });
+            break;
+        }
+
+        default:
+            break;
+    }
+#endif
+
+    const uint16_t complement = isSubtractive ? 0xFFFF : 0;
+    for (; i < count; ++i)
+    {
+        const PDFColorComponent Cb = convertFromFixedPoint(static_cast<uint16_t>(backdrop[i] ^ complement));
+        const PDFColorComponent Cs = convertFromFixedPoint(static_cast<uint16_t>(source[i] ^ complement));
+        blended[i] = static_cast<uint16_t>(convertToFixedPoint(PDFBlendFunction::blend(mode, Cb, Cs)) ^ complement);
+    }
+}
+
+/// Composes resulting color of the row from old color, backdrop color, source
+/// color and blended color, using coefficients of the row.
+/// \param row Row buffers
+/// \param count Number of pixels
+static void composeFixedPointColors(PDFFixedPointBlendRow& row, size_t count)
+{
+    size_t i = 0;
+
+#ifdef PDF4QT_TRANSPARENCY_USE_SSE2
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i sum0 = _mm_setzero_si128();
+        __m128i sum1 = _mm_setzero_si128();
+        accumulateFixedPoint(loadFixedPoint8(row.color.data() + i), loadFixedPoint8(row.k_i_1.data() + i), sum0, sum1);
+        accumulateFixedPoint(loadFixedPoint8(row.backdropColor.data() + i), loadFixedPoint8(row.k_b.data() + i), sum0, sum1);
+        accumulateFixedPoint(loadFixedPoint8(row.sourceColor.data() + i), loadFixedPoint8(row.k_s.data() + i), sum0, sum1);
+        accumulateFixedPoint(loadFixedPoint8(row.blendedColor.data() + i), loadFixedPoint8(row.k_B.data() + i), sum0, sum1);
+        storeFixedPoint8(row.color.data() + i, packFixedPoint(sum0, sum1));
+    }
+#endif
+
+    auto multiply = [](uint16_t value, uint16_t coefficient)
+    {
+        return (uint32_t(value) * coefficient + (1u << (FIXED_POINT_COEFFICIENT_SHIFT - 1))) >> FIXED_POINT_COEFFICIENT_SHIFT;
+    };
+
+    for (; i < count; ++i)
+    {
+        const uint32_t value = multiply(row.color[i], row.k_i_1[i]) +
+                               multiply(row.backdropColor[i], row.k_b[i]) +
+                               multiply(row.sourceColor[i], row.k_s[i]) +
+                               multiply(row.blendedColor[i], row.k_B[i]);
+        row.color[i] = static_cast<uint16_t>(qMin(value, 65535u));
+    }
+}
+
 PDFFloatBitmap::PDFFloatBitmap() :
     m_width(0),
     m_height(0),
@@ -55,6 +420,7 @@ PDFFloatBitmap::PDFFloatBitmap(size_t width, size_t height, PDFPixelFormat forma
 
 PDFColorBuffer PDFFloatBitmap::getPixel(size_t x, size_t y)
 {
+    Q_ASSERT(m_storage == Storage::Float);
     Q_ASSERT(x < m_width);
     Q_ASSERT(y < m_height);
 
@@ -64,6 +430,7 @@ PDFColorBuffer PDFFloatBitmap::getPixel(size_t x, size_t y)
 
 PDFConstColorBuffer PDFFloatBitmap::getPixel(size_t x, size_t y) const
 {
+    Q_ASSERT(m_storage == Storage::Float);
     Q_ASSERT(x < m_width);
     Q_ASSERT(y < m_height);
 
@@ -73,6 +440,7 @@ PDFConstColorBuffer PDFFloatBitmap::getPixel(size_t x, size_t y) const
 
 PDFColorBuffer PDFFloatBitmap::getPixels()
 {
+    Q_ASSERT(m_storage == Storage::Float);
     return PDFColorBuffer(m_data.data(), m_data.size());
 }
 
@@ -111,24 +479,99 @@ PDFFloatBitmap PDFFloatBitmap::getInkCoverageBitmap() const
 
 const PDFColorComponent* PDFFloatBitmap::begin() const
 {
+    Q_ASSERT(m_storage == Storage::Float);
     return m_data.data();
 }
 
 const PDFColorComponent* PDFFloatBitmap::end() const
 {
+    Q_ASSERT(m_storage == Storage::Float);
     return m_data.data() + m_data.size();
 }
 
 PDFColorComponent* PDFFloatBitmap::begin()
 {
+    Q_ASSERT(m_storage == Storage::Float);
     return m_data.data();
 }
 
 PDFColorComponent* PDFFloatBitmap::end()
 {
+    Q_ASSERT(m_storage == Storage::Float);
     return m_data.data() + m_data.size();
 }
 
+void PDFFloatBitmap::setStorage(Storage storage)
+{
+    if (m_storage == storage)
+    {
+        return;
+    }
+
+    const size_t planeSize = m_width * m_height;
+
+    switch (storage)
+    {
+        case Storage::Float:
+        {
+            m_data.resize(m_format.calculateBitmapDataLength(m_width, m_height));
+
+            for (size_t channel = 0; channel < m_pixelSize; ++channel)
+            {
+                const uint16_t* plane = m_fixedPointData.data() + channel * planeSize;
+                PDFColorComponent* value = m_data.data() + channel;
+
+                for (size_t i = 0; i < planeSize; ++i, value += m_pixelSize)
+                {
+                    *value = convertFromFixedPoint(plane[i]);
+                }
+            }
+
+            std::vector<uint16_t>().swap(m_fixedPointData);
+            break;
+        }
+
+        case Storage::FixedPoint16:
+        {
+            m_fixedPointData.resize(m_format.calculateBitmapDataLength(m_width, m_height));
+
+            for (size_t channel = 0; channel < m_pixelSize; ++channel)
+            {
+                uint16_t* plane = m_fixedPointData.data() + channel * planeSize;
+                const PDFColorComponent* value = m_data.data() + channel;
+
+                for (size_t i = 0; i < planeSize; ++i, value += m_pixelSize)
+                {
+                    plane[i] = convertToFixedPoint(*value);
+                }
+            }
+
+            std::vector<PDFColorComponent>().swap(m_data);
+            break;
+        }
+    }
+
+    m_storage = storage;
+}
+
+void PDFFloatBitmap::getFixedPointRow(size_t channel, size_t x, size_t y, size_t count, uint16_t* values) const
+{
+    Q_ASSERT(x + count <= m_width);
+
+    if (m_storage == Storage::FixedPoint16)
+    {
+        const uint16_t* row = m_fixedPointData.data() + getFixedPointIndex(channel, x, y);
+        std::copy(row, row + count, values);
+        return;
+    }
+
+    const PDFColorComponent* value = m_data.data() + getPixelIndex(x, y) + channel;
+    for (size_t i = 0; i < count; ++i, value += m_pixelSize)
+    {
+        values[i] = convertToFixedPoint(*value);
+    }
+}
+
 void PDFFloatBitmap::makeTransparent()
 {
     if (m_format.hasShapeChannel())
@@ -399,6 +842,64 @@ void PDFFloatBitmap::copyChannel(const PDFFloatBitmap& sourceBitmap, uint8_t cha
     }
 }
 
+void PDFFloatBitmap::uniteChannel(const PDFFloatBitmap& bitmap, uint8_t channel)
+{
+    Q_ASSERT(getWidth() == bitmap.getWidth());
+    Q_ASSERT(getHeight() == bitmap.getHeight());
+
+    if (m_storage == Storage::FixedPoint16)
+    {
+        std::vector<uint16_t> row(m_width, 0);
+
+        for (size_t y = 0; y < m_height; ++y)
+        {
+            bitmap.getFixedPointRow(channel, 0, y, m_width, row.data());
+            uint16_t* values = m_fixedPointData.data() + getFixedPointIndex(channel, 0, y);
+
+            for (size_t x = 0; x < m_width; ++x)
+            {
+                values[x] = convertToFixedPoint(PDFBlendFunction::blend_Union(convertFromFixedPoint(values[x]), convertFromFixedPoint(row[x])));
+            }
+        }
+
+        return;
+    }
+
+    if (bitmap.getStorage() != Storage::Float)
+    {
+        PDFFloatBitmap floatBitmap = bitmap;
+        floatBitmap.setStorage(Storage::Float);
+        uniteChannel(floatBitmap, channel);
+        return;
+    }
+
+    for (size_t y = 0; y < m_height; ++y)
+    {
+        for (size_t x = 0; x < m_width; ++x)
+        {
+            PDFConstColorBuffer sourceColorBuffer = bitmap.getPixel(x, y);
+            PDFColorBuffer targetColorBuffer = getPixel(x, y);
+            targetColorBuffer[channel] = PDFBlendFunction::blend_Union(sourceColorBuffer[channel], targetColorBuffer[channel]);
+        }
+    }
+}
+
+void PDFFloatBitmap::copyRows(const PDFFloatBitmap& sourceBitmap, size_t y)
+{
+    Q_ASSERT(m_storage == Storage::Float);
+    Q_ASSERT(sourceBitmap.getStorage() == Storage::Float);
+    Q_ASSERT(getWidth() == sourceBitmap.getWidth());
+    Q_ASSERT(getPixelFormat() == sourceBitmap.getPixelFormat());
+    Q_ASSERT(y + sourceBitmap.getHeight() <= getHeight());
+
+    std::copy(sourceBitmap.m_data.cbegin(), sourceBitmap.m_data.cend(), std::next(m_data.begin(), getPixelIndex(0, y)));
+
+    if (hasActiveColorMask() && sourceBitmap.hasActiveColorMask())
+    {
+        std::copy(sourceBitmap.m_activeColorMask.cbegin(), sourceBitmap.m_activeColorMask.cend(), std::next(m_activeColorMask.begin(), y * m_width));
+    }
+}
+
 PDFFloatBitmap PDFFloatBitmap::resize(size_t width, size_t height, Qt::TransformationMode mode) const
 {
     if (width == 0 || height == 0)
@@ -530,6 +1031,60 @@ void PDFFloatBitmap::blend(const PDFFloatBitmap& source,
     Q_ASSERT(static_cast<std::size_t>( blendRegion.right() ) < source.getWidth());
     Q_ASSERT(static_cast< std::size_t >( blendRegion.bottom() ) < source.getHeight());
 
+    // Overprint mode 0 selects source color for all active channels. If source
+    // has not active color mask, all channels are active, so overprint is the same
+    // as normal blending.
+    const bool isOverprintInactive = overprintMode == OverprintMode::NoOveprint ||
+                                     (overprintMode == OverprintMode::Overprint_Mode_0 && !source.hasActiveColorMask());
+
+    const Storage targetStorage = target.getStorage();
+    if (targetStorage == Storage::FixedPoint16 && PDFBlendModeInfo::isSeparable(mode) && isOverprintInactive)
+    {
+        blendFixedPoint(source, target, backdrop, initialBackdrop, blendSoftMask, alphaIsShape, constantAlpha, mode, knockoutGroup, blendRegion);
+        return;
+    }
+
+    if (targetStorage != Storage::Float ||
+        source.getStorage() != Storage::Float ||
+        backdrop.getStorage() != Storage::Float ||
+        initialBackdrop.getStorage() != Storage::Float ||
+        blendSoftMask.getStorage() != Storage::Float)
+    {
+        // Blend in float storage. Backdrops can be the same bitmap
+        // as target, so they are converted together with the target.
+        target.setStorage(Storage::Float);
+
+        auto getFloatBitmap = [&target](const PDFFloatBitmap& bitmap, PDFFloatBitmap& convertedBitmap) -> const PDFFloatBitmap&
+        {
+            if (&bitmap == &target || bitmap.getStorage() == Storage::Float)
+            {
+                return bitmap;
+            }
+
+            convertedBitmap = bitmap;
+            convertedBitmap.setStorage(Storage::Float);
+            return convertedBitmap;
+        };
+
+        PDFFloatBitmap convertedSource;
+        PDFFloatBitmap convertedBackdrop;
+        PDFFloatBitmap convertedInitialBackdrop;
+        PDFFloatBitmap convertedSoftMask;
+
+        blend(getFloatBitmap(source, convertedSource), target, getFloatBitmap(backdrop, convertedBackdrop),
+              getFloatBitmap(initialBackdrop, convertedInitialBackdrop), getFloatBitmap(blendSoftMask, convertedSoftMask),
+              alphaIsShape, constantAlpha, mode, knockoutGroup, overprintMode, blendRegion);
+
+        target.setStorage(targetStorage);
+        return;
+    }
+
+    if (PDFBlendModeInfo::isSeparable(mode) && isOverprintInactive && !target.hasActiveColorMask())
+    {
+        blendSeparable(source, target, backdrop, initialBackdrop, blendSoftMask, alphaIsShape, constantAlpha, mode, knockoutGroup, blendRegion);
+        return;
+    }
+
     const PDFPixelFormat pixelFormat = source.getPixelFormat();
     const uint8_t shapeChannel = pixelFormat.getShapeChannelIndex();
     const uint8_t opacityChannel = pixelFormat.getOpacityChannelIndex();
@@ -629,9 +1184,9 @@ void PDFFloatBitmap::blend(const PDFFloatBitmap& source,
         return channelBlendModes[channel];
     };
 
-    for (int x = blendRegion.left(); x <= blendRegion.right(); ++x)
+    for (int y = blendRegion.top(); y <= blendRegion.bottom(); ++y)
     {
-        for (int y = blendRegion.top(); y <= blendRegion.bottom(); ++y)
+        for (int x = blendRegion.left(); x <= blendRegion.right(); ++x)
         {
             PDFConstColorBuffer sourceColor = source.getPixel(x, y);
             PDFColorBuffer targetColor = target.getPixel(x, y);
@@ -835,41 +1390,291 @@ void PDFFloatBitmap::blend(const PDFFloatBitmap& source,
     }
 }
 
-void PDFFloatBitmap::blendConvertedSpots(const PDFFloatBitmap& convertedSpotColors)
+void PDFFloatBitmap::blendSeparable(const PDFFloatBitmap& source,
+                                    PDFFloatBitmap& target,
+                                    const PDFFloatBitmap& backdrop,
+                                    const PDFFloatBitmap& initialBackdrop,
+                                    const PDFFloatBitmap& blendSoftMask,
+                                    bool alphaIsShape,
+                                    PDFColorComponent constantAlpha,
+                                    BlendMode mode,
+                                    bool knockoutGroup,
+                                    QRect blendRegion)
 {
-    Q_ASSERT(convertedSpotColors.getPixelFormat().getProcessColorChannelCount() == m_format.getProcessColorChannelCount());
+    Q_ASSERT(PDFBlendModeInfo::isSeparable(mode));
+    Q_ASSERT(!target.hasActiveColorMask());
 
-    const uint8_t processColorChannelStart = m_format.getProcessColorChannelIndexStart();
-    const uint8_t processColorChannelEnd = m_format.getProcessColorChannelIndexEnd();
+    const PDFPixelFormat pixelFormat = source.getPixelFormat();
+    const uint8_t shapeChannel = pixelFormat.getShapeChannelIndex();
+    const uint8_t opacityChannel = pixelFormat.getOpacityChannelIndex();
+    const uint8_t colorChannelStart = pixelFormat.getColorChannelIndexStart();
+    const uint8_t colorChannelEnd = pixelFormat.getColorChannelIndexEnd();
+    const size_t pixelSize = source.getPixelSize();
+    const size_t width = blendRegion.width();
+
+    // Resulting color is calculated as (see 11.4.8 in PDF 2.0 specification):
+    //
+    //  C_i = ((1 - f_s_i) * alpha_i_1 * C_i_1 +
+    //         (f_s_i - alpha_s_i) * alpha_b * C_b +
+    //         alpha_s_i * ((1 - alpha_b) * C_s_i + alpha_b * B(C_b, C_s_i))) / alpha_i
+    //
+    // Coefficients of C_i_1, C_b, C_s_i and B(C_b, C_s_i) do not depend on the color
+    // channel, so we calculate them once per pixel. If alpha_g_i is zero, color is
+    // undefined and we leave it unchanged (coefficient of C_i_1 is 1, others are 0).
+    std::vector<PDFColorComponent> k_i_1(width, 0.0f);
+    std::vector<PDFColorComponent> k_b(width, 0.0f);
+    std::vector<PDFColorComponent> k_s(width, 0.0f);
+    std::vector<PDFColorComponent> k_B(width, 0.0f);
+
+    for (int y = blendRegion.top(); y <= blendRegion.bottom(); ++y)
+    {
+        const PDFColorComponent* sourceRow = source.begin() + source.getPixelIndex(blendRegion.left(), y);
+        const PDFColorComponent* backdropRow = backdrop.begin() + backdrop.getPixelIndex(blendRegion.left(), y);
+        const PDFColorComponent* initialBackdropRow = initialBackdrop.begin() + initialBackdrop.getPixelIndex(blendRegion.left(), y);
+        const PDFColorComponent* softMaskRow = blendSoftMask.begin() + blendSoftMask.getPixelIndex(blendRegion.left(), y);
+        PDFColorComponent* targetRow = target.begin() + target.getPixelIndex(blendRegion.left(), y);
+
+        for (size_t x = 0; x < width; ++x)
+        {
+            const PDFColorComponent* sourceColor = sourceRow + x * pixelSize;
+            PDFColorComponent* targetColor = targetRow + x * pixelSize;
 
-    const PDFColorComponent* sourcePixel = convertedSpotColors.begin();
-    for (PDFColorComponent* targetPixel = begin(); targetPixel != end(); targetPixel += m_pixelSize, sourcePixel+= convertedSpotColors.getPixelSize())
-    {
-        for (uint8_t i = processColorChannelStart; i < processColorChannelEnd; ++i)
+            const PDFColorComponent softMaskValue = softMaskRow[x];
+            const PDFColorComponent f_j_i = sourceColor[shapeChannel];
+            const PDFColorComponent f_m_i = alphaIsShape ? softMaskValue : 1.0f;
+            const PDFColorComponent f_k_i = alphaIsShape ? constantAlpha : 1.0f;
+            const PDFColorComponent q_m_i = !alphaIsShape ? softMaskValue : 1.0f;
+            const PDFColorComponent q_k_i = !alphaIsShape ? constantAlpha : 1.0f;
+            const PDFColorComponent f_s_i = f_j_i * f_m_i * f_k_i;
+            const PDFColorComponent alpha_j_i = sourceColor[opacityChannel];
+            const PDFColorComponent alpha_s_i = alpha_j_i * (f_m_i * q_m_i) * (f_k_i * q_k_i);
+            const PDFColorComponent alpha_g_i_1 = targetColor[opacityChannel];
+            const PDFColorComponent alpha_g_b = knockoutGroup ? 0.0f : alpha_g_i_1;
+            const PDFColorComponent alpha_0 = initialBackdropRow[x * pixelSize + opacityChannel];
+            const PDFColorComponent f_g_i_1 = targetColor[shapeChannel];
+
+            const PDFColorComponent f_g_i = PDFBlendFunction::blend_Union(f_g_i_1, f_s_i);
+            const PDFColorComponent alpha_g_i = (1.0f - f_s_i) * alpha_g_i_1 + (f_s_i - alpha_s_i) * alpha_g_b + alpha_s_i;
+            const PDFColorComponent alpha_i_1 = PDFBlendFunction::blend_Union(alpha_0, alpha_g_i_1);
+            const PDFColorComponent alpha_i = PDFBlendFunction::blend_Union(alpha_0, alpha_g_i);
+            const PDFColorComponent alpha_b = knockoutGroup ? alpha_0 : alpha_i_1;
+
+            if (qFuzzyIsNull(alpha_g_i))
+            {
+                k_i_1[x] = 1.0f;
+                k_b[x] = 0.0f;
+                k_s[x] = 0.0f;
+                k_B[x] = 0.0f;
+            }
+            else
+            {
+                const PDFColorComponent alpha_i_inverted = 1.0f / alpha_i;
+                k_i_1[x] = (1.0f - f_s_i) * alpha_i_1 * alpha_i_inverted;
+                k_b[x] = (f_s_i - alpha_s_i) * alpha_b * alpha_i_inverted;
+                k_s[x] = alpha_s_i * (1.0f - alpha_b) * alpha_i_inverted;
+                k_B[x] = alpha_s_i * alpha_b * alpha_i_inverted;
+            }
+
+            targetColor[shapeChannel] = f_g_i;
+            targetColor[opacityChannel] = alpha_g_i;
+        }
+
+        auto blendChannel = [&](uint8_t channel, auto blendFunction)
         {
-            if (m_format.hasProcessColorsSubtractive())
+            const PDFColorComponent* sourceChannel = sourceRow + channel;
+            const PDFColorComponent* backdropChannel = backdropRow + channel;
+            PDFColorComponent* targetChannel = targetRow + channel;
+
+            for (size_t x = 0; x < width; ++x)
             {
-                targetPixel[i] = PDFBlendFunction::blend_Union(targetPixel[i], sourcePixel[i]);
+                const size_t index = x * pixelSize;
+                const PDFColorComponent C_s_i = sourceChannel[index];
+                const PDFColorComponent C_b = backdropChannel[index];
+                const PDFColorComponent C_i_1 = targetChannel[index];
+                targetChannel[index] = k_i_1[x] * C_i_1 + k_b[x] * C_b + k_s[x] * C_s_i + k_B[x] * blendFunction(C_b, C_s_i);
+            }
+        };
+
+        auto blendChannelWithMode = [&](uint8_t channel, BlendMode channelBlendMode, auto blendFunction)
+        {
+            switch (channelBlendMode)
+            {
+                case BlendMode::Normal:
+                case BlendMode::Compatible:
+                    blendChannel(channel, [&](PDFColorComponent Cb, PDFColorComponent Cs) { return blendFunction(Cb, Cs, [](PDFColorComponent, PDFColorComponent s) { return s; }); });
+                    break;
+
+                case BlendMode::Multiply:
+                    blendChannel(channel, [&](PDFColorComponent Cb, PDFColorComponent Cs) { return blendFunction(Cb, Cs, [](PDFColorComponent b, PDFColorComponent s) { return b * s; }); });
+                    break;
+
+                case BlendMode::Screen:
+                    blendChannel(channel, [&](PDFColorComponent Cb, PDFColorComponent Cs) { return blendFunction(Cb, Cs, [](PDFColorComponent b, PDFColorComponent s) { return b + s - b * s; }); });
+                    break;
+
+                case BlendMode::Darken:
+                    blendChannel(channel, [&](PDFColorComponent Cb, PDFColorComponent Cs) { return blendFunction(Cb, Cs, [](PDFColorComponent b, PDFColorComponent s) { return qMin(b, s); }); });
+                    break;
+
+                case BlendMode::Lighten:
+                    blendChannel(channel, [&](PDFColorComponent Cb, PDFColorComponent Cs) { return blendFunction(Cb, Cs, [](PDFColorComponent b, PDFColorComponent s) { return qMax(b, s); }); });
+                    break;
+
+                default:
+                    blendChannel(channel, [&](PDFColorComponent Cb, PDFColorComponent Cs) { return blendFunction(Cb, Cs, [channelBlendMode](PDFColorComponent b, PDFColorComponent s) { return PDFBlendFunction::blend(channelBlendMode, b, s); }); });
+                    break;
+            }
+        };
+
+        // Additive colors are blended directly, subtractive colors are
+        // complemented before and after blending.
+        auto blendAdditive = [](PDFColorComponent Cb, PDFColorComponent Cs, auto function) { return function(Cb, Cs); };
+        auto blendSubtractive = [](PDFColorComponent Cb, PDFColorComponent Cs, auto function) { return 1.0f - function(1.0f - Cb, 1.0f - Cs); };
+
+        for (uint8_t i = colorChannelStart; i < colorChannelEnd; ++i)
+        {
+            const bool isSpotColor = pixelFormat.hasSpotColors() && i >= pixelFormat.getSpotColorChannelIndexStart();
+
+            // For blending spot colors, only white preserving blend modes are possible.
+            // If this is not the case, revert spot color blend mode to normal blending.
+            // See 11.7.4.2 of PDF 2.0 specification.
+            const BlendMode channelBlendMode = (isSpotColor && !PDFBlendModeInfo::isWhitePreserving(mode)) ? BlendMode::Normal : mode;
+            const bool isSubtractive = isSpotColor ? pixelFormat.hasSpotColorsSubtractive() : pixelFormat.hasProcessColorsSubtractive();
+
+            if (isSubtractive)
+            {
+                blendChannelWithMode(i, channelBlendMode, blendSubtractive);
             }
             else
             {
-                targetPixel[i] = targetPixel[i] * sourcePixel[i];
+                blendChannelWithMode(i, channelBlendMode, blendAdditive);
             }
         }
     }
 }
 
-void PDFFloatBitmap::fillProcessColorChannels(PDFColorComponent value)
+void PDFFloatBitmap::blendFixedPoint(const PDFFloatBitmap& source,
+                                     PDFFloatBitmap& target,
+                                     const PDFFloatBitmap& backdrop,
+                                     const PDFFloatBitmap& initialBackdrop,
+                                     const PDFFloatBitmap& softMask,
+                                     bool alphaIsShape,
+                                     PDFColorComponent constantAlpha,
+                                     BlendMode mode,
+                                     bool knockoutGroup,
+                                     QRect blendRegion)
 {
-    if (!m_format.hasProcessColors())
-    {
-        // No process colors
+    Q_ASSERT(PDFBlendModeInfo::isSeparable(mode));
+    Q_ASSERT(target.getStorage() == Storage::FixedPoint16);
+
+    const PDFPixelFormat pixelFormat = source.getPixelFormat();
+    const uint8_t shapeChannel = pixelFormat.getShapeChannelIndex();
+    const uint8_t opacityChannel = pixelFormat.getOpacityChannelIndex();
+    const uint8_t colorChannelStart = pixelFormat.getColorChannelIndexStart();
+    const uint8_t colorChannelEnd = pixelFormat.getColorChannelIndexEnd();
+    const size_t left = blendRegion.left();
+    const size_t width = blendRegion.width();
+
+    // Pad the row to the whole number of SIMD vectors (8 values of 16-bit).
+    // Padded pixels are transparent, so they have undefined color.
+    const size_t paddedWidth = (width + 7) & ~size_t(7);
+    PDFFixedPointBlendRow row(paddedWidth);
+
+    for (int y = blendRegion.top(); y <= blendRegion.bottom(); ++y)
+    {
+        // Read all inputs of the row first, because
+        // backdrops can be the same bitmap as target.
+        source.getFixedPointRow(shapeChannel, left, y, width, row.sourceShape.data());
+        source.getFixedPointRow(opacityChannel, left, y, width, row.sourceOpacity.data());
+        softMask.getFixedPointRow(0, left, y, width, row.softMask.data());
+        initialBackdrop.getFixedPointRow(opacityChannel, left, y, width, row.initialOpacity.data());
+        target.getFixedPointRow(shapeChannel, left, y, width, row.shape.data());
+        target.getFixedPointRow(opacityChannel, left, y, width, row.opacity.data());
+
+        calculateFixedPointCoefficients(row, paddedWidth, alphaIsShape, constantAlpha, knockoutGroup);
+
+        std::copy_n(row.shape.cbegin(), width, std::next(target.m_fixedPointData.begin(), target.getFixedPointIndex(shapeChannel, left, y)));
+        std::copy_n(row.opacity.cbegin(), width, std::next(target.m_fixedPointData.begin(), target.getFixedPointIndex(opacityChannel, left, y)));
+
+        if (target.hasActiveColorMask())
+        {
+            for (size_t i = 0; i < width; ++i)
+            {
+                if (row.isDefined[i])
+                {
+                    const uint32_t activeColorChannels = source.hasActiveColorMask() ? source.getPixelActiveColorMask(left + i, y) : PDFPixelFormat::getAllColorsMask();
+                    target.markPixelActiveColorMask(left + i, y, activeColorChannels);
+                }
+            }
+        }
+
+        for (uint8_t i = colorChannelStart; i < colorChannelEnd; ++i)
+        {
+            const bool isSpotColor = pixelFormat.hasSpotColors() && i >= pixelFormat.getSpotColorChannelIndexStart();
+
+            // For blending spot colors, only white preserving blend modes are possible.
+            // If this is not the case, revert spot color blend mode to normal blending.
+            // See 11.7.4.2 of PDF 2.0 specification.
+            const BlendMode channelBlendMode = (isSpotColor && !PDFBlendModeInfo::isWhitePreserving(mode)) ? BlendMode::Normal : mode;
+            const bool isSubtractive = isSpotColor ? pixelFormat.hasSpotColorsSubtractive() : pixelFormat.hasProcessColorsSubtractive();
+
+            source.getFixedPointRow(i, left, y, width, row.sourceColor.data());
+            backdrop.getFixedPointRow(i, left, y, width, row.backdropColor.data());
+            target.getFixedPointRow(i, left, y, width, row.color.data());
+
+            blendFixedPointColors(channelBlendMode, isSubtractive, paddedWidth, row.backdropColor.data(), row.sourceColor.data(), row.blendedColor.data());
+            composeFixedPointColors(row, paddedWidth);
+
+            std::copy_n(row.color.cbegin(), width, std::next(target.m_fixedPointData.begin(), target.getFixedPointIndex(i, left, y)));
+        }
+    }
+}
+
+void PDFFloatBitmap::blendConvertedSpots(const PDFFloatBitmap& convertedSpotColors)
+{
+    Q_ASSERT(convertedSpotColors.getPixelFormat().getProcessColorChannelCount() == m_format.getProcessColorChannelCount());
+
+    const uint8_t processColorChannelStart = m_format.getProcessColorChannelIndexStart();
+    const uint8_t processColorChannelEnd = m_format.getProcessColorChannelIndexEnd();
+
+    const PDFColorComponent* sourcePixel = convertedSpotColors.begin();
+    for (PDFColorComponent* targetPixel = begin(); targetPixel != end(); targetPixel += m_pixelSize, sourcePixel+= convertedSpotColors.getPixelSize())
+    {
+        for (uint8_t i = processColorChannelStart; i < processColorChannelEnd; ++i)
+        {
+            if (m_format.hasProcessColorsSubtractive())
+            {
+                targetPixel[i] = PDFBlendFunction::blend_Union(targetPixel[i], sourcePixel[i]);
+            }
+            else
+            {
+                targetPixel[i] = targetPixel[i] * sourcePixel[i];
+            }
+        }
+    }
+}
+
+void PDFFloatBitmap::fillProcessColorChannels(PDFColorComponent value)
+{
+    if (!m_format.hasProcessColors())
+    {
+        // No process colors
         return;
     }
 
     const uint8_t channelStart = m_format.getProcessColorChannelIndexStart();
     const uint8_t channelEnd = m_format.getProcessColorChannelIndexEnd();
 
+    if (m_storage == Storage::FixedPoint16)
+    {
+        for (uint8_t i = channelStart; i < channelEnd; ++i)
+        {
+            fillChannel(i, value);
+        }
+
+        return;
+    }
+
     for (PDFColorComponent* pixel = begin(); pixel != end(); pixel += m_pixelSize)
     {
         std::fill(pixel + channelStart, pixel + channelEnd, value);
@@ -878,6 +1683,14 @@ void PDFFloatBitmap::fillProcessColorChannels(PDFColorComponent value)
 
 void PDFFloatBitmap::fillChannel(size_t channel, PDFColorComponent value)
 {
+    if (m_storage == Storage::FixedPoint16)
+    {
+        // Each channel has its own plane
+        auto it = std::next(m_fixedPointData.begin(), getFixedPointIndex(channel, 0, 0));
+        std::fill(it, std::next(it, m_width * m_height), convertToFixedPoint(value));
+        return;
+    }
+
     // Do we have just one channel?
     if (m_format.getChannelCount() == 1)
     {
@@ -938,6 +1751,10 @@ void PDFFloatBitmapWithColorSpace::convertToColorSpace(const PDFCMS* cms,
         return;
     }
 
+    // Color spaces are converted in float storage
+    const Storage storage = getStorage();
+    setStorage(Storage::Float);
+
     const uint8_t targetDeviceColors = static_cast<uint8_t>(targetColorSpace->getColorComponentCount());
     PDFPixelFormat newFormat = getPixelFormat();
     newFormat.setProcessColors(targetDeviceColors);
@@ -978,6 +1795,7 @@ void PDFFloatBitmapWithColorSpace::convertToColorSpace(const PDFCMS* cms,
     // Simplification - set all color channels active
     temporary.setAllColorActive();
     *this = qMove(temporary);
+    setStorage(storage);
 }
 
 PDFTransparencyRenderer::PDFTransparencyRenderer(const PDFPage* page,
@@ -1031,6 +1849,7 @@ void PDFTransparencyRenderer::beginPaint(QSize pixelSize)
     // Initialize initial opaque soft mask
     PDFFloatBitmap initialSoftMaskBitmap;
     createOpaqueSoftMask(initialSoftMaskBitmap, pixelSize.width(), pixelSize.height());
+    initialSoftMaskBitmap.setStorage(getBlendingStorage());
     m_painterStateStack.top().softMask = PDFTransparencySoftMask(true, qMove(initialSoftMaskBitmap));
 
     PDFPixelFormat pixelFormat = PDFPixelFormat::createFormat(uint8_t(m_deviceColorSpace->getColorComponentCount()),
@@ -1040,6 +1859,7 @@ void PDFTransparencyRenderer::beginPaint(QSize pixelSize)
 
     PDFFloatBitmapWithColorSpace paper = PDFFloatBitmapWithColorSpace(pixelSize.width(), pixelSize.height(), pixelFormat, m_deviceColorSpace);
     paper.makeColorWhite();
+    paper.setStorage(getBlendingStorage());
 
     PDFTransparencyGroupPainterData deviceGroup;
     deviceGroup.alphaIsShape = getGraphicState()->getAlphaIsShape();
@@ -1080,6 +1900,8 @@ const PDFFloatBitmap& PDFTransparencyRenderer::endPaint()
     m_active = false;
     m_painterStateStack.pop();
 
+    // Result is always in float storage
+    getImmediateBackdrop()->setStorage(PDFFloatBitmap::Storage::Float);
     return *getImmediateBackdrop();
 }
 
@@ -1265,11 +2087,9 @@ void PDFTransparencyRenderer::performPixelSampling(const PDFReal shape,
                                                    int x,
                                                    int y,
                                                    const PDFMappedColor& fillColor,
-                                                   const PDFPainterPathSampler& clipSampler,
-                                                   const PDFPainterPathSampler& pathSampler)
+                                                   PDFColorComponent clipValue,
+                                                   PDFColorComponent objectShapeValue)
 {
-    const PDFColorComponent clipValue = clipSampler.sample(QPoint(x, y));
-    const PDFColorComponent objectShapeValue = pathSampler.sample(QPoint(x, y));
     const PDFColorComponent shapeValue = objectShapeValue * clipValue * shape;
 
     if (shapeValue > 0.0f)
@@ -1291,6 +2111,55 @@ void PDFTransparencyRenderer::performPixelSampling(const PDFReal shape,
     }
 }
 
+void PDFTransparencyRenderer::performPathSampling(const PDFReal shape,
+                                                  const PDFReal opacity,
+                                                  const uint8_t shapeChannel,
+                                                  const uint8_t opacityChannel,
+                                                  const uint8_t colorChannelStart,
+                                                  const uint8_t colorChannelEnd,
+                                                  QRect fillRect,
+                                                  const PDFMappedColor& fillColor,
+                                                  const PDFPainterPathSampler& clipSampler,
+                                                  const PDFPainterPathSampler& pathSampler)
+{
+    auto processRow = [&, this](int y)
+    {
+        // Coverage buffers are reused for all rows processed by the thread
+        thread_local PDFPainterPathSampler::RowCoverage clipCoverage;
+        thread_local PDFPainterPathSampler::RowCoverage pathCoverage;
+        pathSampler.computeRowCoverage(y, pathCoverage);
+
+        if (pathCoverage.left > pathCoverage.right)
+        {
+            return;
+        }
+
+        clipSampler.computeRowCoverage(y, clipCoverage);
+
+        // Only pixels covered by both the path and the clipping path can be painted
+        const int left = qMax(fillRect.left(), qMax(pathCoverage.left, clipCoverage.left));
+        const int right = qMin(fillRect.right(), qMin(pathCoverage.right, clipCoverage.right));
+
+        for (int x = left; x <= right; ++x)
+        {
+            performPixelSampling(shape, opacity, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, fillColor, clipCoverage.value(x), pathCoverage.value(x));
+        }
+    };
+
+    if (isMultithreadedPathSamplingUsed(fillRect))
+    {
+        PDFIntegerRange<int> range(fillRect.top(), fillRect.bottom() + 1);
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processRow);
+    }
+    else
+    {
+        for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
+        {
+            processRow(y);
+        }
+    }
+}
+
 void PDFTransparencyRenderer::performFillFragmentFromTexture(const PDFReal shape,
                                                              const PDFReal opacity,
                                                              const uint8_t shapeChannel,
@@ -1301,7 +2170,7 @@ void PDFTransparencyRenderer::performFillFragmentFromTexture(const PDFReal shape
                                                              int y,
                                                              const QTransform& worldToTextureMatrix,
                                                              const PDFFloatBitmap& texture,
-                                                             const PDFPainterPathSampler& clipSampler)
+                                                             PDFColorComponent clipValue)
 {
     // Get pixel buffer from texture
     QPointF sourcePoint(x, y);
@@ -1321,7 +2190,6 @@ void PDFTransparencyRenderer::performFillFragmentFromTexture(const PDFReal shape
 
     PDFConstColorBuffer texel = texture.getPixel(texelCoordinateX, texelCoordinateY);
 
-    const PDFColorComponent clipValue = clipSampler.sample(QPoint(x, y));
     const PDFColorComponent objectShapeValue = texel[shapeChannel];
     const PDFColorComponent objectOpacityValue = texel[opacityChannel];
     const PDFColorComponent shapeValue = objectShapeValue * clipValue * shape;
@@ -2084,6 +2952,7 @@ void PDFTransparencyRenderer::processSoftMask(const PDFDictionary* softMask)
             }
         }
 
+        createdSoftMask.setStorage(getBlendingStorage());
         getPainterState()->softMask = PDFTransparencySoftMask(false, qMove(createdSoftMask));
     }
 }
@@ -2135,45 +3004,7 @@ void PDFTransparencyRenderer::performPathPainting(const QPainterPath& path, bool
             PDFPainterPathSampler pathSampler(worldPath, m_settings.samplesCount, 0.0f, fillRect, m_settings.flags.testFlag(PDFTransparencyRendererSettings::PrecisePathSampler));
             const PDFMappedColor& fillColor = getMappedFillColor();
 
-            if (isMultithreadedPathSamplingUsed(fillRect))
-            {
-                if (fillRect.width() > fillRect.height())
-                {
-                    // Columns
-                    PDFIntegerRange<int> range(fillRect.left(), fillRect.right() + 1);
-                    auto processEntry = [&, this](int x)
-                    {
-                        for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
-                        {
-                            performPixelSampling(shapeFilling, opacityFilling, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, fillColor, clipSampler, pathSampler);
-                        }
-                    };
-                    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processEntry);
-                }
-                else
-                {
-                    // Rows
-                    PDFIntegerRange<int> range(fillRect.top(), fillRect.bottom() + 1);
-                    auto processEntry = [&, this](int y)
-                    {
-                        for (int x = fillRect.left(); x <= fillRect.right(); ++x)
-                        {
-                            performPixelSampling(shapeFilling, opacityFilling, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, fillColor, clipSampler, pathSampler);
-                        }
-                    };
-                    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processEntry);
-                }
-            }
-            else
-            {
-                for (int x = fillRect.left(); x <= fillRect.right(); ++x)
-                {
-                    for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
-                    {
-                        performPixelSampling(shapeFilling, opacityFilling, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, fillColor, clipSampler, pathSampler);
-                    }
-                }
-            }
+            performPathSampling(shapeFilling, opacityFilling, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, fillRect, fillColor, clipSampler, pathSampler);
 
             m_drawBuffer.modify(fillRect, true, false);
         }
@@ -2207,45 +3038,7 @@ void PDFTransparencyRenderer::performPathPainting(const QPainterPath& path, bool
             PDFPainterPathSampler pathSampler(worldPath, m_settings.samplesCount, 0.0f, strokeRect, m_settings.flags.testFlag(PDFTransparencyRendererSettings::PrecisePathSampler));
             const PDFMappedColor& strokeColor = getMappedStrokeColor();
 
-            if (isMultithreadedPathSamplingUsed(strokeRect))
-            {
-                if (strokeRect.width() > strokeRect.height())
-                {
-                    // Columns
-                    PDFIntegerRange<int> range(strokeRect.left(), strokeRect.right() + 1);
-                    auto processEntry = [&, this](int x)
-                    {
-                        for (int y = strokeRect.top(); y <= strokeRect.bottom(); ++y)
-                        {
-                            performPixelSampling(shapeStroking, opacityStroking, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, strokeColor, clipSampler, pathSampler);
-                        }
-                    };
-                    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processEntry);
-                }
-                else
-                {
-                    // Rows
-                    PDFIntegerRange<int> range(strokeRect.top(), strokeRect.bottom() + 1);
-                    auto processEntry = [&, this](int y)
-                    {
-                        for (int x = strokeRect.left(); x <= strokeRect.right(); ++x)
-                        {
-                            performPixelSampling(shapeStroking, opacityStroking, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, strokeColor, clipSampler, pathSampler);
-                        }
-                    };
-                    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processEntry);
-                }
-            }
-            else
-            {
-                for (int x = strokeRect.left(); x <= strokeRect.right(); ++x)
-                {
-                    for (int y = strokeRect.top(); y <= strokeRect.bottom(); ++y)
-                    {
-                        performPixelSampling(shapeStroking, opacityStroking, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, strokeColor, clipSampler, pathSampler);
-                    }
-                }
-            }
+            performPathSampling(shapeStroking, opacityStroking, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, strokeRect, strokeColor, clipSampler, pathSampler);
 
             m_drawBuffer.modify(strokeRect, false, true);
         }
@@ -2355,9 +3148,24 @@ bool PDFTransparencyRenderer::performPathPaintingUsingShading(const QPainterPath
     const uint32_t colorChannelStart = drawBufferPixelFormat.getColorChannelIndexStart();
     const uint32_t colorChannelEnd = drawBufferPixelFormat.getColorChannelIndexEnd();
 
-    for (int x = fillRect.left(); x <= fillRect.right(); ++x)
+    auto processRow = [&, this](int y)
     {
-        for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
+        thread_local PDFPainterPathSampler::RowCoverage clipCoverage;
+        thread_local PDFPainterPathSampler::RowCoverage pathCoverage;
+        pathSampler.computeRowCoverage(y, pathCoverage);
+
+        if (pathCoverage.left > pathCoverage.right)
+        {
+            return;
+        }
+
+        clipSampler.computeRowCoverage(y, clipCoverage);
+
+        // Only pixels covered by both the path and the clipping path can be painted
+        const int left = qMax(fillRect.left(), qMax(pathCoverage.left, clipCoverage.left));
+        const int right = qMin(fillRect.right(), qMin(pathCoverage.right, clipCoverage.right));
+
+        for (int x = left; x <= right; ++x)
         {
             const int texelCoordinateX = x - fillRect.left();
             const int texelCoordinateY = y - fillRect.top();
@@ -2365,8 +3173,8 @@ bool PDFTransparencyRenderer::performPathPaintingUsingShading(const QPainterPath
 
             const PDFColorComponent textureShape = texel[drawBufferShapeChannel];
             const PDFColorComponent textureOpacity = texel[drawBufferOpacityChannel];
-            const PDFColorComponent clipValue = clipSampler.sample(QPoint(x, y));
-            const PDFColorComponent objectShapeValue = pathSampler.sample(QPoint(x, y));
+            const PDFColorComponent clipValue = clipCoverage.value(x);
+            const PDFColorComponent objectShapeValue = pathCoverage.value(x);
             const PDFColorComponent shapeValue = objectShapeValue * clipValue * constantShape * textureShape;
             const PDFColorComponent opacityValue = shapeValue * constantOpacity * textureOpacity;
 
@@ -2388,6 +3196,19 @@ bool PDFTransparencyRenderer::performPathPaintingUsingShading(const QPainterPath
                 m_drawBuffer.markPixelActiveColorMask(x, y, texture.getPixelActiveColorMask(texelCoordinateX, texelCoordinateY));
             }
         }
+    };
+
+    if (isMultithreadedPathSamplingUsed(fillRect))
+    {
+        PDFIntegerRange<int> range(fillRect.top(), fillRect.bottom() + 1);
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processRow);
+    }
+    else
+    {
+        for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
+        {
+            processRow(y);
+        }
     }
 
     m_drawBuffer.modify(fillRect, fill, stroke);
@@ -2497,18 +3318,7 @@ void PDFTransparencyRenderer::performBeginTransparencyGroup(ProcessOrder order,
             // We have stored alpha_g_i in immediate buffer. We must mix it with alpha_0 to get alpha_i
             const PDFFloatBitmapWithColorSpace* initialBackdrop = getInitialBackdrop();
             const uint8_t opacityChannelIndex = initialBackdrop->getPixelFormat().getOpacityChannelIndex();
-            const size_t width = data.initialBackdrop.getWidth();
-            const size_t height = data.initialBackdrop.getHeight();
-
-            for (size_t x = 0; x < width; ++x)
-            {
-                for (size_t y = 0; y < height; ++y)
-                {
-                    PDFConstColorBuffer oldPixel = initialBackdrop->getPixel(x, y);
-                    PDFColorBuffer newPixel = data.initialBackdrop.getPixel(x, y);
-                    newPixel[opacityChannelIndex] = PDFBlendFunction::blend_Union(oldPixel[opacityChannelIndex], newPixel[opacityChannelIndex]);
-                }
-            }
+            data.initialBackdrop.uniteChannel(*initialBackdrop, opacityChannelIndex);
         }
 
         // Prepare soft mask
@@ -2536,6 +3346,10 @@ void PDFTransparencyRenderer::performEndTransparencyGroup(ProcessOrder order, co
 
     if (order == ProcessOrder::AfterOperation)
     {
+        // Bitmaps of the finished group are processed in float storage
+        getImmediateBackdrop()->setStorage(PDFFloatBitmap::Storage::Float);
+        getInitialBackdrop()->setStorage(PDFFloatBitmap::Storage::Float);
+
         // "Unblend" the initial backdrop from immediate backdrop, according to 11.4.8
         removeInitialBackdrop();
 
@@ -2623,8 +3437,63 @@ bool PDFTransparencyRenderer::performOriginalImagePainting(const PDFImage& image
     Q_UNUSED(stream);
 
     PDFFloatBitmap texture = getImage(image);
+    paintImageTexture(texture, image.isInterpolated());
+    return true;
+}
 
-    if (m_settings.flags.testFlag(PDFTransparencyRendererSettings::SmoothImageTransformation) && image.isInterpolated())
+bool PDFTransparencyRenderer::performXObjectImagePainting(const PDFStream* stream)
+{
+    if (!m_imageCache)
+    {
+        // Image is decoded by the content processor, if it is not clipped out
+        return false;
+    }
+
+    // Image masks are painted using current fill color, so they
+    // are not shared, they are decoded as usual.
+    const PDFObject& imageMaskObject = getDocument()->getObject(stream->getDictionary()->get("ImageMask"));
+    if (imageMaskObject.isBool() && imageMaskObject.getBool())
+    {
+        return false;
+    }
+
+    PDFTransparencyImageCache::Key key;
+    key.stream = stream;
+    key.colorSpaceDictionary = getColorSpaceDictionary();
+    key.blendColorSpace = getBlendColorSpace();
+    key.pixelFormat = m_drawBuffer.getPixelFormat();
+    key.renderingIntent = getGraphicState()->getRenderingIntent();
+    key.alphaIsShape = getGraphicState()->getAlphaIsShape();
+
+    if (isContentClippedOut(getCurrentWorldMatrix().mapRect(QRectF(0.0, 0.0, 1.0, 1.0))))
+    {
+        // Image lies outside of the paint area of this renderer (for example,
+        // in another band), it is not decoded, but cache must know about it.
+        m_imageCache->skipImage(key);
+        return true;
+    }
+
+    auto createImage = [this, stream]()
+    {
+        PDFImage image = createXObjectImage(stream);
+
+        PDFTransparencyImageCache::Image result;
+        result.texture = getImage(image);
+        result.isInterpolated = image.isInterpolated();
+        return result;
+    };
+
+    PDFTransparencyImageCache::ImagePointer image = m_imageCache->getImage(key, createImage);
+    paintImageTexture(image->texture, image->isInterpolated);
+    return true;
+}
+
+void PDFTransparencyRenderer::paintImageTexture(const PDFFloatBitmap& sourceTexture, bool isInterpolated)
+{
+    const PDFFloatBitmap* texture = &sourceTexture;
+    PDFFloatBitmap resizedTexture;
+
+    if (m_settings.flags.testFlag(PDFTransparencyRendererSettings::SmoothImageTransformation) && isInterpolated)
     {
         // Test, if we can use smooth images. We can use them under following conditions:
         //  1) Transformed rectangle is not skewed or deformed (so vectors (0, 1) and (1, 0) are orthogonal)
@@ -2632,14 +3501,14 @@ bool PDFTransparencyRenderer::performOriginalImagePainting(const PDFImage& image
         //  3) Aspect ratio of the image is the same
 
         QTransform matrix = getCurrentWorldMatrix();
-        QLineF mappedWidthVector = matrix.map(QLineF(0, 0, texture.getWidth(), 0));
-        QLineF mappedHeightVector = matrix.map(QLineF(0, 0, 0, texture.getHeight()));
+        QLineF mappedWidthVector = matrix.map(QLineF(0, 0, texture->getWidth(), 0));
+        QLineF mappedHeightVector = matrix.map(QLineF(0, 0, 0, texture->getHeight()));
         qreal angle = mappedWidthVector.angleTo(mappedHeightVector);
         if (qFuzzyCompare(angle, 90.0))
         {
             // Image is not skewed, so we if we are shrinking the image
-            const qreal originalWidth = texture.getWidth();
-            const qreal originalHeight = texture.getHeight();
+            const qreal originalWidth = texture->getWidth();
+            const qreal originalHeight = texture->getHeight();
             const qreal originalRatio = originalWidth / originalHeight;
             const qreal transformedWidth = mappedWidthVector.length();
             const qreal transformedHeight = mappedHeightVector.length();
@@ -2647,26 +3516,27 @@ bool PDFTransparencyRenderer::performOriginalImagePainting(const PDFImage& image
 
             if (qFuzzyCompare(originalRatio, transformedRatio) && originalWidth > transformedWidth && originalHeight > transformedHeight)
             {
-                uint32_t activeColorMask = texture.getPixelActiveColorMask(0, 0);
-                texture = texture.resize(qCeil(transformedWidth), qCeil(transformedHeight), Qt::SmoothTransformation);
-                texture.setColorActivity(activeColorMask);
+                uint32_t activeColorMask = texture->getPixelActiveColorMask(0, 0);
+                resizedTexture = texture->resize(qCeil(transformedWidth), qCeil(transformedHeight), Qt::SmoothTransformation);
+                resizedTexture.setColorActivity(activeColorMask);
+                texture = &resizedTexture;
             }
         }
     }
 
-    QTransform imageTransform(1.0 / qreal(texture.getWidth()), 0, 0, 1.0 / qreal(texture.getHeight()), 0, 0);
+    QTransform imageTransform(1.0 / qreal(texture->getWidth()), 0, 0, 1.0 / qreal(texture->getHeight()), 0, 0);
     QTransform worldMatrix = imageTransform * getCurrentWorldMatrix();
 
     // Because Qt uses opposite axis direction than PDF, then we must transform the y-axis
     // to the opposite (so the image is then unchanged)
-    worldMatrix.translate(0.0, texture.getHeight());
+    worldMatrix.translate(0.0, texture->getHeight());
     worldMatrix.scale(1, -1);
 
     QPolygonF imagePolygon;
     imagePolygon << QPointF(0.0, 0.0);
-    imagePolygon << QPointF(0.0, texture.getHeight());
-    imagePolygon << QPointF(texture.getWidth(), texture.getHeight());
-    imagePolygon << QPointF(texture.getWidth(), 0.0);
+    imagePolygon << QPointF(0.0, texture->getHeight());
+    imagePolygon << QPointF(texture->getWidth(), texture->getHeight());
+    imagePolygon << QPointF(texture->getWidth(), 0.0);
 
     QTransform worldToTextureMatrix = worldMatrix.inverted();
     QRectF boundingRectangle = worldMatrix.map(imagePolygon).boundingRect();
@@ -2678,7 +3548,7 @@ bool PDFTransparencyRenderer::performOriginalImagePainting(const PDFImage& image
     PDFPixelFormat format = m_drawBuffer.getPixelFormat();
     Q_ASSERT(format.hasShapeChannel());
     Q_ASSERT(format.hasOpacityChannel());
-    Q_ASSERT(format == texture.getPixelFormat());
+    Q_ASSERT(format == texture->getPixelFormat());
 
     const uint8_t shapeChannel = format.getShapeChannelIndex();
     const uint8_t opacityChannel = format.getOpacityChannelIndex();
@@ -2691,51 +3561,36 @@ bool PDFTransparencyRenderer::performOriginalImagePainting(const PDFImage& image
     {
         PDFPainterPathSampler clipSampler(m_painterStateStack.top().clipPath, m_settings.samplesCount, 1.0f, fillRect, m_settings.flags.testFlag(PDFTransparencyRendererSettings::PrecisePathSampler));
 
-        if (isMultithreadedPathSamplingUsed(fillRect))
+        auto processRow = [&, this](int y)
         {
-            if (fillRect.width() > fillRect.height())
-            {
-                // Columns
-                PDFIntegerRange<int> range(fillRect.left(), fillRect.right() + 1);
-                auto processEntry = [&, this](int x)
-                {
-                    for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
-                    {
-                        performFillFragmentFromTexture(shape, opacity, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, worldToTextureMatrix, texture, clipSampler);
-                    }
-                };
-                PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processEntry);
-            }
-            else
+            thread_local PDFPainterPathSampler::RowCoverage clipCoverage;
+            clipSampler.computeRowCoverage(y, clipCoverage);
+
+            const int left = qMax(fillRect.left(), clipCoverage.left);
+            const int right = qMin(fillRect.right(), clipCoverage.right);
+
+            for (int x = left; x <= right; ++x)
             {
-                // Rows
-                PDFIntegerRange<int> range(fillRect.top(), fillRect.bottom() + 1);
-                auto processEntry = [&, this](int y)
-                {
-                    for (int x = fillRect.left(); x <= fillRect.right(); ++x)
-                    {
-                        performFillFragmentFromTexture(shape, opacity, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, worldToTextureMatrix, texture, clipSampler);
-                    }
-                };
-                PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processEntry);
+                performFillFragmentFromTexture(shape, opacity, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, worldToTextureMatrix, *texture, clipCoverage.value(x));
             }
+        };
+
+        if (isMultithreadedPathSamplingUsed(fillRect))
+        {
+            PDFIntegerRange<int> range(fillRect.top(), fillRect.bottom() + 1);
+            PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), processRow);
         }
         else
         {
-            for (int x = fillRect.left(); x <= fillRect.right(); ++x)
+            for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
             {
-                for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
-                {
-                    performFillFragmentFromTexture(shape, opacity, shapeChannel, opacityChannel, colorChannelStart, colorChannelEnd, x, y, worldToTextureMatrix, texture, clipSampler);
-                }
+                processRow(y);
             }
         }
 
         m_drawBuffer.modify(fillRect, true, false);
         flushDrawBuffer();
     }
-
-    return true;
 }
 
 void PDFTransparencyRenderer::performImagePainting(const QImage& image)
@@ -2995,6 +3850,11 @@ PDFTransparencyRenderer::PDFMappedColor PDFTransparencyRenderer::getMappedFillCo
     return createMappedColor(sourceColor, sourceColorSpace);
 }
 
+PDFFloatBitmap::Storage PDFTransparencyRenderer::getBlendingStorage() const
+{
+    return m_settings.flags.testFlag(PDFTransparencyRendererSettings::FixedPointBlending) ? PDFFloatBitmap::Storage::FixedPoint16 : PDFFloatBitmap::Storage::Float;
+}
+
 QRect PDFTransparencyRenderer::getPaintRect() const
 {
     return QRect(0, 0, int(getBackdrop()->getWidth()), int(getBackdrop()->getHeight()));
@@ -3521,10 +4381,9 @@ PDFPainterPathSampler::PDFPainterPathSampler(QPainterPath path, int samplesCount
     m_fillRect(fillRect),
     m_precise(precise)
 {
-    if (!precise)
+    if (!precise && !m_path.isEmpty())
     {
-        m_fillPolygon = m_path.toFillPolygon();
-        prepareScanLines();
+        prepareEdges();
     }
 }
 
@@ -3535,11 +4394,158 @@ PDFColorComponent PDFPainterPathSampler::sample(QPoint point) const
         return m_defaultShape;
     }
 
-    if (!m_scanLineInfo.empty())
+    if (m_precise)
+    {
+        return sampleByGrid(point);
+    }
+
+    std::lock_guard<std::mutex> lock(m_sampledRowMutex);
+    if (!m_isSampledRowValid || m_sampledRow != point.y())
     {
-        return sampleByScanLine(point);
+        computeRowCoverage(point.y(), m_sampledRowCoverage);
+        m_sampledRow = point.y();
+        m_isSampledRowValid = true;
     }
 
+    return m_sampledRowCoverage.value(point.x());
+}
+
+void PDFPainterPathSampler::computeRowCoverage(int y, RowCoverage& coverage) const
+{
+    coverage.left = 0;
+    coverage.right = -1;
+    coverage.values.clear();
+
+    if (y < m_fillRect.top() || y > m_fillRect.bottom())
+    {
+        return;
+    }
+
+    if (m_path.isEmpty())
+    {
+        coverage.left = m_fillRect.left();
+        coverage.right = m_fillRect.right();
+        coverage.values.assign(m_fillRect.width(), m_defaultShape);
+        return;
+    }
+
+    if (m_precise)
+    {
+        coverage.left = m_fillRect.left();
+        coverage.right = m_fillRect.right();
+        coverage.values.reserve(m_fillRect.width());
+
+        for (int x = m_fillRect.left(); x <= m_fillRect.right(); ++x)
+        {
+            coverage.values.push_back(sampleByGrid(QPoint(x, y)));
+        }
+        return;
+    }
+
+    const size_t bandIndex = (y - m_fillRect.top()) / BAND_HEIGHT;
+    if (bandIndex >= m_bandEdges.size() || m_bandEdges[bandIndex].empty())
+    {
+        return;
+    }
+
+    const std::vector<size_t>& bandEdges = m_bandEdges[bandIndex];
+    const Qt::FillRule fillRule = m_path.fillRule();
+    const int left = m_fillRect.left();
+    const int width = m_fillRect.width();
+    const PDFReal leftBound = left;
+    const PDFReal rightBound = left + width;
+    const PDFReal sampleGain = 1.0 / PDFReal(m_samplesCount);
+
+    // Accumulation buffers - area contains fractional coverage of pixels,
+    // cover contains differences of coverage of fully covered pixels.
+    coverage.area.assign(width + 1, 0.0);
+    coverage.cover.assign(width + 1, 0.0);
+
+    int minIndex = width;
+    int maxIndex = -1;
+
+    for (int subScanLine = 0; subScanLine < m_samplesCount; ++subScanLine)
+    {
+        const PDFReal scanLineY = y + (subScanLine + 0.5) * sampleGain;
+
+        coverage.crossings.clear();
+        for (const size_t edgeIndex : bandEdges)
+        {
+            const Edge& edge = m_edges[edgeIndex];
+            if (edge.y1 <= scanLineY && scanLineY < edge.y2)
+            {
+                coverage.crossings.emplace_back(edge.x1 + (scanLineY - edge.y1) * edge.dxdy, edge.windingNumber);
+            }
+        }
+
+        if (coverage.crossings.empty())
+        {
+            continue;
+        }
+
+        std::sort(coverage.crossings.begin(), coverage.crossings.end());
+
+        // Accumulate spans inside the path
+        int windingNumber = 0;
+        for (size_t i = 0; i + 1 < coverage.crossings.size(); ++i)
+        {
+            windingNumber += coverage.crossings[i].second;
+
+            const bool inside = (fillRule == Qt::WindingFill) ? windingNumber != 0 : windingNumber % 2 != 0;
+            if (!inside)
+            {
+                continue;
+            }
+
+            const PDFReal x1 = qBound(leftBound, coverage.crossings[i].first, rightBound) - leftBound;
+            const PDFReal x2 = qBound(leftBound, coverage.crossings[i + 1].first, rightBound) - leftBound;
+
+            if (x2 <= x1)
+            {
+                continue;
+            }
+
+            // Index of the last pixel can be equal to width, but then
+            // its coverage is zero (buffers have one additional item).
+            const int index1 = int(x1);
+            const int index2 = int(x2);
+
+            if (index1 == index2)
+            {
+                coverage.area[index1] += (x2 - x1) * sampleGain;
+            }
+            else
+            {
+                coverage.area[index1] += (index1 + 1 - x1) * sampleGain;
+                coverage.cover[index1 + 1] += sampleGain;
+                coverage.cover[index2] -= sampleGain;
+                coverage.area[index2] += (x2 - index2) * sampleGain;
+            }
+
+            minIndex = qMin(minIndex, index1);
+            maxIndex = qMax(maxIndex, qMin(index2, width - 1));
+        }
+    }
+
+    if (minIndex > maxIndex)
+    {
+        return;
+    }
+
+    coverage.left = left + minIndex;
+    coverage.right = left + maxIndex;
+    coverage.values.reserve(maxIndex - minIndex + 1);
+
+    PDFReal accumulatedCover = 0.0;
+    for (int i = minIndex; i <= maxIndex; ++i)
+    {
+        accumulatedCover += coverage.cover[i];
+        coverage.values.push_back(qBound(0.0f, PDFColorComponent(coverage.area[i] + accumulatedCover), 1.0f));
+    }
+}
+
+PDFColorComponent PDFPainterPathSampler::sampleByGrid(QPoint point) const
+{
     const qreal coordX1 = point.x();
     const qreal coordX2 = coordX1 + 1.0;
     const qreal coordY1 = point.y();
@@ -3556,33 +4562,14 @@ PDFColorComponent PDFPainterPathSampler::sample(QPoint point) const
     if (m_samplesCount <= 1)
     {
         // Jakub Melka: Just one sample
-        if (m_precise)
-        {
-            return m_path.contains(QPointF(centerX, centerY)) ? 1.0f : 0.0f;
-        }
-        else
-        {
-            return m_fillPolygon.contains(QPointF(centerX, centerY)) ? 1.0f : 0.0f;
-        }
+        return m_path.contains(QPointF(centerX, centerY)) ? 1.0f : 0.0f;
     }
 
     int cornerHits = 0;
-    Qt::FillRule fillRule = m_path.fillRule();
-
-    if (m_precise)
-    {
-        cornerHits += m_path.contains(topLeft) ? 1 : 0;
-        cornerHits += m_path.contains(topRight) ? 1 : 0;
-        cornerHits += m_path.contains(bottomLeft) ? 1 : 0;
-        cornerHits += m_path.contains(bottomRight) ? 1 : 0;
-    }
-    else
-    {
-        cornerHits += m_fillPolygon.containsPoint(topLeft, fillRule) ? 1 : 0;
-        cornerHits += m_fillPolygon.containsPoint(topRight, fillRule) ? 1 : 0;
-        cornerHits += m_fillPolygon.containsPoint(bottomLeft, fillRule) ? 1 : 0;
-        cornerHits += m_fillPolygon.containsPoint(bottomRight, fillRule) ? 1 : 0;
-    }
+    cornerHits += m_path.contains(topLeft) ? 1 : 0;
+    cornerHits += m_path.contains(topRight) ? 1 : 0;
+    cornerHits += m_path.contains(bottomLeft) ? 1 : 0;
+    cornerHits += m_path.contains(bottomRight) ? 1 : 0;
 
     if (cornerHits == 4)
     {
@@ -3608,19 +4595,9 @@ PDFColorComponent PDFPainterPathSampler::sample(QPoint point) const
         {
             const qreal y = offset * (iy + 1) + coordY1;
 
-            if (m_precise)
+            if (m_path.contains(QPointF(x, y)))
             {
-                if (m_path.contains(QPointF(x, y)))
-                {
-                    sampleValue += sampleGain;
-                }
-            }
-            else
-            {
-                if (m_fillPolygon.containsPoint(QPointF(x, y), fillRule))
-                {
-                    sampleValue += sampleGain;
-                }
+                sampleValue += sampleGain;
             }
         }
     }
@@ -3628,231 +4605,388 @@ PDFColorComponent PDFPainterPathSampler::sample(QPoint point) const
     return sampleValue;
 }
 
-PDFColorComponent PDFPainterPathSampler::sampleByScanLine(QPoint point) const
+void PDFPainterPathSampler::prepareEdges()
 {
-    int scanLinePosition = point.y() - m_fillRect.y();
+    const int bandCount = (m_fillRect.height() + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    if (bandCount <= 0)
+    {
+        return;
+    }
 
-    size_t scanLineCountPerPixel = getScanLineCountPerPixel();
-    size_t scanLineTopRow = scanLinePosition * scanLineCountPerPixel;
-    size_t scanLineBottomRow = scanLineTopRow + scanLineCountPerPixel - 1;
-    size_t scanLineGridRowTop = scanLineTopRow + 1;
+    QPolygonF fillPolygon = m_path.toFillPolygon();
+    if (fillPolygon.size() < 2)
+    {
+        return;
+    }
+
+    m_bandEdges.resize(bandCount);
+    m_edges.reserve(fillPolygon.size());
 
-    Qt::FillRule fillRule = m_path.fillRule();
+    const PDFReal top = m_fillRect.top();
 
-    auto performSampling = [&](size_t scanLineIndex, PDFReal firstOrdinate, int sampleCount, PDFReal step, PDFReal gain)
+    // Create edges of the polygon, we must also implicitly close
+    // last edge (if polygon is not closed). Horizontal edges are ignored.
+    // Each edge is registered in all bands of rows it crosses.
+    auto addEdge = [&, this](const QPointF& p1, const QPointF& p2)
     {
-        ScanLineInfo info = m_scanLineInfo[scanLineIndex];
-        auto it = std::next(m_scanLineSamples.cbegin(), info.indexStart);
+        Edge edge;
+        edge.x1 = p1.x();
+        edge.y1 = p1.y();
+        edge.y2 = p2.y();
+        edge.windingNumber = 1;
 
-        PDFReal ordinate = firstOrdinate;
-        PDFColorComponent value = 0.0;
-        auto ordinateIt = it;
-        for (int i = 0; i < sampleCount; ++i)
+        PDFReal x2 = p2.x();
+
+        if (qFuzzyIsNull(edge.y2 - edge.y1) || !std::isfinite(edge.y1) || !std::isfinite(edge.y2))
         {
-            while (std::next(ordinateIt)->x < ordinate)
-            {
-                ++ordinateIt;
-            }
+            return;
+        }
 
-            int windingNumber = ordinateIt->windingNumber;
+        if (edge.y2 < edge.y1)
+        {
+            std::swap(edge.y1, edge.y2);
+            std::swap(edge.x1, x2);
+            edge.windingNumber = -1;
+        }
 
-            const bool inside = (fillRule == Qt::WindingFill) ? windingNumber != 0 : windingNumber % 2 != 0;
-            if (inside)
-            {
-                value += gain;
-            }
+        const PDFReal firstBandValue = std::floor((edge.y1 - top) / BAND_HEIGHT);
+        const PDFReal lastBandValue = std::floor((edge.y2 - top) / BAND_HEIGHT);
 
-            ordinate += step;
+        if (lastBandValue < 0.0 || firstBandValue >= bandCount)
+        {
+            // Edge is outside of the fill rectangle
+            return;
         }
 
-        return value;
-    };
+        const int firstBand = int(qMax(firstBandValue, 0.0));
+        const int lastBand = int(qMin(lastBandValue, PDFReal(bandCount - 1)));
 
-    const qreal coordX1 = point.x();
-    const PDFReal cornerValue = performSampling(scanLineTopRow, coordX1, 2, 1.0, 1.0) + performSampling(scanLineBottomRow, coordX1, 2, 1.0, 1.0);
+        edge.dxdy = (x2 - edge.x1) / (edge.y2 - edge.y1);
+
+        const size_t edgeIndex = m_edges.size();
+        m_edges.push_back(edge);
+
+        for (int band = firstBand; band <= lastBand; ++band)
+        {
+            m_bandEdges[band].push_back(edgeIndex);
+        }
+    };
 
-    if (qFuzzyIsNull(4.0 - cornerValue))
+    for (int i = 1; i < fillPolygon.size(); ++i)
     {
-        // Whole inside
-        return 1.0;
+        addEdge(fillPolygon[i - 1], fillPolygon[i]);
     }
 
-    if (qFuzzyIsNull(cornerValue))
+    if (fillPolygon.front() != fillPolygon.back())
     {
-        // Whole outside
-        return 0.0;
+        addEdge(fillPolygon.back(), fillPolygon.front());
     }
+}
 
-    const qreal offset = 1.0f / PDFColorComponent(m_samplesCount + 1);
-    PDFColorComponent sampleValue = 0.0f;
-    const PDFColorComponent sampleGain = 1.0f / PDFColorComponent(m_samplesCount * m_samplesCount);
+void PDFDrawBuffer::clear()
+{
+    if (!m_modifiedRect.isValid())
+    {
+        return;
+    }
 
-    for (int i = 0; i < m_samplesCount; ++i)
+    for (int x = m_modifiedRect.left(); x <= m_modifiedRect.right(); ++x)
     {
-        sampleValue += performSampling(scanLineGridRowTop++, coordX1 + offset, m_samplesCount, offset, sampleGain);
+        for (int y = m_modifiedRect.top(); y <= m_modifiedRect.bottom(); ++y)
+        {
+            PDFColorBuffer buffer = getPixel(x, y);
+            std::fill(buffer.begin(), buffer.end(), 0.0f);
+            setPixelActiveColorMask(x, y, 0);
+        }
     }
 
-    return sampleValue;
+    m_containsFilling = false;
+    m_containsStroking = false;
+    m_modifiedRect = QRect();
+}
+
+void PDFDrawBuffer::modify(QRect rect, bool containsFilling, bool containsStroking)
+{
+    m_modifiedRect = m_modifiedRect.united(rect);
+    m_containsFilling |= containsFilling;
+    m_containsStroking |= containsStroking;
+}
+
+void PDFTransparencyRenderer::PDFTransparencyGroupPainterData::makeInitialBackdropTransparent()
+{
+    initialBackdrop.makeTransparent();
 }
 
-size_t PDFPainterPathSampler::getScanLineCountPerPixel() const
+void PDFTransparencyRenderer::PDFTransparencyGroupPainterData::makeImmediateBackdropTransparent()
 {
-    return m_samplesCount + 2;
+    immediateBackdrop.makeTransparent();
+    immediateBackdrop.setAllColorInactive();
 }
 
-void PDFPainterPathSampler::prepareScanLines()
+void PDFTransparencyRenderer::PDFTransparencySoftMask::makeOpaque()
 {
-    if (m_fillPolygon.isEmpty())
+    if (!isOpaque())
     {
-        return;
+        m_data->isOpaque = true;
+        m_data->softMask.makeOpaque();
     }
+}
 
-    for (int yOffset = m_fillRect.top(); yOffset <= m_fillRect.bottom(); ++yOffset)
+bool PDFTransparencyImageCache::Key::operator==(const Key& other) const
+{
+    if (stream != other.stream ||
+        colorSpaceDictionary != other.colorSpaceDictionary ||
+        pixelFormat != other.pixelFormat ||
+        renderingIntent != other.renderingIntent ||
+        alphaIsShape != other.alphaIsShape)
     {
-        const qreal coordY1 = yOffset;
-        const qreal coordY2 = coordY1 + 1.0;
-
-        // Top pixel line
-        if (m_scanLineInfo.empty())
-        {
-            m_scanLineInfo.emplace_back(createScanLine(coordY1));
-        }
-        else
-        {
-            m_scanLineInfo.emplace_back(m_scanLineInfo.back());
-        }
-
-        // Sample grid
-        const qreal offset = 1.0f / PDFColorComponent(m_samplesCount + 1);
-        for (int iy = 0; iy < m_samplesCount; ++iy)
-        {
-            const qreal y = offset * (iy + 1) + coordY1;
-            m_scanLineInfo.emplace_back(createScanLine(y));
-        }
+        return false;
+    }
 
-        // Bottom pixel line
-        m_scanLineInfo.emplace_back(createScanLine(coordY2));
+    if (!blendColorSpace || !other.blendColorSpace)
+    {
+        return blendColorSpace == other.blendColorSpace;
     }
+
+    return blendColorSpace->equals(other.blendColorSpace.data());
 }
 
-PDFPainterPathSampler::ScanLineInfo PDFPainterPathSampler::createScanLine(qreal y)
+PDFTransparencyImageCache::ImagePointer PDFTransparencyImageCache::getImage(const Key& key, const std::function<Image()>& createImage)
 {
-    ScanLineInfo result;
-    result.indexStart = m_scanLineSamples.size();
+    std::shared_ptr<Entry> entry;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entry = getEntry(key);
+    }
 
-    // Add start item
-    m_scanLineSamples.emplace_back(-std::numeric_limits<PDFReal>::infinity(), 0);
+    ImagePointer image;
 
-    // Traverse polygon, add sample for each polygon line, we must
-    // also implicitly close last edge (if polygon is not closed)
-    for (int i = 1; i < m_fillPolygon.size(); ++i)
     {
-        createScanLineSample(m_fillPolygon[i - 1], m_fillPolygon[i], y);
+        // Only one renderer decodes the image, others wait until
+        // it is decoded. If decoding fails, next renderer tries it again.
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (!entry->image)
+        {
+            entry->image = std::make_shared<const Image>(createImage());
+        }
+
+        image = entry->image;
     }
 
-    if (m_fillPolygon.front() != m_fillPolygon.back())
     {
-        createScanLineSample(m_fillPolygon.back(), m_fillPolygon.front(), y);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        finishRequest(entry);
     }
 
-    // Add end item
-    m_scanLineSamples.emplace_back(+std::numeric_limits<PDFReal>::infinity(), 0);
+    return image;
+}
 
-    result.indexEnd = m_scanLineSamples.size();
+void PDFTransparencyImageCache::skipImage(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    finishRequest(getEntry(key));
+}
 
-    auto it = std::next(m_scanLineSamples.begin(), result.indexStart);
-    auto itEnd = std::next(m_scanLineSamples.begin(), result.indexEnd);
+std::shared_ptr<PDFTransparencyImageCache::Entry> PDFTransparencyImageCache::getEntry(const Key& key)
+{
+    auto it = std::find_if(m_entries.cbegin(), m_entries.cend(), [&key](const auto& entry) { return entry->key == key; });
+    if (it != m_entries.cend())
+    {
+        return *it;
+    }
 
-    // Jakub Melka: now, sort the line samples and compute properly the winding number
-    std::sort(it, itEnd);
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->key = key;
+    m_entries.push_back(entry);
+    return entry;
+}
 
-    int currentWindingNumber = 0;
-    for (; it != itEnd; ++it)
+void PDFTransparencyImageCache::finishRequest(const std::shared_ptr<Entry>& entry)
+{
+    // Remove the image, when all renderers have requested it
+    if (++entry->requestCount >= m_rendererCount)
     {
-        currentWindingNumber += it->windingNumber;
-        it->windingNumber = currentWindingNumber;
+        m_entries.erase(std::remove(m_entries.begin(), m_entries.end(), entry), m_entries.end());
     }
+}
 
-    return result;
+void PDFTransparencyImageCache::reset(size_t rendererCount)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_rendererCount = qMax(rendererCount, size_t(1));
 }
 
-void PDFPainterPathSampler::createScanLineSample(const QPointF& p1, const QPointF& p2, qreal y)
+PDFTransparencyBandRenderer::PDFTransparencyBandRenderer(const PDFPage* page,
+                                                         const PDFDocument* document,
+                                                         const PDFFontCache* fontCache,
+                                                         const PDFCMS* cms,
+                                                         const PDFOptionalContentActivity* optionalContentActivity,
+                                                         const PDFInkMapper* inkMapper,
+                                                         PDFTransparencyRendererSettings settings,
+                                                         QTransform pagePointToDevicePointMatrix) :
+    m_page(page),
+    m_document(document),
+    m_fontCache(fontCache),
+    m_cms(cms),
+    m_optionalContentActivity(optionalContentActivity),
+    m_inkMapper(inkMapper),
+    m_settings(settings),
+    m_pagePointToDevicePointMatrix(pagePointToDevicePointMatrix)
+{
+
+}
+
+QList<PDFRenderError> PDFTransparencyBandRenderer::render(QSize pixelSize)
 {
-    PDFReal y1 = p1.y();
-    PDFReal y2 = p2.y();
+    m_pixelSize = pixelSize;
+    m_bands.clear();
 
-    if (qFuzzyIsNull(y2 - y1))
+    if (!pixelSize.isValid())
     {
-        // Ignore horizontal lines
-        return;
+        return QList<PDFRenderError>();
     }
 
-    PDFReal x1 = p1.x();
-    PDFReal x2 = p2.x();
+    // Determine band count. Each band should have at least minimal band height,
+    // and we do not create more bands, than threads which can render them.
+    int bandCount = 1;
+    if (m_settings.flags.testFlag(PDFTransparencyRendererSettings::BandParallelRendering))
+    {
+        const int minimalBandHeight = qMax(m_settings.minimalBandHeight, 1);
+        const int maximalBandCount = (pixelSize.height() + minimalBandHeight - 1) / minimalBandHeight;
+        bandCount = qBound(1, PDFExecutionPolicy::getMaxThreadCount(PDFExecutionPolicy::Scope::Page), maximalBandCount);
+    }
 
-    int windingNumber = 1;
-    if (y2 < y1)
+    const int bandHeight = (pixelSize.height() + bandCount - 1) / bandCount;
+    for (int top = 0; top < pixelSize.height(); top += bandHeight)
     {
-        std::swap(y1, y2);
-        std::swap(x1, x2);
-        windingNumber = -1;
+        Band band;
+        band.top = top;
+        m_bands.emplace_back(qMove(band));
     }
 
-    // Do we have intercept?
-    if (y1 <= y && y < y2)
+    std::vector<QList<PDFRenderError>> bandErrors(m_bands.size());
+    m_imageCache.reset(m_bands.size());
+
+    auto renderBand = [&, this](size_t bandIndex)
     {
-        const PDFReal x = interpolate(y, y1, y2, x1, x2);
-        m_scanLineSamples.emplace_back(x, windingNumber);
+        Band& band = m_bands[bandIndex];
+        const int height = qMin(bandHeight, pixelSize.height() - band.top);
+
+        // Band is rendered as a whole page shifted upwards by band top,
+        // so band's renderer only draws pixels of this band.
+        QTransform bandMatrix = m_pagePointToDevicePointMatrix * QTransform::fromTranslate(0.0, -band.top);
+        band.renderer.reset(new PDFTransparencyRenderer(m_page, m_document, m_fontCache, m_cms, m_optionalContentActivity,
+                                                        m_inkMapper, m_settings, bandMatrix));
+
+        if (m_bands.size() > 1)
+        {
+            // Content outside of the band is skipped before it is sampled
+            band.renderer->setRegionOfInterest(QRectF(0.0, 0.0, pixelSize.width(), height));
+            band.renderer->setImageCache(&m_imageCache);
+        }
+
+        band.renderer->beginPaint(QSize(pixelSize.width(), height));
+        bandErrors[bandIndex] = band.renderer->processContents();
+        band.renderer->endPaint();
+    };
+
+    PDFIntegerRange<size_t> range(0, m_bands.size());
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), renderBand);
+
+    // Decoded images are no longer needed
+    m_imageCache.reset(m_bands.size());
+
+    // Each band processes the same content stream, so the same
+    // errors are usually reported for each band.
+    QList<PDFRenderError> errors;
+    for (const QList<PDFRenderError>& currentBandErrors : bandErrors)
+    {
+        for (const PDFRenderError& error : currentBandErrors)
+        {
+            auto isSameError = [&error](const PDFRenderError& otherError) { return error.type == otherError.type && error.message == otherError.message; };
+            if (std::none_of(errors.cbegin(), errors.cend(), isSameError))
+            {
+                errors.push_back(error);
+            }
+        }
     }
+
+    return errors;
 }
 
-void PDFDrawBuffer::clear()
+QImage PDFTransparencyBandRenderer::toImage(bool use16Bit, bool usePaper, const PDFRGB& paperColor) const
 {
-    if (!m_modifiedRect.isValid())
+    if (m_bands.empty())
     {
-        return;
+        return QImage();
     }
 
-    for (int x = m_modifiedRect.left(); x <= m_modifiedRect.right(); ++x)
+    if (m_bands.size() == 1)
     {
-        for (int y = m_modifiedRect.top(); y <= m_modifiedRect.bottom(); ++y)
+        return m_bands.front().renderer->toImage(use16Bit, usePaper, paperColor);
+    }
+
+    QImage image;
+    for (const Band& band : m_bands)
+    {
+        QImage bandImage = band.renderer->toImage(use16Bit, usePaper, paperColor);
+
+        if (bandImage.isNull())
         {
-            PDFColorBuffer buffer = getPixel(x, y);
-            std::fill(buffer.begin(), buffer.end(), 0.0f);
-            setPixelActiveColorMask(x, y, 0);
+            return QImage();
         }
-    }
 
-    m_containsFilling = false;
-    m_containsStroking = false;
-    m_modifiedRect = QRect();
-}
+        if (image.isNull())
+        {
+            image = QImage(m_pixelSize, bandImage.format());
+        }
 
-void PDFDrawBuffer::modify(QRect rect, bool containsFilling, bool containsStroking)
-{
-    m_modifiedRect = m_modifiedRect.united(rect);
-    m_containsFilling |= containsFilling;
-    m_containsStroking |= containsStroking;
-}
+        Q_ASSERT(image.format() == bandImage.format());
+        Q_ASSERT(image.bytesPerLine() == bandImage.bytesPerLine());
 
-void PDFTransparencyRenderer::PDFTransparencyGroupPainterData::makeInitialBackdropTransparent()
-{
-    initialBackdrop.makeTransparent();
-}
+        for (int y = 0; y < bandImage.height(); ++y)
+        {
+            std::copy_n(bandImage.constScanLine(y), bandImage.bytesPerLine(), image.scanLine(band.top + y));
+        }
+    }
 
-void PDFTransparencyRenderer::PDFTransparencyGroupPainterData::makeImmediateBackdropTransparent()
-{
-    immediateBackdrop.makeTransparent();
-    immediateBackdrop.setAllColorInactive();
+    return image;
 }
 
-void PDFTransparencyRenderer::PDFTransparencySoftMask::makeOpaque()
+PDFFloatBitmapWithColorSpace PDFTransparencyBandRenderer::getOriginalProcessBitmap() const
 {
-    if (!isOpaque())
+    if (m_bands.empty())
     {
-        m_data->isOpaque = true;
-        m_data->softMask.makeOpaque();
+        return PDFFloatBitmapWithColorSpace();
+    }
+
+    if (m_bands.size() == 1)
+    {
+        return m_bands.front().renderer->getOriginalProcessBitmap();
+    }
+
+    PDFFloatBitmapWithColorSpace bitmap;
+    for (const Band& band : m_bands)
+    {
+        PDFFloatBitmapWithColorSpace bandBitmap = band.renderer->getOriginalProcessBitmap();
+
+        if (bandBitmap.getWidth() == 0)
+        {
+            // Original process bitmap was not saved
+            return PDFFloatBitmapWithColorSpace();
+        }
+
+        if (bitmap.getWidth() == 0)
+        {
+            bitmap = PDFFloatBitmapWithColorSpace(bandBitmap.getWidth(), m_pixelSize.height(), bandBitmap.getPixelFormat(), bandBitmap.getColorSpace());
+        }
+
+        bitmap.copyRows(bandBitmap, band.top);
     }
+
+    return bitmap;
 }
 
 PDFInkCoverageCalculator::PDFInkCoverageCalculator(const PDFDocument* document,
@@ -3890,7 +5024,12 @@ void PDFInkCoverageCalculator::perform(QSize size, const std::vector<PDFInteger>
         m_progress->start(pages.size(), ProgressStartupInfo());
     }
 
-    auto calculatePageCoverage = [this, size](PDFInteger pageIndex)
+    // If we have less pages than threads, pages are processed one by one,
+    // and each page is rendered in bands in parallel. Otherwise pages
+    // are processed in parallel, each page as a single band.
+    const bool useBandParallelRendering = PDFInteger(pages.size()) < PDFInteger(PDFExecutionPolicy::getIdealThreadCount(PDFExecutionPolicy::Scope::Page));
+
+    auto calculatePageCoverage = [this, size, useBandParallelRendering](PDFInteger pageIndex)
     {
         if (pageIndex >= PDFInteger(m_document->getCatalog()->getPageCount()))
         {
@@ -3924,15 +5063,14 @@ void PDFInkCoverageCalculator::perform(QSize size, const std::vector<PDFInteger>
         settings.flags.setFlag(PDFTransparencyRendererSettings::ActiveColorMask, false);
         settings.flags.setFlag(PDFTransparencyRendererSettings::SeparationSimulation, true);
         settings.activeColorMask = PDFPixelFormat::getAllColorsMask();
+        settings.flags.setFlag(PDFTransparencyRendererSettings::BandParallelRendering, useBandParallelRendering);
 
         QTransform pagePointToDevicePoint = pdf::PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize));
         pdf::PDFCMSPointer cms = m_cmsManager->getCurrentCMS();
-        pdf::PDFTransparencyRenderer renderer(page, m_document, m_fontCache, cms.data(), m_optionalContentActivity,
-                                              m_inkMapper, settings, pagePointToDevicePoint);
+        pdf::PDFTransparencyBandRenderer renderer(page, m_document, m_fontCache, cms.data(), m_optionalContentActivity,
+                                                  m_inkMapper, settings, pagePointToDevicePoint);
 
-        renderer.beginPaint(imageSize);
-        renderer.processContents();
-        renderer.endPaint();
+        renderer.render(imageSize);
 
         PDFFloatBitmapWithColorSpace originalProcessImage = renderer.getOriginalProcessBitmap();
         QSizeF pageSizeMM = page->getRotatedMediaBoxMM().size();
@@ -3995,7 +5133,14 @@ void PDFInkCoverageCalculator::perform(QSize size, const std::vector<PDFInteger>
         m_inkCoverageResults[pageIndex] = qMove(results);
     };
 
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pages.begin(), pages.end(), calculatePageCoverage);
+    if (useBandParallelRendering)
+    {
+        std::for_each(pages.begin(), pages.end(), calculatePageCoverage);
+    }
+    else
+    {
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pages.begin(), pages.end(), calculatePageCoverage);
+    }
 
     if (m_progress)
     {
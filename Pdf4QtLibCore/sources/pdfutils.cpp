@@ -98,22 +98,19 @@ PDFBitReader::Value PDFBitReader::read(PDFBitReader::Value bits)
 
 PDFBitReader::Value PDFBitReader::look(Value bits) const
 {
-    PDFBitReader temp(*this);
+    // Fill the local copy of the buffer, bits beyond the end of the stream are zero
+    Value buffer = m_buffer;
+    Value bitsInBuffer = m_bitsInBuffer;
+    int position = m_position;
 
-    Value result = 0;
-    for (Value i = 0; i < bits; ++i)
+    while (bitsInBuffer < bits)
     {
-        if (!temp.isAtEnd())
-        {
-            result = (result << 1) | temp.read(1);
-        }
-        else
-        {
-            result = (result << 1);
-        }
+        const uint8_t currentByte = (position < m_stream->size()) ? static_cast<uint8_t>((*m_stream)[position++]) : 0;
+        buffer = (buffer << 8) | currentByte;
+        bitsInBuffer += 8;
     }
 
-    return result;
+    return (buffer >> (bitsInBuffer - bits)) & ((static_cast<Value>(1) << bits) - static_cast<Value>(1));
 }
 
 void PDFBitReader::seek(qint64 position)
@@ -214,6 +211,16 @@ void PDFBitWriter::write(Value value)
     flush(false);
 }
 
+void PDFBitWriter::write(Value value, Value bits)
+{
+    Q_ASSERT(bits <= 32);
+
+    m_buffer = (m_buffer << bits) | (value & ((static_cast<Value>(1) << bits) - static_cast<Value>(1)));
+    m_bitsInBuffer += bits;
+
+    flush(false);
+}
+
 void PDFBitWriter::flush(bool alignToByteBoundary)
 {
     if (m_bitsInBuffer >= 8)
@@ -200,6 +200,12 @@ public:
     /// Writes value to the output stream
     void write(Value value);
 
+    /// Writes value with given bit length to the output stream (most
+    /// significant bit first), regardless of bits per component.
+    /// \param value Value
+    /// \param bits Bit length of the value (at most 32 bits)
+    void write(Value value, Value bits);
+
     /// Finish line - align to byte boundary
     void finishLine() { flush(true); }
 
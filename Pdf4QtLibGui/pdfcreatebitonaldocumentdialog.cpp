@@ -316,22 +316,18 @@ void PDFCreateBitonalDocumentDialog::createBitonalDocument()
             QImage bitonalImage = imageConversion.getConvertedImage();
             Q_ASSERT(bitonalImage.format() == QImage::Format_Mono);
 
-            pdf::PDFBitWriter bitWriter(1);
-            bitWriter.reserve(bitonalImage.sizeInBytes());
+            // Bitonal image has packed 1-bit pixels (white pixels have bit set to 1),
+            // so we copy its scanlines directly, only padding bits are reset to zero.
+            const int bytesPerLine = (bitonalImage.width() + 7) / 8;
+            const uchar lastByteMask = (bitonalImage.width() % 8) ? uchar(0xFF << (8 - bitonalImage.width() % 8)) : uchar(0xFF);
+            QByteArray imageData(bytesPerLine * bitonalImage.height(), Qt::Uninitialized);
             for (int row = 0; row < bitonalImage.height(); ++row)
             {
-                for (int col = 0; col < bitonalImage.width(); ++col)
-                {
-                    QRgb pixelValue = bitonalImage.pixel(col, row);
-                    QRgb withoutAlphaValue = pixelValue & 0xFFFFFF;
-                    int value = withoutAlphaValue > 0 ? 1 : 0;
-                    bitWriter.write(value);
-                }
-
-                bitWriter.finishLine();
+                uchar* targetLine = reinterpret_cast<uchar*>(imageData.data()) + row * bytesPerLine;
+                std::copy_n(bitonalImage.constScanLine(row), bytesPerLine, targetLine);
+                targetLine[bytesPerLine - 1] &= lastByteMask;
             }
 
-            QByteArray imageData = bitWriter.takeByteArray();
             QByteArray compressedData = pdf::PDFFlateDecodeFilter::compress(imageData);
 
             pdf::PDFArray array;
@@ -22,6 +22,7 @@
 #include "pdfwidgetutils.h"
 #include "pdfoptionalcontent.h"
 #include "pdfdrawspacecontroller.h"
+#include "pdfimageencoder.h"
 
 #include <QFileDialog>
 #include <QMessageBox>
@@ -337,16 +338,10 @@ void PDFRenderToImagesDialog::on_buttonBox_clicked(QAbstractButton* button)
                 {
                     QString fileName = m_imageExportSettings.getOutputFileName(renderedPageImage.pageIndex, m_imageWriterSettings.getCurrentFormat());
 
-                    QImageWriter imageWriter(fileName, m_imageWriterSettings.getCurrentFormat());
-                    imageWriter.setSubType(m_imageWriterSettings.getCurrentSubtype());
-                    imageWriter.setCompression(m_imageWriterSettings.getCompression());
-                    imageWriter.setQuality(m_imageWriterSettings.getQuality());
-                    imageWriter.setOptimizedWrite(m_imageWriterSettings.hasOptimizedWrite());
-                    imageWriter.setProgressiveScanWrite(m_imageWriterSettings.hasProgressiveScanWrite());
-
-                    if (!imageWriter.write(renderedPageImage.pageImage))
+                    pdf::PDFOperationResult result = pdf::PDFImageEncoder::write(renderedPageImage.pageImage, m_imageWriterSettings, fileName);
+                    if (!result)
                     {
-                        Q_EMIT m_rasterizerPool->renderError(renderedPageImage.pageIndex, pdf::PDFRenderError(pdf::RenderErrorType::Error, tr("Cannot write page image to file '%1', because: %2.").arg(fileName).arg(imageWriter.errorString())));
+                        Q_EMIT m_rasterizerPool->renderError(renderedPageImage.pageIndex, pdf::PDFRenderError(pdf::RenderErrorType::Error, tr("Cannot write page image to file '%1', because: %2.").arg(fileName).arg(result.getErrorMessage())));
                     }
                 };
 
@@ -73,6 +73,9 @@ void PDFAsynchronousPageCompilerWorkerThread::run()
                         PDFCMSPointer cms = proxy->getCMSManager()->getCurrentCMS();
                         PDFRenderer renderer(proxy->getDocument(), proxy->getFontCache(), cms.data(), proxy->getOptionalContentActivity(), proxy->getFeatures(), proxy->getMeshQualitySettings());
                         renderer.setOperationControl(m_compiler);
+                        renderer.setMeshCache(proxy->getMeshCache());
+                        renderer.setJBIG2GlobalsCache(proxy->getJBIG2GlobalsCache());
+                        renderer.setTilingPatternCache(proxy->getTilingPatternCache());
                         renderer.compile(&task.precompiledPage, task.pageIndex);
                         task.finished = true;
                         return compiledPage;
@@ -244,6 +247,23 @@ const PDFPrecompiledPage* PDFAsynchronousPageCompiler::getCompiledPage(PDFIntege
     return page;
 }
 
+void PDFAsynchronousPageCompiler::updateCompiledPageCost(PDFInteger pageIndex)
+{
+    if (m_state != State::Active)
+    {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    if (PDFPrecompiledPage* page = m_cache->take(pageIndex))
+    {
+        // Page is deleted by the cache, if it is too large
+        const qint64 memoryConsumptionEstimate = page->getMemoryConsumptionEstimate();
+        m_cache->insert(pageIndex, page, memoryConsumptionEstimate);
+    }
+}
+
 void PDFAsynchronousPageCompiler::smartClearCache(const int milisecondsLimit, const std::vector<PDFInteger>& activePages)
 {
     if (m_state != State::Active)
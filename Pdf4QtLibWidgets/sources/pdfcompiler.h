@@ -110,6 +110,13 @@ public:
     /// \param compile Compile the page, if it is not found in the cache
     const PDFPrecompiledPage* getCompiledPage(PDFInteger pageIndex, bool compile);
 
+    /// Updates cost of the precompiled page in the cache. Memory consumption
+    /// of the page can grow, when the page is drawn (for example, by native
+    /// renderer caches). If page doesn't fit into the cache anymore, it is removed,
+    /// so pointer to the page must not be used after this call.
+    /// \param pageIndex Index of page
+    void updateCompiledPageCost(PDFInteger pageIndex);
+
     /// Performs smart cache clear. Too old pages are removed from the cache,
     /// but only if these pages are not in active pages. Use this function to
     /// clear cache to avoid huge memory consumption.
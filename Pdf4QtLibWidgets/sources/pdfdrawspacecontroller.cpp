@@ -45,7 +45,10 @@ PDFDrawSpaceController::PDFDrawSpaceController(QObject* parent) :
     m_verticalSpacingMM(5.0),
     m_horizontalSpacingMM(1.0),
     m_pageRotation(PageRotation::None),
-    m_fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT)
+    m_fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT),
+    m_meshCache(DEFAULT_MESH_CACHE_LIMIT),
+    m_jbig2GlobalsCache(DEFAULT_JBIG2_GLOBALS_CACHE_LIMIT),
+    m_tilingPatternCache(DEFAULT_TILING_PATTERN_CACHE_LIMIT)
 {
 
 }
@@ -61,6 +64,9 @@ void PDFDrawSpaceController::setDocument(const PDFModifiedDocument& document)
     {
         m_document = document;
         m_fontCache.setDocument(document);
+        m_meshCache.setDocument(document);
+        m_jbig2GlobalsCache.setDocument(document);
+        m_tilingPatternCache.setDocument(document);
         m_optionalContentActivity = document.getOptionalContentActivity();
 
         // If document is not being reset, then recalculation is not needed,
@@ -824,7 +830,7 @@ void PDFDrawWidgetProxy::drawPages(QPainter* painter, QRect rect, PDFRenderer::F
 
                 if (!isPageContentDrawSuppressed)
                 {
-                    compiledPage->draw(painter, page->getCropBox(), matrix, features, groupInfo.transparency);
+                    compiledPage->draw(painter, page->getCropBox(), matrix, features, groupInfo.transparency, convertor);
                 }
 
                 // Draw text blocks/text lines, if it is enabled
@@ -960,6 +966,9 @@ QImage PDFDrawWidgetProxy::drawThumbnailImage(PDFInteger pageIndex, int pixelSiz
                 // Rasterize the image.
                 PDFCMSPointer cms = getCMSManager()->getCurrentCMS();
                 image = m_rasterizer->render(pageIndex, page, compiledPage, imageSize, m_features, m_widget->getAnnotationManager(), cms.data(), PageRotation::None);
+
+                // Rasterizer can cache its objects in the page, so page is larger now
+                m_compiler->updateCompiledPageCost(pageIndex);
             }
 
             if (image.isNull())
@@ -1589,8 +1598,11 @@ void PDFDrawWidgetProxy::setFeatures(PDFRenderer::Features features)
 {
     if (m_features != features)
     {
-        m_compiler->stop(true);
-        m_textLayoutCompiler->stop(true);
+        // Colors are converted, when compiled page is drawn, so compiled
+        // pages can be kept, if only color adjustment has been changed.
+        const bool isColorAdjustmentChangeOnly = !((m_features ^ features) & ~PDFRenderer::getColorFeatures());
+        m_compiler->stop(!isColorAdjustmentChangeOnly);
+        m_textLayoutCompiler->stop(!isColorAdjustmentChangeOnly);
         m_features = features;
         m_compiler->start();
         m_textLayoutCompiler->start();
@@ -1633,13 +1645,17 @@ void PDFDrawWidgetProxy::setColorTolerance(PDFReal colorTolerance)
 
 void PDFDrawWidgetProxy::onColorManagementSystemChanged()
 {
+    // Colors of the cached meshes and tiling pattern cells depend on the color management system
+    getMeshCache()->clear();
+    getTilingPatternCache()->clear();
     m_compiler->reset();
     Q_EMIT pageImageChanged(true, { });
 }
 
 void PDFDrawWidgetProxy::onOptionalContentGroupStateChanged()
 {
-    m_compiler->reset();
+    // Compiled pages evaluate optional content, when they are drawn,
+    // so they are only redrawn. Text layout must be created again.
     m_textLayoutCompiler->reset();
     Q_EMIT pageImageChanged(true, { });
 }
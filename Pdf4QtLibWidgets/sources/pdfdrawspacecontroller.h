@@ -23,6 +23,9 @@
 #include "pdfdocument.h"
 #include "pdfrenderer.h"
 #include "pdffont.h"
+#include "pdfpattern.h"
+#include "pdfjbig2decoder.h"
+#include "pdfpainter.h"
 #include "pdfdocumentdrawinterface.h"
 #include "pdfwidgetsnapshot.h"
 
@@ -115,6 +118,15 @@ public:
     /// Returns the font cache
     PDFFontCache* getFontCache() { return &m_fontCache; }
 
+    /// Returns the mesh cache
+    PDFMeshCache* getMeshCache() { return &m_meshCache; }
+
+    /// Returns the cache of decoded JBIG2 global segments
+    PDFJBIG2GlobalsCache* getJBIG2GlobalsCache() { return &m_jbig2GlobalsCache; }
+
+    /// Returns the cache of rasterized tiling pattern cells
+    PDFTilingPatternCache* getTilingPatternCache() { return &m_tilingPatternCache; }
+
     /// Returns optional content activity
     const PDFOptionalContentActivity* getOptionalContentActivity() const { return m_optionalContentActivity; }
 
@@ -174,6 +186,15 @@ private:
 
     /// Font cache
     PDFFontCache m_fontCache;
+
+    /// Mesh cache of the shadings
+    PDFMeshCache m_meshCache;
+
+    /// Cache of decoded JBIG2 global segments
+    PDFJBIG2GlobalsCache m_jbig2GlobalsCache;
+
+    /// Cache of rasterized tiling pattern cells
+    PDFTilingPatternCache m_tilingPatternCache;
 };
 
 /// This is a proxy class to draw space controller using widget. We have two spaces, pixel space
@@ -329,6 +350,9 @@ public:
 
     const PDFDocument* getDocument() const { return m_controller->getDocument(); }
     PDFFontCache* getFontCache() const { return m_controller->getFontCache(); }
+    PDFMeshCache* getMeshCache() const { return m_controller->getMeshCache(); }
+    PDFJBIG2GlobalsCache* getJBIG2GlobalsCache() const { return m_controller->getJBIG2GlobalsCache(); }
+    PDFTilingPatternCache* getTilingPatternCache() const { return m_controller->getTilingPatternCache(); }
     const PDFOptionalContentActivity* getOptionalContentActivity() const { return m_controller->getOptionalContentActivity(); }
     PDFRenderer::Features getFeatures() const;
     const PDFMeshQualitySettings& getMeshQualitySettings() const { return m_meshQualitySettings; }
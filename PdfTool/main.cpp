@@ -55,5 +55,11 @@ int main(int argc, char *argv[])
     parser.addVersionOption();
     parser.process(arguments);
 
-    return application->execute(application->getOptions(&parser));
+    pdftool::PDFToolOptions options = application->getOptions(&parser);
+    if (options.batchMode)
+    {
+        return application->executeBatch(options);
+    }
+
+    return application->execute(options);
 }
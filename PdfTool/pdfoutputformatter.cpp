@@ -25,6 +25,7 @@
 #include <QStringEncoder>
 
 #include <stack>
+#include <utility>
 
 #ifdef Q_OS_WIN
 #include "Windows.h"
@@ -57,6 +58,10 @@ public:
     /// Get result string in unicode.
     virtual QString getString() const = 0;
 
+    /// Returns text written so far and removes it from the formatter,
+    /// so it is not kept in memory (used in streaming mode).
+    virtual QString takeString() = 0;
+
     /// Ends current line (for formatters, that support it)
     virtual void endl() { }
 };
@@ -69,6 +74,7 @@ public:
     virtual void beginElement(PDFOutputFormatter::Element type, QString name, QString description, Qt::Alignment alignment, int reference) override;
     virtual void endElement() override;
     virtual QString getString() const override;
+    virtual QString takeString() override;
     virtual void endl() override;
 
 private:
@@ -99,6 +105,7 @@ public:
     virtual void beginElement(PDFOutputFormatter::Element type, QString name, QString description, Qt::Alignment alignment, int reference) override;
     virtual void endElement() override;
     virtual QString getString() const override;
+    virtual QString takeString() override;
 
 private:
     QString m_string;
@@ -117,6 +124,7 @@ public:
     virtual void beginElement(PDFOutputFormatter::Element type, QString name, QString description, Qt::Alignment alignment, int reference) override;
     virtual void endElement() override;
     virtual QString getString() const override;
+    virtual QString takeString() override;
     virtual void endl() override;
 
 private:
@@ -124,6 +132,7 @@ private:
     QXmlStreamWriter m_streamWriter;
     int m_depth;
     int m_headerDepth;
+    bool m_isDocumentTypeWritten;
     std::stack<PDFOutputFormatter::Element> m_elementStack;
 };
 
@@ -285,6 +294,12 @@ QString PDFTextOutputFormatterImpl::getString() const
     return m_string;
 }
 
+QString PDFTextOutputFormatterImpl::takeString()
+{
+    m_streamWriter.flush();
+    return std::exchange(m_string, QString());
+}
+
 void PDFTextOutputFormatterImpl::endl()
 {
     m_streamWriter << Qt::endl;
@@ -316,6 +331,7 @@ PDFHtmlOutputFormatterImpl::PDFHtmlOutputFormatterImpl() :
     m_streamWriter(&m_string),
     m_depth(0),
     m_headerDepth(1),
+    m_isDocumentTypeWritten(false),
     m_elementStack()
 {
 
@@ -475,8 +491,28 @@ void PDFHtmlOutputFormatterImpl::endElement()
 QString PDFHtmlOutputFormatterImpl::getString() const
 {
     QString html = m_string;
-    html.remove(0, html.indexOf("?>") + 2);
-    html.prepend("<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML 1.1//EN\" \"http://www.w3.org/TR/xhtml11/DTD/xhtml11.dtd\">");
+
+    if (!m_isDocumentTypeWritten)
+    {
+        html.remove(0, html.indexOf("?>") + 2);
+        html.prepend("<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML 1.1//EN\" \"http://www.w3.org/TR/xhtml11/DTD/xhtml11.dtd\">");
+    }
+
+    return html;
+}
+
+QString PDFHtmlOutputFormatterImpl::takeString()
+{
+    if (!m_isDocumentTypeWritten && !m_string.contains("?>"))
+    {
+        // Xml declaration was not written yet, we must wait for it,
+        // because it is replaced by the document type declaration.
+        return QString();
+    }
+
+    QString html = getString();
+    m_string.clear();
+    m_isDocumentTypeWritten = true;
     return html;
 }
 
@@ -588,8 +624,21 @@ QString PDFXmlOutputFormatterImpl::getString() const
     return m_string;
 }
 
+QString PDFXmlOutputFormatterImpl::takeString()
+{
+    return std::exchange(m_string, QString());
+}
+
 PDFOutputFormatter::PDFOutputFormatter(Style style) :
-    m_impl(nullptr)
+    PDFOutputFormatter(style, false, QStringConverter::Utf8)
+{
+
+}
+
+PDFOutputFormatter::PDFOutputFormatter(Style style, bool streaming, QStringConverter::Encoding encoding) :
+    m_impl(nullptr),
+    m_streaming(streaming),
+    m_encoding(encoding)
 {
     switch (style)
     {
@@ -622,6 +671,11 @@ void PDFOutputFormatter::beginElement(PDFOutputFormatter::Element type, QString
 void PDFOutputFormatter::endElement()
 {
     m_impl->endElement();
+
+    if (m_streaming)
+    {
+        flush();
+    }
 }
 
 void PDFOutputFormatter::endl()
@@ -629,13 +683,29 @@ void PDFOutputFormatter::endl()
     m_impl->endl();
 }
 
+void PDFOutputFormatter::flush()
+{
+    if (m_streaming)
+    {
+        QString text = m_impl->takeString();
+        if (!text.isEmpty())
+        {
+            PDFConsole::writeText(text, m_encoding);
+        }
+    }
+}
+
 QString PDFOutputFormatter::getString() const
 {
     return m_impl->getString();
 }
 
+static QMutex s_writeTextMutex;
+
 void PDFConsole::writeText(QString text, QStringConverter::Encoding encoding)
 {
+    QMutexLocker lock(&s_writeTextMutex);
+
 #ifdef Q_OS_WIN
     HANDLE outputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
     if (!WriteConsoleW(outputHandle, text.utf16(), text.size(), nullptr, nullptr))
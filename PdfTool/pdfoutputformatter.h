@@ -39,6 +39,16 @@ public:
     };
 
     explicit PDFOutputFormatter(Style style);
+
+    /// Creates output formatter. If \p streaming is true, then each element is
+    /// written to the console as soon as it is closed, and it is not kept in memory.
+    /// In this mode, \p getString returns only text, which was not yet written.
+    /// Text style tables are written at once, when the table is closed, because
+    /// widths of columns are known only after all rows are processed.
+    /// \param style Output style
+    /// \param streaming Write closed elements immediately to the console
+    /// \param encoding Encoding used for writing to the console
+    explicit PDFOutputFormatter(Style style, bool streaming, QStringConverter::Encoding encoding);
     ~PDFOutputFormatter();
 
     enum class Element
@@ -89,8 +99,14 @@ public:
     /// Get result string in unicode.
     QString getString() const;
 
+    /// Writes text, which was not yet written, to the console. Has effect
+    /// only in streaming mode.
+    void flush();
+
 private:
     PDFOutputFormatterImpl* m_impl;
+    bool m_streaming;
+    QStringConverter::Encoding m_encoding;
 };
 
 class PDFConsole
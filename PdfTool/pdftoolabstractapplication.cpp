@@ -18,8 +18,15 @@
 #include "pdftoolabstractapplication.h"
 #include "pdfdocumentreader.h"
 #include "pdfutils.h"
+#include "pdfexception.h"
 
+#include <QFile>
+#include <QHash>
 #include <QFileInfo>
+#include <QTextStream>
+#include <QDirIterator>
+#include <QThreadPool>
+#include <QElapsedTimer>
 #include <QCommandLineParser>
 
 namespace pdftool
@@ -60,7 +67,7 @@ QString PDFToolHelpApplication::getStandardString(StandardString standardString)
 
 int PDFToolHelpApplication::execute(const PDFToolOptions& options)
 {
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("help", PDFToolTranslationContext::tr("PDFTool help"));
     formatter.endl();
 
@@ -138,6 +145,18 @@ PDFToolAbstractApplication::Options PDFToolHelpApplication::getOptionsFlags() co
     return ConsoleFormat;
 }
 
+void PDFToolDocumentStatistics::merge(const PDFToolDocumentStatistics& other)
+{
+    pagesProcessed += other.pagesProcessed;
+    compileTime += other.compileTime;
+    renderTime += other.renderTime;
+    encodeTime += other.encodeTime;
+    writeTime += other.writeTime;
+    totalTime += other.totalTime;
+    errors += other.errors;
+    warnings += other.warnings;
+}
+
 PDFToolAbstractApplication::PDFToolAbstractApplication(bool isDefault)
 {
     PDFToolApplicationStorage::registerApplication(this, isDefault);
@@ -153,6 +172,11 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("text-codec", QString("Text codec used when writing text output to redirected standard output. UTF-8 is default."), "text codec", "UTF-8"));
     }
 
+    if (optionFlags.testFlag(ConsoleFormat) || optionFlags.testFlag(XmlExport))
+    {
+        parser->addOption(QCommandLineOption("console-stream", "Write output to the console continuously, as it is produced, instead of at once at the end."));
+    }
+
     if (optionFlags.testFlag(DateFormat))
     {
         parser->addOption(QCommandLineOption("date-format", "Console output date/time format (valid values: short|long|iso|rfc2822).", "date format", "short"));
@@ -222,7 +246,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
 
     if (optionFlags.testFlag(TextAnalysis))
     {
-        parser->addOption(QCommandLineOption("text-analysis-alg", "Text analysis algorithm (auto - select automatically, layout - perform automatic layout algorithm, content - simple content stream reading order, structure - use tagged document structure).", "algorithm", "auto"));
+        parser->addOption(QCommandLineOption("text-analysis-alg", "Text analysis algorithm (auto - select automatically, layout - perform automatic layout algorithm, content - simple content stream reading order, structure - use tagged document structure). Text of layout and content algorithms is fetched in batches of pages, structure algorithm (also selected by auto for tagged documents) processes whole document at once.", "algorithm", "auto"));
     }
 
     if (optionFlags.testFlag(TextShow))
@@ -311,6 +335,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("render-show-page-stat", "Show page rendering statistics."));
         parser->addOption(QCommandLineOption("render-msaa-samples", "MSAA sample count for GPU rendering.", "samples", "4"));
         parser->addOption(QCommandLineOption("render-rasterizers", "Number of rasterizer contexts.", "rasterizers", QString::number(pdf::PDFRasterizerPool::getDefaultRasterizerCount())));
+        parser->addOption(QCommandLineOption("render-encoders", "Number of threads encoding rendered images.", "encoders", QString::number(pdf::PDFRasterizerPool::getDefaultRasterizerCount())));
     }
 
     if (optionFlags.testFlag(Optimize))
@@ -340,6 +365,21 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("enc-owner-password", "Owner password.", "owner password"));
         parser->addOption(QCommandLineOption("enc-permissions", "Document permissions (flags represented as a number).", "permissions"));
     }
+
+    if (optionFlags.testFlag(Server))
+    {
+        parser->addOption(QCommandLineOption("server-socket", "Name of local socket, on which server listens. If not set, requests are read from standard input.", "socket"));
+        parser->addOption(QCommandLineOption("server-jobs", "Number of requests processed concurrently.", "jobs", QString::number(QThread::idealThreadCount())));
+        parser->addOption(QCommandLineOption("server-max-documents", "Maximal number of documents kept open.", "documents", "16"));
+    }
+
+    if (optionFlags.testFlag(Batch))
+    {
+        parser->addOption(QCommandLineOption("batch", "Process all documents matching the file name pattern (for example, 'docs/*.pdf').", "pattern"));
+        parser->addOption(QCommandLineOption("batch-list", "Process all documents listed in the text file (one file name per line).", "file"));
+        parser->addOption(QCommandLineOption("batch-recursive", "Search for documents matching the batch pattern also in subdirectories."));
+        parser->addOption(QCommandLineOption("batch-documents", "Maximal number of documents processed concurrently.", "documents", "4"));
+    }
 }
 
 PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser) const
@@ -377,6 +417,11 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         options.outputCodec = getEncoding(parser->value("text-codec"));
     }
 
+    if (optionFlags.testFlag(ConsoleFormat) || optionFlags.testFlag(XmlExport))
+    {
+        options.outputStreaming = parser->isSet("console-stream");
+    }
+
     if (optionFlags.testFlag(DateFormat))
     {
         QString dateFormat = parser->value("date-format");
@@ -881,6 +926,14 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
             options.renderRasterizerCount = correctedRasterizerCount;
         }
 
+        textValue = parser->value("render-encoders");
+        options.renderEncoderCount = textValue.toInt(&ok);
+        if (!ok || options.renderEncoderCount < 1)
+        {
+            options.renderEncoderCount = pdf::PDFRasterizerPool::getDefaultRasterizerCount();
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Uknown encoder count '%1'. %2 encoders are used as default.").arg(textValue).arg(options.renderEncoderCount), options.outputCodec);
+        }
+
         options.renderShowPageStatistics = parser->isSet("render-show-page-stat");
     }
 
@@ -970,9 +1023,281 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         options.encryptionPermissions = parser->value("enc-permissions").toUInt();
     }
 
+    if (optionFlags.testFlag(Server))
+    {
+        options.serverSocket = parser->value("server-socket");
+
+        bool ok = false;
+        QString textValue = parser->value("server-jobs");
+        options.serverJobs = textValue.toInt(&ok);
+        if (!ok || options.serverJobs < 1)
+        {
+            options.serverJobs = QThread::idealThreadCount();
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid number of concurrent requests '%1'. %2 requests are used as default.").arg(textValue).arg(options.serverJobs), options.outputCodec);
+        }
+
+        textValue = parser->value("server-max-documents");
+        options.serverMaxDocuments = textValue.toInt(&ok);
+        if (!ok || options.serverMaxDocuments < 1)
+        {
+            options.serverMaxDocuments = 16;
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid maximal number of open documents '%1'. %2 documents are used as default.").arg(textValue).arg(options.serverMaxDocuments), options.outputCodec);
+        }
+    }
+
+    if (optionFlags.testFlag(Batch))
+    {
+        options.batchMode = parser->isSet("batch") || parser->isSet("batch-list");
+
+        if (options.batchMode)
+        {
+            if (!options.document.isEmpty())
+            {
+                options.batchDocuments << options.document;
+            }
+
+            if (parser->isSet("batch"))
+            {
+                QFileInfo patternInfo(parser->value("batch"));
+                QDirIterator::IteratorFlags iteratorFlags = parser->isSet("batch-recursive") ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags;
+                QDirIterator iterator(patternInfo.path(), QStringList() << patternInfo.fileName(), QDir::Files, iteratorFlags);
+
+                QStringList matchedDocuments;
+                while (iterator.hasNext())
+                {
+                    matchedDocuments << iterator.next();
+                }
+
+                // Directory iterator doesn't guarantee any order of files
+                matchedDocuments.sort();
+                options.batchDocuments << matchedDocuments;
+            }
+
+            if (parser->isSet("batch-list"))
+            {
+                QString listFileName = parser->value("batch-list");
+                QFile listFile(listFileName);
+                if (listFile.open(QFile::ReadOnly | QFile::Text))
+                {
+                    QTextStream stream(&listFile);
+                    while (!stream.atEnd())
+                    {
+                        QString fileName = stream.readLine().trimmed();
+                        if (!fileName.isEmpty() && !fileName.startsWith('#'))
+                        {
+                            options.batchDocuments << fileName;
+                        }
+                    }
+                    listFile.close();
+                }
+                else
+                {
+                    PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open document list file '%1'. %2").arg(listFileName, listFile.errorString()), options.outputCodec);
+                }
+            }
+
+            options.batchDocuments.removeDuplicates();
+        }
+
+        bool ok = false;
+        QString textValue = parser->value("batch-documents");
+        options.batchMaxOpenDocuments = textValue.toInt(&ok);
+        if (!ok || options.batchMaxOpenDocuments < 1)
+        {
+            options.batchMaxOpenDocuments = 4;
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid number of concurrently processed documents '%1'. %2 documents are used as default.").arg(textValue).arg(options.batchMaxOpenDocuments), options.outputCodec);
+        }
+    }
+
     return options;
 }
 
+int PDFToolAbstractApplication::executeBatch(const PDFToolOptions& options)
+{
+    if (options.batchDocuments.isEmpty())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("No document found for batch processing."), options.outputCodec);
+        return ErrorNoDocumentSpecified;
+    }
+
+    struct DocumentResult
+    {
+        int exitCode = ErrorUnknown;
+        qint64 time = 0;
+        PDFToolDocumentStatistics statistics;
+    };
+
+    const int documentCount = int(options.batchDocuments.size());
+    std::vector<DocumentResult> results(documentCount);
+
+    // Images of different documents must not overwrite each other,
+    // so the file template is prefixed with the document name.
+    QStringList fileTemplates;
+    if (getOptionsFlags().testFlag(ImageExportSettingsFiles))
+    {
+        QHash<QString, int> usedNames;
+        for (const QString& document : options.batchDocuments)
+        {
+            QString name = QFileInfo(document).completeBaseName();
+            const int count = ++usedNames[name];
+            if (count > 1)
+            {
+                name = QString("%1-%2").arg(name).arg(count);
+            }
+            fileTemplates << QString("%1-%2").arg(name, options.imageExportSettings.getFileTemplate());
+        }
+    }
+
+    // Documents are processed in their own thread pool, which limits number
+    // of documents opened at the same time. Page-level work is performed
+    // by the page pool of the execution policy, which is shared by all documents.
+    QThreadPool documentPool;
+    documentPool.setMaxThreadCount(options.batchMaxOpenDocuments);
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+
+    for (int i = 0; i < documentCount; ++i)
+    {
+        documentPool.start([this, i, &options, &fileTemplates, &results]()
+        {
+            PDFToolOptions documentOptions = options;
+            documentOptions.batchMode = false;
+            documentOptions.batchDocuments.clear();
+
+            // Output of each document is written at once, so outputs
+            // of concurrently processed documents are not interleaved.
+            documentOptions.outputStreaming = false;
+            documentOptions.document = options.batchDocuments[i];
+
+            DocumentResult& result = results[i];
+            documentOptions.batchDocumentStatistics = &result.statistics;
+
+            if (!fileTemplates.isEmpty())
+            {
+                documentOptions.imageExportSettings.setFileTemplate(fileTemplates[i]);
+            }
+
+            QElapsedTimer timer;
+            timer.start();
+
+            try
+            {
+                result.exitCode = execute(documentOptions);
+            }
+            catch (const pdf::PDFException& exception)
+            {
+                result.exitCode = ExitFailure;
+                PDFConsole::writeError(PDFToolTranslationContext::tr("Processing of document '%1' failed. %2").arg(documentOptions.document, exception.getMessage()), options.outputCodec);
+            }
+
+            result.time = timer.elapsed();
+        });
+    }
+
+    documentPool.waitForDone();
+    const qint64 wallTime = wallTimer.elapsed();
+
+    // Write combined statistics
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
+    formatter.beginDocument("batch", PDFToolTranslationContext::tr("Batch processing of %1 documents").arg(documentCount));
+    formatter.endl();
+
+    formatter.beginTable("documents", PDFToolTranslationContext::tr("Documents"));
+
+    formatter.beginTableHeaderRow("header");
+    formatter.writeTableHeaderColumn("no", PDFToolTranslationContext::tr("No."), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("document", PDFToolTranslationContext::tr("Document"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("result", PDFToolTranslationContext::tr("Result"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("time", PDFToolTranslationContext::tr("Time [msec]"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("pages", PDFToolTranslationContext::tr("Pages"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("errors", PDFToolTranslationContext::tr("Errors"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("warnings", PDFToolTranslationContext::tr("Warnings"), Qt::AlignLeft);
+    formatter.endTableHeaderRow();
+
+    QLocale locale;
+
+    int documentsSucceeded = 0;
+    qint64 documentsTime = 0;
+    PDFToolDocumentStatistics statistics;
+    for (int i = 0; i < documentCount; ++i)
+    {
+        const DocumentResult& result = results[i];
+        const bool succeeded = result.exitCode == ExitSuccess;
+
+        if (succeeded)
+        {
+            ++documentsSucceeded;
+        }
+        documentsTime += result.time;
+        statistics.merge(result.statistics);
+
+        formatter.beginTableRow("document", i + 1);
+        formatter.writeTableColumn("no", locale.toString(i + 1), Qt::AlignRight);
+        formatter.writeTableColumn("document", options.batchDocuments[i]);
+        formatter.writeTableColumn("result", succeeded ? PDFToolTranslationContext::tr("OK") : PDFToolTranslationContext::tr("Failed (exit code %1)").arg(result.exitCode));
+        formatter.writeTableColumn("time", locale.toString(result.time), Qt::AlignRight);
+        formatter.writeTableColumn("pages", locale.toString(result.statistics.pagesProcessed), Qt::AlignRight);
+        formatter.writeTableColumn("errors", locale.toString(result.statistics.errors), Qt::AlignRight);
+        formatter.writeTableColumn("warnings", locale.toString(result.statistics.warnings), Qt::AlignRight);
+        formatter.endTableRow();
+    }
+
+    formatter.endTable();
+    formatter.endl();
+
+    formatter.beginTable("statistics", PDFToolTranslationContext::tr("Statistics"));
+
+    formatter.beginTableHeaderRow("header");
+    formatter.writeTableHeaderColumn("description", PDFToolTranslationContext::tr("Description"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("value", PDFToolTranslationContext::tr("Value"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("unit", PDFToolTranslationContext::tr("Unit"), Qt::AlignLeft);
+    formatter.endTableHeaderRow();
+
+    auto writeValue = [&formatter](QString name, QString description, QString value, QString unit)
+    {
+        formatter.beginTableRow(name);
+        formatter.writeTableColumn("description", description);
+        formatter.writeTableColumn("value", value, Qt::AlignRight);
+        formatter.writeTableColumn("unit", unit);
+        formatter.endTableRow();
+    };
+
+    const double documentsPerSecond = wallTime > 0 ? double(documentCount) / (double(wallTime) / 1000.0) : 0.0;
+
+    writeValue("documents", PDFToolTranslationContext::tr("Documents processed"), locale.toString(documentCount), PDFToolTranslationContext::tr("-"));
+    writeValue("documents-succeeded", PDFToolTranslationContext::tr("Documents succeeded"), locale.toString(documentsSucceeded), PDFToolTranslationContext::tr("-"));
+    writeValue("documents-failed", PDFToolTranslationContext::tr("Documents failed"), locale.toString(documentCount - documentsSucceeded), PDFToolTranslationContext::tr("-"));
+    writeValue("max-open-documents", PDFToolTranslationContext::tr("Maximal open documents"), locale.toString(options.batchMaxOpenDocuments), PDFToolTranslationContext::tr("-"));
+    writeValue("total-time", PDFToolTranslationContext::tr("Total time"), locale.toString(documentsTime), PDFToolTranslationContext::tr("msec"));
+    writeValue("wall-time", PDFToolTranslationContext::tr("Wall time"), locale.toString(wallTime), PDFToolTranslationContext::tr("msec"));
+    writeValue("documents-per-second", PDFToolTranslationContext::tr("Processing speed (wall time)"), locale.toString(documentsPerSecond, 'f', 3), PDFToolTranslationContext::tr("documents / sec"));
+
+    // Page statistics are available only for commands, which process pages
+    if (statistics.pagesProcessed > 0)
+    {
+        const double pagesPerSecond = wallTime > 0 ? double(statistics.pagesProcessed) / (double(wallTime) / 1000.0) : 0.0;
+
+        writeValue("pages", PDFToolTranslationContext::tr("Pages processed"), locale.toString(statistics.pagesProcessed), PDFToolTranslationContext::tr("-"));
+        writeValue("compile-time", PDFToolTranslationContext::tr("Total compile time"), locale.toString(statistics.compileTime), PDFToolTranslationContext::tr("msec"));
+        writeValue("render-time", PDFToolTranslationContext::tr("Total render time"), locale.toString(statistics.renderTime), PDFToolTranslationContext::tr("msec"));
+        writeValue("encode-time", PDFToolTranslationContext::tr("Total encode time"), locale.toString(statistics.encodeTime), PDFToolTranslationContext::tr("msec"));
+        writeValue("write-time", PDFToolTranslationContext::tr("Total write time"), locale.toString(statistics.writeTime), PDFToolTranslationContext::tr("msec"));
+        writeValue("page-total-time", PDFToolTranslationContext::tr("Total page time"), locale.toString(statistics.totalTime), PDFToolTranslationContext::tr("msec"));
+        writeValue("pages-per-second", PDFToolTranslationContext::tr("Page processing speed (wall time)"), locale.toString(pagesPerSecond, 'f', 3), PDFToolTranslationContext::tr("pages / sec"));
+    }
+
+    writeValue("errors", PDFToolTranslationContext::tr("Errors"), locale.toString(statistics.errors), PDFToolTranslationContext::tr("-"));
+    writeValue("warnings", PDFToolTranslationContext::tr("Warnings"), locale.toString(statistics.warnings), PDFToolTranslationContext::tr("-"));
+
+    formatter.endTable();
+
+    formatter.endDocument();
+    PDFConsole::writeText(formatter.getString(), options.outputCodec);
+
+    return documentsSucceeded == documentCount ? ExitSuccess : ExitFailure;
+}
+
 QString PDFToolAbstractApplication::convertDateTimeToString(const QDateTime& dateTime, PDFToolOptions::DateFormat dateFormat)
 {
     switch (dateFormat)
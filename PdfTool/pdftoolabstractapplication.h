@@ -29,6 +29,7 @@
 #include <QtGlobal>
 #include <QString>
 #include <QDateTime>
+#include <QThread>
 #include <QCoreApplication>
 #include <QStringConverter>
 
@@ -44,6 +45,23 @@ struct PDFToolTranslationContext
     Q_DECLARE_TR_FUNCTIONS(PDFToolTranslationContext)
 };
 
+/// Statistics of the command executed for one document of the batch. Commands,
+/// which process pages (render, benchmark), fill it, so batch can write
+/// combined statistics of all documents.
+struct PDFToolDocumentStatistics
+{
+    qint64 pagesProcessed = 0;
+    qint64 compileTime = 0;
+    qint64 renderTime = 0;
+    qint64 encodeTime = 0;
+    qint64 writeTime = 0;
+    qint64 totalTime = 0;
+    qint64 errors = 0;
+    qint64 warnings = 0;
+
+    void merge(const PDFToolDocumentStatistics& other);
+};
+
 struct PDFToolOptions
 {
     enum DateFormat
@@ -57,6 +75,7 @@ struct PDFToolOptions
     // For option 'ConsoleFormat'
     PDFOutputFormatter::Style outputStyle = PDFOutputFormatter::Style::Text;
     QStringConverter::Encoding outputCodec = QStringConverter::Utf8;
+    bool outputStreaming = false;
 
     // For option 'DateFormat'
     DateFormat outputDateFormat = LocaleShortDate;
@@ -139,6 +158,7 @@ struct PDFToolOptions
     bool renderShowPageStatistics = false;
     int renderMSAAsamples = 4;
     int renderRasterizerCount = pdf::PDFRasterizerPool::getDefaultRasterizerCount();
+    int renderEncoderCount = pdf::PDFRasterizerPool::getDefaultRasterizerCount();
 
     // For option 'Separate'
     QString separatePagePattern;
@@ -159,6 +179,17 @@ struct PDFToolOptions
     // For option 'CertStoreInstall'
     QString certificateStoreInstallCertificateFile;
 
+    // For option 'Server'
+    QString serverSocket;
+    int serverJobs = QThread::idealThreadCount();
+    int serverMaxDocuments = 16;
+
+    // For option 'Batch'
+    bool batchMode = false;
+    QStringList batchDocuments;
+    int batchMaxOpenDocuments = 4;
+    PDFToolDocumentStatistics* batchDocumentStatistics = nullptr; ///< Statistics of the document (filled by the command, if not null)
+
     // For option 'Encrypt'
     pdf::PDFSecurityHandlerFactory::Algorithm encryptionAlgorithm = pdf::PDFSecurityHandlerFactory::Algorithm::AES_256;
     pdf::PDFSecurityHandlerFactory::EncryptContents encryptionContents = pdf::PDFSecurityHandlerFactory::EncryptContents::All;
@@ -252,6 +283,8 @@ public:
         CertStoreInstall                = 0x00400000,       ///< Settings for certificate store install certificate tool
         Encrypt                         = 0x00800000,       ///< Encryption settings
         Diff                            = 0x01000000,       ///< Diff settings (compare documents)
+        Server                          = 0x02000000,       ///< Render server settings
+        Batch                           = 0x04000000,       ///< Process multiple documents in one run
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -262,6 +295,13 @@ public:
     void initializeCommandLineParser(QCommandLineParser* parser) const;
     PDFToolOptions getOptions(QCommandLineParser* parser) const;
 
+    /// Executes application for each document of the batch. Documents are processed
+    /// concurrently, but at most \p options.batchMaxOpenDocuments documents are open
+    /// at the same time. Page-level work of all documents shares the page pool
+    /// of the execution policy. Combined statistics are written at the end.
+    /// \param options Options (document list is taken from batch options)
+    int executeBatch(const PDFToolOptions& options);
+
     static QString convertDateTimeToString(const QDateTime& dateTime, PDFToolOptions::DateFormat dateFormat);
 
 protected:
@@ -113,7 +113,7 @@ int PDFToolAttachmentsApplication::execute(const PDFToolOptions& options)
     if (savedFileCount == 0)
     {
         // Just print a list of embedded files
-        PDFOutputFormatter formatter(options.outputStyle);
+        PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
         formatter.beginDocument("attachments", PDFToolTranslationContext::tr("Attached files of document %1").arg(options.document));
         formatter.endl();
 
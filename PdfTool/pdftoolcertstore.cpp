@@ -65,7 +65,7 @@ int PDFToolCertStore::execute(const PDFToolOptions& options)
         certificates.insert(certificates.end(), std::make_move_iterator(systemCertificates.begin()), std::make_move_iterator(systemCertificates.end()));
     }
 
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("cert-store", PDFToolTranslationContext::tr("Certificates used in signature verification"));
     formatter.endl();
 
@@ -46,7 +46,7 @@ QString PDFToolColorProfiles::getStandardString(StandardString standardString) c
 
 int PDFToolColorProfiles::execute(const PDFToolOptions& options)
 {
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("color-profiles", PDFToolTranslationContext::tr("Available Color Profiles"));
     formatter.endl();
 
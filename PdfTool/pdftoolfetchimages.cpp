@@ -40,11 +40,11 @@ public:
                                                QTransform pagePointToDevicePointMatrix,
                                                const pdf::PDFMeshQualitySettings& meshQualitySettings,
                                                pdf::PDFInteger pageIndex,
-                                               PDFToolFetchImages* tool) :
+                                               PDFToolFetchImages::ExtractedImages* extractedImages) :
         BaseClass(page, document, fontCache, cms, optionalContentActivity, pagePointToDevicePointMatrix, meshQualitySettings),
         m_pageIndex(pageIndex),
         m_order(0),
-        m_tool(tool)
+        m_extractedImages(extractedImages)
     {
 
     }
@@ -57,7 +57,7 @@ protected:
 private:
     pdf::PDFInteger m_pageIndex;
     pdf::PDFInteger m_order;
-    PDFToolFetchImages* m_tool;
+    PDFToolFetchImages::ExtractedImages* m_extractedImages;
 };
 
 bool PDFImageContentExtractorProcessor::isContentSuppressedByOC(pdf::PDFObjectReference ocgOrOcmd)
@@ -92,7 +92,7 @@ bool PDFImageContentExtractorProcessor::isContentKindSuppressed(ContentKind kind
 
 void PDFImageContentExtractorProcessor::performImagePainting(const QImage& image)
 {
-    m_tool->onImageExtracted(m_pageIndex, m_order++, image);
+    m_extractedImages->addImage(m_pageIndex, m_order++, image);
 }
 
 QString PDFToolFetchImages::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
@@ -160,7 +160,10 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
     fontCache.setDocument(md);
     fontCache.setCacheShrinkEnabled(nullptr, false);
 
-    auto processPageContents = [&, this](pdf::PDFInteger pageIndex)
+    ExtractedImages extractedImages;
+    Images& images = extractedImages.images;
+
+    auto processPageContents = [&](pdf::PDFInteger pageIndex)
     {
         const pdf::PDFCatalog* catalog = document.getCatalog();
         if (!catalog->getPage(pageIndex))
@@ -173,7 +176,7 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
         Q_ASSERT(page);
 
         PDFImageContentExtractorProcessor processor(page, &document, &fontCache, cms.data(), &optionalContentActivity,
-                                                    QTransform(), meshQualitySettings, pageIndex, this);
+                                                    QTransform(), meshQualitySettings, pageIndex, &extractedImages);
         processor.processContents();
     };
 
@@ -184,10 +187,10 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
     {
         return std::make_pair(left.pageIndex, left.order) < std::make_pair(right.pageIndex, right.order);
     };
-    std::sort(m_images.begin(), m_images.end(), comparator);
+    std::sort(images.begin(), images.end(), comparator);
 
     // Write information about images
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("images", PDFToolTranslationContext::tr("Images fetched from document %1").arg(options.document));
     formatter.endl();
 
@@ -204,9 +207,9 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
 
     QLocale locale;
 
-    for (size_t i = 0; i < m_images.size(); ++i)
+    for (size_t i = 0; i < images.size(); ++i)
     {
-        Image& image = m_images[i];
+        Image& image = images[i];
         image.fileName = options.imageExportSettings.getOutputFileName(pdf::PDFInteger(i), options.imageWriterSettings.getCurrentFormat());
 
         formatter.beginTableRow("image", int(i));
@@ -227,9 +230,9 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
     PDFConsole::writeText(formatter.getString(), options.outputCodec);
 
     // Store images to the disk file
-    auto saveImage = [this, &options](size_t index)
+    auto saveImage = [&images, &options](size_t index)
     {
-        Image& image = m_images[index];
+        Image& image = images[index];
 
         QImageWriter imageWriter(image.fileName, options.imageWriterSettings.getCurrentFormat());
         imageWriter.setSubType(options.imageWriterSettings.getCurrentSubtype());
@@ -244,7 +247,7 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
         }
     };
 
-    auto imageRange = pdf::PDFIntegerRange<size_t>(0, m_images.size());
+    auto imageRange = pdf::PDFIntegerRange<size_t>(0, images.size());
     pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Page, imageRange.begin(), imageRange.end(), saveImage);
 
     return ExitSuccess;
@@ -252,26 +255,26 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
 
 PDFToolAbstractApplication::Options PDFToolFetchImages::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | ImageWriterSettings | ImageExportSettingsFiles | ColorManagementSystem;
+    return ConsoleFormat | OpenDocument | PageSelector | ImageWriterSettings | ImageExportSettingsFiles | ColorManagementSystem | Batch;
 }
 
-void PDFToolFetchImages::onImageExtracted(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const QImage& image)
+void PDFToolFetchImages::ExtractedImages::addImage(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const QImage& image)
 {
     QCryptographicHash hasher(QCryptographicHash::Sha512);
     QByteArrayView imageData(image.bits(), image.sizeInBytes());
     hasher.addData(imageData);
     QByteArray hash = hasher.result();
 
-    QMutexLocker lock(&m_mutex);
-    auto it = std::find_if(m_images.begin(), m_images.end(), [&hash](const Image& image) { return image.hash == hash; });
-    if (it == m_images.cend())
+    QMutexLocker lock(&mutex);
+    auto it = std::find_if(images.begin(), images.end(), [&hash](const Image& image) { return image.hash == hash; });
+    if (it == images.cend())
     {
         Image imageStructure;
         imageStructure.hash = hash;
         imageStructure.pageIndex = pageIndex;
         imageStructure.order = order;
         imageStructure.image = image;
-        m_images.emplace_back(qMove(imageStructure));
+        images.emplace_back(qMove(imageStructure));
     }
     else
     {
@@ -32,9 +32,6 @@ public:
     virtual int execute(const PDFToolOptions& options) override;
     virtual Options getOptionsFlags() const override;
 
-    void onImageExtracted(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const QImage& image);
-
-private:
     struct Image
     {
         QByteArray hash;
@@ -45,8 +42,19 @@ private:
     };
     using Images = std::vector<Image>;
 
-    QMutex m_mutex;
-    Images m_images;
+    /// Images extracted from a single document. Images are not stored in the
+    /// application, so multiple documents can be processed concurrently.
+    struct ExtractedImages
+    {
+        /// Adds image to the list, if the same image was not found yet
+        /// \param pageIndex Page index
+        /// \param order Order of the image on the page
+        /// \param image Image
+        void addImage(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const QImage& image);
+
+        QMutex mutex;
+        Images images;
+    };
 };
 
 }   // namespace pdftool
@@ -17,6 +17,7 @@
 
 #include "pdftoolfetchtext.h"
 #include "pdfdocumenttextflow.h"
+#include "pdffont.h"
 
 namespace pdftool
 {
@@ -68,48 +69,85 @@ int PDFToolFetchTextApplication::execute(const PDFToolOptions& options)
         return ErrorInvalidArguments;
     }
 
-    pdf::PDFDocumentTextFlowFactory factory;
-    pdf::PDFDocumentTextFlow documentTextFlow = factory.create(&document, pages, options.textAnalysisAlgorithm);
-
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("text-extraction", QString());
     formatter.endl();
 
-    for (const pdf::PDFDocumentTextFlow::Item& item : documentTextFlow.getItems())
+    auto writeTextFlow = [&formatter, &options](const pdf::PDFDocumentTextFlow& documentTextFlow)
     {
-        if (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureItemStart))
+        for (const pdf::PDFDocumentTextFlow::Item& item : documentTextFlow.getItems())
         {
-            formatter.beginHeader("item", item.text);
-        }
+            if (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureItemStart))
+            {
+                formatter.beginHeader("item", item.text);
+            }
 
-        if (!item.text.isEmpty())
-        {
-            bool showText = (item.flags.testFlag(pdf::PDFDocumentTextFlow::Text)) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageStart) && options.textShowPageNumbers) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageEnd) && options.textShowPageNumbers) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureTitle) && options.textShowStructTitles) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureLanguage) && options.textShowStructLanguage) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureAlternativeDescription) && options.textShowStructAlternativeDescription) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureExpandedForm) && options.textShowStructExpandedForm) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureActualText) && options.textShowStructActualText) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructurePhoneme) && options.textShowStructPhoneme);
-
-            if (showText)
+            if (!item.text.isEmpty())
             {
-                formatter.writeText("text", item.text);
+                bool showText = (item.flags.testFlag(pdf::PDFDocumentTextFlow::Text)) ||
+                                (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageStart) && options.textShowPageNumbers) ||
+                                (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageEnd) && options.textShowPageNumbers) ||
+                                (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureTitle) && options.textShowStructTitles) ||
+                                (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureLanguage) && options.textShowStructLanguage) ||
+                                (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureAlternativeDescription) && options.textShowStructAlternativeDescription) ||
+                                (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureExpandedForm) && options.textShowStructExpandedForm) ||
+                                (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureActualText) && options.textShowStructActualText) ||
+                                (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructurePhoneme) && options.textShowStructPhoneme);
+
+                if (showText)
+                {
+                    formatter.writeText("text", item.text);
+                }
             }
-        }
 
-        if (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureItemEnd))
-        {
-            formatter.endHeader();
+            if (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureItemEnd))
+            {
+                formatter.endHeader();
+            }
+
+            if (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageEnd))
+            {
+                formatter.endl();
+            }
         }
+    };
+
+    // Layout and content algorithms process pages independently, so text flow
+    // is created and written in batches of pages, and memory doesn't grow with
+    // the document. Structure algorithm needs the structure tree of the whole
+    // document, so text flow is created for all pages at once. Automatic
+    // algorithm selects it for documents with logical structure. Font cache
+    // is shared by all batches, so fonts are not parsed again for each batch.
+    pdf::PDFFontCache fontCache(pdf::DEFAULT_FONT_CACHE_LIMIT, pdf::DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+    pdf::PDFModifiedDocument md(&document, nullptr);
+    fontCache.setDocument(md);
+    fontCache.setCacheShrinkEnabled(nullptr, false);
+
+    pdf::PDFDocumentTextFlowFactory factory;
+    factory.setFontCache(&fontCache);
+    const pdf::PDFDocumentTextFlowFactory::Algorithm algorithm = options.textAnalysisAlgorithm;
+    const bool isProcessedInBatches = algorithm == pdf::PDFDocumentTextFlowFactory::Algorithm::Layout ||
+                                      algorithm == pdf::PDFDocumentTextFlowFactory::Algorithm::Content ||
+                                      (algorithm == pdf::PDFDocumentTextFlowFactory::Algorithm::Auto && !document.getCatalog()->isLogicalStructureMarked());
 
-        if (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageEnd))
+    if (isProcessedInBatches)
+    {
+        // Pages of the batch are processed in parallel
+        constexpr size_t PAGE_BATCH_SIZE = 32;
+
+        for (auto it = pages.cbegin(); it != pages.cend();)
         {
-            formatter.endl();
+            auto itEnd = std::next(it, qMin<size_t>(PAGE_BATCH_SIZE, std::distance(it, pages.cend())));
+            writeTextFlow(factory.create(&document, std::vector<pdf::PDFInteger>(it, itEnd), algorithm));
+            it = itEnd;
         }
     }
+    else
+    {
+        writeTextFlow(factory.create(&document, pages, algorithm));
+    }
+
+    fontCache.setCacheShrinkEnabled(nullptr, true);
 
     formatter.endDocument();
 
@@ -125,7 +163,7 @@ int PDFToolFetchTextApplication::execute(const PDFToolOptions& options)
 
 PDFToolAbstractApplication::Options PDFToolFetchTextApplication::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | TextAnalysis | TextShow;
+    return ConsoleFormat | OpenDocument | PageSelector | TextAnalysis | TextShow | Batch;
 }
 
 }   // namespace pdftool
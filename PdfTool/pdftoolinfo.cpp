@@ -62,7 +62,7 @@ int PDFToolInfoApplication::execute(const PDFToolOptions& options)
     const pdf::PDFDocumentInfo* info = document.getInfo();
     const pdf::PDFCatalog* catalog = document.getCatalog();
 
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("info", PDFToolTranslationContext::tr("Information about document %1").arg(options.document));
     formatter.endl();
 
@@ -299,7 +299,7 @@ int PDFToolInfoApplication::execute(const PDFToolOptions& options)
 
 PDFToolAbstractApplication::Options PDFToolInfoApplication::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | DateFormat | ComputeHashes;
+    return ConsoleFormat | OpenDocument | DateFormat | ComputeHashes | Batch;
 }
 
 }   // namespace pdftool
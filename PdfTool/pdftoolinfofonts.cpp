@@ -276,7 +276,7 @@ int PDFToolInfoFonts::execute(const PDFToolOptions& options)
         directFonts.emplace_back(qMove(item.second));
     }
 
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("info-fonts", PDFToolTranslationContext::tr("Fonts used in document %1").arg(options.document));
     formatter.endl();
 
@@ -57,7 +57,7 @@ int PDFToolInfoInksApplication::execute(const PDFToolOptions& options)
     cmsManager.setDocument(&document);
     cmsManager.setSettings(options.cmsSettings);
 
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("info-inks", PDFToolTranslationContext::tr("Inks"));
     formatter.endl();
 
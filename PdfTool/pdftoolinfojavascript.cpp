@@ -67,7 +67,7 @@ int PDFToolInfoJavaScriptApplication::execute(const PDFToolOptions& options)
 
     QLocale locale;
 
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("info-javascripts", PDFToolTranslationContext::tr("JavaScript used in document %1").arg(options.document));
     formatter.endl();
 
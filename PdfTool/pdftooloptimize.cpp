@@ -79,7 +79,7 @@ int PDFToolOptimize::execute(const PDFToolOptions& options)
 
 PDFToolAbstractApplication::Options PDFToolOptimize::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | Optimize;
+    return ConsoleFormat | OpenDocument | Optimize | Batch;
 }
 
 }   // namespace pdftool
@@ -18,7 +18,10 @@
 #include "pdftoolrender.h"
 #include "pdffont.h"
 #include "pdfconstants.h"
+#include "pdfimageencoder.h"
 
+#include <QFile>
+#include <QBuffer>
 #include <QColorSpace>
 #include <QElapsedTimer>
 
@@ -51,47 +54,66 @@ QString PDFToolRender::getStandardString(PDFToolAbstractApplication::StandardStr
 
 PDFToolAbstractApplication::Options PDFToolRender::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | ImageWriterSettings | ImageExportSettingsFiles | ImageExportSettingsResolution | ColorManagementSystem | RenderFlags;
+    return ConsoleFormat | OpenDocument | PageSelector | ImageWriterSettings | ImageExportSettingsFiles | ImageExportSettingsResolution | ColorManagementSystem | RenderFlags | Batch;
 }
 
-void PDFToolRender::finish(const PDFToolOptions& options)
+void PDFToolRender::finish(const PDFToolOptions& options, const RenderStatistics& statistics)
 {
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("render", PDFToolTranslationContext::tr("Render document %1").arg(options.document));
     formatter.endl();
 
-    writeStatistics(formatter);
+    writeStatistics(formatter, statistics);
     if (options.renderShowPageStatistics)
     {
-        writePageStatistics(formatter);
+        writePageStatistics(formatter, statistics);
     }
-    writeErrors(formatter);
+    writeErrors(formatter, statistics);
 
     formatter.endDocument();
     PDFConsole::writeText(formatter.getString(), options.outputCodec);
 }
 
-void PDFToolRender::onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage)
+void PDFToolRender::onPageEncode(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage)
 {
-    writePageInfoStatistics(renderedPageImage);
+    QBuffer buffer(&renderedPageImage.encodedImage);
+    buffer.open(QBuffer::WriteOnly);
+
+    pdf::PDFOperationResult result = pdf::PDFImageEncoder::write(renderedPageImage.pageImage, options.imageWriterSettings, &buffer);
+    if (!result)
+    {
+        QString fileName = options.imageExportSettings.getOutputFileName(renderedPageImage.pageIndex, options.imageWriterSettings.getCurrentFormat());
+        statistics.pageInfo[renderedPageImage.pageIndex].errors.emplace_back(pdf::PDFRenderError(pdf::RenderErrorType::Error, PDFToolTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(fileName).arg(result.getErrorMessage())));
+        renderedPageImage.encodedImage.clear();
+    }
+
+    // Image is no longer needed, release the memory before waiting for the write stage
+    renderedPageImage.pageImage = QImage();
+}
+
+void PDFToolRender::onPageRendered(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage)
+{
+    writePageInfoStatistics(statistics, renderedPageImage);
+
+    if (renderedPageImage.encodedImage.isEmpty())
+    {
+        // Encoding failed, error was already reported
+        return;
+    }
+
     QString fileName = options.imageExportSettings.getOutputFileName(renderedPageImage.pageIndex, options.imageWriterSettings.getCurrentFormat());
 
     QElapsedTimer imageWriterTimer;
     imageWriterTimer.start();
 
-    QImageWriter imageWriter(fileName, options.imageWriterSettings.getCurrentFormat());
-    imageWriter.setSubType(options.imageWriterSettings.getCurrentSubtype());
-    imageWriter.setCompression(options.imageWriterSettings.getCompression());
-    imageWriter.setQuality(options.imageWriterSettings.getQuality());
-    imageWriter.setOptimizedWrite(options.imageWriterSettings.hasOptimizedWrite());
-    imageWriter.setProgressiveScanWrite(options.imageWriterSettings.hasProgressiveScanWrite());
-
-    if (!imageWriter.write(renderedPageImage.pageImage))
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(renderedPageImage.encodedImage) != renderedPageImage.encodedImage.size())
     {
-        m_pageInfo[renderedPageImage.pageIndex].errors.emplace_back(pdf::PDFRenderError(pdf::RenderErrorType::Error, PDFToolTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(fileName).arg(imageWriter.errorString())));
+        statistics.pageInfo[renderedPageImage.pageIndex].errors.emplace_back(pdf::PDFRenderError(pdf::RenderErrorType::Error, PDFToolTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(fileName).arg(file.errorString())));
     }
+    file.close();
 
-    m_pageInfo[renderedPageImage.pageIndex].pageWriteTime = imageWriterTimer.elapsed();
+    statistics.pageInfo[renderedPageImage.pageIndex].pageWriteTime = imageWriterTimer.elapsed();
 }
 
 QString PDFToolBenchmark::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
@@ -120,27 +142,34 @@ PDFToolAbstractApplication::Options PDFToolBenchmark::getOptionsFlags() const
     return ConsoleFormat | OpenDocument | PageSelector | ImageExportSettingsResolution | ColorManagementSystem | RenderFlags;
 }
 
-void PDFToolBenchmark::finish(const PDFToolOptions& options)
+void PDFToolBenchmark::finish(const PDFToolOptions& options, const RenderStatistics& statistics)
 {
-    PDFOutputFormatter formatter(options.outputStyle);
+    PDFOutputFormatter formatter(options.outputStyle, options.outputStreaming, options.outputCodec);
     formatter.beginDocument("benchmark", PDFToolTranslationContext::tr("Benchmark rendering of document %1").arg(options.document));
     formatter.endl();
 
-    writeStatistics(formatter);
+    writeStatistics(formatter, statistics);
     if (options.renderShowPageStatistics)
     {
-        writePageStatistics(formatter);
+        writePageStatistics(formatter, statistics);
     }
-    writeErrors(formatter);
+    writeErrors(formatter, statistics);
 
     formatter.endDocument();
     PDFConsole::writeText(formatter.getString(), options.outputCodec);
 }
 
-void PDFToolBenchmark::onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage)
+void PDFToolBenchmark::onPageRendered(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage)
 {
     Q_UNUSED(options);
-    writePageInfoStatistics(renderedPageImage);
+    writePageInfoStatistics(statistics, renderedPageImage);
+}
+
+void PDFToolRenderBase::onPageEncode(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage)
+{
+    Q_UNUSED(options);
+    Q_UNUSED(statistics);
+    Q_UNUSED(renderedPageImage);
 }
 
 int PDFToolRenderBase::execute(const PDFToolOptions& options)
@@ -180,17 +209,18 @@ int PDFToolRenderBase::execute(const PDFToolOptions& options)
     fontCache.setDocument(md);
     fontCache.setCacheShrinkEnabled(nullptr, false);
 
-    m_pageInfo.resize(document.getCatalog()->getPageCount());
+    RenderStatistics statistics;
+    statistics.pageInfo.resize(document.getCatalog()->getPageCount());
     pdf::PDFRasterizerPool rasterizerPool(&document, &fontCache, &cmsManager,
                                           &optionalContentActivity, options.renderFeatures, meshQualitySettings,
                                           pdf::PDFRasterizerPool::getCorrectedRasterizerCount(options.renderRasterizerCount),
                                           options.renderUseSoftwareRendering ? pdf::RendererEngine::QPainter : pdf::RendererEngine::Blend2D_SingleThread, nullptr);
 
-    auto onRenderError = [this](pdf::PDFInteger pageIndex, pdf::PDFRenderError error)
+    auto onRenderError = [&statistics](pdf::PDFInteger pageIndex, pdf::PDFRenderError error)
     {
         if (pageIndex != pdf::PDFCatalog::INVALID_PAGE_INDEX)
         {
-            m_pageInfo[pageIndex].errors.emplace_back(qMove(error));
+            statistics.pageInfo[pageIndex].errors.emplace_back(qMove(error));
         }
     };
     QObject holder;
@@ -228,38 +258,94 @@ int PDFToolRenderBase::execute(const PDFToolOptions& options)
     QElapsedTimer timer;
     timer.start();
 
-    rasterizerPool.render(pageIndices, imageSizeGetter, std::bind(&PDFToolRenderBase::onPageRendered, this, options, std::placeholders::_1), nullptr);
+    pdf::PDFRasterizerPipelineSettings pipelineSettings;
+    pipelineSettings.encodeThreadCount = options.renderEncoderCount;
 
-    m_wallTime = timer.elapsed();
+    rasterizerPool.render(pageIndices, imageSizeGetter,
+                          std::bind(&PDFToolRenderBase::onPageEncode, this, std::cref(options), std::ref(statistics), std::placeholders::_1),
+                          std::bind(&PDFToolRenderBase::onPageRendered, this, std::cref(options), std::ref(statistics), std::placeholders::_1),
+                          pipelineSettings, nullptr);
+
+    statistics.wallTime = timer.elapsed();
 
     fontCache.setCacheShrinkEnabled(nullptr, true);
 
-    finish(options);
+    if (options.batchDocumentStatistics)
+    {
+        *options.batchDocumentStatistics = getDocumentStatistics(statistics);
+    }
+
+    finish(options, statistics);
     return ExitSuccess;
 }
 
-void PDFToolRenderBase::writePageInfoStatistics(const pdf::PDFRenderedPageImage& renderedPageImage)
+void PDFToolRenderBase::writePageInfoStatistics(RenderStatistics& statistics, const pdf::PDFRenderedPageImage& renderedPageImage)
 {
-    PageInfo& info = m_pageInfo[renderedPageImage.pageIndex];
+    PageInfo& info = statistics.pageInfo[renderedPageImage.pageIndex];
     info.isRendered = true;
+    info.pageQueueTime = renderedPageImage.pageQueueTime;
     info.pageCompileTime = renderedPageImage.pageCompileTime;
     info.pageWaitTime = renderedPageImage.pageWaitTime;
     info.pageRenderTime = renderedPageImage.pageRenderTime;
+    info.pageEncodeTime = renderedPageImage.pageEncodeTime;
     info.pageTotalTime = renderedPageImage.pageTotalTime;
     info.pageIndex = renderedPageImage.pageIndex;
 }
 
-void PDFToolRenderBase::writeStatistics(PDFOutputFormatter& formatter)
+PDFToolDocumentStatistics PDFToolRenderBase::getDocumentStatistics(const RenderStatistics& statistics) const
+{
+    PDFToolDocumentStatistics documentStatistics;
+
+    for (const PageInfo& info : statistics.pageInfo)
+    {
+        if (!info.isRendered)
+        {
+            continue;
+        }
+
+        ++documentStatistics.pagesProcessed;
+        documentStatistics.compileTime += info.pageCompileTime;
+        documentStatistics.renderTime += info.pageRenderTime;
+        documentStatistics.encodeTime += info.pageEncodeTime;
+        documentStatistics.writeTime += info.pageWriteTime;
+        documentStatistics.totalTime += info.pageTotalTime + info.pageWriteTime;
+
+        for (const pdf::PDFRenderError& error : info.errors)
+        {
+            switch (error.type)
+            {
+                case pdf::RenderErrorType::Error:
+                    ++documentStatistics.errors;
+                    break;
+
+                case pdf::RenderErrorType::Warning:
+                case pdf::RenderErrorType::NotImplemented:
+                case pdf::RenderErrorType::NotSupported:
+                    ++documentStatistics.warnings;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    return documentStatistics;
+}
+
+void PDFToolRenderBase::writeStatistics(PDFOutputFormatter& formatter, const RenderStatistics& statistics)
 {
     // Jakub Melka: Write overall statistics
     qint64 pagesRendered = 0;
+    qint64 pageQueueTime = 0;
     qint64 pageCompileTime = 0;
     qint64 pageWaitTime = 0;
     qint64 pageRenderTime = 0;
+    qint64 pageEncodeTime = 0;
     qint64 pageTotalTime = 0;
     qint64 pageWriteTime = 0;
 
-    for (const PageInfo& info : m_pageInfo)
+    for (const PageInfo& info : statistics.pageInfo)
     {
         if (!info.isRendered)
         {
@@ -267,23 +353,26 @@ void PDFToolRenderBase::writeStatistics(PDFOutputFormatter& formatter)
         }
 
         ++pagesRendered;
+        pageQueueTime += info.pageQueueTime;
         pageCompileTime += info.pageCompileTime;
         pageWaitTime += info.pageWaitTime;
         pageRenderTime += info.pageRenderTime;
+        pageEncodeTime += info.pageEncodeTime;
         pageTotalTime += info.pageTotalTime + info.pageWriteTime;
         pageWriteTime += info.pageWriteTime;
     }
 
-    if (pagesRendered > 0 && pageTotalTime > 0 && m_wallTime > 0)
+    if (pagesRendered > 0 && pageTotalTime > 0 && statistics.wallTime > 0)
     {
         QLocale locale;
 
         double renderingSpeedPerCore = double(pagesRendered) / (double(pageTotalTime) / 1000.0);
-        double renderingSpeedWallTime = double(pagesRendered) / (double(m_wallTime) / 1000.0);
+        double renderingSpeedWallTime = double(pagesRendered) / (double(statistics.wallTime) / 1000.0);
 
         double compileRatio = 100.0 * double(pageCompileTime) / double(pageTotalTime);
         double waitRatio = 100.0 * double(pageWaitTime) / double(pageTotalTime);
         double renderRatio = 100.0 * double(pageRenderTime) / double(pageTotalTime);
+        double encodeRatio = 100.0 * double(pageEncodeTime) / double(pageTotalTime);
         double writeRatio = 100.0 * double(pageWriteTime) / double(pageTotalTime);
 
         formatter.beginTable("statistics", PDFToolTranslationContext::tr("Statistics"));
@@ -307,14 +396,17 @@ void PDFToolRenderBase::writeStatistics(PDFOutputFormatter& formatter)
         writeValue("compile-time", PDFToolTranslationContext::tr("Total compile time"), locale.toString(pageCompileTime), PDFToolTranslationContext::tr("msec"));
         writeValue("render-time", PDFToolTranslationContext::tr("Total render time"), locale.toString(pageRenderTime), PDFToolTranslationContext::tr("msec"));
         writeValue("wait-time", PDFToolTranslationContext::tr("Total wait time"), locale.toString(pageWaitTime), PDFToolTranslationContext::tr("msec"));
+        writeValue("queue-time", PDFToolTranslationContext::tr("Total queue time"), locale.toString(pageQueueTime), PDFToolTranslationContext::tr("msec"));
+        writeValue("encode-time", PDFToolTranslationContext::tr("Total encode time"), locale.toString(pageEncodeTime), PDFToolTranslationContext::tr("msec"));
         writeValue("write-time", PDFToolTranslationContext::tr("Total write time"), locale.toString(pageWriteTime), PDFToolTranslationContext::tr("msec"));
         writeValue("total-time", PDFToolTranslationContext::tr("Total time"), locale.toString(pageTotalTime), PDFToolTranslationContext::tr("msec"));
-        writeValue("wall-time", PDFToolTranslationContext::tr("Wall time"), locale.toString(m_wallTime), PDFToolTranslationContext::tr("msec"));
+        writeValue("wall-time", PDFToolTranslationContext::tr("Wall time"), locale.toString(statistics.wallTime), PDFToolTranslationContext::tr("msec"));
         writeValue("pages-per-second-core", PDFToolTranslationContext::tr("Rendering speed (per core)"), locale.toString(renderingSpeedPerCore, 'f', 3), PDFToolTranslationContext::tr("pages / sec (one core)"));
         writeValue("pages-per-second-wall", PDFToolTranslationContext::tr("Rendering speed (wall time)"), locale.toString(renderingSpeedWallTime, 'f', 3), PDFToolTranslationContext::tr("pages / sec"));
         writeValue("compile-time-ratio", PDFToolTranslationContext::tr("Compile time ratio"), locale.toString(compileRatio, 'f', 2), PDFToolTranslationContext::tr("%"));
         writeValue("render-time-ratio", PDFToolTranslationContext::tr("Render time ratio"), locale.toString(renderRatio, 'f', 2), PDFToolTranslationContext::tr("%"));
         writeValue("wait-time-ratio", PDFToolTranslationContext::tr("Wait time ratio"), locale.toString(waitRatio, 'f', 2), PDFToolTranslationContext::tr("%"));
+        writeValue("encode-time-ratio", PDFToolTranslationContext::tr("Encode time ratio"), locale.toString(encodeRatio, 'f', 2), PDFToolTranslationContext::tr("%"));
         writeValue("write-time-ratio", PDFToolTranslationContext::tr("Write time ratio"), locale.toString(writeRatio, 'f', 2), PDFToolTranslationContext::tr("%"));
 
         formatter.endTable();
@@ -322,7 +414,7 @@ void PDFToolRenderBase::writeStatistics(PDFOutputFormatter& formatter)
     }
 }
 
-void PDFToolRenderBase::writePageStatistics(PDFOutputFormatter& formatter)
+void PDFToolRenderBase::writePageStatistics(PDFOutputFormatter& formatter, const RenderStatistics& statistics)
 {
     formatter.beginTable("page-statistics", PDFToolTranslationContext::tr("Page Statistics"));
 
@@ -331,13 +423,15 @@ void PDFToolRenderBase::writePageStatistics(PDFOutputFormatter& formatter)
     formatter.writeTableHeaderColumn("compile-time", PDFToolTranslationContext::tr("Compile Time [msec]"), Qt::AlignLeft);
     formatter.writeTableHeaderColumn("render-time", PDFToolTranslationContext::tr("Render Time [msec]"), Qt::AlignLeft);
     formatter.writeTableHeaderColumn("wait-time", PDFToolTranslationContext::tr("Wait Time [msec]"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("queue-time", PDFToolTranslationContext::tr("Queue Time [msec]"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("encode-time", PDFToolTranslationContext::tr("Encode Time [msec]"), Qt::AlignLeft);
     formatter.writeTableHeaderColumn("write-time", PDFToolTranslationContext::tr("Write Time [msec]"), Qt::AlignLeft);
     formatter.writeTableHeaderColumn("total-time", PDFToolTranslationContext::tr("Total Time [msec]"), Qt::AlignLeft);
     formatter.endTableHeaderRow();
 
     QLocale locale;
 
-    for (const PageInfo& info : m_pageInfo)
+    for (const PageInfo& info : statistics.pageInfo)
     {
         if (!info.isRendered)
         {
@@ -349,6 +443,8 @@ void PDFToolRenderBase::writePageStatistics(PDFOutputFormatter& formatter)
         formatter.writeTableColumn("compile-time", locale.toString(info.pageCompileTime), Qt::AlignRight);
         formatter.writeTableColumn("render-time", locale.toString(info.pageRenderTime), Qt::AlignRight);
         formatter.writeTableColumn("wait-time", locale.toString(info.pageWaitTime), Qt::AlignRight);
+        formatter.writeTableColumn("queue-time", locale.toString(info.pageQueueTime), Qt::AlignRight);
+        formatter.writeTableColumn("encode-time", locale.toString(info.pageEncodeTime), Qt::AlignRight);
         formatter.writeTableColumn("write-time", locale.toString(info.pageWriteTime), Qt::AlignRight);
         formatter.writeTableColumn("total-time", locale.toString(info.pageTotalTime), Qt::AlignRight);
         formatter.endTableRow();
@@ -358,7 +454,7 @@ void PDFToolRenderBase::writePageStatistics(PDFOutputFormatter& formatter)
     formatter.endl();
 }
 
-void PDFToolRenderBase::writeErrors(PDFOutputFormatter& formatter)
+void PDFToolRenderBase::writeErrors(PDFOutputFormatter& formatter, const RenderStatistics& statistics)
 {
     formatter.beginTable("rendering-errors", PDFToolTranslationContext::tr("Rendering Errors"));
 
@@ -370,7 +466,7 @@ void PDFToolRenderBase::writeErrors(PDFOutputFormatter& formatter)
 
     QLocale locale;
 
-    for (const PageInfo& info : m_pageInfo)
+    for (const PageInfo& info : statistics.pageInfo)
     {
         if (!info.isRendered)
         {
@@ -30,29 +30,47 @@ public:
     virtual int execute(const PDFToolOptions& options) override;
 
 protected:
-    virtual void finish(const PDFToolOptions& options) = 0;
-    virtual void onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage) = 0;
-
-    void writePageInfoStatistics(const pdf::PDFRenderedPageImage& renderedPageImage);
-
-    void writeStatistics(PDFOutputFormatter& formatter);
-    void writePageStatistics(PDFOutputFormatter& formatter);
-    void writeErrors(PDFOutputFormatter& formatter);
-
     struct PageInfo
     {
         bool isRendered = false;
         pdf::PDFInteger pageIndex = 0;
+        qint64 pageQueueTime = 0;
         qint64 pageCompileTime = 0;
         qint64 pageWaitTime = 0;
         qint64 pageRenderTime = 0;
+        qint64 pageEncodeTime = 0;
         qint64 pageTotalTime = 0;
         qint64 pageWriteTime = 0;
         std::vector<pdf::PDFRenderError> errors;
     };
 
-    std::vector<PageInfo> m_pageInfo;
-    qint64 m_wallTime = 0;
+    /// Rendering statistics of a single document. Statistics are not stored
+    /// in the application, so multiple documents can be rendered concurrently.
+    struct RenderStatistics
+    {
+        std::vector<PageInfo> pageInfo;
+        qint64 wallTime = 0;
+    };
+
+    virtual void finish(const PDFToolOptions& options, const RenderStatistics& statistics) = 0;
+
+    /// Encodes rendered page image. Called in parallel from the encode stage
+    /// of the rendering pipeline, pages can be encoded in arbitrary order.
+    virtual void onPageEncode(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage);
+
+    /// Called from the write stage of the rendering pipeline, pages
+    /// are processed sequentially in the order, in which they were requested.
+    virtual void onPageRendered(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage) = 0;
+
+    void writePageInfoStatistics(RenderStatistics& statistics, const pdf::PDFRenderedPageImage& renderedPageImage);
+
+    /// Returns statistics of rendered pages, which are combined
+    /// with statistics of other documents in batch mode.
+    PDFToolDocumentStatistics getDocumentStatistics(const RenderStatistics& statistics) const;
+
+    void writeStatistics(PDFOutputFormatter& formatter, const RenderStatistics& statistics);
+    void writePageStatistics(PDFOutputFormatter& formatter, const RenderStatistics& statistics);
+    void writeErrors(PDFOutputFormatter& formatter, const RenderStatistics& statistics);
 };
 
 class PDFToolRender : public PDFToolRenderBase
@@ -62,8 +80,9 @@ public:
     virtual Options getOptionsFlags() const override;
 
 protected:
-    virtual void finish(const PDFToolOptions& options) override;
-    virtual void onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage) override;
+    virtual void finish(const PDFToolOptions& options, const RenderStatistics& statistics) override;
+    virtual void onPageEncode(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage) override;
+    virtual void onPageRendered(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage) override;
 };
 
 class PDFToolBenchmark : public PDFToolRenderBase
@@ -73,8 +92,8 @@ public:
     virtual Options getOptionsFlags() const override;
 
 protected:
-    virtual void finish(const PDFToolOptions& options) override;
-    virtual void onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage) override;
+    virtual void finish(const PDFToolOptions& options, const RenderStatistics& statistics) override;
+    virtual void onPageRendered(const PDFToolOptions& options, RenderStatistics& statistics, pdf::PDFRenderedPageImage& renderedPageImage) override;
 };
 
 }   // namespace pdftool
@@ -0,0 +1,661 @@
+//    Copyright (C) 2024 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "pdftoolserver.h"
+#include "pdfannotation.h"
+#include "pdfconstants.h"
+#include "pdfdocumentreader.h"
+#include "pdfexecutionpolicy.h"
+#include "pdffont.h"
+#include "pdfjbig2decoder.h"
+#include "pdfoptionalcontent.h"
+#include "pdfpainter.h"
+
+#include <QFile>
+#include <QPointer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QElapsedTimer>
+#include <QThreadPool>
+
+#include <map>
+#include <atomic>
+#include <memory>
+
+namespace pdftool
+{
+
+static PDFToolServer s_toolServerApplication;
+
+/// Document opened by the server, together with its caches. Document
+/// is kept in memory between requests, and also its compiled pages are.
+class PDFToolServerDocument
+{
+public:
+    explicit PDFToolServerDocument(pdf::PDFDocument document,
+                                   QDateTime lastModified,
+                                   const PDFToolOptions& options,
+                                   const pdf::PDFMeshQualitySettings& meshQualitySettings,
+                                   qint64 compiledPagesMemoryLimit);
+    ~PDFToolServerDocument();
+
+    const pdf::PDFDocument* getDocument() const { return &m_document; }
+    const QDateTime& getLastModified() const { return m_lastModified; }
+    const pdf::PDFAnnotationManager* getAnnotationManager() const { return &m_annotationManager; }
+    pdf::PDFCMSPointer getCMS() const { return m_cmsManager.getCurrentCMS(); }
+
+    /// Returns compiled page. If page is not compiled yet, then it is compiled
+    /// and stored in the cache. This function is thread safe.
+    /// \param pageIndex Page index
+    /// \param[out] isCached Was page found in the cache?
+    std::shared_ptr<const pdf::PDFPrecompiledPage> getCompiledPage(pdf::PDFInteger pageIndex, bool& isCached);
+
+private:
+    struct CompiledPage
+    {
+        std::shared_ptr<const pdf::PDFPrecompiledPage> page;
+        quint64 lastUsed = 0;
+    };
+
+    pdf::PDFDocument m_document;
+    QDateTime m_lastModified;
+    pdf::PDFRenderer::Features m_features;
+    const pdf::PDFMeshQualitySettings& m_meshQualitySettings;
+    pdf::PDFOptionalContentActivity m_optionalContentActivity;
+    pdf::PDFFontCache m_fontCache;
+    pdf::PDFJBIG2GlobalsCache m_jbig2GlobalsCache;
+    pdf::PDFCMSManager m_cmsManager;
+    pdf::PDFAnnotationManager m_annotationManager;
+
+    QMutex m_mutex;
+    std::map<pdf::PDFInteger, CompiledPage> m_compiledPages;
+    qint64 m_compiledPagesMemoryLimit = 0;
+    quint64 m_useCounter = 0;
+};
+
+PDFToolServerDocument::PDFToolServerDocument(pdf::PDFDocument document,
+                                             QDateTime lastModified,
+                                             const PDFToolOptions& options,
+                                             const pdf::PDFMeshQualitySettings& meshQualitySettings,
+                                             qint64 compiledPagesMemoryLimit) :
+    m_document(qMove(document)),
+    m_lastModified(qMove(lastModified)),
+    m_features(options.renderFeatures),
+    m_meshQualitySettings(meshQualitySettings),
+    m_optionalContentActivity(&m_document, pdf::OCUsage::Export, nullptr),
+    m_fontCache(pdf::DEFAULT_FONT_CACHE_LIMIT, pdf::DEFAULT_REALIZED_FONT_CACHE_LIMIT),
+    m_jbig2GlobalsCache(pdf::DEFAULT_JBIG2_GLOBALS_CACHE_LIMIT),
+    m_cmsManager(nullptr),
+    m_annotationManager(&m_fontCache, &m_cmsManager, &m_optionalContentActivity, meshQualitySettings, options.renderFeatures, pdf::PDFAnnotationManager::Target::Print, nullptr),
+    m_compiledPagesMemoryLimit(compiledPagesMemoryLimit)
+{
+    m_cmsManager.setDocument(&m_document);
+    m_cmsManager.setSettings(options.cmsSettings);
+
+    pdf::PDFModifiedDocument modifiedDocument(&m_document, &m_optionalContentActivity);
+    m_fontCache.setDocument(modifiedDocument);
+    m_fontCache.setCacheShrinkEnabled(this, false);
+    m_jbig2GlobalsCache.setDocument(modifiedDocument);
+    m_annotationManager.setDocument(modifiedDocument);
+}
+
+PDFToolServerDocument::~PDFToolServerDocument()
+{
+    m_fontCache.setCacheShrinkEnabled(this, true);
+}
+
+std::shared_ptr<const pdf::PDFPrecompiledPage> PDFToolServerDocument::getCompiledPage(pdf::PDFInteger pageIndex, bool& isCached)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_compiledPages.find(pageIndex);
+        if (it != m_compiledPages.end())
+        {
+            it->second.lastUsed = ++m_useCounter;
+            isCached = true;
+            return it->second.page;
+        }
+    }
+
+    // Compile the page without the lock, so other pages can be compiled in parallel
+    isCached = false;
+    std::shared_ptr<pdf::PDFPrecompiledPage> compiledPage = std::make_shared<pdf::PDFPrecompiledPage>();
+    pdf::PDFCMSPointer cms = m_cmsManager.getCurrentCMS();
+    pdf::PDFRenderer renderer(&m_document, &m_fontCache, cms.data(), &m_optionalContentActivity, m_features, m_meshQualitySettings);
+    renderer.setJBIG2GlobalsCache(&m_jbig2GlobalsCache);
+    renderer.compileVisibleContent(compiledPage.get(), pageIndex);
+
+    QMutexLocker lock(&m_mutex);
+    auto it = m_compiledPages.find(pageIndex);
+    if (it != m_compiledPages.end())
+    {
+        // Another request compiled the page in the meantime
+        it->second.lastUsed = ++m_useCounter;
+        return it->second.page;
+    }
+
+    // Remove least recently used pages, if we exceed the memory limit. Memory consumption
+    // of the cached pages is evaluated again, because the pages can grow when drawn
+    // (the native renderer caches its objects in the page).
+    qint64 compiledPagesMemory = compiledPage->getMemoryConsumptionEstimate();
+    for (const auto& item : m_compiledPages)
+    {
+        compiledPagesMemory += item.second.page->getMemoryConsumptionEstimate();
+    }
+
+    while (compiledPagesMemory > m_compiledPagesMemoryLimit && !m_compiledPages.empty())
+    {
+        auto leastRecentlyUsedIt = std::min_element(m_compiledPages.begin(), m_compiledPages.end(), [](const auto& l, const auto& r) { return l.second.lastUsed < r.second.lastUsed; });
+        compiledPagesMemory -= leastRecentlyUsedIt->second.page->getMemoryConsumptionEstimate();
+        m_compiledPages.erase(leastRecentlyUsedIt);
+    }
+
+    CompiledPage& cachedPage = m_compiledPages[pageIndex];
+    cachedPage.page = compiledPage;
+    cachedPage.lastUsed = ++m_useCounter;
+    return compiledPage;
+}
+
+/// Render server, which processes the requests. Requests are processed
+/// in the request thread pool, pages of each request are rendered
+/// in parallel using execution policy.
+class PDFToolRenderServer
+{
+public:
+    explicit PDFToolRenderServer(const PDFToolOptions& options);
+    ~PDFToolRenderServer();
+
+    /// Reads requests from standard input, until end of input
+    /// is reached, or quit request is received.
+    int executeStandardInput();
+
+    /// Listens on local socket with given name, until quit
+    /// request is received.
+    /// \param socketName Socket name
+    int executeLocalSocket(const QString& socketName);
+
+private:
+    using ResponseCallback = std::function<void(QByteArray)>;
+
+    /// Processes the request and returns the response
+    /// \param request Request (JSON object)
+    /// \param[out] isQuitRequest Is it request to quit the server?
+    QByteArray processRequest(const QByteArray& request, bool* isQuitRequest);
+
+    /// Starts processing the request in the request thread pool. Response
+    /// is passed to the callback, which is called from the worker thread.
+    /// \param request Request
+    /// \param callback Response callback
+    void startRequest(QByteArray request, ResponseCallback callback);
+
+    /// Returns opened document. If document is not opened, or file
+    /// was changed since it was opened, then it is read again. Documents
+    /// are cached together with the password, so document opened by one
+    /// client can't be used without the password by another client.
+    /// \param fileName File name
+    /// \param password Password
+    /// \param[out] isCached Was document found in the cache?
+    /// \param[out] errorMessage Error message
+    std::shared_ptr<PDFToolServerDocument> getDocument(const QString& fileName, const QString& password, bool& isCached, QString& errorMessage);
+
+    /// Maximal memory consumed by compiled pages of all opened documents,
+    /// each document can use its share of the limit.
+    static constexpr qint64 COMPILED_PAGES_MEMORY_LIMIT = 1024 * 1024 * 1024;
+
+    PDFToolOptions m_options;
+    pdf::PDFMeshQualitySettings m_meshQualitySettings;
+    pdf::PDFRasterizerPool m_rasterizerPool;
+    QThreadPool m_requestThreadPool;
+
+    QMutex m_documentsMutex;
+    std::map<std::pair<QString, QString>, std::pair<std::shared_ptr<PDFToolServerDocument>, quint64>> m_documents;
+    quint64 m_documentUseCounter = 0;
+
+    std::atomic_bool m_quitRequested = false;
+    std::function<void()> m_quitFunction;
+};
+
+PDFToolRenderServer::PDFToolRenderServer(const PDFToolOptions& options) :
+    m_options(options),
+    m_rasterizerPool(nullptr, nullptr, nullptr, nullptr, options.renderFeatures, m_meshQualitySettings,
+                     pdf::PDFRasterizerPool::getCorrectedRasterizerCount(options.renderRasterizerCount),
+                     options.renderUseSoftwareRendering ? pdf::RendererEngine::QPainter : pdf::RendererEngine::Blend2D_SingleThread, nullptr)
+{
+    m_requestThreadPool.setMaxThreadCount(options.serverJobs);
+}
+
+PDFToolRenderServer::~PDFToolRenderServer()
+{
+    m_requestThreadPool.waitForDone();
+}
+
+int PDFToolRenderServer::executeStandardInput()
+{
+    QMutex outputMutex;
+    auto writeResponse = [this, &outputMutex](QByteArray response)
+    {
+        QMutexLocker lock(&outputMutex);
+        PDFConsole::writeText(QString::fromUtf8(response), m_options.outputCodec);
+    };
+
+    QFile input;
+    if (!input.open(stdin, QFile::ReadOnly))
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot read standard input."), m_options.outputCodec);
+        return PDFToolAbstractApplication::ErrorUnknown;
+    }
+
+    while (!m_quitRequested)
+    {
+        QByteArray request = input.readLine().trimmed();
+        if (request.isEmpty())
+        {
+            if (input.atEnd())
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        // Quit request is processed synchronously, otherwise we would
+        // be blocked reading the next line until end of the input.
+        QJsonDocument requestDocument = QJsonDocument::fromJson(request);
+        if (requestDocument.isObject() && requestDocument.object().value("command").toString() == "quit")
+        {
+            m_requestThreadPool.waitForDone();
+
+            bool isQuitRequest = false;
+            writeResponse(processRequest(request, &isQuitRequest));
+            break;
+        }
+
+        startRequest(qMove(request), writeResponse);
+    }
+
+    m_requestThreadPool.waitForDone();
+    return PDFToolAbstractApplication::ExitSuccess;
+}
+
+int PDFToolRenderServer::executeLocalSocket(const QString& socketName)
+{
+    QLocalServer server;
+    QLocalServer::removeServer(socketName);
+    if (!server.listen(socketName))
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot listen on local socket '%1', because: %2.").arg(socketName, server.errorString()), m_options.outputCodec);
+        return PDFToolAbstractApplication::ErrorUnknown;
+    }
+
+    m_quitFunction = [&server]()
+    {
+        QMetaObject::invokeMethod(&server, &QCoreApplication::quit, Qt::QueuedConnection);
+    };
+
+    auto onNewConnection = [this, &server]()
+    {
+        while (QLocalSocket* socket = server.nextPendingConnection())
+        {
+            QObject::connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+            QObject::connect(socket, &QLocalSocket::readyRead, socket, [this, socket, &server]()
+            {
+                while (socket->canReadLine())
+                {
+                    QByteArray request = socket->readLine().trimmed();
+                    if (request.isEmpty())
+                    {
+                        continue;
+                    }
+
+                    // Response is written to the socket from the main thread.
+                    // Socket can be already closed, when response is ready.
+                    QPointer<QLocalSocket> socketPointer(socket);
+                    auto writeResponse = [socketPointer, &server](QByteArray response)
+                    {
+                        QMetaObject::invokeMethod(&server, [socketPointer, response]()
+                        {
+                            if (socketPointer)
+                            {
+                                socketPointer->write(response);
+                                socketPointer->flush();
+                            }
+                        }, Qt::QueuedConnection);
+                    };
+                    startRequest(qMove(request), writeResponse);
+                }
+            });
+        }
+    };
+    QObject::connect(&server, &QLocalServer::newConnection, &server, onNewConnection);
+
+    int result = QCoreApplication::exec();
+    m_requestThreadPool.waitForDone();
+    m_quitFunction = nullptr;
+    return result;
+}
+
+void PDFToolRenderServer::startRequest(QByteArray request, ResponseCallback callback)
+{
+    m_requestThreadPool.start([this, request = qMove(request), callback = qMove(callback)]()
+    {
+        bool isQuitRequest = false;
+        QByteArray response = processRequest(request, &isQuitRequest);
+        callback(response);
+
+        if (isQuitRequest)
+        {
+            m_quitRequested = true;
+
+            if (m_quitFunction)
+            {
+                m_quitFunction();
+            }
+        }
+    });
+}
+
+std::shared_ptr<PDFToolServerDocument> PDFToolRenderServer::getDocument(const QString& fileName, const QString& password, bool& isCached, QString& errorMessage)
+{
+    QFileInfo fileInfo(fileName);
+    const QString filePath = fileInfo.absoluteFilePath();
+    const QDateTime lastModified = fileInfo.lastModified();
+    const std::pair<QString, QString> documentKey(filePath, password);
+
+    {
+        QMutexLocker lock(&m_documentsMutex);
+        auto it = m_documents.find(documentKey);
+        if (it != m_documents.end() && it->second.first->getLastModified() == lastModified)
+        {
+            it->second.second = ++m_documentUseCounter;
+            isCached = true;
+            return it->second.first;
+        }
+    }
+
+    // Read the document without the lock, other documents
+    // can be used (or read) in the meantime.
+    isCached = false;
+    bool isFirstPasswordAttempt = true;
+    auto passwordCallback = [&password, &isFirstPasswordAttempt](bool* ok) -> QString
+    {
+        *ok = isFirstPasswordAttempt;
+        isFirstPasswordAttempt = false;
+        return password;
+    };
+    pdf::PDFDocumentReader reader(nullptr, passwordCallback, m_options.permissiveReading, false);
+    pdf::PDFDocument document = reader.readFromFile(filePath);
+
+    switch (reader.getReadingResult())
+    {
+        case pdf::PDFDocumentReader::Result::OK:
+            break;
+
+        case pdf::PDFDocumentReader::Result::Cancelled:
+            errorMessage = PDFToolTranslationContext::tr("Invalid password provided.");
+            return nullptr;
+
+        case pdf::PDFDocumentReader::Result::Failed:
+            errorMessage = PDFToolTranslationContext::tr("Error occured during document reading. %1").arg(reader.getErrorMessage());
+            return nullptr;
+
+        default:
+            Q_ASSERT(false);
+            return nullptr;
+    }
+
+    const qint64 compiledPagesMemoryLimit = COMPILED_PAGES_MEMORY_LIMIT / qMax(m_options.serverMaxDocuments, 1);
+    auto serverDocument = std::make_shared<PDFToolServerDocument>(qMove(document), lastModified, m_options, m_meshQualitySettings, compiledPagesMemoryLimit);
+
+    QMutexLocker lock(&m_documentsMutex);
+    m_documents[documentKey] = std::make_pair(serverDocument, ++m_documentUseCounter);
+
+    // Close least recently used documents. Documents, which are being
+    // used by some request, are closed after the request is finished.
+    while (m_documents.size() > size_t(m_options.serverMaxDocuments))
+    {
+        auto leastRecentlyUsedIt = std::min_element(m_documents.begin(), m_documents.end(), [](const auto& l, const auto& r) { return l.second.second < r.second.second; });
+        m_documents.erase(leastRecentlyUsedIt);
+    }
+
+    return serverDocument;
+}
+
+QByteArray PDFToolRenderServer::processRequest(const QByteArray& request, bool* isQuitRequest)
+{
+    QElapsedTimer requestTimer;
+    requestTimer.start();
+
+    QJsonObject response;
+
+    auto finishResponse = [&response, &requestTimer](QString errorMessage)
+    {
+        response["status"] = errorMessage.isEmpty() ? QString("ok") : QString("error");
+        if (!errorMessage.isEmpty())
+        {
+            response["message"] = errorMessage;
+        }
+        response["latency-time"] = requestTimer.elapsed();
+        return QJsonDocument(response).toJson(QJsonDocument::Compact) + '\n';
+    };
+
+    QJsonParseError parseError;
+    QJsonDocument requestDocument = QJsonDocument::fromJson(request, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !requestDocument.isObject())
+    {
+        return finishResponse(PDFToolTranslationContext::tr("Invalid request: %1.").arg(parseError.errorString()));
+    }
+
+    QJsonObject requestObject = requestDocument.object();
+    if (requestObject.contains("id"))
+    {
+        response["id"] = requestObject.value("id");
+    }
+
+    if (requestObject.value("command").toString() == "quit")
+    {
+        *isQuitRequest = true;
+        return finishResponse(QString());
+    }
+
+    const QString documentFileName = requestObject.value("document").toString();
+    const QString outputFileName = requestObject.value("output").toString();
+    const QByteArray format = requestObject.value("format").toString("png").toLatin1();
+
+    if (documentFileName.isEmpty())
+    {
+        return finishResponse(PDFToolTranslationContext::tr("No document specified."));
+    }
+
+    if (outputFileName.isEmpty())
+    {
+        return finishResponse(PDFToolTranslationContext::tr("No output file specified."));
+    }
+
+    if (!QImageWriter::supportedImageFormats().contains(format))
+    {
+        return finishResponse(PDFToolTranslationContext::tr("Unsupported image format '%1'.").arg(QString::fromLatin1(format)));
+    }
+
+    bool isDocumentCached = false;
+    QString errorMessage;
+    std::shared_ptr<PDFToolServerDocument> serverDocument = getDocument(documentFileName, requestObject.value("password").toString(), isDocumentCached, errorMessage);
+    response["document-cached"] = isDocumentCached;
+
+    if (!serverDocument)
+    {
+        return finishResponse(errorMessage);
+    }
+
+    const pdf::PDFDocument* document = serverDocument->getDocument();
+
+    // Output file name is a template, character '%' is replaced by page number
+    QFileInfo outputFileInfo(outputFileName);
+    pdf::PDFPageImageExportSettings exportSettings(document);
+    exportSettings.setDirectory(outputFileInfo.absolutePath());
+    exportSettings.setFileTemplate(outputFileInfo.fileName());
+
+    if (requestObject.contains("pixels"))
+    {
+        exportSettings.setResolutionMode(pdf::PDFPageImageExportSettings::ResolutionMode::Pixels);
+        exportSettings.setPixelResolution(requestObject.value("pixels").toInt());
+    }
+    else
+    {
+        exportSettings.setResolutionMode(pdf::PDFPageImageExportSettings::ResolutionMode::DPI);
+        exportSettings.setDpiResolution(requestObject.value("dpi").toInt(300));
+    }
+
+    if (requestObject.contains("pages"))
+    {
+        exportSettings.setPageSelectionMode(pdf::PDFPageImageExportSettings::PageSelectionMode::Selection);
+        exportSettings.setPageSelection(requestObject.value("pages").toString());
+    }
+
+    if (!exportSettings.validate(&errorMessage))
+    {
+        return finishResponse(errorMessage);
+    }
+
+    // Render the pages
+    QMutex responseMutex;
+    QJsonArray errors;
+    qint64 pageCompileTime = 0;
+    qint64 pageRenderTime = 0;
+    qint64 pageWriteTime = 0;
+    int pagesCached = 0;
+
+    auto processPage = [&](pdf::PDFInteger pageIndex)
+    {
+        const pdf::PDFPage* page = document->getCatalog()->getPage(pageIndex);
+        if (!page)
+        {
+            QMutexLocker lock(&responseMutex);
+            errors.append(PDFToolTranslationContext::tr("Page %1 not found.").arg(pageIndex + 1));
+            return;
+        }
+
+        QElapsedTimer pageTimer;
+        pageTimer.start();
+
+        bool isPageCached = false;
+        std::shared_ptr<const pdf::PDFPrecompiledPage> compiledPage = serverDocument->getCompiledPage(pageIndex, isPageCached);
+        const qint64 compileTime = pageTimer.restart();
+
+        QSize imageSize;
+        switch (exportSettings.getResolutionMode())
+        {
+            case pdf::PDFPageImageExportSettings::ResolutionMode::DPI:
+                imageSize = (page->getRotatedMediaBox().size() * pdf::PDF_POINT_TO_INCH * exportSettings.getDpiResolution()).toSize();
+                break;
+
+            case pdf::PDFPageImageExportSettings::ResolutionMode::Pixels:
+                imageSize = page->getRotatedMediaBox().size().scaled(exportSettings.getPixelResolution(), exportSettings.getPixelResolution(), Qt::KeepAspectRatio).toSize();
+                break;
+
+            default:
+                Q_ASSERT(false);
+                break;
+        }
+
+        pdf::PDFCMSPointer cms = serverDocument->getCMS();
+        pdf::PDFRasterizer* rasterizer = m_rasterizerPool.acquire();
+        QImage image = rasterizer->render(pageIndex, page, compiledPage.get(), imageSize, m_options.renderFeatures, serverDocument->getAnnotationManager(), cms.data(), pdf::PageRotation::None);
+        m_rasterizerPool.release(rasterizer);
+        const qint64 renderTime = pageTimer.restart();
+
+        QString fileName = exportSettings.getOutputFileName(pageIndex, format);
+        QImageWriter imageWriter(fileName, format);
+        imageWriter.setCompression(m_options.imageWriterSettings.getCompression());
+        imageWriter.setQuality(m_options.imageWriterSettings.getQuality());
+        const bool isWritten = imageWriter.write(image);
+        const qint64 writeTime = pageTimer.elapsed();
+
+        QMutexLocker lock(&responseMutex);
+        pageCompileTime += compileTime;
+        pageRenderTime += renderTime;
+        pageWriteTime += writeTime;
+        pagesCached += isPageCached ? 1 : 0;
+
+        if (!isPageCached)
+        {
+            for (const pdf::PDFRenderError& error : compiledPage->getErrors())
+            {
+                errors.append(PDFToolTranslationContext::tr("Page %1: %2").arg(pageIndex + 1).arg(error.message));
+            }
+        }
+
+        if (!isWritten)
+        {
+            errors.append(PDFToolTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(fileName, imageWriter.errorString()));
+        }
+    };
+
+    std::vector<pdf::PDFInteger> pageIndices = exportSettings.getPages();
+    pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Page, pageIndices.cbegin(), pageIndices.cend(), processPage);
+
+    response["pages"] = int(pageIndices.size());
+    response["pages-cached"] = pagesCached;
+    response["compile-time"] = pageCompileTime;
+    response["render-time"] = pageRenderTime;
+    response["write-time"] = pageWriteTime;
+    response["errors"] = errors;
+    return finishResponse(QString());
+}
+
+QString PDFToolServer::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
+{
+    switch (standardString)
+    {
+        case Command:
+            return "server";
+
+        case Name:
+            return PDFToolTranslationContext::tr("Render server");
+
+        case Description:
+            return PDFToolTranslationContext::tr("Render pages of documents on requests read from standard input or local socket, keeping documents and caches in memory.");
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    return QString();
+}
+
+PDFToolAbstractApplication::Options PDFToolServer::getOptionsFlags() const
+{
+    return ConsoleFormat | ImageWriterSettings | ColorManagementSystem | RenderFlags | Server;
+}
+
+int PDFToolServer::execute(const PDFToolOptions& options)
+{
+    PDFToolRenderServer server(options);
+
+    if (options.serverSocket.isEmpty())
+    {
+        return server.executeStandardInput();
+    }
+
+    return server.executeLocalSocket(options.serverSocket);
+}
+
+}   // namespace pdftool
@@ -0,0 +1,42 @@
+//    Copyright (C) 2024 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef PDFTOOLSERVER_H
+#define PDFTOOLSERVER_H
+
+#include "pdftoolabstractapplication.h"
+
+namespace pdftool
+{
+
+/// Headless render server. Server keeps documents, font caches, color management
+/// systems and compiled pages in memory across requests, so small, repeated
+/// render jobs do not pay the startup cost again. Requests are JSON objects,
+/// one per line, read from the standard input or from a local socket, and are
+/// processed concurrently. For each request, one line with JSON response
+/// is written back.
+class PDFToolServer : public PDFToolAbstractApplication
+{
+public:
+    virtual QString getStandardString(StandardString standardString) const override;
+    virtual int execute(const PDFToolOptions& options) override;
+    virtual Options getOptionsFlags() const override;
+};
+
+}   // namespace pdftool
+
+#endif // PDFTOOLSERVER_H
@@ -235,6 +235,13 @@ int PDFToolXmlApplication::execute(const PDFToolOptions& options)
         writer.writeAttribute("gen", QString::number(entry.generation));
         entry.object.accept(&visitor);
         writer.writeEndElement();
+
+        if (options.outputStreaming)
+        {
+            // Write finished object immediately, do not keep it in memory
+            PDFConsole::writeText(xmlString, options.outputCodec);
+            xmlString.clear();
+        }
     }
 
     writer.writeEndElement();
@@ -18,6 +18,8 @@
 
 #include <QtTest>
 #include <QMetaType>
+#include <QBuffer>
+#include <QImageReader>
 
 #include "pdfparser.h"
 #include "pdfconstants.h"
@@ -27,8 +29,26 @@
 #include "pdfdocument.h"
 #include "pdfexception.h"
 #include "pdfjbig2decoder.h"
+#include "pdfimageconversion.h"
+#include "pdfpainterutils.h"
+#include "pdfpainter.h"
+#include "pdfblpainter.h"
+#include "pdfcolorconvertor.h"
+#include "pdftransparencyrenderer.h"
+#include "pdfccittfaxdecoder.h"
+#include "pdfimageencoder.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfdocumentreader.h"
+#include "pdfcms.h"
+#include "pdffont.h"
+#include "pdfoptionalcontent.h"
+#include "pdfimage.h"
+#include "pdfannotation.h"
 
 #include <regex>
+#include <random>
+#include <numeric>
+#include <atomic>
 
 #ifdef PDF4QT_COMPILER_MSVC
 #pragma warning(push)
@@ -60,12 +80,71 @@ private slots:
     void test_stitching_function();
     void test_postscript_function();
     void test_jbig2_arithmetic_decoder();
+    void test_jbig2_bitmap();
+    void test_jbig2_globals_cache();
+    void test_bitonal_conversion();
+    void test_painter_rectangle_detection();
+    void test_blend2d_complex_then_rectangle_clip();
+    void test_blend2d_cache_memory_consumption();
+    void test_converted_colors_parallel_draw();
+    void test_separable_blend_accuracy();
+    void test_path_sampler_parity();
+    void test_ccitt_fax_decoder();
+    void test_lzw_encoder_round_trip();
+    void test_png_encoder_round_trip();
+    void test_tiff_encoder_round_trip();
+    void test_tiling_pattern_cell_cache();
+    void test_compile_visible_content();
+    void test_shading_native_gradient();
+    void test_shading_mesh_cache();
+    void test_optional_content_draw_time();
+    void test_rasterizer_pool_pipeline();
+    void test_annotation_manager_shared();
+    void test_annotation_appearance_cache();
+    void test_transparency_band_rendering();
+    void test_fixed_point_blend_accuracy();
+    void test_fixed_point_blending_rendering();
+    void test_form_instancing_color_space();
+    void test_form_instancing_snap_images();
+    void test_type3_glyph_instancing();
 
 private:
     void scanWholeStream(const char* stream);
     void testTokens(const char* stream, const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens);
 
     QString getStringFromTokens(const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens);
+
+    /// Creates document from the objects. Object numbers start from 1,
+    /// first object must be the catalog.
+    /// \param objects Objects of the document
+    pdf::PDFDocument createDocument(const std::vector<QByteArray>& objects) const;
+
+    /// Creates document with single page 200 x 200, which is filled by the tiling
+    /// pattern, with given pattern cell step and content. Pattern resources are
+    /// written as object 6 and optional content group as object 7.
+    /// \param step Step (and bounding box) of the pattern cell
+    /// \param content Content of the pattern cell
+    /// \param resources Resources of the pattern
+    pdf::PDFDocument createTilingPatternDocument(int step, const QByteArray& content, const QByteArray& resources) const;
+
+    /// Creates document with pages 40 x 40 filled with white color. Each page has
+    /// printable square annotation with rectangle [10, 10, 30, 30], its appearance
+    /// stream fills the annotation rectangle with given color. If color is empty,
+    /// then page has no annotation.
+    /// \param appearanceColors Color operators of the appearance streams (for example, "1 0 0 rg")
+    pdf::PDFDocument createAnnotationDocument(const std::vector<QByteArray>& appearanceColors) const;
+
+    /// Creates test images for image encoder, covering all pixel formats
+    /// of the encoder (bilevel, indexed with and without transparency, gray,
+    /// gray with alpha, RGB and RGBA), widths are not multiples of 8.
+    std::vector<QImage> createEncoderTestImages() const;
+
+    /// Reads image from the data using QImageReader
+    QImage readImage(const QByteArray& data, const QByteArray& format) const;
+
+    /// Returns true, if images have the same size and same pixels (color
+    /// of fully transparent pixels is not compared).
+    bool isSameImage(const QImage& image1, const QImage& image2) const;
 };
 
 LexicalAnalyzerTest::LexicalAnalyzerTest()
@@ -995,6 +1074,22 @@ void LexicalAnalyzerTest::test_postscript_function()
         pdf::PDFFunctionPtr function = pdf::PDFFunction::createFunction(&document, parser.getObject());
 
         QVERIFY(function);
+
+        const pdf::PDFPostScriptFunction* postScriptFunction = dynamic_cast<const pdf::PDFPostScriptFunction*>(function.get());
+        QVERIFY(postScriptFunction);
+        QVERIFY(postScriptFunction->isCompiled());
+
+        std::vector<double> batchInput;
+        for (double value = -1.0; value <= 3.0; value += 0.01)
+        {
+            batchInput.push_back(value);
+        }
+
+        std::vector<double> batchOutput(batchInput.size(), 0.0);
+        pdf::PDFFunction::FunctionResult batchResult = function->applyBatch(batchInput.data(), batchInput.data() + batchInput.size(), batchOutput.data(), batchOutput.data() + batchOutput.size(), batchInput.size());
+        QVERIFY(batchResult);
+
+        size_t sampleIndex = 0;
         for (double value = -1.0; value <= 3.0; value += 0.01)
         {
             const double clampedValue = qBound(0.0, value, 1.0);
@@ -1019,7 +1114,12 @@ void LexicalAnalyzerTest::test_postscript_function()
                 }
 
                 QVERIFY(isSame);
+
+                // Batch evaluation must give exactly the same result
+                QCOMPARE(batchOutput[sampleIndex], actual);
             }
+
+            ++sampleIndex;
         }
     };
 
@@ -1102,60 +1202,2268 @@ void LexicalAnalyzerTest::test_jbig2_arithmetic_decoder()
     QVERIFY(decompressed == decompressedByAD);
 }
 
-void LexicalAnalyzerTest::scanWholeStream(const char* stream)
+void LexicalAnalyzerTest::test_jbig2_globals_cache()
 {
-    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+    auto appendInt = [](QByteArray& data, uint32_t value)
+    {
+        data.append(char((value >> 24) & 0xFF));
+        data.append(char((value >> 16) & 0xFF));
+        data.append(char((value >> 8) & 0xFF));
+        data.append(char(value & 0xFF));
+    };
 
-    // Scan whole stream
-    while (!analyzer.isAtEnd())
+    auto createSegment = [&](uint32_t number, uint8_t type, uint8_t page, const QByteArray& segmentData)
     {
-        analyzer.fetch();
+        QByteArray segment;
+        appendInt(segment, number);
+        segment.append(char(type));
+        segment.append(char(0)); // No referred segments
+        segment.append(char(page));
+        appendInt(segment, uint32_t(segmentData.size()));
+        segment.append(segmentData);
+        return segment;
+    };
+
+    // Global segments contain pattern dictionary with one 1x1 pattern,
+    // page data contain only page information (8x8 page).
+    QByteArray patternDictionary;
+    patternDictionary.append(char(0));  // Flags (arithmetic coding, template 0)
+    patternDictionary.append(char(1));  // HDPW
+    patternDictionary.append(char(1));  // HDPH
+    appendInt(patternDictionary, 0);    // GRAYMAX
+    patternDictionary.append(QByteArray::fromHex("00000000FFACFFAC"));
+    const QByteArray globalsData = createSegment(0, 16, 0, patternDictionary);
+
+    QByteArray pageInformation;
+    appendInt(pageInformation, 8);      // Width
+    appendInt(pageInformation, 8);      // Height
+    appendInt(pageInformation, 0);      // X resolution
+    appendInt(pageInformation, 0);      // Y resolution
+    pageInformation.append(char(0));    // Flags
+    pageInformation.append(char(0));    // Striping
+    pageInformation.append(char(0));
+    const QByteArray pageData = createSegment(1, 48, 1, pageInformation);
+
+    auto createStream = [](const QByteArray& dictionary, const QByteArray& data)
+    {
+        return "<< " + dictionary + " /Length " + QByteArray::number(data.size()) + " >>\nstream\n" + data + "\nendstream";
+    };
+
+    const QByteArray imageDictionary = "/Type /XObject /Subtype /Image /Width 8 /Height 8 /ColorSpace /DeviceGray /BitsPerComponent 1 /Filter /JBIG2Decode /DecodeParms << /JBIG2Globals 7 0 R >>";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 10 10] /Contents 4 0 R >>");
+    objects.push_back(createStream(QByteArray(), QByteArray()));
+    objects.push_back(createStream(imageDictionary, pageData));
+    objects.push_back(createStream(imageDictionary, pageData));
+    objects.push_back(createStream(QByteArray(), globalsData));
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFJBIG2GlobalsCache cache(pdf::DEFAULT_JBIG2_GLOBALS_CACHE_LIMIT);
+    cache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+
+    pdf::PDFRenderErrorReporterDummy reporter;
+    pdf::PDFColorSpacePointer colorSpace(new pdf::PDFDeviceGrayColorSpace());
+
+    for (pdf::PDFObjectReference imageReference : { pdf::PDFObjectReference(5, 0), pdf::PDFObjectReference(6, 0) })
+    {
+        const pdf::PDFObject& imageObject = document.getObjectByReference(imageReference);
+        QVERIFY(imageObject.isStream());
+
+        pdf::PDFImage image = pdf::PDFImage::createImage(&document, imageObject.getStream(), colorSpace, false, pdf::RenderingIntent::Perceptual, &reporter, &cache);
+        QCOMPARE(image.getImageData().getWidth(), 8u);
+        QCOMPARE(image.getImageData().getHeight(), 8u);
     }
+
+    // Global segments of both images are decoded only once, and they
+    // are then shared (cache contains only one copy of them).
+    pdf::PDFJBIG2GlobalsPointer globals = pdf::PDFJBIG2Decoder::decodeGlobals(globalsData, &reporter);
+    QVERIFY(globals->getSegment(0));
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), globals->getMemoryConsumptionEstimate());
+
+    pdf::PDFJBIG2GlobalsPointer cachedGlobals = cache.getGlobals(&document, pdf::PDFObjectReference(7, 0), &reporter);
+    QCOMPARE(cache.getGlobals(&document, pdf::PDFObjectReference(7, 0), &reporter), cachedGlobals);
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), globals->getMemoryConsumptionEstimate());
 }
 
-void LexicalAnalyzerTest::testTokens(const char* stream, const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens)
+void LexicalAnalyzerTest::test_jbig2_bitmap()
 {
-    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+    QRandomGenerator generator(314159);
 
-    std::vector<pdf::PDFLexicalAnalyzer::Token> scanned;
-    scanned.reserve(tokens.size());
+    auto createRandomBitmap = [&generator](int width, int height)
+    {
+        pdf::PDFJBIG2Bitmap bitmap(width, height, 0x00);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                bitmap.setPixel(x, y, generator.bounded(2));
+            }
+        }
+        return bitmap;
+    };
 
-    // Scan whole stream
-    while (!analyzer.isAtEnd())
+    auto isSame = [](const pdf::PDFJBIG2Bitmap& a, const pdf::PDFJBIG2Bitmap& b)
     {
-        scanned.emplace_back(analyzer.fetch());
+        if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight())
+        {
+            return false;
+        }
+
+        for (int y = 0; y < a.getHeight(); ++y)
+        {
+            for (int x = 0; x < a.getWidth(); ++x)
+            {
+                if (a.getPixel(x, y) != b.getPixel(x, y))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    };
+
+    const std::array operations = { pdf::PDFJBIG2BitOperation::Or, pdf::PDFJBIG2BitOperation::And, pdf::PDFJBIG2BitOperation::Xor,
+                                    pdf::PDFJBIG2BitOperation::NotXor, pdf::PDFJBIG2BitOperation::Replace };
+
+    for (int i = 0; i < 200; ++i)
+    {
+        const int targetWidth = generator.bounded(1, 100);
+        const int targetHeight = generator.bounded(1, 20);
+        const int sourceWidth = generator.bounded(1, 70);
+        const int sourceHeight = generator.bounded(1, 20);
+        const int offsetX = generator.bounded(-40, 100);
+        const int offsetY = generator.bounded(-10, 20);
+        const pdf::PDFJBIG2BitOperation operation = operations[generator.bounded(int(operations.size()))];
+
+        pdf::PDFJBIG2Bitmap target = createRandomBitmap(targetWidth, targetHeight);
+        pdf::PDFJBIG2Bitmap source = createRandomBitmap(sourceWidth, sourceHeight);
+
+        // Reference result is computed pixel by pixel
+        pdf::PDFJBIG2Bitmap expected = target;
+        for (int y = 0; y < sourceHeight; ++y)
+        {
+            for (int x = 0; x < sourceWidth; ++x)
+            {
+                const int targetX = x + offsetX;
+                const int targetY = y + offsetY;
+
+                if (targetX < 0 || targetX >= targetWidth || targetY < 0 || targetY >= targetHeight)
+                {
+                    continue;
+                }
+
+                const uint8_t s = source.getPixel(x, y);
+                const uint8_t t = expected.getPixel(targetX, targetY);
+                uint8_t value = 0;
+
+                switch (operation)
+                {
+                    case pdf::PDFJBIG2BitOperation::Or:
+                        value = t | s;
+                        break;
+                    case pdf::PDFJBIG2BitOperation::And:
+                        value = t & s;
+                        break;
+                    case pdf::PDFJBIG2BitOperation::Xor:
+                        value = t ^ s;
+                        break;
+                    case pdf::PDFJBIG2BitOperation::NotXor:
+                        value = !(t ^ s);
+                        break;
+                    default:
+                        value = s;
+                        break;
+                }
+
+                expected.setPixel(targetX, targetY, value);
+            }
+        }
+
+        target.paint(source, offsetX, offsetY, operation, false, 0x00);
+        QVERIFY(isSame(target, expected));
+
+        // Subbitmap
+        const int subbitmapWidth = generator.bounded(1, 80);
+        const int subbitmapHeight = generator.bounded(1, 20);
+        pdf::PDFJBIG2Bitmap subbitmap = target.getSubbitmap(offsetX, offsetY, subbitmapWidth, subbitmapHeight);
+
+        pdf::PDFJBIG2Bitmap expectedSubbitmap(subbitmapWidth, subbitmapHeight, 0x00);
+        for (int y = 0; y < subbitmapHeight; ++y)
+        {
+            for (int x = 0; x < subbitmapWidth; ++x)
+            {
+                expectedSubbitmap.setPixel(x, y, target.getPixelSafe(x + offsetX, y + offsetY));
+            }
+        }
+
+        QVERIFY(isSame(subbitmap, expectedSubbitmap));
     }
 
-    // Format error message
-    QString actual = getStringFromTokens(scanned);
-    QString expected = getStringFromTokens(tokens);
+    // Filled bitmap must have zero padding, so painting it onto
+    // empty bitmap doesn't modify pixels out of its area.
+    pdf::PDFJBIG2Bitmap filled(5, 3, 0xFF);
+    pdf::PDFJBIG2Bitmap empty(40, 3, 0x00);
+    empty.paint(filled, 0, 0, pdf::PDFJBIG2BitOperation::Or, false, 0x00);
+    QCOMPARE(empty.getPixel(4, 1), uint8_t(1));
+    QCOMPARE(empty.getPixel(5, 1), uint8_t(0));
+    QCOMPARE(empty.getPixel(31, 1), uint8_t(0));
+}
 
-    // Now, compare scanned tokens
-    QVERIFY2(scanned == tokens, qPrintable(QString("stream: %1, actual = %2, expected = %3").arg(QString(stream), actual, expected)));
+void LexicalAnalyzerTest::test_bitonal_conversion()
+{
+    QRandomGenerator generator(271828);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        const int width = generator.bounded(1, 70);
+        const int height = generator.bounded(1, 20);
+        const int threshold = generator.bounded(0, 256);
+
+        QImage image(width, height, QImage::Format_ARGB32);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                image.setPixel(x, y, generator.generate() | 0xFF000000);
+            }
+        }
+
+        pdf::PDFImageConversion imageConversion;
+        imageConversion.setConversionMethod(pdf::PDFImageConversion::ConversionMethod::Manual);
+        imageConversion.setThreshold(threshold);
+        imageConversion.setImage(image);
+        QVERIFY(imageConversion.convert());
+
+        const QImage bitonalImage = imageConversion.getConvertedImage();
+        QCOMPARE(bitonalImage.format(), QImage::Format_Mono);
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const bool isWhite = image.pixelColor(x, y).lightness() >= threshold;
+                QCOMPARE(bitonalImage.pixelIndex(x, y), isWhite ? 1 : 0);
+            }
+        }
+
+        // Converting by bands must give the same result
+        QImage bandedImage(width, height, QImage::Format_Mono);
+        for (int top = 0; top < height; top += 7)
+        {
+            const int bandHeight = qMin(7, height - top);
+            pdf::PDFImageConversion::convertToBitonal(image.copy(0, top, width, bandHeight), threshold, bandedImage, top);
+        }
+
+        for (int y = 0; y < height; ++y)
+        {
+            QVERIFY(std::equal(bitonalImage.constScanLine(y), bitonalImage.constScanLine(y) + (width + 7) / 8, bandedImage.constScanLine(y)));
+        }
+    }
 }
 
-QString LexicalAnalyzerTest::getStringFromTokens(const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens)
+void LexicalAnalyzerTest::test_painter_rectangle_detection()
 {
-    QStringList stringTokens;
+    // Rectangle added by addRect (closed by line to the first corner)
+    QPainterPath rectPath;
+    rectPath.addRect(QRectF(10, 20, 30, 40));
+    std::optional<QRectF> rect = pdf::PDFPainterHelper::getRectangle(rectPath);
+    QVERIFY(rect.has_value());
+    QCOMPARE(*rect, QRectF(10, 20, 30, 40));
+
+    // Rectangle with four corners, starting with vertical edge, in reversed orientation
+    QPainterPath verticalFirstPath;
+    verticalFirstPath.moveTo(50, 60);
+    verticalFirstPath.lineTo(50, 10);
+    verticalFirstPath.lineTo(5, 10);
+    verticalFirstPath.lineTo(5, 60);
+    rect = pdf::PDFPainterHelper::getRectangle(verticalFirstPath);
+    QVERIFY(rect.has_value());
+    QCOMPARE(*rect, QRectF(5, 10, 45, 50));
+
+    // Rotated rectangle is not axis-aligned
+    QPainterPath rotatedPath = QTransform().rotate(30).map(rectPath);
+    QVERIFY(!pdf::PDFPainterHelper::getRectangle(rotatedPath).has_value());
+
+    // Four points, but not a rectangle
+    QPainterPath trapezoidPath;
+    trapezoidPath.moveTo(0, 0);
+    trapezoidPath.lineTo(10, 0);
+    trapezoidPath.lineTo(8, 10);
+    trapezoidPath.lineTo(0, 10);
+    QVERIFY(!pdf::PDFPainterHelper::getRectangle(trapezoidPath).has_value());
+
+    // Curves and multiple subpaths are not rectangles
+    QPainterPath ellipsePath;
+    ellipsePath.addEllipse(QRectF(0, 0, 10, 10));
+    QVERIFY(!pdf::PDFPainterHelper::getRectangle(ellipsePath).has_value());
+
+    QPainterPath twoRectsPath;
+    twoRectsPath.addRect(QRectF(0, 0, 10, 10));
+    twoRectsPath.addRect(QRectF(20, 20, 10, 10));
+    QVERIFY(!pdf::PDFPainterHelper::getRectangle(twoRectsPath).has_value());
+
+    // Closing point differs from the first point
+    QPainterPath openPath;
+    openPath.moveTo(0, 0);
+    openPath.lineTo(10, 0);
+    openPath.lineTo(10, 10);
+    openPath.lineTo(0, 10);
+    openPath.lineTo(0, 5);
+    QVERIFY(!pdf::PDFPainterHelper::getRectangle(openPath).has_value());
+
+    // Empty path
+    QVERIFY(!pdf::PDFPainterHelper::getRectangle(QPainterPath()).has_value());
+}
 
-    QMetaEnum metaEnum = QMetaEnum::fromType<pdf::PDFLexicalAnalyzer::TokenType>();
-    Q_ASSERT(metaEnum.isValid());
+void LexicalAnalyzerTest::test_blend2d_complex_then_rectangle_clip()
+{
+    // Page clips by ellipse at first, then by rectangle covering left half
+    // of the image, and then fills whole image.
+    QPainterPath ellipsePath;
+    ellipsePath.addEllipse(QRectF(0, 0, 100, 100));
 
-    for (const pdf::PDFLexicalAnalyzer::Token& token : tokens)
+    QPainterPath clipRectPath;
+    clipRectPath.addRect(QRectF(0, 0, 50, 100));
+
+    QPainterPath fillPath;
+    fillPath.addRect(QRectF(0, 0, 100, 100));
+
+    pdf::PDFPrecompiledPage page;
+    page.addClip(ellipsePath);
+    page.addClip(clipRectPath);
+    page.addPath(Qt::NoPen, QBrush(Qt::black), fillPath, false);
+
+    QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+    QVERIFY(pdf::PDFBLPageRenderer::draw(image, &page, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor(), false));
+
+    // Inside both ellipse and rectangle
+    QCOMPARE(qAlpha(image.pixel(30, 50)), 255);
+
+    // Inside ellipse, outside of rectangle
+    QCOMPARE(qAlpha(image.pixel(80, 50)), 0);
+
+    // Inside rectangle, outside of ellipse
+    QCOMPARE(qAlpha(image.pixel(2, 2)), 0);
+    QCOMPARE(qAlpha(image.pixel(2, 97)), 0);
+}
+
+void LexicalAnalyzerTest::test_blend2d_cache_memory_consumption()
+{
+    QPainterPath path;
+    path.addEllipse(QRectF(0, 0, 100, 100));
+
+    // Image is in RGB888 format, so it is converted to premultiplied ARGB by the renderer
+    QImage pageImage(64, 64, QImage::Format_RGB888);
+    pageImage.fill(Qt::red);
+
+    pdf::PDFPrecompiledPage page;
+    page.addPath(QPen(Qt::blue), QBrush(Qt::black), path, false);
+    page.addImage(pageImage);
+    page.finalize(0, { });
+
+    const qint64 compiledMemoryConsumption = page.getMemoryConsumptionEstimate();
+
+    QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+    QVERIFY(pdf::PDFBLPageRenderer::draw(image, &page, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor(), false));
+
+    // Native cache is counted, including the converted image
+    const qint64 drawnMemoryConsumption = page.getMemoryConsumptionEstimate();
+    QVERIFY(drawnMemoryConsumption >= compiledMemoryConsumption + 64 * 64 * 4);
+
+    // Cache is not copied with the page
+    pdf::PDFPrecompiledPage pageCopy = page;
+    QCOMPARE(pageCopy.getMemoryConsumptionEstimate(), compiledMemoryConsumption);
+
+    // Drawing again with the same color convertor doesn't change the estimate
+    QVERIFY(pdf::PDFBLPageRenderer::draw(image, &page, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor(), false));
+    QCOMPARE(page.getMemoryConsumptionEstimate(), drawnMemoryConsumption);
+}
+
+void LexicalAnalyzerTest::test_converted_colors_parallel_draw()
+{
+    QLinearGradient gradient(0, 0, 100, 0);
+    gradient.setColorAt(0.0, Qt::red);
+    gradient.setColorAt(1.0, Qt::blue);
+
+    QPainterPath path;
+    path.addRect(QRectF(0, 0, 100, 50));
+
+    QImage pageImage(32, 32, QImage::Format_ARGB32);
+    pageImage.fill(Qt::green);
+
+    pdf::PDFPrecompiledPage page;
+    page.addPath(Qt::NoPen, QBrush(gradient), path, false);
+    page.addSetWorldMatrix(QTransform(100, 0, 0, 50, 0, 50));
+    page.addImage(pageImage);
+    page.finalize(0, { });
+
+    const qint64 compiledMemoryConsumption = page.getMemoryConsumptionEstimate();
+
+    pdf::PDFColorConvertor colorConvertor;
+    colorConvertor.setMode(pdf::PDFColorConvertor::Mode::InvertedColors);
+
+    auto drawPage = [&page](const pdf::PDFColorConvertor& convertor)
     {
-        QString tokenTypeAsString = metaEnum.valueToKey(static_cast<int>(token.type));
+        QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        page.draw(&painter, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, convertor);
+        painter.end();
+        return image;
+    };
 
-        if (!token.data.isValid())
+    const QImage referenceImage = drawPage(colorConvertor);
+    const qint64 drawnMemoryConsumption = page.getMemoryConsumptionEstimate();
+
+    // Converted image and gradient are counted
+    QVERIFY(drawnMemoryConsumption >= compiledMemoryConsumption + 32 * 32 * 4);
+
+    // Drawing from more threads at once gives the same result, cache is reused
+    std::vector<QImage> images(16);
+    std::vector<size_t> indices(images.size(), 0);
+    std::iota(indices.begin(), indices.end(), 0);
+    pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Page, indices.begin(), indices.end(), [&](size_t index)
+    {
+        images[index] = drawPage(colorConvertor);
+    });
+
+    for (const QImage& image : images)
+    {
+        QCOMPARE(image, referenceImage);
+    }
+    QCOMPARE(page.getMemoryConsumptionEstimate(), drawnMemoryConsumption);
+
+    // Cache is cleared, when color convertor is changed
+    QImage normalImage = drawPage(pdf::PDFColorConvertor());
+    QCOMPARE(qRed(normalImage.pixel(50, 75)), 0);
+    QCOMPARE(qGreen(normalImage.pixel(50, 75)), 255);
+    QCOMPARE(qGreen(referenceImage.pixel(50, 75)), 0);
+
+    pdf::PDFColorConvertor grayscaleConvertor;
+    grayscaleConvertor.setMode(pdf::PDFColorConvertor::Mode::Grayscale);
+    drawPage(grayscaleConvertor);
+    QCOMPARE(page.getMemoryConsumptionEstimate(), drawnMemoryConsumption);
+}
+
+void LexicalAnalyzerTest::test_separable_blend_accuracy()
+{
+    // Separable blend modes without overprint are blended by row-wise fast path,
+    // unless target has active color mask. Both paths must give the same result
+    // within tolerance given by float rounding.
+    constexpr size_t width = 37;
+    constexpr size_t height = 5;
+    constexpr pdf::PDFColorComponent tolerance = 1.0e-5f;
+
+    std::mt19937 generator(0x1234);
+    std::uniform_real_distribution<pdf::PDFColorComponent> colorDistribution(0.0f, 1.0f);
+    std::uniform_real_distribution<pdf::PDFColorComponent> alphaDistribution(0.1f, 1.0f);
+
+    auto createBitmap = [&](pdf::PDFPixelFormat format)
+    {
+        pdf::PDFFloatBitmap bitmap(width, height, format);
+        for (size_t y = 0; y < height; ++y)
         {
-            stringTokens << tokenTypeAsString;
+            for (size_t x = 0; x < width; ++x)
+            {
+                pdf::PDFColorBuffer pixel = bitmap.getPixel(x, y);
+                for (uint8_t i = format.getColorChannelIndexStart(); i < format.getColorChannelIndexEnd(); ++i)
+                {
+                    pixel[i] = colorDistribution(generator);
+                }
+                pixel[format.getShapeChannelIndex()] = alphaDistribution(generator);
+                pixel[format.getOpacityChannelIndex()] = alphaDistribution(generator);
+            }
+        }
+        return bitmap;
+    };
+
+    auto withActiveColorMask = [](const pdf::PDFFloatBitmap& bitmap, pdf::PDFPixelFormat format)
+    {
+        pdf::PDFFloatBitmap result(bitmap.getWidth(), bitmap.getHeight(), format);
+        std::copy(bitmap.begin(), bitmap.end(), result.begin());
+        result.setAllColorActive();
+        return result;
+    };
+
+    const std::vector<std::pair<pdf::PDFPixelFormat, pdf::PDFPixelFormat>> formats = {
+        { pdf::PDFPixelFormat::createFormat(3, 0, true, false, false), pdf::PDFPixelFormat::createFormat(3, 0, true, false, true) },
+        { pdf::PDFPixelFormat::createFormat(4, 2, true, true, false), pdf::PDFPixelFormat::createFormat(4, 2, true, true, true) }
+    };
+
+    const std::vector<pdf::BlendMode> modes = { pdf::BlendMode::Normal, pdf::BlendMode::Multiply, pdf::BlendMode::Screen, pdf::BlendMode::Overlay,
+                                                pdf::BlendMode::Darken, pdf::BlendMode::Lighten, pdf::BlendMode::ColorDodge, pdf::BlendMode::ColorBurn,
+                                                pdf::BlendMode::HardLight, pdf::BlendMode::SoftLight, pdf::BlendMode::Difference, pdf::BlendMode::Exclusion };
+
+    pdf::PDFFloatBitmap softMask(width, height, pdf::PDFPixelFormat::createOpacityMask());
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            softMask.getPixel(x, y)[0] = alphaDistribution(generator);
+        }
+    }
+
+    const QRect blendRegion(1, 1, int(width) - 2, int(height) - 2);
+
+    for (const auto& formatPair : formats)
+    {
+        for (pdf::BlendMode mode : modes)
+        {
+            for (int variant = 0; variant < 4; ++variant)
+            {
+                const bool knockoutGroup = variant & 1;
+                const bool alphaIsShape = variant & 2;
+
+                pdf::PDFFloatBitmap source = createBitmap(formatPair.first);
+                pdf::PDFFloatBitmap backdrop = createBitmap(formatPair.first);
+                pdf::PDFFloatBitmap initialBackdrop = createBitmap(formatPair.first);
+                pdf::PDFFloatBitmap fastTarget = createBitmap(formatPair.first);
+
+                pdf::PDFFloatBitmap generalSource = withActiveColorMask(source, formatPair.second);
+                pdf::PDFFloatBitmap generalBackdrop = withActiveColorMask(backdrop, formatPair.second);
+                pdf::PDFFloatBitmap generalInitialBackdrop = withActiveColorMask(initialBackdrop, formatPair.second);
+                pdf::PDFFloatBitmap generalTarget = withActiveColorMask(fastTarget, formatPair.second);
+
+                pdf::PDFFloatBitmap::blend(source, fastTarget, backdrop, initialBackdrop, softMask, alphaIsShape, 0.7f, mode, knockoutGroup, pdf::PDFFloatBitmap::OverprintMode::NoOveprint, blendRegion);
+                pdf::PDFFloatBitmap::blend(generalSource, generalTarget, generalBackdrop, generalInitialBackdrop, softMask, alphaIsShape, 0.7f, mode, knockoutGroup, pdf::PDFFloatBitmap::OverprintMode::NoOveprint, blendRegion);
+
+                const pdf::PDFColorComponent* fastIt = fastTarget.begin();
+                const pdf::PDFColorComponent* generalIt = generalTarget.begin();
+                for (; fastIt != fastTarget.end(); ++fastIt, ++generalIt)
+                {
+                    QVERIFY(qAbs(*fastIt - *generalIt) <= tolerance);
+                }
+            }
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_path_sampler_parity()
+{
+    // Scanline rasterizer must give the same coverage as the precise
+    // sampler, which uses regular grid of samples, up to the sampling error.
+    constexpr int samplesCount = 16;
+    constexpr pdf::PDFColorComponent maximalTolerance = 0.25f;
+    constexpr pdf::PDFColorComponent averageTolerance = 0.01f;
+
+    std::vector<QPainterPath> paths;
+
+    QPainterPath ellipsePath;
+    ellipsePath.addEllipse(QPointF(30.3, 20.7), 24.1, 15.6);
+    paths.push_back(ellipsePath);
+
+    QPainterPath starPath;
+    starPath.setFillRule(Qt::OddEvenFill);
+    for (int i = 0; i < 5; ++i)
+    {
+        const qreal angle = qDegreesToRadians(90.0 + i * 144.0);
+        const QPointF point(32.5 + 28.0 * qCos(angle), 30.5 - 28.0 * qSin(angle));
+        if (i == 0)
+        {
+            starPath.moveTo(point);
         }
         else
         {
-            stringTokens << QString("%1(%2)").arg(tokenTypeAsString, token.data.toString());
+            starPath.lineTo(point);
         }
     }
+    starPath.closeSubpath();
+    paths.push_back(starPath);
 
-    return QString("{ %1 }").arg(stringTokens.join(", "));
+    QPainterPath rectanglePath;
+    rectanglePath.addRect(QRectF(5.25, 7.5, 30.6, 12.3));
+    paths.push_back(QTransform().rotate(17.0).map(rectanglePath));
+
+    for (const QPainterPath& path : paths)
+    {
+        const QRect fillRect = path.controlPointRect().toAlignedRect().adjusted(-2, -2, 2, 2);
+        pdf::PDFPainterPathSampler scanlineSampler(path, samplesCount, 0.0f, fillRect, false);
+        pdf::PDFPainterPathSampler preciseSampler(path, samplesCount, 0.0f, fillRect, true);
+
+        pdf::PDFPainterPathSampler::RowCoverage coverage;
+        pdf::PDFColorComponent maximalDifference = 0.0f;
+        pdf::PDFColorComponent totalDifference = 0.0f;
+
+        for (int y = fillRect.top(); y <= fillRect.bottom(); ++y)
+        {
+            scanlineSampler.computeRowCoverage(y, coverage);
+
+            for (int x = fillRect.left(); x <= fillRect.right(); ++x)
+            {
+                const pdf::PDFColorComponent value = coverage.value(x);
+                QCOMPARE(scanlineSampler.sample(QPoint(x, y)), value);
+
+                const pdf::PDFColorComponent difference = qAbs(value - preciseSampler.sample(QPoint(x, y)));
+                maximalDifference = qMax(maximalDifference, difference);
+                totalDifference += difference;
+            }
+        }
+
+        const pdf::PDFColorComponent averageDifference = totalDifference / pdf::PDFColorComponent(fillRect.width() * fillRect.height());
+        QVERIFY2(maximalDifference <= maximalTolerance, qPrintable(QString("Maximal difference %1").arg(maximalDifference)));
+        QVERIFY2(averageDifference <= averageTolerance, qPrintable(QString("Average difference %1").arg(averageDifference)));
+    }
+}
+
+void LexicalAnalyzerTest::test_ccitt_fax_decoder()
+{
+    // Creates stream from bits written as characters, spaces are ignored
+    auto createStream = [](const char* bits)
+    {
+        QByteArray stream;
+        int bitCount = 0;
+        for (const char* bit = bits; *bit; ++bit)
+        {
+            if (*bit == ' ')
+            {
+                continue;
+            }
+
+            if (bitCount % 8 == 0)
+            {
+                stream.append(char(0));
+            }
+
+            if (*bit == '1')
+            {
+                stream.back() = char(uint8_t(stream.back()) | (0x80 >> (bitCount % 8)));
+            }
+            ++bitCount;
+        }
+        return stream;
+    };
+
+    auto decode = [](const QByteArray& stream, pdf::PDFCCITTFaxDecoderParameters parameters)
+    {
+        parameters.decode = { 0.0, 1.0 };
+        pdf::PDFCCITTFaxDecoder decoder(&stream, parameters);
+        return decoder.decode();
+    };
+
+    // Group 3 streams with known codes. Decoder writes packed rows, white pixels
+    // as ones, padding bits of the last byte of the row are zero.
+    {
+        // Pure 1D encoding, rows W3 B2 W15 and W0 B20
+        pdf::PDFCCITTFaxDecoderParameters parameters;
+        parameters.K = 0;
+        parameters.columns = 20;
+        parameters.rows = 2;
+        parameters.hasEndOfBlock = false;
+
+        pdf::PDFImageData imageData = decode(createStream("1000 11 110101 00110101 00001101000"), parameters);
+        QCOMPARE(imageData.getHeight(), 2u);
+        QCOMPARE(imageData.getData(), QByteArray::fromHex("E7FFF0000000"));
+    }
+
+    {
+        // End of line before each row, terminated by the return to control
+        pdf::PDFCCITTFaxDecoderParameters parameters;
+        parameters.K = 0;
+        parameters.columns = 20;
+        parameters.hasEndOfLine = true;
+        parameters.hasEndOfBlock = true;
+
+        pdf::PDFImageData imageData = decode(createStream("000000000001 1000 11 110101 000000000001 00110101 00001101000 000000000001 000000000001"), parameters);
+        QCOMPARE(imageData.getHeight(), 2u);
+        QCOMPARE(imageData.getData(), QByteArray::fromHex("E7FFF0000000"));
+    }
+
+    {
+        // Mixed encoding with byte aligned rows, second row W3 B3 W14
+        // is encoded by modes V0, VR1, V0 against the first row.
+        pdf::PDFCCITTFaxDecoderParameters parameters;
+        parameters.K = 2;
+        parameters.columns = 20;
+        parameters.rows = 2;
+        parameters.hasEncodedByteAlign = true;
+        parameters.hasEndOfBlock = false;
+        parameters.hasBlackIsOne = true;
+
+        pdf::PDFImageData imageData = decode(createStream("1 1000 11 110101 000 0 1 011 1"), parameters);
+        QCOMPARE(imageData.getHeight(), 2u);
+        QCOMPARE(imageData.getData(), QByteArray::fromHex("E7FFF0E3FFF0"));
+        QCOMPARE(imageData.getDecode(), std::vector<pdf::PDFReal>({ 1.0, 0.0 }));
+    }
+
+    {
+        // Make-up codes, runs W130 B70 span whole bytes
+        pdf::PDFCCITTFaxDecoderParameters parameters;
+        parameters.K = 0;
+        parameters.columns = 200;
+        parameters.rows = 1;
+        parameters.hasEndOfBlock = false;
+
+        pdf::PDFImageData imageData = decode(createStream("10010 0111 0000001111 0010"), parameters);
+        QCOMPARE(imageData.getHeight(), 1u);
+        QCOMPARE(imageData.getData(), QByteArray(16, char(0xFF)) + QByteArray::fromHex("C0") + QByteArray(8, char(0)));
+    }
+
+    // Group 4 streams created by the encoder. Widths are not multiples
+    // of 8, so the last byte of each row is padded.
+    for (const QSize& size : { QSize(1, 1), QSize(13, 7), QSize(37, 29), QSize(203, 64) })
+    {
+        const int width = size.width();
+        const int height = size.height();
+        const int bytesPerLine = (width + 7) / 8;
+
+        // Bit value 1 means black pixel. Rows alternate between random pixels,
+        // runs of various lengths, white and black rows, so all coding modes are used.
+        std::mt19937 generator(width);
+        QByteArray data(bytesPerLine * height, 0);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                bool isBlack = false;
+                switch (y % 4)
+                {
+                    case 0:
+                        isBlack = generator() % 2;
+                        break;
+
+                    case 1:
+                        isBlack = (x / (y % 7 + 1)) % 2;
+                        break;
+
+                    case 2:
+                        isBlack = x > width / 3 && x < width / 3 + y;
+                        break;
+
+                    default:
+                        isBlack = x != y;
+                        break;
+                }
+
+                if (isBlack)
+                {
+                    data[y * bytesPerLine + x / 8] = data[y * bytesPerLine + x / 8] | char(0x80 >> (x % 8));
+                }
+            }
+        }
+
+        QByteArray encoded = pdf::PDFCCITTFaxEncoder::encodeGroup4(reinterpret_cast<const uint8_t*>(data.constData()), width, height, bytesPerLine);
+
+        pdf::PDFCCITTFaxDecoderParameters parameters;
+        parameters.K = -1;
+        parameters.columns = width;
+        parameters.rows = height;
+        parameters.hasEndOfBlock = true;
+        parameters.decode = { 0.0, 1.0 };
+
+        pdf::PDFCCITTFaxDecoder decoder(&encoded, parameters);
+        pdf::PDFImageData imageData = decoder.decode();
+
+        QCOMPARE(imageData.getWidth(), uint(width));
+        QCOMPARE(imageData.getHeight(), uint(height));
+
+        // Decoder writes white pixels as ones
+        const QByteArray& decoded = imageData.getData();
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const uint8_t mask = 0x80 >> (x % 8);
+                const bool isBlack = uint8_t(data[y * bytesPerLine + x / 8]) & mask;
+                const bool isDecodedBlack = !(uint8_t(decoded[y * imageData.getStride() + x / 8]) & mask);
+                QCOMPARE(isDecodedBlack, isBlack);
+            }
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_lzw_encoder_round_trip()
+{
+    std::mt19937 generator(0x4C5A57);
+
+    std::vector<QByteArray> inputs;
+    inputs.push_back(QByteArray());
+    inputs.push_back(QByteArray("A"));
+    inputs.push_back(QByteArray("-----A---B"));
+
+    // Random data overflow the code table, so clear codes are used
+    QByteArray randomData(70000, 0);
+    std::generate(randomData.begin(), randomData.end(), [&generator]() { return char(generator() % 256); });
+    inputs.push_back(randomData);
+
+    // Data with small alphabet produce long strings in the code table
+    QByteArray smallAlphabetData(300000, 0);
+    std::generate(smallAlphabetData.begin(), smallAlphabetData.end(), [&generator]() { return char(generator() % 4); });
+    inputs.push_back(smallAlphabetData);
+
+    QByteArray runData(50000, 0);
+    for (int i = 0; i < runData.size(); ++i)
+    {
+        runData[i] = char((i / 7) % 256);
+    }
+    inputs.push_back(runData);
+
+    for (const QByteArray& input : inputs)
+    {
+        QByteArray encoded = pdf::PDFImageEncoder::encodeLZW(reinterpret_cast<const uint8_t*>(input.constData()), input.size());
+
+        pdf::PDFLzwDecodeFilter filter;
+        QByteArray decoded = filter.apply(encoded, [](const pdf::PDFObject& object) -> const pdf::PDFObject& { return object; }, pdf::PDFObject(), nullptr);
+        QCOMPARE(decoded, input);
+    }
+}
+
+void LexicalAnalyzerTest::test_png_encoder_round_trip()
+{
+    for (const QImage& image : createEncoderTestImages())
+    {
+        for (int compression : { 0, 50, 100 })
+        {
+            QByteArray encoded = pdf::PDFImageEncoder::encodePNG(image, compression, 0.0f);
+            QImage decoded = readImage(encoded, "png");
+            QVERIFY2(isSameImage(image, decoded), qPrintable(QString("PNG, format %1, width %2, compression %3").arg(image.format()).arg(image.width()).arg(compression)));
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_tiff_encoder_round_trip()
+{
+    if (!QImageReader::supportedImageFormats().contains("tiff"))
+    {
+        QSKIP("TIFF image format plugin is not available.");
+    }
+
+    for (const QImage& image : createEncoderTestImages())
+    {
+        for (pdf::PDFImageEncoder::TIFFCompression compression : { pdf::PDFImageEncoder::TIFFCompression::None,
+                                                                   pdf::PDFImageEncoder::TIFFCompression::LZW,
+                                                                   pdf::PDFImageEncoder::TIFFCompression::Deflate })
+        {
+            QByteArray encoded = pdf::PDFImageEncoder::encodeTIFF(image, compression);
+            QImage decoded = readImage(encoded, "tiff");
+            QVERIFY2(isSameImage(image, decoded), qPrintable(QString("TIFF, format %1, width %2, compression %3").arg(image.format()).arg(image.width()).arg(int(compression))));
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_tiling_pattern_cell_cache()
+{
+    pdf::PDFFontCache fontCache(8, 8);
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    const pdf::PDFRenderer::Features features = pdf::PDFRenderer::getDefaultFeatures();
+
+    auto compile = [&](const pdf::PDFDocument& document, pdf::PDFTilingPatternCache& cache, const pdf::PDFOptionalContentActivity* optionalContentActivity, QTransform pagePointToDevicePointMatrix)
+    {
+        fontCache.setDocument(pdf::PDFModifiedDocument(const_cast<pdf::PDFDocument*>(&document), nullptr));
+        cache.setDocument(pdf::PDFModifiedDocument(const_cast<pdf::PDFDocument*>(&document), nullptr));
+
+        pdf::PDFPrecompiledPage page;
+        pdf::PDFPrecompiledPageGenerator generator(&page, features, document.getCatalog()->getPage(0), &document, &fontCache, &cms, optionalContentActivity, meshQualitySettings, pagePointToDevicePointMatrix);
+        generator.setTilingPatternCache(&cache);
+        page.finalize(0, generator.processContents());
+        return page;
+    };
+
+    {
+        // Cell 10 x 10 points is rasterized with 4 pixels per point in the page space.
+        // Page compiled in the device space zoomed 4 times uses 1 pixel per device
+        // space unit, so the same cell image is used.
+        pdf::PDFDocument document = createTilingPatternDocument(10, "1 0 0 rg 0 0 5 5 re f", "<< >>");
+        pdf::PDFTilingPatternCache cache(64 * 1024 * 1024);
+
+        pdf::PDFPrecompiledPage page = compile(document, cache, nullptr, QTransform());
+        QVERIFY(page.getErrors().isEmpty());
+        QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(40 * 40 * 4));
+
+        compile(document, cache, nullptr, QTransform::fromScale(4.0, 4.0));
+        QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(40 * 40 * 4));
+    }
+
+    {
+        // Small cell is rasterized with higher resolution
+        pdf::PDFDocument document = createTilingPatternDocument(2, "0 0 1 1 re f", "<< >>");
+        pdf::PDFTilingPatternCache cache(64 * 1024 * 1024);
+        compile(document, cache, nullptr, QTransform());
+        QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(32 * 32 * 4));
+    }
+
+    {
+        // Large cell is painted as vector graphics
+        pdf::PDFDocument document = createTilingPatternDocument(1000, "0 0 500 500 re f", "<< >>");
+        pdf::PDFTilingPatternCache cache(64 * 1024 * 1024);
+        compile(document, cache, nullptr, QTransform());
+        QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(0));
+    }
+
+    {
+        // Errors of the cell content are reported to the page, also when cell is cached
+        pdf::PDFDocument document = createTilingPatternDocument(10, "/Im1 Do 0 0 5 5 re f", "<< >>");
+        pdf::PDFTilingPatternCache cache(64 * 1024 * 1024);
+
+        pdf::PDFPrecompiledPage page = compile(document, cache, nullptr, QTransform());
+        QVERIFY(cache.getMemoryConsumptionEstimate() > 0);
+        QVERIFY(!page.getErrors().isEmpty());
+
+        pdf::PDFPrecompiledPage cachedPage = compile(document, cache, nullptr, QTransform());
+        QCOMPARE(cachedPage.getErrors().size(), page.getErrors().size());
+    }
+
+    {
+        // Cell with optional content is painted as vector graphics, when optional
+        // content is evaluated at the time the page is drawn.
+        pdf::PDFDocument document = createTilingPatternDocument(10, "/OC /MC0 BDC 0 0 5 5 re f EMC", "<< /Properties << /MC0 7 0 R >> >>");
+        pdf::PDFOptionalContentActivity optionalContentActivity(&document, pdf::OCUsage::View, nullptr);
+        pdf::PDFTilingPatternCache cache(64 * 1024 * 1024);
+
+        compile(document, cache, &optionalContentActivity, QTransform());
+        pdf::PDFPrecompiledPage page = compile(document, cache, &optionalContentActivity, QTransform());
+        QVERIFY(page.getErrors().isEmpty());
+
+        // Cell image is created only once, but it is not used
+        QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(40 * 40 * 4));
+        QImage image(200, 200, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        page.draw(&painter, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor());
+        painter.end();
+        QCOMPARE(qGray(image.pixel(2, 2)), 0);
+
+        // When optional content group is switched off, then cell content is not drawn
+        optionalContentActivity.setState(pdf::PDFObjectReference(7, 0), pdf::OCState::OFF);
+        image.fill(Qt::white);
+        painter.begin(&image);
+        page.draw(&painter, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor());
+        painter.end();
+        QCOMPARE(qGray(image.pixel(2, 2)), 255);
+
+        // Cell image is cached for each state of the optional content
+        compile(document, cache, &optionalContentActivity, QTransform());
+        QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(2 * 40 * 40 * 4));
+    }
+}
+
+void LexicalAnalyzerTest::test_shading_native_gradient()
+{
+    // Shadings use quadratic function, so gradient must have more stops, than
+    // start and end color. Shadings (object number in the comment):
+    //  6 - axial shading, painted on the page
+    //  7 - radial shading with concentric circles
+    //  8 - radial shading with disjoint circles, which must be meshed
+    const QByteArray function = "<< /FunctionType 2 /Domain [0 1] /C0 [0] /C1 [1] /N 2 >>";
+    const QByteArray content = "/Pattern cs /P0 scn 0 0 100 10 re f";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 100 10] /Contents 4 0 R /Resources << /Pattern << /P0 5 0 R >> >> >>");
+    objects.push_back("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    objects.push_back("<< /Type /Pattern /PatternType 2 /Shading 6 0 R >>");
+    objects.push_back("<< /ShadingType 2 /ColorSpace /DeviceGray /Coords [0 0 100 0] /Extend [true true] /Function " + function + " >>");
+    objects.push_back("<< /ShadingType 3 /ColorSpace /DeviceGray /Coords [50 5 0 50 5 40] /Extend [true true] /Function " + function + " >>");
+    objects.push_back("<< /ShadingType 3 /ColorSpace /DeviceGray /Coords [20 5 5 80 5 5] /Function " + function + " >>");
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFRenderErrorReporterDummy reporter;
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    meshQualitySettings.deviceSpaceMeshingArea = QRectF(0, 0, 100, 10);
+    meshQualitySettings.minimalMeshResolution = 0.5;
+    meshQualitySettings.preferredMeshResolution = 2.0;
+
+    auto createGradient = [&](pdf::PDFObjectReference reference, const QTransform& userSpaceToDeviceSpaceMatrix)
+    {
+        pdf::PDFPatternPtr pattern = pdf::PDFPattern::createShadingPattern(nullptr, &document, document.getObjectByReference(reference), QTransform(), pdf::PDFObject(), &cms, pdf::RenderingIntent::Perceptual, &reporter, false);
+        pdf::PDFMeshQualitySettings settings = meshQualitySettings;
+        settings.userSpaceToDeviceSpaceMatrix = userSpaceToDeviceSpaceMatrix;
+        return pattern->getShadingPattern()->createGradient(settings, &cms, pdf::RenderingIntent::Perceptual, &reporter);
+    };
+
+    // Colors of the stops are within the tolerance (and rounding to 8-bit color)
+    auto verifyStops = [&](const pdf::PDFShadingGradient& gradient)
+    {
+        const QGradientStops stops = gradient.getGradient().stops();
+        QVERIFY(stops.size() > 2);
+
+        for (const QGradientStop& stop : stops)
+        {
+            const pdf::PDFReal expectedValue = stop.first * stop.first;
+            QVERIFY(qAbs(stop.second.redF() - expectedValue) <= meshQualitySettings.tolerance + 1.0 / 255.0);
+        }
+    };
+
+    pdf::PDFShadingGradient axialGradient = createGradient(pdf::PDFObjectReference(6, 0), QTransform());
+    QVERIFY(axialGradient.isValid());
+    QCOMPARE(axialGradient.getGradient().type(), QGradient::LinearGradient);
+    verifyStops(axialGradient);
+
+    pdf::PDFShadingGradient radialGradient = createGradient(pdf::PDFObjectReference(7, 0), QTransform());
+    QVERIFY(radialGradient.isValid());
+    QCOMPARE(radialGradient.getGradient().type(), QGradient::RadialGradient);
+    verifyStops(radialGradient);
+
+    // Circles mapped onto ellipses and disjoint circles can't be represented by the gradient
+    QVERIFY(!createGradient(pdf::PDFObjectReference(7, 0), QTransform::fromScale(2.0, 1.0)).isValid());
+    QVERIFY(!createGradient(pdf::PDFObjectReference(8, 0), QTransform()).isValid());
+
+    // Page filled by the axial shading
+    pdf::PDFFontCache fontCache(8, 8);
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+
+    pdf::PDFPrecompiledPage page;
+    pdf::PDFPrecompiledPageGenerator generator(&page, pdf::PDFRenderer::getDefaultFeatures(), document.getCatalog()->getPage(0), &document, &fontCache, &cms, nullptr, pdf::PDFMeshQualitySettings(), QTransform());
+    page.finalize(0, generator.processContents());
+    QVERIFY(page.getErrors().isEmpty());
+
+    QImage image(100, 10, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::blue);
+    QPainter painter(&image);
+    page.draw(&painter, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor());
+    painter.end();
+
+    for (int x : { 0, 25, 50, 75, 99 })
+    {
+        const pdf::PDFReal s = (x + 0.5) / 100.0;
+        const int expectedGray = qRound(s * s * 255.0);
+        const QRgb pixel = image.pixel(x, 5);
+        QVERIFY2(qAbs(qRed(pixel) - expectedGray) <= 5 && qRed(pixel) == qBlue(pixel), qPrintable(QString("x = %1, gray = %2, expected gray = %3").arg(x).arg(qRed(pixel)).arg(expectedGray)));
+    }
+}
+
+void LexicalAnalyzerTest::test_shading_mesh_cache()
+{
+    // Free form triangle shading (object 4) with two triangles, covering the
+    // square [0, 0, 100, 100], color is gray ramp in the x direction.
+    const QByteArray data = "00000000 00FF00FF 0000FF00 00FF00FF 00FFFF00 0000FF00>";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 100 100] >>");
+    objects.push_back("<< /ShadingType 4 /ColorSpace /DeviceGray /BitsPerCoordinate 8 /BitsPerComponent 8 /BitsPerFlag 8 "
+                      "/Decode [0 100 0 100 0 1] /Filter /ASCIIHexDecode /Length " + QByteArray::number(data.size()) + " >>\nstream\n" + data + "\nendstream");
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFRenderErrorReporterDummy reporter;
+    const pdf::RenderingIntent intent = pdf::RenderingIntent::Perceptual;
+
+    // Only shadings referenced from the document can be cached
+    const pdf::PDFObject shadingReference = pdf::PDFObject::createReference(pdf::PDFObjectReference(4, 0));
+    pdf::PDFPatternPtr pattern = pdf::PDFPattern::createShadingPattern(nullptr, &document, shadingReference, QTransform(), pdf::PDFObject(), &cms, intent, &reporter, false);
+    pdf::PDFPatternPtr directPattern = pdf::PDFPattern::createShadingPattern(nullptr, &document, document.getObject(shadingReference), QTransform(), pdf::PDFObject(), &cms, intent, &reporter, false);
+    const pdf::PDFShadingPattern* shadingPattern = pattern->getShadingPattern();
+    const pdf::PDFShadingPattern* directShadingPattern = directPattern->getShadingPattern();
+
+    auto createSettings = [](const QTransform& userSpaceToDeviceSpaceMatrix, pdf::PDFReal resolution)
+    {
+        pdf::PDFMeshQualitySettings settings;
+        settings.userSpaceToDeviceSpaceMatrix = userSpaceToDeviceSpaceMatrix;
+        settings.deviceSpaceMeshingArea = userSpaceToDeviceSpaceMatrix.mapRect(QRectF(0, 0, 100, 100));
+        settings.minimalMeshResolution = resolution;
+        settings.preferredMeshResolution = resolution * 2.0;
+        return settings;
+    };
+
+    // Vertices of the cached meshes are quantized to 16-bit integers
+    auto isSameMesh = [](const pdf::PDFMesh& mesh, const pdf::PDFMesh& expectedMesh, const QTransform& transform)
+    {
+        const std::vector<QPointF>& vertices = mesh.getVertices();
+        const std::vector<QPointF>& expectedVertices = expectedMesh.getVertices();
+        if (vertices.empty() || vertices.size() != expectedVertices.size() || mesh.getTriangles().size() != expectedMesh.getTriangles().size())
+        {
+            return false;
+        }
+
+        const pdf::PDFReal tolerance = 2.0 * 100.0 * qSqrt(qAbs(transform.determinant())) / 65535.0;
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            const QPointF difference = vertices[i] - transform.map(expectedVertices[i]);
+            if (qAbs(difference.x()) > tolerance || qAbs(difference.y()) > tolerance)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    pdf::PDFMeshCache cache(64 * 1024 * 1024);
+
+    // First mesh is created and stored in the cache
+    const pdf::PDFMeshQualitySettings settings = createSettings(QTransform(), 2.0);
+    const pdf::PDFMesh expectedMesh = shadingPattern->createMesh(settings, &cms, intent, &reporter, nullptr);
+    const pdf::PDFMesh mesh = cache.getMesh(shadingPattern, settings, &cms, intent, &reporter, nullptr);
+    const qint64 memoryConsumption = cache.getMemoryConsumptionEstimate();
+    QVERIFY(memoryConsumption > 0);
+    QVERIFY(isSameMesh(mesh, expectedMesh, QTransform()));
+
+    // Same settings, cached mesh is used
+    QVERIFY(isSameMesh(cache.getMesh(shadingPattern, settings, &cms, intent, &reporter, nullptr), expectedMesh, QTransform()));
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), memoryConsumption);
+
+    // Zoomed and rotated page with resolution scaled by the zoom, cached mesh is transformed
+    QTransform zoomMatrix;
+    zoomMatrix.translate(50, 20);
+    zoomMatrix.rotate(30);
+    zoomMatrix.scale(1.5, 1.5);
+    QVERIFY(isSameMesh(cache.getMesh(shadingPattern, createSettings(zoomMatrix, 3.0), &cms, intent, &reporter, nullptr), expectedMesh, zoomMatrix));
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), memoryConsumption);
+
+    // Shading, which is not referenced, is not cached
+    QVERIFY(isSameMesh(cache.getMesh(directShadingPattern, settings, &cms, intent, &reporter, nullptr), expectedMesh, QTransform()));
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), memoryConsumption);
+
+    // Different rendering intent or tolerance can't use cached mesh
+    pdf::PDFMeshQualitySettings toleranceSettings = settings;
+    toleranceSettings.tolerance = 0.05;
+    cache.getMesh(shadingPattern, settings, &cms, pdf::RenderingIntent::Saturation, &reporter, nullptr);
+    const qint64 intentMemoryConsumption = cache.getMemoryConsumptionEstimate();
+    QVERIFY(intentMemoryConsumption > memoryConsumption);
+    cache.getMesh(shadingPattern, toleranceSettings, &cms, intent, &reporter, nullptr);
+    QVERIFY(cache.getMemoryConsumptionEstimate() > intentMemoryConsumption);
+    cache.clear();
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(0));
+
+    // Zoom without scaled resolution - new mesh replaces the mesh of the same matrix class
+    cache.getMesh(shadingPattern, settings, &cms, intent, &reporter, nullptr);
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), memoryConsumption);
+    const pdf::PDFMeshQualitySettings zoomedSettings = createSettings(QTransform::fromScale(10.0, 10.0), 2.0);
+    const pdf::PDFMesh zoomedMesh = cache.getMesh(shadingPattern, zoomedSettings, &cms, intent, &reporter, nullptr);
+    const pdf::PDFMesh expectedZoomedMesh = shadingPattern->createMesh(zoomedSettings, &cms, intent, &reporter, nullptr);
+    QVERIFY(isSameMesh(zoomedMesh, expectedZoomedMesh, QTransform()));
+    QVERIFY(zoomedMesh.getTriangles().size() > mesh.getTriangles().size());
+    const qint64 zoomedMemoryConsumption = cache.getMemoryConsumptionEstimate();
+    QVERIFY(zoomedMemoryConsumption > memoryConsumption);
+    QVERIFY(isSameMesh(cache.getMesh(shadingPattern, zoomedSettings, &cms, intent, &reporter, nullptr), expectedZoomedMesh, QTransform()));
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), zoomedMemoryConsumption);
+
+    // Non-uniform scale is another matrix class, mesh is added to the cache
+    const pdf::PDFMeshQualitySettings stretchedSettings = createSettings(QTransform::fromScale(2.0, 1.0), 2.0);
+    QVERIFY(isSameMesh(cache.getMesh(shadingPattern, stretchedSettings, &cms, intent, &reporter, nullptr), shadingPattern->createMesh(stretchedSettings, &cms, intent, &reporter, nullptr), QTransform()));
+    QVERIFY(cache.getMemoryConsumptionEstimate() > zoomedMemoryConsumption);
+
+    // Mesh exceeding the cache limit is not stored
+    cache.setCacheLimit(memoryConsumption / 2);
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(0));
+    QVERIFY(isSameMesh(cache.getMesh(shadingPattern, settings, &cms, intent, &reporter, nullptr), expectedMesh, QTransform()));
+    QCOMPARE(cache.getMemoryConsumptionEstimate(), qint64(0));
+}
+
+void LexicalAnalyzerTest::test_optional_content_draw_time()
+{
+    // Page content (optional content in the comment):
+    //  - red rectangle [0, 10] in the group 6
+    //  - green rectangle [20, 30] in the membership dictionary 8 (groups 6 and 7 are on)
+    //  - blue rectangle [40, 50] in the form in the group 7
+    //  - clip [60, 70] in the group 7 and black rectangle [60, 80] after it
+    const QByteArray formContent = "0 0 1 rg 40 0 10 10 re f";
+    const QByteArray content = "/OC /MC0 BDC 1 0 0 rg 0 0 10 10 re f EMC "
+                               "/OC /MC1 BDC 0 1 0 rg 20 0 10 10 re f EMC "
+                               "/Fm0 Do "
+                               "q /OC /MC2 BDC 60 0 10 10 re W n EMC 0 0 0 rg 60 0 20 10 re f Q";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R /OCProperties << /OCGs [6 0 R 7 0 R] /D << /ON [6 0 R 7 0 R] >> >> >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 100 10] /Contents 4 0 R "
+                      "/Resources << /XObject << /Fm0 5 0 R >> /Properties << /MC0 6 0 R /MC1 8 0 R /MC2 7 0 R >> >> >>");
+    objects.push_back("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    objects.push_back("<< /Type /XObject /Subtype /Form /BBox [0 0 100 10] /OC 7 0 R /Length " + QByteArray::number(formContent.size()) + " >>\nstream\n" + formContent + "\nendstream");
+    objects.push_back("<< /Type /OCG /Name (Layer 1) >>");
+    objects.push_back("<< /Type /OCG /Name (Layer 2) >>");
+    objects.push_back("<< /Type /OCMD /OCGs [6 0 R 7 0 R] /P /AllOn >>");
+    pdf::PDFDocument document = createDocument(objects);
+
+    const pdf::PDFObjectReference layer1(6, 0);
+    const pdf::PDFObjectReference layer2(7, 0);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    pdf::PDFOptionalContentActivity optionalContentActivity(&document, pdf::OCUsage::View, nullptr);
+
+    auto compile = [&](const pdf::PDFOptionalContentActivity* activity)
+    {
+        pdf::PDFPrecompiledPage page;
+        pdf::PDFPrecompiledPageGenerator generator(&page, pdf::PDFRenderer::getDefaultFeatures(), document.getCatalog()->getPage(0), &document, &fontCache, &cms, activity, meshQualitySettings, QTransform());
+        page.finalize(0, generator.processContents());
+        return page;
+    };
+
+    auto draw = [](const pdf::PDFPrecompiledPage& page)
+    {
+        QImage image(100, 10, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        page.draw(&painter, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor());
+        painter.end();
+        return image;
+    };
+
+    // Returns colors at the centers of the red, green, blue rectangles and colors inside/outside of the clip
+    auto getColors = [](const QImage& image)
+    {
+        return std::vector<QRgb>{ image.pixel(5, 5), image.pixel(25, 5), image.pixel(45, 5), image.pixel(65, 5), image.pixel(75, 5) };
+    };
+
+    const QRgb white = qRgb(255, 255, 255);
+    const QRgb red = qRgb(255, 0, 0);
+    const QRgb green = qRgb(0, 255, 0);
+    const QRgb blue = qRgb(0, 0, 255);
+    const QRgb black = qRgb(0, 0, 0);
+
+    // Page is compiled only once, when second layer is off, so page doesn't depend on the state
+    optionalContentActivity.setState(layer2, pdf::OCState::OFF);
+    pdf::PDFPrecompiledPage page = compile(&optionalContentActivity);
+    QVERIFY(page.getErrors().isEmpty());
+    QVERIFY(page.getOptionalContentActivity() == &optionalContentActivity);
+
+    // Clip in the hidden optional content is still applied
+    QCOMPARE(getColors(draw(page)), (std::vector<QRgb>{ red, white, white, black, white }));
+
+    optionalContentActivity.setState(layer2, pdf::OCState::ON);
+    const std::vector<QRgb> allColors{ red, green, blue, black, white };
+    QCOMPARE(getColors(draw(page)), allColors);
+
+    optionalContentActivity.setState(layer1, pdf::OCState::OFF);
+    QCOMPARE(getColors(draw(page)), (std::vector<QRgb>{ white, white, blue, black, white }));
+
+    // Without optional content activity, all content is painted
+    pdf::PDFPrecompiledPage pageWithoutOptionalContent = compile(nullptr);
+    QVERIFY(!pageWithoutOptionalContent.getOptionalContentActivity());
+    QCOMPARE(getColors(draw(pageWithoutOptionalContent)), allColors);
+}
+
+void LexicalAnalyzerTest::test_rasterizer_pool_pipeline()
+{
+    // Each page is filled with its own gray level
+    const int pageCount = 12;
+
+    QByteArray kids;
+    for (int i = 0; i < pageCount; ++i)
+    {
+        kids += QByteArray::number(3 + 2 * i) + " 0 R ";
+    }
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [" + kids + "] /Count " + QByteArray::number(pageCount) + " >>");
+    for (int i = 0; i < pageCount; ++i)
+    {
+        const QByteArray content = QByteArray::number(i / pdf::PDFReal(pageCount - 1)) + " g 0 0 20 20 re f";
+        objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 20 20] /Contents " + QByteArray::number(4 + 2 * i) + " 0 R >>");
+        objects.push_back("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    }
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+    pdf::PDFCMSManager cmsManager(nullptr);
+    cmsManager.setDocument(&document);
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    pdf::PDFRasterizerPool rasterizerPool(&document, &fontCache, &cmsManager, nullptr, pdf::PDFRenderer::getDefaultFeatures(), meshQualitySettings, 2, pdf::RendererEngine::QPainter, nullptr);
+
+    // Page 100 doesn't exist, so it is skipped. Page 3 is rendered twice.
+    const std::vector<pdf::PDFInteger> pageIndices = { 5, 0, 11, 3, 100, 3, 7, 1, 2, 4, 6, 8, 9, 10 };
+    std::vector<pdf::PDFInteger> expectedPageIndices = pageIndices;
+    expectedPageIndices.erase(std::remove(expectedPageIndices.begin(), expectedPageIndices.end(), 100), expectedPageIndices.end());
+
+    auto getExpectedGray = [](pdf::PDFInteger pageIndex)
+    {
+        return qRound(255.0 * pageIndex / pdf::PDFReal(pageCount - 1));
+    };
+    auto getImageSize = [](const pdf::PDFPage*) { return QSize(20, 20); };
+
+    pdf::PDFRasterizerPipelineSettings settings;
+    settings.compileThreadCount = 2;
+    settings.encodeThreadCount = 3;
+    settings.maxPagesInFlight = 4;
+
+    std::atomic_int encodedPageCount = 0;
+    std::atomic_int writtenPageCount = 0;
+    std::atomic_bool isPagesInFlightExceeded = false;
+    std::vector<pdf::PDFInteger> writtenPageIndices;
+    bool isWrittenImageValid = true;
+
+    // Encoding takes different time for each page, so pages are encoded
+    // in arbitrary order, but they must be written in the requested order.
+    auto encodeImage = [&](pdf::PDFRenderedPageImage& renderedPageImage)
+    {
+        QThread::msleep((pageCount - renderedPageImage.pageIndex) % 4 * 5);
+        renderedPageImage.encodedImage = QByteArray::number(qGray(renderedPageImage.pageImage.pixel(10, 10)));
+
+        if (++encodedPageCount - writtenPageCount > settings.maxPagesInFlight)
+        {
+            isPagesInFlightExceeded = true;
+        }
+    };
+
+    auto writeImage = [&](pdf::PDFRenderedPageImage& renderedPageImage)
+    {
+        const int gray = renderedPageImage.encodedImage.toInt();
+        isWrittenImageValid = isWrittenImageValid &&
+                              !renderedPageImage.encodedImage.isEmpty() &&
+                              qAbs(gray - getExpectedGray(renderedPageImage.pageIndex)) <= 1 &&
+                              renderedPageImage.pageTotalTime >= renderedPageImage.pageEncodeTime;
+        writtenPageIndices.push_back(renderedPageImage.pageIndex);
+        ++writtenPageCount;
+    };
+
+    rasterizerPool.render(pageIndices, getImageSize, encodeImage, writeImage, settings, nullptr);
+    QCOMPARE(writtenPageIndices, expectedPageIndices);
+    QCOMPARE(encodedPageCount.load(), int(expectedPageIndices.size()));
+    QVERIFY(isWrittenImageValid);
+    QVERIFY(!isPagesInFlightExceeded);
+
+    // Processing method of the simple overload is called for all pages
+    std::atomic_int processedPageCount = 0;
+    std::atomic_bool isProcessedImageValid = true;
+    auto processImage = [&](pdf::PDFRenderedPageImage& renderedPageImage)
+    {
+        if (qAbs(qGray(renderedPageImage.pageImage.pixel(10, 10)) - getExpectedGray(renderedPageImage.pageIndex)) > 1)
+        {
+            isProcessedImageValid = false;
+        }
+        ++processedPageCount;
+    };
+    rasterizerPool.render(pageIndices, getImageSize, processImage, nullptr);
+    QCOMPARE(processedPageCount.load(), int(expectedPageIndices.size()));
+    QVERIFY(isProcessedImageValid);
+}
+
+void LexicalAnalyzerTest::test_annotation_manager_shared()
+{
+    // Even pages have annotation with its own gray level, odd pages have no annotation
+    const int pageCount = 8;
+    std::vector<QByteArray> appearanceColors;
+    for (int i = 0; i < pageCount; ++i)
+    {
+        appearanceColors.push_back(i % 2 == 0 ? QByteArray::number(i * 0.1) + " g" : QByteArray());
+    }
+    pdf::PDFDocument document = createAnnotationDocument(appearanceColors);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+    pdf::PDFCMSManager cmsManager(nullptr);
+    cmsManager.setDocument(&document);
+    pdf::PDFOptionalContentActivity optionalContentActivity(&document, pdf::OCUsage::Print, nullptr);
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    const pdf::PDFRenderer::Features features = pdf::PDFRenderer::getDefaultFeatures();
+
+    // Annotations of the page are parsed only once, also when
+    // page annotations are requested from multiple threads.
+    pdf::PDFAnnotationManager annotationManager(&fontCache, &cmsManager, &optionalContentActivity, meshQualitySettings, features, pdf::PDFAnnotationManager::Target::Print, nullptr);
+    annotationManager.setDocument(pdf::PDFModifiedDocument(&document, &optionalContentActivity));
+    const pdf::PDFAnnotationManager& sharedAnnotationManager = annotationManager;
+
+    std::vector<size_t> requests(pageCount * 16, 0);
+    std::iota(requests.begin(), requests.end(), 0);
+    std::vector<const pdf::PDFAnnotationManager::PageAnnotations*> pageAnnotations(requests.size(), nullptr);
+    pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Page, requests.cbegin(), requests.cend(), [&](size_t request)
+    {
+        pageAnnotations[request] = &sharedAnnotationManager.getPageAnnotations(pdf::PDFInteger(request % pageCount));
+    });
+
+    for (size_t request = 0; request < requests.size(); ++request)
+    {
+        const pdf::PDFInteger pageIndex = pdf::PDFInteger(request % pageCount);
+        QVERIFY(pageAnnotations[request] == &sharedAnnotationManager.getPageAnnotations(pageIndex));
+        QCOMPARE(pageAnnotations[request]->annotations.size(), size_t(pageIndex % 2 == 0 ? 1 : 0));
+    }
+
+    // Pages rendered in parallel by the rasterizer pool share one annotation manager
+    pdf::PDFRasterizerPool rasterizerPool(&document, &fontCache, &cmsManager, &optionalContentActivity, features, meshQualitySettings, 4, pdf::RendererEngine::QPainter, nullptr);
+
+    std::vector<pdf::PDFInteger> pageIndices;
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+        {
+            pageIndices.push_back(pageIndex);
+        }
+    }
+
+    std::atomic_int renderedPageCount = 0;
+    std::atomic_bool isAnnotationDrawnCorrectly = true;
+    auto processImage = [&](pdf::PDFRenderedPageImage& renderedPageImage)
+    {
+        const pdf::PDFInteger pageIndex = renderedPageImage.pageIndex;
+        const int expectedGray = pageIndex % 2 == 0 ? qRound(pageIndex * 0.1 * 255.0) : 255;
+        const QImage& image = renderedPageImage.pageImage;
+
+        if (qAbs(qGray(image.pixel(20, 20)) - expectedGray) > 1 || qGray(image.pixel(5, 5)) != 255)
+        {
+            isAnnotationDrawnCorrectly = false;
+        }
+        ++renderedPageCount;
+    };
+
+    rasterizerPool.render(pageIndices, [](const pdf::PDFPage*) { return QSize(40, 40); }, processImage, nullptr);
+    QCOMPARE(renderedPageCount.load(), int(pageIndices.size()));
+    QVERIFY(isAnnotationDrawnCorrectly);
+}
+
+void LexicalAnalyzerTest::test_annotation_appearance_cache()
+{
+    // Second document differs only in the color of the appearance stream
+    pdf::PDFDocument document = createAnnotationDocument({ "1 0 0 rg" });
+    pdf::PDFDocument changedDocument = createAnnotationDocument({ "0 0 1 rg" });
+
+    pdf::PDFFontCache fontCache(8, 8);
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+    pdf::PDFCMSManager cmsManager(nullptr);
+    pdf::PDFOptionalContentActivity optionalContentActivity(&document, pdf::OCUsage::View, nullptr);
+    const pdf::PDFRenderer::Features features = pdf::PDFRenderer::getDefaultFeatures();
+
+    pdf::PDFAnnotationManager annotationManager(&fontCache, &cmsManager, &optionalContentActivity, pdf::PDFMeshQualitySettings(), features, pdf::PDFAnnotationManager::Target::Print, nullptr);
+    annotationManager.setDocument(pdf::PDFModifiedDocument(&document, &optionalContentActivity));
+
+    // Draws annotations of the page into image of given size and returns color in the center of the annotation
+    auto drawAnnotations = [&](int size)
+    {
+        QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+
+        QList<pdf::PDFRenderError> errors;
+        pdf::PDFTextLayoutGetter textLayoutGetter(nullptr, 0);
+        const QTransform matrix = pdf::PDFRenderer::createPagePointToDevicePointMatrix(document.getCatalog()->getPage(0), QRectF(0, 0, size, size));
+
+        QPainter painter(&image);
+        annotationManager.drawPage(&painter, 0, nullptr, textLayoutGetter, matrix, pdf::PDFColorConvertor(), errors);
+        painter.end();
+        return image.pixel(size / 2, size / 2);
+    };
+
+    auto getCompiledAppearances = [&]() -> const auto&
+    {
+        return annotationManager.getPageAnnotations(0).annotations.front().compiledAppearances;
+    };
+    auto getCompiledAppearance = [&]()
+    {
+        auto it = getCompiledAppearances().find(pdf::PDFAppeareanceStreams::Appearance::Normal);
+        return it != getCompiledAppearances().cend() ? it->second : nullptr;
+    };
+
+    const QRgb red = qRgb(255, 0, 0);
+    const QRgb blue = qRgb(0, 0, 255);
+
+    // Appearance stream is compiled, when annotation is drawn for the first time
+    QVERIFY(getCompiledAppearances().empty());
+    QCOMPARE(drawAnnotations(40), red);
+    std::shared_ptr<const pdf::PDFPrecompiledPage> compiledAppearance = getCompiledAppearance();
+    QVERIFY(compiledAppearance);
+    QCOMPARE(getCompiledAppearances().size(), size_t(1));
+
+    // Drawing again or zooming reuses compiled appearance stream
+    QCOMPARE(drawAnnotations(40), red);
+    QCOMPARE(drawAnnotations(100), red);
+    QVERIFY(getCompiledAppearance() == compiledAppearance);
+
+    // Changing of renderer features invalidates compiled appearance streams
+    annotationManager.setFeatures(features | pdf::PDFRenderer::SmoothImages);
+    QVERIFY(getCompiledAppearances().empty());
+    annotationManager.setFeatures(features);
+    QCOMPARE(drawAnnotations(40), red);
+    QVERIFY(getCompiledAppearance() != compiledAppearance);
+    compiledAppearance = getCompiledAppearance();
+
+    annotationManager.invalidateCompiledAppearances();
+    QVERIFY(getCompiledAppearances().empty());
+    QCOMPARE(drawAnnotations(40), red);
+    compiledAppearance = getCompiledAppearance();
+
+    // Document change without annotation change keeps annotations,
+    // but appearance streams must be compiled again.
+    const pdf::PDFAnnotationManager::PageAnnotations* pageAnnotations = &annotationManager.getPageAnnotations(0);
+    annotationManager.setDocument(pdf::PDFModifiedDocument(&changedDocument, &optionalContentActivity, pdf::PDFModifiedDocument::None));
+    QVERIFY(&annotationManager.getPageAnnotations(0) == pageAnnotations);
+    QVERIFY(getCompiledAppearances().empty());
+    QCOMPARE(drawAnnotations(40), red);
+    QVERIFY(getCompiledAppearance() != compiledAppearance);
+
+    // Changed annotations are parsed again, so new appearance stream is used
+    annotationManager.setDocument(pdf::PDFModifiedDocument(&document, &optionalContentActivity, pdf::PDFModifiedDocument::None));
+    annotationManager.setDocument(pdf::PDFModifiedDocument(&changedDocument, &optionalContentActivity, pdf::PDFModifiedDocument::Annotation));
+    QVERIFY(getCompiledAppearances().empty());
+    QCOMPARE(drawAnnotations(40), blue);
+}
+
+void LexicalAnalyzerTest::test_transparency_band_rendering()
+{
+    // Page content crosses band boundaries: transparent fill, stroke with miter joins,
+    // multiply blend mode, image spanning several bands, small image lying in one band
+    // only (it is skipped by other bands) and form with knockout transparency group.
+    QByteArray imageData;
+    for (int i = 0; i < 16; ++i)
+    {
+        const char color[3] = { char(i * 16), char(255 - i * 16), char((i % 4) * 64) };
+        imageData += QByteArray(color, 3).toHex();
+    }
+    imageData += ">";
+
+    const QByteArray formContent = "/GS0 gs 0 1 0 rg 50 5 40 40 re f 60 15 40 40 re f";
+    const QByteArray content = "q /GS0 gs 0.5 g 10 10 80 30 re f Q "
+                               "q 1 0 0 RG 4 w 2 J 0 j 10 M 20 20 m 80 90 l 30 60 l S Q "
+                               "q /GS1 gs 0 0 1 rg 30 30 40 40 re f Q "
+                               "q 40 0 0 40 5 55 cm /Im0 Do Q "
+                               "q 10 0 0 10 85 85 cm /Im0 Do Q "
+                               "/Fm0 Do";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 100 100] /Contents 4 0 R "
+                      "/Resources << /ExtGState << /GS0 7 0 R /GS1 8 0 R >> /XObject << /Im0 5 0 R /Fm0 6 0 R >> >> >>");
+    objects.push_back("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    objects.push_back("<< /Type /XObject /Subtype /Image /Width 4 /Height 4 /ColorSpace /DeviceRGB /BitsPerComponent 8 /Filter /ASCIIHexDecode "
+                      "/Length " + QByteArray::number(imageData.size()) + " >>\nstream\n" + imageData + "\nendstream");
+    objects.push_back("<< /Type /XObject /Subtype /Form /BBox [0 0 100 100] /Group << /S /Transparency /K true >> /Resources << /ExtGState << /GS0 7 0 R >> >> "
+                      "/Length " + QByteArray::number(formContent.size()) + " >>\nstream\n" + formContent + "\nendstream");
+    objects.push_back("<< /Type /ExtGState /ca 0.5 /CA 0.5 >>");
+    objects.push_back("<< /Type /ExtGState /BM /Multiply /ca 0.8 >>");
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+    pdf::PDFCMSManager cmsManager(nullptr);
+    cmsManager.setDocument(&document);
+    pdf::PDFCMSPointer cms = cmsManager.getCurrentCMS();
+    pdf::PDFInkMapper inkMapper(&cmsManager, &document);
+    inkMapper.createSpotColors(false);
+
+    const pdf::PDFPage* page = document.getCatalog()->getPage(0);
+    const QSize imageSize(100, 100);
+    const QTransform pagePointToDevicePointMatrix = pdf::PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize));
+
+    auto render = [&](bool useBands, QList<pdf::PDFRenderError>& errors)
+    {
+        pdf::PDFTransparencyRendererSettings settings;
+        settings.minimalBandHeight = 8;
+        settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::BandParallelRendering, useBands);
+
+        pdf::PDFTransparencyBandRenderer renderer(page, &document, &fontCache, cms.data(), nullptr, &inkMapper, settings, pagePointToDevicePointMatrix);
+        errors = renderer.render(imageSize);
+        return renderer.toImage(false, true, pdf::PDFRGB{ 1.0f, 1.0f, 1.0f });
+    };
+
+    // Page is divided into six bands, last band is smaller than the others
+    const int maxThreadCount = pdf::PDFExecutionPolicy::getMaxThreadCount(pdf::PDFExecutionPolicy::Scope::Page);
+    pdf::PDFExecutionPolicy::setMaxThreadCount(pdf::PDFExecutionPolicy::Scope::Page, 6);
+    QList<pdf::PDFRenderError> bandErrors;
+    QImage bandImage = render(true, bandErrors);
+    pdf::PDFExecutionPolicy::setMaxThreadCount(pdf::PDFExecutionPolicy::Scope::Page, maxThreadCount);
+
+    QList<pdf::PDFRenderError> errors;
+    QImage image = render(false, errors);
+
+    QVERIFY(!image.isNull());
+    QCOMPARE(bandImage.size(), image.size());
+    QCOMPARE(bandImage.format(), image.format());
+    QCOMPARE(bandErrors.size(), errors.size());
+
+    // Band renderer samples paths in shifted device space, so sample
+    // lying exactly on the path edge can be evaluated differently.
+    int maxDifference = 0;
+    int differentPixelCount = 0;
+    for (int y = 0; y < image.height(); ++y)
+    {
+        for (int x = 0; x < image.width(); ++x)
+        {
+            const QRgb pixel = image.pixel(x, y);
+            const QRgb bandPixel = bandImage.pixel(x, y);
+            const int difference = qMax(qMax(qAbs(qRed(pixel) - qRed(bandPixel)), qAbs(qGreen(pixel) - qGreen(bandPixel))), qAbs(qBlue(pixel) - qBlue(bandPixel)));
+            maxDifference = qMax(maxDifference, difference);
+            differentPixelCount += difference > 2 ? 1 : 0;
+        }
+    }
+
+    QVERIFY2(maxDifference <= 255 / 16 + 2, qPrintable(QString("Maximal difference is %1.").arg(maxDifference)));
+    QVERIFY2(differentPixelCount <= image.width() * image.height() / 100, qPrintable(QString("%1 pixels differ.").arg(differentPixelCount)));
+
+    // Content is really painted (small image in the top right corner and the gray rectangle)
+    QVERIFY(image.pixel(90, 10) != qRgb(255, 255, 255));
+    QVERIFY(image.pixel(15, 75) != qRgb(255, 255, 255));
+
+    // Image is removed from the shared cache, when all renderers requested or skipped it
+    pdf::PDFTransparencyImageCache imageCache;
+    imageCache.reset(3);
+    int createdImageCount = 0;
+    auto createImage = [&createdImageCount]()
+    {
+        ++createdImageCount;
+        return pdf::PDFTransparencyImageCache::Image();
+    };
+
+    pdf::PDFTransparencyImageCache::Key key;
+    imageCache.skipImage(key);
+    imageCache.getImage(key, createImage);
+    imageCache.getImage(key, createImage);
+    QCOMPARE(createdImageCount, 1);
+    imageCache.getImage(key, createImage);
+    QCOMPARE(createdImageCount, 2);
+}
+
+void LexicalAnalyzerTest::test_fixed_point_blend_accuracy()
+{
+    // Blending of bitmaps in fixed point storage is compared with blending in float
+    // storage. Colors have 8-bit precision, so they are represented exactly in both
+    // storages, and results must agree within documented tolerance. Non-separable
+    // blend mode is blended in float storage, even if target is in fixed point storage.
+    constexpr size_t width = 37;
+    constexpr size_t height = 5;
+    constexpr pdf::PDFColorComponent tolerance = 1.0e-3f;
+
+    std::mt19937 generator(0x5678);
+    std::uniform_int_distribution<int> colorDistribution(0, 255);
+    std::uniform_real_distribution<pdf::PDFColorComponent> alphaDistribution(0.1f, 1.0f);
+    std::uniform_int_distribution<uint32_t> maskDistribution(0, pdf::PDFPixelFormat::getAllColorsMask());
+
+    auto createBitmap = [&](pdf::PDFPixelFormat format)
+    {
+        pdf::PDFFloatBitmap bitmap(width, height, format);
+        for (size_t y = 0; y < height; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                pdf::PDFColorBuffer pixel = bitmap.getPixel(x, y);
+                for (uint8_t i = format.getColorChannelIndexStart(); i < format.getColorChannelIndexEnd(); ++i)
+                {
+                    pixel[i] = colorDistribution(generator) / 255.0f;
+                }
+                pixel[format.getShapeChannelIndex()] = alphaDistribution(generator);
+                pixel[format.getOpacityChannelIndex()] = alphaDistribution(generator);
+                bitmap.setPixelActiveColorMask(x, y, maskDistribution(generator));
+            }
+        }
+        return bitmap;
+    };
+
+    auto toFixedPoint = [](pdf::PDFFloatBitmap bitmap)
+    {
+        bitmap.setStorage(pdf::PDFFloatBitmap::Storage::FixedPoint16);
+        return bitmap;
+    };
+
+    const std::vector<pdf::PDFPixelFormat> formats = {
+        pdf::PDFPixelFormat::createFormat(3, 0, true, false, true),
+        pdf::PDFPixelFormat::createFormat(4, 2, true, true, true)
+    };
+
+    const std::vector<pdf::BlendMode> modes = { pdf::BlendMode::Normal, pdf::BlendMode::Multiply, pdf::BlendMode::Screen, pdf::BlendMode::Overlay,
+                                                pdf::BlendMode::Darken, pdf::BlendMode::Lighten, pdf::BlendMode::ColorDodge, pdf::BlendMode::ColorBurn,
+                                                pdf::BlendMode::HardLight, pdf::BlendMode::SoftLight, pdf::BlendMode::Difference, pdf::BlendMode::Exclusion,
+                                                pdf::BlendMode::Luminosity };
+
+    pdf::PDFFloatBitmap softMask(width, height, pdf::PDFPixelFormat::createOpacityMask());
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            softMask.getPixel(x, y)[0] = alphaDistribution(generator);
+        }
+    }
+    const pdf::PDFFloatBitmap fixedPointSoftMask = toFixedPoint(softMask);
+
+    const QRect blendRegion(1, 1, int(width) - 2, int(height) - 2);
+
+    for (const pdf::PDFPixelFormat format : formats)
+    {
+        for (pdf::BlendMode mode : modes)
+        {
+            for (int variant = 0; variant < 16; ++variant)
+            {
+                const bool knockoutGroup = variant & 1;
+                const bool alphaIsShape = variant & 2;
+                const bool isolated = variant & 4;
+                const bool isSourceFixedPoint = variant & 8;
+
+                pdf::PDFFloatBitmap source = createBitmap(format);
+                pdf::PDFFloatBitmap initialBackdrop = createBitmap(format);
+                pdf::PDFFloatBitmap target = createBitmap(format);
+
+                if (isolated)
+                {
+                    initialBackdrop.makeTransparent();
+                }
+
+                pdf::PDFFloatBitmap fixedPointSource = isSourceFixedPoint ? toFixedPoint(source) : source;
+                pdf::PDFFloatBitmap fixedPointInitialBackdrop = toFixedPoint(initialBackdrop);
+                pdf::PDFFloatBitmap fixedPointTarget = toFixedPoint(target);
+
+                // As in the transparency renderer, backdrop is the initial backdrop
+                // for knockout groups, otherwise it is the target itself.
+                pdf::PDFFloatBitmap::blend(source, target, knockoutGroup ? initialBackdrop : target, initialBackdrop, softMask,
+                                           alphaIsShape, 0.7f, mode, knockoutGroup, pdf::PDFFloatBitmap::OverprintMode::NoOveprint, blendRegion);
+                pdf::PDFFloatBitmap::blend(fixedPointSource, fixedPointTarget, knockoutGroup ? fixedPointInitialBackdrop : fixedPointTarget, fixedPointInitialBackdrop, fixedPointSoftMask,
+                                           alphaIsShape, 0.7f, mode, knockoutGroup, pdf::PDFFloatBitmap::OverprintMode::NoOveprint, blendRegion);
+
+                QVERIFY(fixedPointTarget.getStorage() == pdf::PDFFloatBitmap::Storage::FixedPoint16);
+                fixedPointTarget.setStorage(pdf::PDFFloatBitmap::Storage::Float);
+
+                for (size_t y = 0; y < height; ++y)
+                {
+                    for (size_t x = 0; x < width; ++x)
+                    {
+                        pdf::PDFConstColorBuffer pixel = target.getPixel(x, y);
+                        pdf::PDFConstColorBuffer fixedPointPixel = fixedPointTarget.getPixel(x, y);
+
+                        for (size_t i = 0; i < pixel.size(); ++i)
+                        {
+                            QVERIFY2(qAbs(pixel[i] - fixedPointPixel[i]) <= tolerance,
+                                     qPrintable(QString("Mode %1, variant %2, pixel (%3, %4), channel %5: %6 != %7.").arg(int(mode)).arg(variant).arg(x).arg(y).arg(i).arg(pixel[i]).arg(fixedPointPixel[i])));
+                        }
+
+                        QCOMPARE(fixedPointTarget.getPixelActiveColorMask(x, y), target.getPixelActiveColorMask(x, y));
+                    }
+                }
+            }
+        }
+    }
+
+    // Conversion between storages keeps values with 8-bit precision exactly
+    pdf::PDFFloatBitmap bitmap = createBitmap(formats.back());
+    pdf::PDFFloatBitmap convertedBitmap = toFixedPoint(bitmap);
+    convertedBitmap.setStorage(pdf::PDFFloatBitmap::Storage::Float);
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            pdf::PDFConstColorBuffer pixel = bitmap.getPixel(x, y);
+            pdf::PDFConstColorBuffer convertedPixel = convertedBitmap.getPixel(x, y);
+
+            for (size_t i = 0; i < pixel.size(); ++i)
+            {
+                QVERIFY(qRound(pixel[i] * 255.0f) == qRound(convertedPixel[i] * 255.0f));
+                QVERIFY(qAbs(pixel[i] - convertedPixel[i]) <= 1.0f / 65535.0f);
+            }
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_fixed_point_blending_rendering()
+{
+    // Page with blend modes, soft mask, knockout group and isolated group is rendered
+    // with float blending and with fixed point blending, results must be the same
+    // up to small rounding differences.
+    const QByteArray content = "q /GS0 gs 0.5 g 10 10 80 30 re f Q "
+                               "q /GS1 gs 0 0 1 rg 30 30 40 40 re f Q "
+                               "q /GS2 gs 1 0 0 rg 20 50 60 40 re f Q "
+                               "/Fm0 Do "
+                               "q /GS3 gs /Fm1 Do Q";
+    const QByteArray knockoutFormContent = "/GS0 gs 0 1 0 rg 50 5 40 40 re f 60 15 40 40 re f";
+    const QByteArray isolatedFormContent = "0 0 1 rg 5 60 50 30 re f /GS4 gs 1 1 0 rg 25 70 50 25 re f";
+    const QByteArray softMaskFormContent = "0.6 g 0 0 50 100 re f 1 g 50 0 50 100 re f";
+
+    auto createStream = [](const QByteArray& dictionary, const QByteArray& data)
+    {
+        return "<< " + dictionary + " /Length " + QByteArray::number(data.size()) + " >>\nstream\n" + data + "\nendstream";
+    };
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 100 100] /Contents 4 0 R "
+                      "/Resources << /ExtGState << /GS0 7 0 R /GS1 8 0 R /GS2 9 0 R /GS3 11 0 R >> /XObject << /Fm0 5 0 R /Fm1 6 0 R >> >> >>");
+    objects.push_back(createStream("", content));
+    objects.push_back(createStream("/Type /XObject /Subtype /Form /BBox [0 0 100 100] /Group << /S /Transparency /K true >> /Resources << /ExtGState << /GS0 7 0 R >> >>", knockoutFormContent));
+    objects.push_back(createStream("/Type /XObject /Subtype /Form /BBox [0 0 100 100] /Group << /S /Transparency /I true >> /Resources << /ExtGState << /GS4 12 0 R >> >>", isolatedFormContent));
+    objects.push_back("<< /Type /ExtGState /ca 0.5 /CA 0.5 >>");
+    objects.push_back("<< /Type /ExtGState /BM /Multiply /ca 0.8 >>");
+    objects.push_back("<< /Type /ExtGState /BM /Screen /SMask << /Type /Mask /S /Luminosity /G 10 0 R >> >>");
+    objects.push_back(createStream("/Type /XObject /Subtype /Form /BBox [0 0 100 100] /Group << /S /Transparency /CS /DeviceGray >>", softMaskFormContent));
+    objects.push_back("<< /Type /ExtGState /ca 0.7 >>");
+    objects.push_back("<< /Type /ExtGState /BM /Overlay /ca 0.6 >>");
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+    pdf::PDFCMSManager cmsManager(nullptr);
+    cmsManager.setDocument(&document);
+    pdf::PDFCMSPointer cms = cmsManager.getCurrentCMS();
+    pdf::PDFInkMapper inkMapper(&cmsManager, &document);
+    inkMapper.createSpotColors(false);
+
+    const pdf::PDFPage* page = document.getCatalog()->getPage(0);
+    const QSize imageSize(100, 100);
+    const QTransform pagePointToDevicePointMatrix = pdf::PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize));
+
+    auto render = [&](bool useFixedPoint, QList<pdf::PDFRenderError>& errors)
+    {
+        pdf::PDFTransparencyRendererSettings settings;
+        settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::FixedPointBlending, useFixedPoint);
+
+        pdf::PDFTransparencyBandRenderer renderer(page, &document, &fontCache, cms.data(), nullptr, &inkMapper, settings, pagePointToDevicePointMatrix);
+        errors = renderer.render(imageSize);
+        return renderer.toImage(false, true, pdf::PDFRGB{ 1.0f, 1.0f, 1.0f });
+    };
+
+    QList<pdf::PDFRenderError> errors;
+    QList<pdf::PDFRenderError> fixedPointErrors;
+    QImage image = render(false, errors);
+    QImage fixedPointImage = render(true, fixedPointErrors);
+
+    QVERIFY(!image.isNull());
+    QCOMPARE(fixedPointImage.size(), image.size());
+    QCOMPARE(fixedPointImage.format(), image.format());
+    QCOMPARE(fixedPointErrors.size(), errors.size());
+
+    int maxDifference = 0;
+    for (int y = 0; y < image.height(); ++y)
+    {
+        for (int x = 0; x < image.width(); ++x)
+        {
+            const QRgb pixel = image.pixel(x, y);
+            const QRgb fixedPointPixel = fixedPointImage.pixel(x, y);
+            maxDifference = qMax(maxDifference, qAbs(qRed(pixel) - qRed(fixedPointPixel)));
+            maxDifference = qMax(maxDifference, qAbs(qGreen(pixel) - qGreen(fixedPointPixel)));
+            maxDifference = qMax(maxDifference, qAbs(qBlue(pixel) - qBlue(fixedPointPixel)));
+        }
+    }
+
+    QVERIFY2(maxDifference <= 2, qPrintable(QString("Maximal difference is %1.").arg(maxDifference)));
+
+    // Content is really painted (rectangle with soft mask and the gray rectangle)
+    QVERIFY(image.pixel(30, 30) != qRgb(255, 255, 255));
+    QVERIFY(image.pixel(15, 75) != qRgb(255, 255, 255));
+}
+
+void LexicalAnalyzerTest::test_compile_visible_content()
+{
+    // Page has crop box in the left bottom quarter of the media box. First
+    // rectangle is inside the crop box, second one is outside of it.
+    const QByteArray content = "0 0 1 rg 20 20 10 10 re f 150 150 10 10 re f";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 200 200] /CropBox [0 0 100 100] /Contents 4 0 R >>");
+    objects.push_back("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    const pdf::PDFPage* page = document.getCatalog()->getPage(0);
+    const QTransform matrix = pdf::PDFRenderer::createPagePointToDevicePointMatrix(page, QRectF(0, 0, 200, 200));
+
+    auto compileAndDraw = [&](pdf::PDFRenderer::Features features)
+    {
+        pdf::PDFRenderer renderer(&document, &fontCache, &cms, nullptr, features, meshQualitySettings);
+        pdf::PDFPrecompiledPage compiledPage;
+        renderer.compileVisibleContent(&compiledPage, 0);
+
+        // Page is drawn without clipping, so skipped content can be detected
+        QImage image(200, 200, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        compiledPage.draw(&painter, page->getCropBox(), matrix, pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor());
+        painter.end();
+        return image;
+    };
+
+    const QPoint insidePoint = matrix.map(QPointF(25, 25)).toPoint();
+    const QPoint outsidePoint = matrix.map(QPointF(155, 155)).toPoint();
+
+    // Without clipping to the crop box, whole page is compiled
+    QImage fullImage = compileAndDraw(pdf::PDFRenderer::None);
+    QCOMPARE(fullImage.pixel(insidePoint), qRgb(0, 0, 255));
+    QCOMPARE(fullImage.pixel(outsidePoint), qRgb(0, 0, 255));
+
+    // Content outside of the crop box is skipped
+    QImage visibleImage = compileAndDraw(pdf::PDFRenderer::ClipToCropBox);
+    QCOMPARE(visibleImage.pixel(insidePoint), qRgb(0, 0, 255));
+    QCOMPARE(visibleImage.pixel(outsidePoint), qRgb(255, 255, 255));
+}
+
+void LexicalAnalyzerTest::test_form_instancing_color_space()
+{
+    // Form is painted twice with black fill color, first in the indexed color
+    // space, then in the DeviceGray color space. Form sets color index 1,
+    // which is green in the indexed color space and white in the DeviceGray
+    // color space, so the form can't be compiled only once.
+    const QByteArray formContent = "1 sc 0 0 10 10 re f";
+    const QByteArray content = "/CS0 cs 0 sc /Fm0 Do /DeviceGray cs 1 0 0 1 20 0 cm /Fm0 Do";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 40 20] /Contents 4 0 R "
+                      "/Resources << /XObject << /Fm0 5 0 R >> /ColorSpace << /CS0 [/Indexed /DeviceRGB 1 <000000 00FF00>] >> >> >>");
+    objects.push_back("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    objects.push_back("<< /Type /XObject /Subtype /Form /BBox [0 0 10 10] /Length " + QByteArray::number(formContent.size()) + " >>\nstream\n" + formContent + "\nendstream");
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+
+    pdf::PDFPrecompiledPage page;
+    pdf::PDFPrecompiledPageGenerator generator(&page, pdf::PDFRenderer::getDefaultFeatures(), document.getCatalog()->getPage(0), &document, &fontCache, &cms, nullptr, meshQualitySettings, QTransform());
+    page.finalize(0, generator.processContents());
+    QVERIFY(page.getErrors().isEmpty());
+
+    QImage image(40, 20, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::blue);
+    QPainter painter(&image);
+    page.draw(&painter, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor());
+    painter.end();
+
+    QCOMPARE(image.pixel(5, 5), qRgb(0, 255, 0));
+    QCOMPARE(image.pixel(25, 5), qRgb(255, 255, 255));
+}
+
+void LexicalAnalyzerTest::test_form_instancing_snap_images()
+{
+    // Form with image is compiled once and drawn twice, snap info
+    // of the page must contain image of each form instance.
+    const QByteArray formContent = "10 0 0 10 0 0 cm /Im0 Do";
+    const QByteArray content = "/Fm0 Do 1 0 0 1 20 0 cm /Fm0 Do";
+    const QByteArray imageData(1, char(0));
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 40 20] /Contents 4 0 R /Resources << /XObject << /Fm0 5 0 R >> >> >>");
+    objects.push_back("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    objects.push_back("<< /Type /XObject /Subtype /Form /BBox [0 0 10 10] /Resources << /XObject << /Im0 6 0 R >> >> /Length " + QByteArray::number(formContent.size()) + " >>\nstream\n" + formContent + "\nendstream");
+    objects.push_back("<< /Type /XObject /Subtype /Image /Width 1 /Height 1 /ColorSpace /DeviceGray /BitsPerComponent 8 /Length 1 >>\nstream\n" + imageData + "\nendstream");
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+
+    pdf::PDFPrecompiledPage page;
+    pdf::PDFPrecompiledPageGenerator generator(&page, pdf::PDFRenderer::getDefaultFeatures(), document.getCatalog()->getPage(0), &document, &fontCache, &cms, nullptr, meshQualitySettings, QTransform());
+    page.finalize(0, generator.processContents());
+    QVERIFY(page.getErrors().isEmpty());
+    QCOMPARE(page.getInstancedPageCount(), size_t(1));
+
+    const std::vector<pdf::PDFSnapInfo::SnapImage>& snapImages = page.getSnapInfo()->getSnapImages();
+    QCOMPARE(snapImages.size(), size_t(2));
+    QCOMPARE(snapImages[0].imagePath.boundingRect(), QRectF(0, 0, 10, 10));
+    QCOMPARE(snapImages[1].imagePath.boundingRect(), QRectF(20, 0, 10, 10));
+}
+
+void LexicalAnalyzerTest::test_type3_glyph_instancing()
+{
+    // Same Type 3 glyph is drawn with two different font sizes, glyph
+    // is compiled only once and both glyphs are instances of it.
+    const QByteArray glyphContent = "1000 0 0 0 1000 1000 d1 0 0 1000 1000 re f";
+    const QByteArray content = "BT /F1 10 Tf 0 0 Td (a) Tj /F1 20 Tf 20 0 Td (a) Tj ET";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 50 30] /Contents 4 0 R /Resources << /Font << /F1 5 0 R >> >> >>");
+    objects.push_back("<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    objects.push_back("<< /Type /Font /Subtype /Type3 /FontBBox [0 0 1000 1000] /FontMatrix [0.001 0 0 0.001 0 0] /CharProcs << /a 6 0 R >> "
+                      "/Encoding << /Type /Encoding /Differences [97 /a] >> /FirstChar 97 /LastChar 97 /Widths [1000] /Resources << >> >>");
+    objects.push_back("<< /Length " + QByteArray::number(glyphContent.size()) + " >>\nstream\n" + glyphContent + "\nendstream");
+    pdf::PDFDocument document = createDocument(objects);
+
+    pdf::PDFFontCache fontCache(8, 8);
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, nullptr));
+
+    pdf::PDFPrecompiledPage page;
+    pdf::PDFPrecompiledPageGenerator generator(&page, pdf::PDFRenderer::getDefaultFeatures(), document.getCatalog()->getPage(0), &document, &fontCache, &cms, nullptr, meshQualitySettings, QTransform());
+    page.finalize(0, generator.processContents());
+    QVERIFY(page.getErrors().isEmpty());
+    QCOMPARE(page.getInstancedPageCount(), size_t(1));
+
+    // Both glyphs are drawn, each with its own size
+    QImage image(50, 30, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    page.draw(&painter, QRectF(), QTransform(), pdf::PDFRenderer::None, 1.0, pdf::PDFColorConvertor());
+    painter.end();
+
+    QCOMPARE(image.pixel(5, 5), qRgb(0, 0, 0));
+    QCOMPARE(image.pixel(15, 5), qRgb(255, 255, 255));
+    QCOMPARE(image.pixel(25, 15), qRgb(0, 0, 0));
+    QCOMPARE(image.pixel(45, 5), qRgb(255, 255, 255));
+}
+
+void LexicalAnalyzerTest::scanWholeStream(const char* stream)
+{
+    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+
+    // Scan whole stream
+    while (!analyzer.isAtEnd())
+    {
+        analyzer.fetch();
+    }
+}
+
+void LexicalAnalyzerTest::testTokens(const char* stream, const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens)
+{
+    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+
+    std::vector<pdf::PDFLexicalAnalyzer::Token> scanned;
+    scanned.reserve(tokens.size());
+
+    // Scan whole stream
+    while (!analyzer.isAtEnd())
+    {
+        scanned.emplace_back(analyzer.fetch());
+    }
+
+    // Format error message
+    QString actual = getStringFromTokens(scanned);
+    QString expected = getStringFromTokens(tokens);
+
+    // Now, compare scanned tokens
+    QVERIFY2(scanned == tokens, qPrintable(QString("stream: %1, actual = %2, expected = %3").arg(QString(stream), actual, expected)));
+}
+
+QString LexicalAnalyzerTest::getStringFromTokens(const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens)
+{
+    QStringList stringTokens;
+
+    QMetaEnum metaEnum = QMetaEnum::fromType<pdf::PDFLexicalAnalyzer::TokenType>();
+    Q_ASSERT(metaEnum.isValid());
+
+    for (const pdf::PDFLexicalAnalyzer::Token& token : tokens)
+    {
+        QString tokenTypeAsString = metaEnum.valueToKey(static_cast<int>(token.type));
+
+        if (!token.data.isValid())
+        {
+            stringTokens << tokenTypeAsString;
+        }
+        else
+        {
+            stringTokens << QString("%1(%2)").arg(tokenTypeAsString, token.data.toString());
+        }
+    }
+
+    return QString("{ %1 }").arg(stringTokens.join(", "));
+}
+
+pdf::PDFDocument LexicalAnalyzerTest::createDocument(const std::vector<QByteArray>& objects) const
+{
+    QByteArray data = "%PDF-1.7\n";
+    std::vector<int> offsets;
+
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        offsets.push_back(data.size());
+        data += QByteArray::number(int(i + 1)) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+
+    const int xrefOffset = data.size();
+    data += "xref\n0 " + QByteArray::number(int(objects.size() + 1)) + "\n";
+    data += "0000000000 65535 f \n";
+    for (int offset : offsets)
+    {
+        data += QByteArray::number(offset).rightJustified(10, '0') + " 00000 n \n";
+    }
+    data += "trailer\n<< /Size " + QByteArray::number(int(objects.size() + 1)) + " /Root 1 0 R >>\n";
+    data += "startxref\n" + QByteArray::number(xrefOffset) + "\n%%EOF\n";
+
+    pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, true, false);
+    pdf::PDFDocument document = reader.readFromBuffer(data);
+    Q_ASSERT(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    return document;
+}
+
+pdf::PDFDocument LexicalAnalyzerTest::createTilingPatternDocument(int step, const QByteArray& content, const QByteArray& resources) const
+{
+    auto createStream = [](const QByteArray& dictionary, const QByteArray& streamData)
+    {
+        return "<< " + dictionary + " /Length " + QByteArray::number(streamData.size()) + " >>\nstream\n" + streamData + "\nendstream";
+    };
+
+    const QByteArray pageContent = "/Pattern cs /P1 scn 0 0 200 200 re f";
+    const QByteArray stepString = QByteArray::number(step);
+    const QByteArray patternDictionary = "/Type /Pattern /PatternType 1 /PaintType 1 /TilingType 1 /BBox [0 0 " + stepString + " " + stepString + "] /XStep " + stepString + " /YStep " + stepString + " /Resources 6 0 R";
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R /OCProperties << /OCGs [7 0 R] /D << /ON [7 0 R] >> >> >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 200 200] /Resources << /Pattern << /P1 5 0 R >> >> /Contents 4 0 R >>");
+    objects.push_back(createStream(QByteArray(), pageContent));
+    objects.push_back(createStream(patternDictionary, content));
+    objects.push_back(resources);
+    objects.push_back("<< /Type /OCG /Name (Layer) >>");
+    return createDocument(objects);
+}
+
+pdf::PDFDocument LexicalAnalyzerTest::createAnnotationDocument(const std::vector<QByteArray>& appearanceColors) const
+{
+    auto createStream = [](const QByteArray& dictionary, const QByteArray& streamData)
+    {
+        return "<< " + dictionary + " /Length " + QByteArray::number(streamData.size()) + " >>\nstream\n" + streamData + "\nendstream";
+    };
+
+    // Each page uses four objects: page, page content, annotation and appearance stream
+    QByteArray kids;
+    for (size_t i = 0; i < appearanceColors.size(); ++i)
+    {
+        kids += QByteArray::number(int(3 + 4 * i)) + " 0 R ";
+    }
+
+    std::vector<QByteArray> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [" + kids + "] /Count " + QByteArray::number(int(appearanceColors.size())) + " >>");
+    for (size_t i = 0; i < appearanceColors.size(); ++i)
+    {
+        const int pageObject = int(3 + 4 * i);
+        const QByteArray annotations = !appearanceColors[i].isEmpty() ? "/Annots [" + QByteArray::number(pageObject + 2) + " 0 R]" : QByteArray();
+        const QByteArray appearanceContent = appearanceColors[i] + " 0 0 20 20 re f";
+
+        objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 40 40] /Contents " + QByteArray::number(pageObject + 1) + " 0 R " + annotations + " >>");
+        objects.push_back(createStream(QByteArray(), "1 g 0 0 40 40 re f"));
+        objects.push_back("<< /Type /Annot /Subtype /Square /Rect [10 10 30 30] /F 4 /AP << /N " + QByteArray::number(pageObject + 3) + " 0 R >> >>");
+        objects.push_back(createStream("/Type /XObject /Subtype /Form /BBox [0 0 20 20]", appearanceContent));
+    }
+    return createDocument(objects);
+}
+
+std::vector<QImage> LexicalAnalyzerTest::createEncoderTestImages() const
+{
+    std::vector<QImage> images;
+    std::mt19937 generator(0x504E47);
+
+    // Bilevel image
+    QImage bilevelImage(37, 11, QImage::Format_Mono);
+    bilevelImage.fill(1);
+    for (int y = 0; y < bilevelImage.height(); ++y)
+    {
+        for (int x = 0; x < bilevelImage.width(); ++x)
+        {
+            bilevelImage.setPixel(x, y, (x * y + x / 3) % 2);
+        }
+    }
+    images.push_back(bilevelImage);
+
+    auto createImage = [&generator](int width, int height, const std::vector<QRgb>& colors)
+    {
+        QImage image(width, height, QImage::Format_ARGB32);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                image.setPixel(x, y, colors[generator() % colors.size()]);
+            }
+        }
+        return image;
+    };
+
+    auto createColors = [&generator](size_t count, bool isGray, bool hasAlpha)
+    {
+        std::vector<QRgb> colors;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const int red = generator() % 256;
+            const int green = isGray ? red : int(generator() % 256);
+            const int blue = isGray ? red : int(generator() % 256);
+            const int alpha = hasAlpha ? int(generator() % 256) : 255;
+            colors.push_back(qRgba(red, green, blue, alpha));
+        }
+        return colors;
+    };
+
+    // Indexed images - 1, 2 and 4 bit palette with transparency (tRNS), 8 bit opaque palette
+    images.push_back(createImage(13, 5, { qRgba(255, 0, 0, 255), qRgba(0, 0, 255, 128) }));
+    images.push_back(createImage(19, 9, { qRgb(255, 0, 0), qRgb(0, 255, 0), qRgb(0, 0, 255), qRgba(0, 0, 0, 0) }));
+    images.push_back(createImage(21, 7, createColors(12, false, true)));
+    images.push_back(createImage(29, 13, createColors(200, false, false)));
+
+    // Grayscale images, with and without alpha channel
+    images.push_back(createImage(45, 17, createColors(300, true, false)));
+    images.push_back(createImage(23, 15, createColors(300, true, true)));
+
+    QImage grayImage(31, 9, QImage::Format_Grayscale8);
+    for (int y = 0; y < grayImage.height(); ++y)
+    {
+        for (int x = 0; x < grayImage.width(); ++x)
+        {
+            grayImage.setPixel(x, y, qRgb(x * 8, x * 8, x * 8));
+        }
+    }
+    images.push_back(grayImage);
+
+    // Images with color table, which are encoded without conversion to ARGB32 format
+    QImage monoLSBImage = bilevelImage.convertToFormat(QImage::Format_MonoLSB);
+    images.push_back(monoLSBImage);
+
+    QImage coloredMonoImage = bilevelImage;
+    coloredMonoImage.setColorTable({ qRgb(255, 0, 0), qRgba(0, 0, 255, 128) });
+    images.push_back(coloredMonoImage);
+
+    QImage indexedImage(27, 11, QImage::Format_Indexed8);
+    const std::vector<QRgb> indexedColors = createColors(64, false, false);
+    indexedImage.setColorTable(QList<QRgb>(indexedColors.cbegin(), indexedColors.cend()));
+    for (int y = 0; y < indexedImage.height(); ++y)
+    {
+        for (int x = 0; x < indexedImage.width(); ++x)
+        {
+            // Only part of the color table is used
+            indexedImage.setPixel(x, y, (x + y) % 40);
+        }
+    }
+    images.push_back(indexedImage);
+
+    QImage bilevelGrayImage(17, 7, QImage::Format_Grayscale8);
+    for (int y = 0; y < bilevelGrayImage.height(); ++y)
+    {
+        for (int x = 0; x < bilevelGrayImage.width(); ++x)
+        {
+            bilevelGrayImage.setPixel(x, y, ((x + y) % 3 == 0) ? qRgb(0, 0, 0) : qRgb(255, 255, 255));
+        }
+    }
+    images.push_back(bilevelGrayImage);
+
+    // True color images, with and without alpha channel
+    images.push_back(createImage(61, 19, createColors(1000, false, false)));
+    images.push_back(createImage(33, 21, createColors(1000, false, true)));
+
+    return images;
+}
+
+QImage LexicalAnalyzerTest::readImage(const QByteArray& data, const QByteArray& format) const
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer, format);
+    return reader.read();
+}
+
+bool LexicalAnalyzerTest::isSameImage(const QImage& image1, const QImage& image2) const
+{
+    if (image1.size() != image2.size())
+    {
+        return false;
+    }
+
+    QImage convertedImage1 = image1.convertToFormat(QImage::Format_ARGB32);
+    QImage convertedImage2 = image2.convertToFormat(QImage::Format_ARGB32);
+
+    for (int y = 0; y < convertedImage1.height(); ++y)
+    {
+        const QRgb* line1 = reinterpret_cast<const QRgb*>(convertedImage1.constScanLine(y));
+        const QRgb* line2 = reinterpret_cast<const QRgb*>(convertedImage2.constScanLine(y));
+
+        for (int x = 0; x < convertedImage1.width(); ++x)
+        {
+            const QRgb color1 = line1[x];
+            const QRgb color2 = line2[x];
+
+            if (qAlpha(color1) != qAlpha(color2) || (qAlpha(color1) > 0 && qRgb(qRed(color1), qGreen(color1), qBlue(color1)) != qRgb(qRed(color2), qGreen(color2), qBlue(color2))))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
 #ifdef PDF4QT_COMPILER_MSVC